@@ -0,0 +1 @@
+../../../../../LuaOC/Classes/LOArrayVarargs.h
\ No newline at end of file
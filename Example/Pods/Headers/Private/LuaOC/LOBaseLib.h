@@ -0,0 +1 @@
+../../../../../LuaOC/Classes/LOBaseLib.h
\ No newline at end of file
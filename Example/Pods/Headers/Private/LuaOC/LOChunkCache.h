@@ -0,0 +1 @@
+../../../../../LuaOC/Classes/LOChunkCache.h
\ No newline at end of file
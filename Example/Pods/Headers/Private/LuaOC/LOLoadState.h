@@ -0,0 +1 @@
+../../../../../LuaOC/Classes/LOLoadState.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../../../../LuaOC/Classes/LOLua.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../../../../LuaOC/Classes/LOPairVarargs.h
\ No newline at end of file
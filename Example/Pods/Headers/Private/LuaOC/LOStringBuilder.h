@@ -0,0 +1 @@
+../../../../../LuaOC/Classes/LOStringBuilder.h
\ No newline at end of file
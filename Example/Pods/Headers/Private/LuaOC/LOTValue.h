@@ -0,0 +1 @@
+../../../../../LuaOC/Classes/LOTValue.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../../../../LuaOC/Classes/LOCoroutineLib.h
\ No newline at end of file
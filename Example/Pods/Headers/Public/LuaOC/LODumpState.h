@@ -0,0 +1 @@
+../../../../../LuaOC/Classes/LODumpState.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../../../../LuaOC/Classes/LOFrameVarargs.h
\ No newline at end of file
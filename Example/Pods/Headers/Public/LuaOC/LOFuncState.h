@@ -0,0 +1 @@
+../../../../../LuaOC/Classes/LOFuncState.h
\ No newline at end of file
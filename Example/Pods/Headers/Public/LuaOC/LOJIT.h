@@ -0,0 +1 @@
+../../../../../LuaOC/Classes/LOJIT.h
\ No newline at end of file
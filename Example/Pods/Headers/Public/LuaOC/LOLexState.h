@@ -0,0 +1 @@
+../../../../../LuaOC/Classes/LOLexState.h
\ No newline at end of file
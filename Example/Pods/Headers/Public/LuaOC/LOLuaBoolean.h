@@ -0,0 +1 @@
+../../../../../LuaOC/Classes/LOLuaBoolean.h
\ No newline at end of file
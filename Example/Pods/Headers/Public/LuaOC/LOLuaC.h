@@ -0,0 +1 @@
+../../../../../LuaOC/Classes/LOLuaC.h
\ No newline at end of file
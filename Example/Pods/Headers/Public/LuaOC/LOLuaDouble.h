@@ -0,0 +1 @@
+../../../../../LuaOC/Classes/LOLuaDouble.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../../../../LuaOC/Classes/LOLuaNone.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../../../../LuaOC/Classes/LOPrototype.h
\ No newline at end of file
@@ -0,0 +1 @@
+../../../../../LuaOC/Classes/LOUpValue.h
\ No newline at end of file
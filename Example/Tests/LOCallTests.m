@@ -0,0 +1,401 @@
+//
+//  LOCallTests.m
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import "LOTestCase.h"
+#import "LOLuaFunction.h"
+#import "LOLuaThread.h"
+#import "LOLuaError.h"
+#import "LOLuaC.h"
+#import "LOLuaClosure.h"
+#import "LOLuaTable.h"
+
+/** Keeps the arguments of its last call, both as passed and dealiased, and returns them */
+@interface LOKeepArgs : LOLuaFunction
+@property (nonatomic, strong) LOVarargs *window;
+@property (nonatomic, strong) LOVarargs *kept;
+@end
+
+@implementation LOKeepArgs
+
+- (LOVarargs *)invoke:(LOVarargs *)args
+{
+    self.window = args;
+    self.kept = [args dealias];
+    return args;
+}
+
+@end
+
+/** Adds two ints, recording rather than throwing an error on bad arguments */
+@interface LOCheckedAdd : LOLuaFunction
+@end
+
+@implementation LOCheckedAdd
+
+- (LOVarargs *)invoke:(LOVarargs *)args
+{
+    int a, b;
+    if (![args tryCheckInt:1 result:&a] || ![args tryCheckInt:2 result:&b])
+        return LOLuaValue.NONE;
+    return [LOLuaValue valueOfInt:a + b];
+}
+
+@end
+
+/** Raises a lua error */
+@interface LORaise : LOLuaFunction
+@end
+
+@implementation LORaise
+
+- (LOVarargs *)invoke:(LOVarargs *)args
+{
+    return [LOLuaValue error:@"boom"];
+}
+
+@end
+
+/** Calls its first argument through the running thread, pushing a frame for it */
+@interface LOCallThrough : LOLuaFunction
+@end
+
+@implementation LOCallThrough
+
+- (LOVarargs *)invoke:(LOVarargs *)args
+{
+    return [LOLuaThreadCurrent() call:[args arg1] values:NULL count:0];
+}
+
+@end
+
+/** Native functions overriding single call methods, returning which one ran and with what */
+@interface LOCall0 : LOLuaFunction
+@end
+
+@implementation LOCall0
+
+- (LOLuaValue *)call
+{
+    return [LOLuaValue valueOfString:@"call"];
+}
+
+@end
+
+@interface LOCall1 : LOLuaFunction
+@end
+
+@implementation LOCall1
+
+- (LOLuaValue *)call:(LOLuaValue *)arg
+{
+    return [LOLuaValue valueOfString:[NSString stringWithFormat:@"call:%@", arg.toNSString]];
+}
+
+@end
+
+@interface LOCall02 : LOLuaFunction
+@end
+
+@implementation LOCall02
+
+- (LOLuaValue *)call
+{
+    return [LOLuaValue valueOfString:@"call"];
+}
+
+- (LOLuaValue *)call:(LOLuaValue *)arg1 arg2:(LOLuaValue *)arg2
+{
+    return [LOLuaValue valueOfString:[NSString stringWithFormat:@"call:%@ arg2:%@", arg1.toNSString, arg2.toNSString]];
+}
+
+@end
+
+@interface LOCallTests : LOTestCase
+@end
+
+@implementation LOCallTests
+
+#pragma mark - argument frames
+
+- (void)testKeptArgumentsSurviveTheNextNativeCall
+{
+    LOLuaThread *L = [LOLuaThread new];
+    LOKeepArgs *keep = [LOKeepArgs new];
+    LOKeepArgs *other = [LOKeepArgs new];
+    LOTValue args[] = { LOTValueFromInt(1), LOTValueUnbox([LOLuaValue valueOfString:@"two"]), LOTValueFromDouble(3.5) };
+    LOVarargs *r = [L call:keep values:args count:3];
+    LOTValue more[] = { LOTValueFromInt(7), LOTValueFromInt(8), LOTValueFromInt(9), LOTValueFromInt(10) };
+    [L call:other values:more count:4];
+
+    XCTAssertEqual(keep.kept.narg, 3);
+    XCTAssertEqual([keep.kept toInt:1], 1);
+    XCTAssertEqualObjects([keep.kept toNSString:2], @"two");
+    XCTAssertEqual([keep.kept toDouble:3], 3.5);
+    // the window itself was handed to the next call and emptied
+    XCTAssertEqual(keep.window.narg, 0);
+
+    // results returned in the window were copied by the call
+    XCTAssertEqual(r.narg, 3);
+    XCTAssertEqualObjects([r toNSString:2], @"two");
+
+    [L call:keep values:NULL count:0];
+    XCTAssertTrue(keep.kept == LOLuaValue.NONE);
+}
+
+- (void)testKeptArgumentsSurviveTheNextCall
+{
+    LOKeepArgs *keep = [LOKeepArgs new];
+    LOKeepArgs *other = [LOKeepArgs new];
+    [self.globals rawSet:[LOLuaValue valueOfString:@"keep"] value:keep];
+    [self.globals rawSet:[LOLuaValue valueOfString:@"other"] value:other];
+    LOVarargs *r = [self run:@"local a, b = keep(1, 'two', 3.5)\n"
+                              "other('x', 'y', 'z', 'w')\n"
+                              "return a, b"];
+
+    XCTAssertEqual(keep.kept.narg, 3);
+    XCTAssertEqual([keep.kept toInt:1], 1);
+    XCTAssertEqualObjects([keep.kept toNSString:2], @"two");
+    XCTAssertEqual([keep.kept toDouble:3], 3.5);
+    // the window itself was handed to the next call and emptied
+    XCTAssertEqual(keep.window.narg, 0);
+
+    // results returned in the window were copied by the call
+    XCTAssertEqual([r toInt:1], 1);
+    XCTAssertEqualObjects([r toNSString:2], @"two");
+}
+
+- (void)testDealiasingAnEmptyFrameGivesNone
+{
+    LOKeepArgs *keep = [LOKeepArgs new];
+    [self.globals rawSet:[LOLuaValue valueOfString:@"keep"] value:keep];
+    [self run:@"keep()"];
+    XCTAssertTrue(keep.kept == LOLuaValue.NONE);
+    [self run:@"keep(nil)"];
+    XCTAssertEqual(keep.kept.narg, 1);
+    XCTAssertTrue([[keep.kept arg1] isNil]);
+}
+
+
+#pragma mark - recorded errors
+
+- (void)testRecordedErrorsAreReturnedByPcall
+{
+    LOCheckedAdd *add = [LOCheckedAdd new];
+    LOLuaThread *L = LOLuaThreadCurrent();
+
+    LOVarargs *r = [L pcall:add args:[LOLuaValue varargsOf:@[[LOLuaValue valueOfInt:2], [LOLuaValue valueOfInt:3]]]];
+    XCTAssertTrue([r toBoolean:1]);
+    XCTAssertEqual([r toInt:2], 5);
+
+    r = [L pcall:add args:[LOLuaValue varargsOf:@[[LOLuaValue valueOfInt:2], [LOLuaTable new]]]];
+    XCTAssertEqual(r.narg, 2);
+    XCTAssertFalse([r toBoolean:1]);
+    XCTAssertTrue([[r toNSString:2] containsString:@"bad argument #2"]);
+    XCTAssertFalse(LOLuaThreadErrorPending(L));
+
+    // an unprotected call raises what was recorded
+    LOTValue args[] = { LOTValueFromInt(1), LOTValueUnbox([LOLuaValue valueOfString:@"x"]) };
+    XCTAssertThrowsSpecific([L call:add values:args count:2], LOLuaError);
+    XCTAssertFalse(LOLuaThreadErrorPending(L));
+}
+
+- (void)testRecordedErrorsAreCollectedByPcall
+{
+    [self.globals rawSet:[LOLuaValue valueOfString:@"add"] value:[LOCheckedAdd new]];
+    LOLuaClosure *f = [LOLuaC load:[@"local a, b = ...\n"
+                                     "local s = add(a, b)\n"
+                                     "return s, 'after'" dataUsingEncoding:NSUTF8StringEncoding]
+                              name:@"=test" env:self.globals];
+    LOLuaThread *L = LOLuaThreadCurrent();
+
+    LOVarargs *r = [L pcall:f args:[LOLuaValue varargsOf:@[[LOLuaValue valueOfInt:2], [LOLuaValue valueOfInt:3]]]];
+    XCTAssertTrue([r toBoolean:1]);
+    XCTAssertEqual([r toInt:2], 5);
+    XCTAssertEqualObjects([r toNSString:3], @"after");
+
+    // the failing call returns at once, nothing after it in the chunk runs
+    r = [L pcall:f args:[LOLuaValue varargsOf:@[[LOLuaValue valueOfInt:2], [LOLuaTable new]]]];
+    XCTAssertEqual(r.narg, 2);
+    XCTAssertFalse([r toBoolean:1]);
+    XCTAssertTrue([[r toNSString:2] containsString:@"bad argument #2"]);
+    XCTAssertTrue([[r toNSString:2] containsString:@"number expected, got table"]);
+    XCTAssertFalse(LOLuaThreadErrorPending(L));
+
+    // the thread is usable again
+    r = [L pcall:f args:[LOLuaValue varargsOf:@[[LOLuaValue valueOfInt:1], [LOLuaValue valueOfInt:1]]]];
+    XCTAssertEqual([r toInt:2], 2);
+}
+
+- (void)testRecordedErrorsRaiseOutsideProtectedCalls
+{
+    [self.globals rawSet:[LOLuaValue valueOfString:@"add"] value:[LOCheckedAdd new]];
+    XCTAssertThrowsSpecific([self run:@"return add(1, {})"], LOLuaError);
+    XCTAssertFalse(LOLuaThreadErrorPending(LOLuaThreadCurrent()));
+    XCTAssertEqual([[self eval:@"return add(20, 22)"] toInt], 42);
+}
+
+- (void)testInterpreterErrorsAreCaughtByScriptPcall
+{
+    LOVarargs *r = [self run:@"local t = {}\n"
+                              "local ok1, e1 = pcall(function() return 1 + {} end)\n"
+                              "local ok2, e2 = pcall(function() return #nil end)\n"
+                              "local ok3, e3 = pcall(function() return {} < {} end)\n"
+                              "local ok4, e4 = pcall(function() return t.x.y end)\n"
+                              "local ok5, e5 = pcall(function() t[nil] = 1 end)\n"
+                              "local ok6, e6 = pcall(function() undefined() end)\n"
+                              "local ok7, e7 = pcall(function() for i = 1, 'x' do end end)\n"
+                              "return ok1, e1, ok2, e2, ok3, e3, ok4, e4, ok5, e5, ok6, e6, ok7, e7, pcall(function(a) return a .. 'b' end, 'a')"];
+    NSArray *messages = @[ @"attempt to perform arithmetic on a table value",
+                           @"attempt to get length of a nil value",
+                           @"attempt to compare two table values",
+                           @"attempt to index a nil value",
+                           @"table index is nil",
+                           @"attempt to call a nil value",
+                           @"'for' limit must be a number" ];
+    for (int i = 0; i < (int)messages.count; i++) {
+        XCTAssertFalse([r toBoolean:2 * i + 1]);
+        XCTAssertEqualObjects([r toNSString:2 * i + 2], messages[i]);
+    }
+    XCTAssertTrue([r toBoolean:15]);
+    XCTAssertEqualObjects([r toNSString:16], @"ab");
+    XCTAssertFalse(LOLuaThreadErrorPending(LOLuaThreadCurrent()));
+}
+
+- (void)testScriptErrorsCarryTheirPositionAndValue
+{
+    LOVarargs *r = [self run:@"local function fail(level) error('boom', level) end\n"
+                              "local function outer() fail(2) end\n"
+                              "local ok1, e1 = pcall(fail)\n"
+                              "local ok2, e2 = pcall(outer)\n"
+                              "local ok3, e3 = pcall(fail, 0)\n"
+                              "local t = {}\n"
+                              "local ok4, e4 = pcall(error, t)\n"
+                              "local ok5, e5 = pcall(error, 'plain')\n"
+                              "return e1, e2, e3, e4 == t, e5, ok1 or ok2 or ok3 or ok4 or ok5"];
+    XCTAssertEqualObjects([r toNSString:1], @"test:1: boom");
+    XCTAssertEqualObjects([r toNSString:2], @"test:2: boom");
+    XCTAssertEqualObjects([r toNSString:3], @"boom");
+    XCTAssertTrue([r toBoolean:4]);
+    // level 1 is pcall itself, a native function without a position
+    XCTAssertEqualObjects([r toNSString:5], @"plain");
+    XCTAssertFalse([r toBoolean:6]);
+
+    LOLuaError *error = nil;
+    @try {
+        [self run:@"local x = 1\nerror('unprotected')"];
+    } @catch (LOLuaError *e) {
+        error = e;
+    }
+    XCTAssertEqualObjects(error.reason, @"test:2: unprotected");
+    XCTAssertEqualObjects([[self run:@"return pcall(error, 'again', 0)"] toNSString:2], @"again");
+}
+
+
+#pragma mark - error positions
+
+- (void)testTracebackIsFormattedFromTheCapturedFrames
+{
+    LORaise *raise = [LORaise new];
+    LOTValue args[] = { LOTValueUnbox(raise) };
+    LOLuaError *error = nil;
+    @try {
+        [LOLuaThreadCurrent() call:[LOCallThrough new] values:args count:1];
+    } @catch (LOLuaError *e) {
+        error = e;
+    }
+    XCTAssertNotNil(error);
+    XCTAssertEqualObjects(error.reason, @"boom");
+    // native frames have no position
+    XCTAssertNil(error.fileLine);
+    NSString *traceback = error.traceback;
+    XCTAssertTrue([traceback hasPrefix:@"stack traceback:"]);
+    XCTAssertEqual([traceback componentsSeparatedByString:@"\n\t[C]: in "].count, 3u);
+    XCTAssertTrue([traceback containsString:raise.toNSString]);
+    XCTAssertEqualObjects(error.traceback, traceback);
+
+    error.fileLine = @"elsewhere:1";
+    XCTAssertEqualObjects(error.fileLine, @"elsewhere:1");
+}
+
+- (void)testTracebackIsFormattedAfterTheStackUnwound
+{
+    LOLuaError *error = nil;
+    @try {
+        [self run:@"local function f(x)\n"
+                   "  x()\n"
+                   "end\n"
+                   "f(nil)"];
+    } @catch (LOLuaError *e) {
+        error = e;
+    }
+    XCTAssertNotNil(error);
+    XCTAssertEqualObjects(error.reason, @"attempt to call a nil value");
+    // read long after the frames that raised it returned
+    NSString *traceback = error.traceback;
+    XCTAssertTrue([traceback hasPrefix:@"stack traceback:"]);
+    XCTAssertTrue([traceback containsString:@"\n\ttest:2: in "]);
+    XCTAssertTrue([traceback containsString:@"\n\ttest:4: in "]);
+    XCTAssertTrue([traceback rangeOfString:@"test:2:"].location < [traceback rangeOfString:@"test:4:"].location);
+    XCTAssertEqualObjects(error.traceback, traceback);
+
+    error.fileLine = @"elsewhere:1";
+    XCTAssertEqualObjects(error.fileLine, @"elsewhere:1");
+}
+
+
+#pragma mark - fixed arities
+
+- (void)testCallsGoToTheNearestOverriddenArity
+{
+    LOLuaValue *a = [LOLuaValue valueOfInt:1], *b = [LOLuaValue valueOfString:@"b"], *c = [LOLuaValue valueOfDouble:2.5];
+    LOCall0 *f0 = [LOCall0 new];
+    LOCall1 *f1 = [LOCall1 new];
+    LOCall02 *f02 = [LOCall02 new];
+
+    XCTAssertEqualObjects([[f0 call:a arg2:b arg3:c] toNSString], @"call");
+    XCTAssertEqualObjects([[f1 call] toNSString], @"call:nil");
+    XCTAssertEqualObjects([[f1 call:a arg2:b] toNSString], @"call:1");
+    XCTAssertEqualObjects([[f02 call] toNSString], @"call");
+    XCTAssertEqualObjects([[f02 call:a] toNSString], @"call:1 arg2:nil");
+    XCTAssertEqualObjects([[f02 call:a arg2:b arg3:c] toNSString], @"call:1 arg2:b");
+
+    XCTAssertEqualObjects([[f02 invoke:[LOLuaValue varargsOf:@[a]]] toNSString:1], @"call:1 arg2:nil");
+    XCTAssertEqualObjects([[f1 invoke:LOLuaValue.NONE] toNSString:1], @"call:nil");
+}
+
+- (void)testLuaCallsReachFixedArities
+{
+    [self.globals rawSet:[LOLuaValue valueOfString:@"f0"] value:[LOCall0 new]];
+    [self.globals rawSet:[LOLuaValue valueOfString:@"f1"] value:[LOCall1 new]];
+    [self.globals rawSet:[LOLuaValue valueOfString:@"f02"] value:[LOCall02 new]];
+    LOVarargs *r = [self run:@"return f0(1, 2), f1(), f1('x', 'y', 'z'), f02(), f02(7), f02(7, 8, 9), (f1(f02(1, 2)))"];
+    XCTAssertEqualObjects([r toNSString:1], @"call");
+    XCTAssertEqualObjects([r toNSString:2], @"call:nil");
+    XCTAssertEqualObjects([r toNSString:3], @"call:x");
+    XCTAssertEqualObjects([r toNSString:4], @"call");
+    XCTAssertEqualObjects([r toNSString:5], @"call:7 arg2:nil");
+    XCTAssertEqualObjects([r toNSString:6], @"call:7 arg2:8");
+    XCTAssertEqualObjects([r toNSString:7], @"call:call:1 arg2:2");
+}
+
+- (void)testFixedCallsReachVarargFunctions
+{
+    LOKeepArgs *keep = [LOKeepArgs new];
+    LOLuaValue *a = [LOLuaValue valueOfInt:1], *b = [LOLuaValue valueOfString:@"b"];
+    XCTAssertTrue([keep call:a arg2:b] == a);
+    XCTAssertEqual(keep.kept.narg, 2);
+    XCTAssertTrue([keep.kept arg:2] == b);
+    XCTAssertTrue([[keep call] isNil]);
+    XCTAssertEqual(keep.kept.narg, 0);
+
+    // lua functions take fixed calls too
+    LOLuaFunction *add = (LOLuaFunction *)[self eval:@"return function(x, y, z) return x + (y or 0) + (z or 0) end"];
+    XCTAssertEqual([[add call:a] toInt], 1);
+    XCTAssertEqual([[add call:a arg2:a arg3:a] toInt], 3);
+}
+
+@end
@@ -0,0 +1,280 @@
+//
+//  LOChunkTests.m
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import "LOTestCase.h"
+#import "LOLuaC.h"
+#import "LOLuaClosure.h"
+#import "LOLuaError.h"
+#import "LOLuaString.h"
+#import "LOLoadState.h"
+#import "LODumpState.h"
+#import "LOPrototype.h"
+#import "LOChunkCache.h"
+#if __has_include(<CommonCrypto/CommonDigest.h>)
+#import <CommonCrypto/CommonDigest.h>
+#endif
+
+static NSString * const LOChunkTestsSource =
+    @"local t = {}\n"
+     "local function add(a, b) return a + b end\n"
+     "for i = 1, 10 do t[i] = add(i, 0.5) end\n"
+     "local s = 'a long string constant, longer than the interned ones'\n"
+     "return t[10], #s, add, ...";
+
+@interface LOChunkTests : LOTestCase
+@end
+
+static void LOAppendInt(NSMutableData *data, int i)
+{
+    [data appendBytes:&i length:4];
+}
+
+static void LOAppendByte(NSMutableData *data, int b)
+{
+    uint8_t c = (uint8_t)b;
+    [data appendBytes:&c length:1];
+}
+
+/** A stripped chunk for this host of one vararg function with no nested functions and {@code _ENV} as its upvalue */
+static NSData *LOChunkTestsChunk(int maxstacksize, const int *code, int codeSize, const double *k, int kSize)
+{
+    NSMutableData *chunk = [NSMutableData data];
+    uint16_t probe = 1;
+    [chunk appendBytes:LOLoadStateSignature length:4];
+    LOAppendByte(chunk, LOLoadStateVersion);
+    LOAppendByte(chunk, LOLoadStateFormat);
+    LOAppendByte(chunk, *(uint8_t *)&probe);
+    LOAppendByte(chunk, 4);
+    LOAppendByte(chunk, 8);
+    LOAppendByte(chunk, 4);
+    LOAppendByte(chunk, 8);
+    LOAppendByte(chunk, LOLoadStateNumberFormatFloatsOrDoubles);
+    [chunk appendBytes:LOLoadStateTail length:6];
+    LOAppendInt(chunk, 0);      // linedefined
+    LOAppendInt(chunk, 0);      // lastlinedefined
+    LOAppendByte(chunk, 0);     // numparams
+    LOAppendByte(chunk, 1);     // is_vararg
+    LOAppendByte(chunk, maxstacksize);
+    LOAppendInt(chunk, codeSize);
+    for (int i = 0; i < codeSize; i++)
+        LOAppendInt(chunk, code[i]);
+    LOAppendInt(chunk, kSize);
+    for (int i = 0; i < kSize; i++) {
+        LOAppendByte(chunk, 3);
+        [chunk appendBytes:&k[i] length:8];
+    }
+    LOAppendInt(chunk, 0);      // no nested functions
+    LOAppendInt(chunk, 1);      // _ENV, in the caller's stack at 0
+    LOAppendByte(chunk, 1);
+    LOAppendByte(chunk, 0);
+    uint64_t nosource = 0;
+    [chunk appendBytes:&nosource length:8];
+    LOAppendInt(chunk, 0);
+    LOAppendInt(chunk, 0);
+    LOAppendInt(chunk, 0);
+    return chunk;
+}
+
+/** {@code return 7}: LOADK 0 0, RETURN 0 2, RETURN 0 1 */
+static NSData *LOChunkTestsReturnSeven(void)
+{
+    int code[] = { 0x00000001, 0x0100001F, 0x0080001F };
+    double k[] = { 7 };
+    return LOChunkTestsChunk(2, code, 3, k, 1);
+}
+
+/** {@code local a, b = ... return a + b}: VARARG 0 3, ADD 2 0 1, RETURN 2 2, RETURN 0 1 */
+static NSData *LOChunkTestsAdd(void)
+{
+    int code[] = { 0x01800026, 0x0000408D, 0x0100009F, 0x0080001F };
+    return LOChunkTestsChunk(3, code, 4, NULL, 0);
+}
+
+@implementation LOChunkTests
+
+#pragma mark - dump and undump
+
+- (void)testUndumpReadsAHandBuiltChunk
+{
+    LOPrototype *p = [LOLoadState undump:LOChunkTestsReturnSeven() name:@"=test"];
+    XCTAssertEqual(p->_codeSize, 3);
+    XCTAssertEqual(p->_code[0], 0x00000001);
+    XCTAssertEqual(p->_kSize, 1);
+    XCTAssertEqual(LOTValueToDouble(p->_k[0]), 7.0);
+    XCTAssertEqual(p->_maxstacksize, 2);
+    XCTAssertEqual(p->_numparams, 0);
+    XCTAssertTrue(p->_isVararg);
+    XCTAssertEqual(p->_upvaluesSize, 1);
+    XCTAssertTrue(p->_upvalues[0].instack);
+    XCTAssertEqual(p->_upvalues[0].idx, 0);
+    XCTAssertEqual(p->_p.count, 0u);
+    XCTAssertEqual(p->_lineinfoSize, 0);
+    // a stripped chunk is named by the caller
+    XCTAssertEqualObjects(p.shortSource, @"test");
+}
+
+- (void)testHandBuiltChunksRun
+{
+    LOPrototype *p = [LOLoadState undump:LOChunkTestsReturnSeven() name:@"=test"];
+    LOVarargs *r = [[[LOLuaClosure alloc] initWithPrototype:p env:self.globals] invoke:LOLuaValue.NONE];
+    XCTAssertEqual(r.narg, 1);
+    XCTAssertEqual([r toInt:1], 7);
+
+    LOLuaClosure *add = [[LOLuaClosure alloc] initWithPrototype:[LOLoadState undump:LOChunkTestsAdd() name:@"=add"]
+                                                            env:self.globals];
+    XCTAssertEqual([[add invoke:[LOLuaValue varargsOf:@[[LOLuaValue valueOfInt:2], [LOLuaValue valueOfInt:3]]]] toInt:1], 5);
+    XCTAssertEqual([[add invoke:[LOLuaValue varargsOf:@[[LOLuaValue valueOfDouble:2.5], [LOLuaValue valueOfInt:1]]]] toDouble:1], 3.5);
+}
+
+- (void)testUndumpRunsWhatWasDumped
+{
+    LOPrototype *p = [LOLuaC compile:[LOChunkTestsSource dataUsingEncoding:NSUTF8StringEncoding] name:@"=test"];
+    NSData *chunk = [LODumpState dump:p stripDebug:NO];
+    XCTAssertTrue([LOLoadState isBinaryChunk:chunk]);
+
+    LOLuaClosure *f = [LOLuaC load:chunk name:@"=other" env:self.globals];
+    LOVarargs *r = [f invoke:[LOLuaValue valueOfString:@"extra"]];
+    XCTAssertEqual([r toDouble:1], 10.5);
+    XCTAssertEqual([r toInt:2], 55);
+    XCTAssertEqual([[r arg:3] type], LOLuaTypeFunction);
+    XCTAssertEqualObjects([r toNSString:4], @"extra");
+    // the chunk keeps its own source name
+    XCTAssertEqualObjects(f->_p.shortSource, @"test");
+
+    // dumping the loaded prototypes again gives the same bytes
+    XCTAssertEqualObjects([LODumpState dump:f->_p stripDebug:NO], chunk);
+    XCTAssertEqualObjects([LODumpState dump:f->_p stripDebug:YES], [LODumpState dump:p stripDebug:YES]);
+}
+
+- (void)testUndumpKeepsLineInfoUnlessStripped
+{
+    NSData *source = [@"local x\nx()" dataUsingEncoding:NSUTF8StringEncoding];
+    LOPrototype *p = [LOLuaC compile:source name:@"=test"];
+
+    LOLuaError *error = nil;
+    @try {
+        [[[LOLuaClosure alloc] initWithPrototype:[LOLoadState undump:[LODumpState dump:p stripDebug:NO] name:@"=x"]
+                                             env:self.globals] invoke:LOLuaValue.NONE];
+    } @catch (LOLuaError *e) {
+        error = e;
+    }
+    XCTAssertTrue([error.traceback containsString:@"test:2:"]);
+
+    LOPrototype *stripped = [LOLoadState undump:[LODumpState dump:p stripDebug:YES] name:@"=x"];
+    XCTAssertEqual(stripped->_lineinfoSize, 0);
+}
+
+- (void)testUndumpFileMapsTheChunk
+{
+    NSString *path = [NSTemporaryDirectory() stringByAppendingPathComponent:[NSUUID UUID].UUIDString];
+    LOPrototype *p = [LOLuaC compile:[LOChunkTestsSource dataUsingEncoding:NSUTF8StringEncoding] name:@"=test"];
+    XCTAssertTrue([[LODumpState dump:p stripDebug:YES] writeToFile:path atomically:YES]);
+
+    NSError *error = nil;
+    LOPrototype *q = [LOLoadState undumpFile:path error:&error];
+    [[NSFileManager defaultManager] removeItemAtPath:path error:NULL];
+    XCTAssertNotNil(q);
+    XCTAssertNil(error);
+    // constants stay readable once the file is gone
+    LOVarargs *r = [[[LOLuaClosure alloc] initWithPrototype:q env:self.globals] invoke:LOLuaValue.NONE];
+    XCTAssertEqual([r toInt:2], 55);
+
+    XCTAssertNil([LOLoadState undumpFile:path error:&error]);
+    XCTAssertNotNil(error);
+}
+
+- (void)testMalformedChunksRaise
+{
+    NSData *chunk = [LODumpState dump:[LOLuaC compile:[@"return 1" dataUsingEncoding:NSUTF8StringEncoding] name:@"=test"]
+                           stripDebug:YES];
+    XCTAssertThrowsSpecific([LOLoadState undump:[chunk subdataWithRange:NSMakeRange(0, chunk.length - 5)] name:@"=test"], LOLuaError);
+
+    NSMutableData *version = [chunk mutableCopy];
+    ((uint8_t *)version.mutableBytes)[4] = 0x51;
+    XCTAssertThrowsSpecific([LOLoadState undump:version name:@"=test"], LOLuaError);
+}
+
+
+#pragma mark - chunk cache
+
+static NSString *LOChunkTestsSHA256(const void *bytes, size_t length)
+{
+    uint8_t digest[LOChunkCacheDigestLength];
+    LOChunkCacheSHA256(bytes, length, digest);
+    NSMutableString *hex = [NSMutableString string];
+    for (int i = 0; i < LOChunkCacheDigestLength; i++)
+        [hex appendFormat:@"%02x", digest[i]];
+    return hex;
+}
+
+- (void)testChecksumsMatchKnownAnswers
+{
+    // FIPS 180-4 examples, the last two spanning several blocks
+    XCTAssertEqualObjects(LOChunkTestsSHA256("", 0), @"e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+    XCTAssertEqualObjects(LOChunkTestsSHA256("abc", 3), @"ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+    const char *message = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+    XCTAssertEqualObjects(LOChunkTestsSHA256(message, strlen(message)), @"248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+    NSMutableData *million = [NSMutableData dataWithLength:1000000];
+    memset(million.mutableBytes, 'a', million.length);
+    XCTAssertEqualObjects(LOChunkTestsSHA256(million.bytes, million.length), @"cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0");
+#if __has_include(<CommonCrypto/CommonDigest.h>)
+    // every padding case of the tail agrees with CommonCrypto
+    for (size_t n = 0; n <= 130; n++) {
+        uint8_t builtin[LOChunkCacheDigestLength], system[CC_SHA256_DIGEST_LENGTH];
+        LOChunkCacheSHA256(million.bytes, n, builtin);
+        CC_SHA256(million.bytes, (CC_LONG)n, system);
+        XCTAssertEqual(memcmp(builtin, system, sizeof(builtin)), 0, @"length %zu", n);
+    }
+#endif
+
+    XCTAssertEqual(LOChunkCacheCRC32(0, "", 0), 0u);
+    XCTAssertEqual(LOChunkCacheCRC32(0, "123456789", 9), 0xCBF43926u);
+    XCTAssertEqual(LOChunkCacheCRC32(LOChunkCacheCRC32(0, "1234", 4), "56789", 5), 0xCBF43926u);
+}
+
+- (void)testChunkCacheCompilesOnceAndRepairsDamagedEntries
+{
+    NSString *directory = [NSTemporaryDirectory() stringByAppendingPathComponent:[NSUUID UUID].UUIDString];
+    NSFileManager *fm = [NSFileManager defaultManager];
+    NSData *source = [LOChunkTestsSource dataUsingEncoding:NSUTF8StringEncoding];
+
+    LOChunkCache *cache = [[LOChunkCache alloc] initWithDirectory:directory];
+    XCTAssertEqual([[cache load:source name:@"=first" env:self.globals] invoke:LOLuaValue.NONE].narg, 3);
+    NSArray *files = [fm contentsOfDirectoryAtPath:directory error:NULL];
+    XCTAssertEqual(files.count, 1u);
+    NSString *path = [directory stringByAppendingPathComponent:files.firstObject];
+    NSData *entry = [NSData dataWithContentsOfFile:path];
+    id inode = [fm attributesOfItemAtPath:path error:NULL][NSFileSystemFileNumber];
+
+    // a cache over the same directory, as in a later process, reads the entry without rewriting it
+    LOChunkCache *later = [[LOChunkCache alloc] initWithDirectory:directory];
+    LOPrototype *p = [later prototypeForSource:source name:@"=second"];
+    XCTAssertEqualObjects([fm attributesOfItemAtPath:path error:NULL][NSFileSystemFileNumber], inode);
+    XCTAssertEqualObjects(p.shortSource, @"second");
+    LOVarargs *r = [[[LOLuaClosure alloc] initWithPrototype:p env:self.globals] invoke:LOLuaValue.NONE];
+    XCTAssertEqual([r toDouble:1], 10.5);
+    XCTAssertEqual([r toInt:2], 55);
+
+    // a damaged chunk is never run, the source is compiled again and the entry replaced
+    NSMutableData *damaged = [entry mutableCopy];
+    ((uint8_t *)damaged.mutableBytes)[damaged.length - 20] ^= 0xff;
+    [damaged writeToFile:path atomically:YES];
+    r = [[later load:source name:@"=third" env:self.globals] invoke:LOLuaValue.NONE];
+    XCTAssertEqual([r toInt:2], 55);
+    XCTAssertEqualObjects([NSData dataWithContentsOfFile:path], entry);
+
+    [damaged setLength:entry.length / 2];
+    [damaged writeToFile:path atomically:YES];
+    XCTAssertEqual([[[later load:source name:@"=fourth" env:self.globals] invoke:LOLuaValue.NONE] toInt:2], 55);
+    XCTAssertEqualObjects([NSData dataWithContentsOfFile:path], entry);
+
+    [later removeAllEntries];
+    XCTAssertEqual([fm contentsOfDirectoryAtPath:directory error:NULL].count, 0u);
+    [fm removeItemAtPath:directory error:NULL];
+}
+
+@end
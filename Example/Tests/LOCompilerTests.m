@@ -0,0 +1,127 @@
+//
+//  LOCompilerTests.m
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import "LOTestCase.h"
+#import "LOLua.h"
+#import "LOLuaC.h"
+#import "LOLuaError.h"
+#import "LOLuaString.h"
+#import "LOLoadState.h"
+#import "LODumpState.h"
+#import "LOPrototype.h"
+
+@interface LOCompilerTests : LOTestCase
+@end
+
+static void LOAppendInt(NSMutableData *data, int i)
+{
+    [data appendBytes:&i length:4];
+}
+
+static void LOAppendByte(NSMutableData *data, int b)
+{
+    uint8_t c = (uint8_t)b;
+    [data appendBytes:&c length:1];
+}
+
+@implementation LOCompilerTests
+
+- (void)testFoldsConstantsIntoTheChunkLuacWrites
+{
+    LOPrototype *p = [LOLuaC compile:[@"local a = 2 * 3 + 1\nreturn a" dataUsingEncoding:NSUTF8StringEncoding] name:@"=test"];
+
+    // luac -s of the same source on this host
+    NSMutableData *expected = [NSMutableData data];
+    uint16_t probe = 1;
+    [expected appendBytes:LOLoadStateSignature length:4];
+    LOAppendByte(expected, 0x52);
+    LOAppendByte(expected, 0);
+    LOAppendByte(expected, *(uint8_t *)&probe);
+    LOAppendByte(expected, 4);
+    LOAppendByte(expected, 8);
+    LOAppendByte(expected, 4);
+    LOAppendByte(expected, 8);
+    LOAppendByte(expected, 0);
+    [expected appendBytes:LOLoadStateTail length:6];
+    LOAppendInt(expected, 0);   // linedefined
+    LOAppendInt(expected, 0);   // lastlinedefined
+    LOAppendByte(expected, 0);  // numparams
+    LOAppendByte(expected, 1);  // is_vararg
+    LOAppendByte(expected, 2);  // maxstacksize
+    LOAppendInt(expected, 3);
+    LOAppendInt(expected, LO_CREATE_ABx(LO_OP_LOADK, 0, 0));
+    LOAppendInt(expected, LO_CREATE_ABC(LO_OP_RETURN, 0, 2, 0));
+    LOAppendInt(expected, LO_CREATE_ABC(LO_OP_RETURN, 0, 1, 0));
+    LOAppendInt(expected, 1);
+    LOAppendByte(expected, 3);
+    double seven = 7;
+    [expected appendBytes:&seven length:8];
+    LOAppendInt(expected, 0);   // no nested functions
+    LOAppendInt(expected, 1);   // _ENV, in the caller's stack at 0
+    LOAppendByte(expected, 1);
+    LOAppendByte(expected, 0);
+    uint64_t nosource = 0;
+    [expected appendBytes:&nosource length:8];
+    LOAppendInt(expected, 0);
+    LOAppendInt(expected, 0);
+    LOAppendInt(expected, 0);
+
+    XCTAssertEqualObjects([LODumpState dump:p stripDebug:YES], expected);
+}
+
+- (void)testNumericForLoopMatchesLuac
+{
+    LOPrototype *p = [LOLuaC compile:[@"for i = 1, 3 do end" dataUsingEncoding:NSUTF8StringEncoding] name:@"=test"];
+    int expected[] = {
+        LO_CREATE_ABx(LO_OP_LOADK, 0, 0),
+        LO_CREATE_ABx(LO_OP_LOADK, 1, 1),
+        LO_CREATE_ABx(LO_OP_LOADK, 2, 0),
+        LO_CREATE_ABx(LO_OP_FORPREP, 0, 0 + LO_MAXARG_sBx),
+        LO_CREATE_ABx(LO_OP_FORLOOP, 0, -1 + LO_MAXARG_sBx),
+        LO_CREATE_ABC(LO_OP_RETURN, 0, 1, 0),
+    };
+    int n = (int)(sizeof(expected) / sizeof(expected[0]));
+    XCTAssertEqual(p->_codeSize, n);
+    for (int pc = 0; pc < MIN(n, p->_codeSize); pc++)
+        XCTAssertEqual(p->_code[pc], expected[pc], @"instruction %d", pc + 1);
+    XCTAssertEqual(p->_kSize, 2);
+    XCTAssertEqual(LOTValueToDouble(p->_k[0]), 1.0);
+    XCTAssertEqual(LOTValueToDouble(p->_k[1]), 3.0);
+    XCTAssertEqual(p->_maxstacksize, 4);
+}
+
+- (void)testConstantStringsDoNotReferenceTheSource
+{
+    NSMutableData *source = [[@"return 'hello', 'a long string constant that is not interned at all'" dataUsingEncoding:NSUTF8StringEncoding] mutableCopy];
+    LOPrototype *p = [LOLuaC compile:source name:@"=test"];
+    memset(source.mutableBytes, 'x', source.length);
+
+    XCTAssertEqualObjects([LOTValueGetObject(p->_k[0]) toNSString], @"hello");
+    XCTAssertEqualObjects([LOTValueGetObject(p->_k[1]) toNSString], @"a long string constant that is not interned at all");
+    // short constants are the interned strings
+    XCTAssertTrue(LOTValueGetObject(p->_k[0]) == [LOLuaString valueOf:@"hello"]);
+}
+
+- (void)testRunsWhatItCompiles
+{
+    LOVarargs *r = [self run:@"local function fib(n) if n < 2 then return n end return fib(n - 1) + fib(n - 2) end\n"
+                              "local s = ''\n"
+                              "for i = 1, 3 do s = s .. i end\n"
+                              "return fib(20), s, #{1, 2, 3}, not nil"];
+    XCTAssertEqual([r toInt:1], 6765);
+    XCTAssertEqualObjects([r toNSString:2], @"123");
+    XCTAssertEqual([r toInt:3], 3);
+    XCTAssertTrue([r toBoolean:4]);
+}
+
+- (void)testSyntaxErrorsRaise
+{
+    XCTAssertThrowsSpecific([LOLuaC compile:[@"x = = 1" dataUsingEncoding:NSUTF8StringEncoding] name:@"=test"], LOLuaError);
+    XCTAssertThrowsSpecific([self run:@"return 1 +"], LOLuaError);
+}
+
+@end
@@ -0,0 +1,247 @@
+//
+//  LOCoroutineTests.m
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import "LOTestCase.h"
+#import "LOLuaFunction.h"
+#import "LOLuaThread.h"
+#import "LOLuaError.h"
+
+/** A native coroutine body: yields the running sum of the values it is resumed with, until resumed with nil */
+@interface LOSumYields : LOLuaFunction
+@end
+
+@implementation LOSumYields
+
+- (LOVarargs *)invoke:(LOVarargs *)args
+{
+    int sum = 0;
+    while (![args isNil:1]) {
+        sum += [args checkInt:1];
+        args = [LOLuaThread yield:[LOLuaValue valueOfInt:sum]];
+    }
+    return [LOLuaValue valueOfString:@"done"];
+}
+
+@end
+
+/** Calls its first argument with the rest, putting a native frame under the callee */
+@interface LOApply : LOLuaFunction
+@end
+
+@implementation LOApply
+
+- (LOVarargs *)invoke:(LOVarargs *)args
+{
+    return [[args arg1] invoke:[args subArgs:2]];
+}
+
+@end
+
+@interface LOCoroutineTests : LOTestCase
+@end
+
+@implementation LOCoroutineTests
+
+- (void)setUp
+{
+    [super setUp];
+    [self.globals rawSet:[LOLuaValue valueOfString:@"apply"] value:[LOApply new]];
+}
+
+#pragma mark - resume and yield
+
+- (void)testNativeBodiesResumeAndYield
+{
+    LOLuaThread *co = [[LOLuaThread alloc] initWithFunction:[LOSumYields new]];
+    XCTAssertEqualObjects(co.statusName, @"suspended");
+
+    LOVarargs *r = [co resume:[LOLuaValue valueOfInt:1]];
+    XCTAssertTrue([r toBoolean:1]);
+    XCTAssertEqual([r toInt:2], 1);
+    XCTAssertEqualObjects(co.statusName, @"suspended");
+    r = [co resume:[LOLuaValue valueOfInt:41]];
+    XCTAssertEqual([r toInt:2], 42);
+    r = [co resume:LOLuaValue.NONE];
+    XCTAssertTrue([r toBoolean:1]);
+    XCTAssertEqualObjects([r toNSString:2], @"done");
+    XCTAssertEqualObjects(co.statusName, @"dead");
+
+    r = [co resume:LOLuaValue.NONE];
+    XCTAssertFalse([r toBoolean:1]);
+    XCTAssertEqualObjects([r toNSString:2], @"cannot resume dead coroutine");
+}
+
+- (void)testClosingASuspendedNativeBody
+{
+    LOLuaThread *co = [[LOLuaThread alloc] initWithFunction:[LOSumYields new]];
+    XCTAssertEqual([[co resume:[LOLuaValue valueOfInt:5]] toInt:2], 5);
+    [co close];
+    XCTAssertEqualObjects(co.statusName, @"dead");
+    XCTAssertFalse([[co resume:[LOLuaValue valueOfInt:1]] toBoolean:1]);
+    // closing a dead coroutine does nothing
+    [co close];
+
+    XCTAssertThrowsSpecific([LOLuaThread yield:LOLuaValue.NONE], LOLuaError);
+}
+
+- (void)testValuesTravelBothWays
+{
+    LOVarargs *r = [self run:@"local co = coroutine.create(function(a, b)\n"
+                              "  local c = coroutine.yield(a + b, 'first')\n"
+                              "  local d, e = coroutine.yield(c * 2)\n"
+                              "  return d .. e, coroutine.status(coroutine.running())\n"
+                              "end)\n"
+                              "local s0 = coroutine.status(co)\n"
+                              "local ok1, x1, y1 = coroutine.resume(co, 1, 2)\n"
+                              "local s1 = coroutine.status(co)\n"
+                              "local ok2, x2 = coroutine.resume(co, 10)\n"
+                              "local ok3, x3, y3 = coroutine.resume(co, 'a', 'b')\n"
+                              "local ok4, x4 = coroutine.resume(co)\n"
+                              "return s0, x1, y1, s1, x2, x3, y3, coroutine.status(co), ok4, x4"];
+    XCTAssertEqualObjects([r toNSString:1], @"suspended");
+    XCTAssertEqual([r toInt:2], 3);
+    XCTAssertEqualObjects([r toNSString:3], @"first");
+    XCTAssertEqualObjects([r toNSString:4], @"suspended");
+    XCTAssertEqual([r toInt:5], 20);
+    XCTAssertEqualObjects([r toNSString:6], @"ab");
+    XCTAssertEqualObjects([r toNSString:7], @"running");
+    XCTAssertEqualObjects([r toNSString:8], @"dead");
+    XCTAssertFalse([r toBoolean:9]);
+    XCTAssertEqualObjects([r toNSString:10], @"cannot resume dead coroutine");
+}
+
+- (void)testWrappedGeneratorsDriveAForLoop
+{
+    LOVarargs *r = [self run:@"local function gen(n) return coroutine.wrap(function() for i = 1, n do coroutine.yield(i) end end) end\n"
+                              "local s = 0\n"
+                              "for v in gen(100) do s = s + v end\n"
+                              "local outer = coroutine.wrap(function()\n"
+                              "  for v in gen(3) do coroutine.yield(v * 10) end\n"
+                              "end)\n"
+                              "return s, outer(), outer(), outer()"];
+    XCTAssertEqual([r toInt:1], 5050);
+    XCTAssertEqual([r toInt:2], 10);
+    XCTAssertEqual([r toInt:3], 20);
+    XCTAssertEqual([r toInt:4], 30);
+}
+
+- (void)testErrorsEndTheCoroutine
+{
+    LOVarargs *r = [self run:@"local co = coroutine.create(function() local up = 1 coroutine.yield(function() return up end) local f f() end)\n"
+                              "local _, get = coroutine.resume(co)\n"
+                              "local ok, err = coroutine.resume(co)\n"
+                              "return ok, err, coroutine.status(co), get()"];
+    XCTAssertFalse([r toBoolean:1]);
+    XCTAssertTrue([[r toNSString:2] containsString:@"attempt to call a nil value"]);
+    XCTAssertEqualObjects([r toNSString:3], @"dead");
+    // upvalues of the abandoned frames were closed
+    XCTAssertEqual([r toInt:4], 1);
+
+    XCTAssertThrowsSpecific([self run:@"coroutine.yield(1)"], LOLuaError);
+    XCTAssertThrowsSpecific([self run:@"coroutine.wrap(function() local f f() end)()"], LOLuaError);
+}
+
+#pragma mark - native frames
+
+- (void)testOnlyStackfulCoroutinesYieldAcrossNativeCalls
+{
+    LOVarargs *r = [self run:@"local body = function() return apply(function(x) return coroutine.yield(x) end, 7) end\n"
+                              "local ok, err = coroutine.resume(coroutine.create(body))\n"
+                              "local co = coroutine.create(function() return apply(function(x) return coroutine.yield(x) + 1 end, 7) end, true)\n"
+                              "local ok1, y = coroutine.resume(co)\n"
+                              "local ok2, z = coroutine.resume(co, 41)\n"
+                              "return ok, err, y, z, coroutine.status(co)"];
+    XCTAssertFalse([r toBoolean:1]);
+    XCTAssertEqualObjects([r toNSString:2], @"attempt to yield across a C-call boundary");
+    XCTAssertEqual([r toInt:3], 7);
+    XCTAssertEqual([r toInt:4], 42);
+    XCTAssertEqualObjects([r toNSString:5], @"dead");
+}
+
+- (void)testClosingASuspendedStackfulCoroutine
+{
+    LOVarargs *r = [self run:@"local co = coroutine.create(function() apply(coroutine.yield, 1) return 'unreached' end, true)\n"
+                              "coroutine.resume(co)\n"
+                              "local closed = coroutine.close(co)\n"
+                              "local ok, err = coroutine.resume(co)\n"
+                              "return closed, coroutine.status(co), ok, err"];
+    XCTAssertTrue([r toBoolean:1]);
+    XCTAssertEqualObjects([r toNSString:2], @"dead");
+    XCTAssertFalse([r toBoolean:3]);
+    XCTAssertEqualObjects([r toNSString:4], @"cannot resume dead coroutine");
+}
+
+
+#pragma mark - stack growth
+
+- (void)testStacksGrowUpToTheirMaximum
+{
+    LOLuaThread *L = [LOLuaThread new];
+    [L setStackSize:4 maxStackSize:64];
+    XCTAssertEqual(L->_stackSize, 4);
+
+    int base = LOLuaThreadReserve(L, 40);
+    XCTAssertGreaterThanOrEqual(L->_stackSize, base + 40);
+    XCTAssertLessThanOrEqual(L->_stackSize, 64);
+    XCTAssertTrue(LOTValueIsNil(L->_stack[base + 39]));
+    XCTAssertThrowsSpecific(LOLuaThreadReserve(L, 40), LOLuaError);
+
+    // the slots in use are never cut off
+    [L setStackSize:8 maxStackSize:64];
+    XCTAssertGreaterThanOrEqual(L->_stackSize, base + 40);
+    LOLuaThreadPopTo(L, base);
+    [L setStackSize:8 maxStackSize:64];
+    XCTAssertEqual(L->_stackSize, MAX(base, 8));
+
+    XCTAssertThrowsSpecific([L setStackSize:0 maxStackSize:16], LOLuaError);
+    XCTAssertThrowsSpecific([L setStackSize:16 maxStackSize:0], LOLuaError);
+}
+
+- (void)testOpenUpvaluesFollowTheStackAsItGrows
+{
+    LOLuaThread *co = (LOLuaThread *)[self eval:
+        @"return coroutine.create(function(n)\n"
+         "  local getters = {}\n"
+         "  local function down(i)\n"
+         "    local v = i\n"
+         "    getters[i] = function() return v end\n"
+         "    if i == n then coroutine.yield(#getters) else down(i + 1) end\n"
+         "    v = v * 2\n"
+         "  end\n"
+         "  down(1)\n"
+         "  local s = 0\n"
+         "  for i = 1, n do s = s + getters[i]() end\n"
+         "  return s\n"
+         "end)"];
+    XCTAssertEqual(co.type, LOLuaTypeThread);
+    // grows by reallocating many times while every level holds an open upvalue
+    [co setStackSize:4 maxStackSize:LOLuaThreadMaxStackSize];
+    [self.globals rawSet:[LOLuaValue valueOfString:@"co"] value:co];
+
+    LOVarargs *r = [self run:@"local ok1, count = coroutine.resume(co, 2000)\n"
+                              "local ok2, sum = coroutine.resume(co)\n"
+                              "return ok1, count, ok2, sum"];
+    XCTAssertTrue([r toBoolean:1]);
+    XCTAssertEqual([r toInt:2], 2000);
+    XCTAssertTrue([r toBoolean:3]);
+    XCTAssertEqual([r toInt:4], 2000 * 2001);
+}
+
+- (void)testTheMaximumStopsRunawayRecursion
+{
+    LOLuaThread *co = (LOLuaThread *)[self eval:@"return coroutine.create(function() local function f(n) return 1 + f(n + 1) end return f(1) end)"];
+    [co setStackSize:8 maxStackSize:256];
+    [self.globals rawSet:[LOLuaValue valueOfString:@"co"] value:co];
+    LOVarargs *r = [self run:@"return coroutine.resume(co)"];
+    XCTAssertFalse([r toBoolean:1]);
+    XCTAssertTrue([[r toNSString:2] containsString:@"stack overflow"]);
+
+    XCTAssertThrowsSpecific([co setStackSize:0 maxStackSize:16], LOLuaError);
+    XCTAssertThrowsSpecific([co setStackSize:16 maxStackSize:0], LOLuaError);
+}
+
+@end
@@ -0,0 +1,323 @@
+//
+//  LOStringTests.m
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import "LOTestCase.h"
+#import "LOLuaString.h"
+#import "LOLuaBoolean.h"
+#import "LOLuaTable.h"
+#import "LOStringBuilder.h"
+#import "LOLuaNumber.h"
+#import <locale.h>
+
+@interface LOStringTests : LOTestCase
+@end
+
+static NSString *LOFormat(double d)
+{
+    char buffer[LOLuaNumberMaxFormatLength];
+    int n = LOLuaNumberFormat(d, buffer);
+    return [[NSString alloc] initWithBytes:buffer length:n encoding:NSASCIIStringEncoding];
+}
+
+static BOOL LOParse(const char *s, LOTValue *result)
+{
+    return LOLuaNumberParse((const unsigned char *)s, (int)strlen(s), result);
+}
+
+@implementation LOStringTests
+
+#pragma mark - bytes and bridging
+
+- (void)testStringsAreBytes
+{
+    LOLuaString *s = [LOLuaString valueOf:@"héllo"];
+    XCTAssertEqual(s.length, 6);
+    XCTAssertEqualObjects([s toNSString], @"héllo");
+    XCTAssertEqual(LOLuaStringBytes(s)[1], 0xc3);
+
+    [self.globals rawSet:[LOLuaValue valueOfString:@"s"] value:s];
+    LOVarargs *r = [self run:@"return #s, #'a\\0b', 'a\\0b' == 'a\\0c', 'a\\0b' < 'a\\0c'"];
+    XCTAssertEqual([r toInt:1], 6);
+    XCTAssertEqual([r toInt:2], 3);
+    XCTAssertFalse([r toBoolean:3]);
+    XCTAssertTrue([r toBoolean:4]);
+
+    // bytes that are not UTF-8 survive as keys and values
+    LOLuaString *raw = [LOLuaString valueOfBytes:"\xff\xfe\x00\x80" length:4];
+    XCTAssertEqual(raw.length, 4);
+    LOLuaTable *t = [LOLuaTable new];
+    [t rawSet:raw value:[LOLuaValue valueOfInt:1]];
+    XCTAssertEqual([[t rawGet:[LOLuaString valueOfBytes:"\xff\xfe\x00\x80" length:4]] toInt], 1);
+    XCTAssertTrue([[t rawGet:[LOLuaString valueOfBytes:"\xff\xfe\x00\x81" length:4]] isNil]);
+}
+
+- (void)testNSStringsBridgeWithoutCopies
+{
+    NSString *text = [@"" stringByPaddingToLength:200 withString:@"abc" startingAtIndex:0];
+    LOLuaString *s = [LOLuaString valueOf:text];
+    NSString *bridged = [s toNSString];
+    XCTAssertEqualObjects(bridged, text);
+    XCTAssertEqual(bridged.length, 200u);
+    XCTAssertEqual([bridged characterAtIndex:199], [text characterAtIndex:199]);
+    // handing the bridged string back gives the lua string it came from
+    XCTAssertTrue([LOLuaString valueOf:bridged] == s);
+
+    NSString *accented = [@"é" stringByPaddingToLength:100 withString:@"é" startingAtIndex:0];
+    LOLuaString *u = [LOLuaString valueOf:accented];
+    XCTAssertEqual(u.length, 200);
+    XCTAssertEqualObjects([u toNSString], accented);
+    XCTAssertEqual([u toNSString].length, 100u);
+}
+
+- (void)testLongStringsHashOnFirstUse
+{
+    NSString *text = [@"" stringByPaddingToLength:LOLuaStringMaxShortLength + 10 withString:@"k" startingAtIndex:0];
+    LOLuaString *a = [LOLuaString valueOf:text], *b = [LOLuaString valueOf:text];
+    XCTAssertFalse(a->_interned);
+    XCTAssertEqual(a->_hashCode, 0u);
+
+    LOLuaTable *t = [LOLuaTable new];
+    [t rawSet:a value:[LOLuaValue valueOfInt:7]];
+    XCTAssertNotEqual(a->_hashCode, 0u);
+    XCTAssertEqual(a->_hashCode, LOLuaStringHashBytes(LOLuaStringBytes(a), a.length));
+    XCTAssertEqual([[t rawGet:b] toInt], 7);
+    XCTAssertEqual(b->_hashCode, a->_hashCode);
+
+    // short strings hash when interned
+    XCTAssertNotEqual([LOLuaString valueOf:@"short"]->_hashCode, 0u);
+}
+
+
+#pragma mark - views and ropes
+
+- (void)testLongSubstringsAreViews
+{
+    NSString *text = [@"" stringByPaddingToLength:300 withString:@"0123456789" startingAtIndex:0];
+    LOLuaString *s = [LOLuaString valueOf:text];
+    LOLuaString *view = [s substring:10 end:210];
+    XCTAssertEqual(view.length, 200);
+    XCTAssertTrue(view->_bytes == s->_bytes + 10);
+    XCTAssertEqualObjects([view toNSString], [text substringWithRange:NSMakeRange(10, 200)]);
+    XCTAssertTrue(LOLuaStringEquals(view, [LOLuaString valueOf:[text substringWithRange:NSMakeRange(10, 200)]]));
+
+    // short pieces are interned copies
+    LOLuaString *piece = [s substring:3 end:7];
+    XCTAssertTrue(piece == [LOLuaString valueOf:@"3456"]);
+    XCTAssertEqual([s substring:5 end:5].length, 0);
+}
+
+- (void)testConcatenationBuildsRopesThatReadAsFlatStrings
+{
+    LOLuaString *built = (LOLuaString *)[self eval:@"local s = ''\n"
+                                                    "for i = 1, 1000 do s = s .. 'piece' .. i .. ';' end\n"
+                                                    "return s"];
+    NSMutableString *expected = [NSMutableString string];
+    for (int i = 1; i <= 1000; i++)
+        [expected appendFormat:@"piece%d;", i];
+
+    XCTAssertEqual(built.length, (int)expected.length);
+    XCTAssertTrue(built->_left != nil);
+    XCTAssertTrue(LOLuaStringEquals(built, [LOLuaString valueOf:expected]));
+    // flattened once, the halves are dropped
+    XCTAssertTrue(built->_left == nil && built->_right == nil);
+    XCTAssertEqualObjects([built toNSString], expected);
+
+    [self.globals rawSet:[LOLuaValue valueOfString:@"flat"] value:[LOLuaValue valueOfString:expected]];
+    LOVarargs *r = [self run:@"local s = ''\n"
+                              "for i = 1, 1000 do s = s .. 'piece' .. i .. ';' end\n"
+                              "local t = { [flat] = 'hit' }\n"
+                              "return t[s], s == flat, #(s .. s), s < flat .. 'x'"];
+    XCTAssertEqualObjects([r toNSString:1], @"hit");
+    XCTAssertTrue([r toBoolean:2]);
+    XCTAssertEqual([r toInt:3], (int)expected.length * 2);
+    XCTAssertTrue([r toBoolean:4]);
+}
+
+- (void)testShortConcatenationsStayFlat
+{
+    LOLuaString *a = [LOLuaString valueOf:@"abc"], *b = [LOLuaString valueOf:@"def"];
+    LOLuaString *ab = LOLuaStringConcat(a, b);
+    XCTAssertTrue(ab->_left == nil);
+    XCTAssertTrue(ab == [LOLuaString valueOf:@"abcdef"]);
+
+    NSString *half = [@"" stringByPaddingToLength:LOLuaStringMinRopeLength withString:@"x" startingAtIndex:0];
+    LOLuaString *rope = LOLuaStringConcat([LOLuaString valueOf:half], a);
+    XCTAssertTrue(rope->_left != nil);
+    XCTAssertEqual(rope.length, LOLuaStringMinRopeLength + 3);
+    XCTAssertEqualObjects([rope toNSString], [half stringByAppendingString:@"abc"]);
+}
+
+
+#pragma mark - string builder
+
+- (void)testVarargsAndTostringFormatThroughTheBuilder
+{
+    LOVarargs *args = [LOLuaValue varargsOf:@[[LOLuaValue valueOfInt:1], [LOLuaValue valueOfDouble:2.5],
+                                              [LOLuaValue valueOfString:@"s"], [LOLuaBoolean defaultTrue], LOLuaValue.NIL]];
+    XCTAssertEqualObjects([args toNSString], @"(1,2.5,s,true,nil)");
+    XCTAssertEqualObjects([LOLuaValue.NONE toNSString], @"()");
+
+    LOVarargs *r = [self run:@"return tostring(12), tostring(-3.5), tostring(nil), tostring(false), tostring({}), tostring('x')"];
+    XCTAssertEqualObjects([r toNSString:1], @"12");
+    XCTAssertEqualObjects([r toNSString:2], @"-3.5");
+    XCTAssertEqualObjects([r toNSString:3], @"nil");
+    XCTAssertEqualObjects([r toNSString:4], @"false");
+    XCTAssertTrue([[r toNSString:5] hasPrefix:@"table: "]);
+    XCTAssertEqualObjects([r toNSString:6], @"x");
+}
+
+- (void)testNestedTostringGetsItsOwnBuilder
+{
+    LOLuaTable *mt = [LOLuaTable new];
+    LOLuaTable *p = [LOLuaTable new], *q = [LOLuaTable new];
+    [p setmetatable:mt];
+    [q setmetatable:mt];
+    [q rawSet:[LOLuaValue valueOfString:@"inner"] value:p];
+    [self.globals rawSet:[LOLuaValue valueOfString:@"mt"] value:mt];
+    [self.globals rawSet:[LOLuaValue valueOfString:@"p"] value:p];
+    [self.globals rawSet:[LOLuaValue valueOfString:@"q"] value:q];
+    [self run:@"mt.__tostring = function(t) if t.inner then return '<' .. tostring(t.inner) .. '>' end return 'P' end"];
+
+    XCTAssertEqualObjects([[self eval:@"return tostring(q)"] toNSString], @"<P>");
+    // a builder in use outside lua is left alone by the nested calls
+    LOStringBuilder *sb = LOStringBuilderAcquire();
+    LOStringBuilderAppendCString(sb, "q=");
+    LOTValueAppendToString(sb, LOTValueUnbox(q));
+    XCTAssertEqualObjects(LOStringBuilderToNSString(sb), @"q=<P>");
+    LOStringBuilderRelease(sb);
+    XCTAssertTrue([[[LOLuaValue varargsOf:@[p, q]] toNSString] hasPrefix:@"(table: "]);
+}
+
+- (void)testTheThreadBuilderIsReused
+{
+    LOStringBuilder *sb = LOStringBuilderAcquire();
+    LOStringBuilder *nested = LOStringBuilderAcquire();
+    XCTAssertTrue(sb != nested);
+    LOStringBuilderAppendCString(nested, "nested");
+    XCTAssertEqualObjects(LOStringBuilderToNSString(nested), @"nested");
+    LOStringBuilderRelease(nested);
+
+    LOStringBuilderAppendInt(sb, -42);
+    LOStringBuilderAppendChar(sb, ' ');
+    LOStringBuilderAppendNSString(sb, @"é");
+    XCTAssertEqualObjects(LOStringBuilderToNSString(sb), @"-42 é");
+    XCTAssertTrue(LOStringBuilderToLuaString(sb) == [LOLuaString valueOf:@"-42 é"]);
+    LOStringBuilderRelease(sb);
+
+    LOStringBuilder *again = LOStringBuilderAcquire();
+    XCTAssertTrue(again == sb);
+    XCTAssertEqual(again->length, 0);
+    // a huge string does not leave a huge buffer behind
+    LOStringBuilderGrow(again, LOStringBuilderMaxRetainedCapacity * 2);
+    LOStringBuilderRelease(again);
+    again = LOStringBuilderAcquire();
+    XCTAssertLessThanOrEqual(again->capacity, LOStringBuilderMaxRetainedCapacity);
+    LOStringBuilderRelease(again);
+}
+
+
+#pragma mark - numbers
+
+- (void)testNumbersFormatAsTheShortestRoundTrip
+{
+    XCTAssertEqualObjects(LOFormat(0.1), @"0.1");
+    XCTAssertEqualObjects(LOFormat(1.0 / 3), @"0.3333333333333333");
+    XCTAssertEqualObjects(LOFormat(-1.5), @"-1.5");
+    XCTAssertEqualObjects(LOFormat(123.456), @"123.456");
+    XCTAssertEqualObjects(LOFormat(9007199254740992.0), @"9007199254740992");
+    XCTAssertEqualObjects(LOFormat(1e20), @"100000000000000000000");
+    XCTAssertEqualObjects(LOFormat(1e21), @"1e+21");
+    XCTAssertEqualObjects(LOFormat(1e100), @"1e+100");
+    XCTAssertEqualObjects(LOFormat(0.0001), @"0.0001");
+    XCTAssertEqualObjects(LOFormat(0.00001), @"1e-05");
+    XCTAssertEqualObjects(LOFormat(5e-324), @"5e-324");
+    XCTAssertEqualObjects(LOFormat(1.7976931348623157e308), @"1.7976931348623157e+308");
+    XCTAssertEqualObjects(LOFormat(INFINITY), @"inf");
+    XCTAssertEqualObjects(LOFormat(-INFINITY), @"-inf");
+    XCTAssertEqualObjects(LOFormat(NAN), @"nan");
+    XCTAssertEqualObjects(LOFormat(-0.0), @"-0");
+
+    // every finite double reads back as itself
+    uint64_t bits = 0x9E3779B97F4A7C15ULL;
+    for (int i = 0; i < 10000; i++) {
+        bits = bits * 6364136223846793005ULL + 1442695040888963407ULL;
+        double d;
+        memcpy(&d, &bits, sizeof(d));
+        if (!isfinite(d) || d == 0)
+            continue;
+        LOTValue v;
+        NSString *text = LOFormat(d);
+        XCTAssertTrue(LOParse(text.UTF8String, &v), @"%@", text);
+        XCTAssertEqual(LOTValueToDouble(v), d, @"%@", text);
+    }
+}
+
+- (void)testFormattingIgnoresTheLocale
+{
+    char *saved = strdup(setlocale(LC_NUMERIC, NULL));
+    setlocale(LC_NUMERIC, "de_DE.UTF-8");
+    XCTAssertEqualObjects(LOFormat(1.5), @"1.5");
+    LOTValue v;
+    XCTAssertTrue(LOParse("1.5", &v));
+    XCTAssertEqual(LOTValueToDouble(v), 1.5);
+    setlocale(LC_NUMERIC, saved);
+    free(saved);
+}
+
+- (void)testNumeralsParseAsLuaReadsThem
+{
+    LOTValue v;
+    XCTAssertTrue(LOParse("  12\t", &v));
+    XCTAssertTrue(LOTValueIsInt(v));
+    XCTAssertEqual(LOTValueGetInt(v), 12);
+    XCTAssertTrue(LOParse("-2147483648", &v));
+    XCTAssertTrue(LOTValueIsInt(v));
+    XCTAssertTrue(LOParse("2147483648", &v));
+    XCTAssertEqual(LOTValueToDouble(v), 2147483648.0);
+    XCTAssertTrue(LOParse("0x1F", &v));
+    XCTAssertEqual(LOTValueToDouble(v), 31);
+    XCTAssertTrue(LOParse("0x1p4", &v));
+    XCTAssertEqual(LOTValueToDouble(v), 16);
+    XCTAssertTrue(LOParse("0x.8", &v));
+    XCTAssertEqual(LOTValueToDouble(v), 0.5);
+    XCTAssertTrue(LOParse("1e2", &v));
+    XCTAssertEqual(LOTValueToDouble(v), 100);
+    XCTAssertTrue(LOParse(".5", &v));
+    XCTAssertEqual(LOTValueToDouble(v), 0.5);
+    XCTAssertTrue(LOParse("5.", &v));
+    XCTAssertEqual(LOTValueToDouble(v), 5);
+    XCTAssertTrue(LOParse("0.1", &v));
+    XCTAssertEqual(LOTValueToDouble(v), 0.1);
+    XCTAssertTrue(LOParse("1e400", &v));
+    XCTAssertEqual(LOTValueToDouble(v), INFINITY);
+
+    const char *bad[] = { "", " ", "1e", "0x", "1 2", "- 1", "1.2.3", "0x1g", "inf", "nan" };
+    for (int i = 0; i < (int)(sizeof(bad) / sizeof(bad[0])); i++)
+        XCTAssertFalse(LOParse(bad[i], &v), @"%s", bad[i]);
+}
+
+- (void)testTostringAndTonumber
+{
+    LOVarargs *r = [self run:@"return tostring(0.1), tostring(1e100), tostring(2^53), tostring(-1.5e-7), tostring(1/0),\n"
+                              "  tonumber(' 0x10 '), tonumber('1e1'), tonumber('abc'), '10' + 1,\n"
+                              "  tonumber('10', 2), tonumber('ff', 16), tonumber('zz', 36), tonumber('8', 8)"];
+    XCTAssertEqualObjects([r toNSString:1], @"0.1");
+    XCTAssertEqualObjects([r toNSString:2], @"1e+100");
+    XCTAssertEqualObjects([r toNSString:3], @"9007199254740992");
+    XCTAssertEqualObjects([r toNSString:4], @"-1.5e-07");
+    XCTAssertEqualObjects([r toNSString:5], @"inf");
+    XCTAssertEqual([r toInt:6], 16);
+    XCTAssertEqual([r toDouble:7], 10);
+    XCTAssertTrue([r isNil:8]);
+    XCTAssertEqual([r toInt:9], 11);
+    XCTAssertEqual([r toInt:10], 2);
+    XCTAssertEqual([r toInt:11], 255);
+    XCTAssertEqual([r toInt:12], 1295);
+    XCTAssertTrue([r isNil:13]);
+}
+
+@end
@@ -0,0 +1,284 @@
+//
+//  LOTableTests.m
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import "LOTestCase.h"
+#import "LOLuaTable.h"
+#import "LOLuaString.h"
+#import "LOLuaError.h"
+#import "LOLuaC.h"
+#import "LOLuaClosure.h"
+
+@interface LOTableTests : LOTestCase
+@end
+
+@implementation LOTableTests
+
+#pragma mark - array and hash parts
+
+- (void)testKeysLandInTheArrayAndHashParts
+{
+    LOVarargs *r = [self run:@"local t = {}\n"
+                              "for i = 1, 100 do t[i] = i * 2 end\n"
+                              "t.x = 'y' t[1.5] = 'f' t[-1] = 'm'\n"
+                              "return t, #t, t[50], t.x, t[1.5], t[-1], t[101]"];
+    LOLuaTable *t = (LOLuaTable *)[r arg1];
+    XCTAssertGreaterThanOrEqual(t->_arraySize, 100);
+    XCTAssertEqual([r toInt:2], 100);
+    XCTAssertEqual([r toInt:3], 100);
+    XCTAssertEqualObjects([r toNSString:4], @"y");
+    XCTAssertEqualObjects([r toNSString:5], @"f");
+    XCTAssertEqualObjects([r toNSString:6], @"m");
+    XCTAssertTrue([r isNil:7]);
+}
+
+- (void)testClearedKeysKeepProbingAndTraversalWorking
+{
+    LOLuaTable *t = [[LOLuaTable alloc] initWithArraySize:0 hashSize:0];
+    for (int i = 0; i < 200; i++)
+        [t rawSet:[LOLuaValue valueOfString:[NSString stringWithFormat:@"k%d", i]] value:[LOLuaValue valueOfInt:i]];
+    for (int i = 0; i < 200; i += 2)
+        [t rawSet:[LOLuaValue valueOfString:[NSString stringWithFormat:@"k%d", i]] value:LOLuaValue.NIL];
+
+    for (int i = 1; i < 200; i += 2)
+        XCTAssertEqual([[t rawGet:[LOLuaValue valueOfString:[NSString stringWithFormat:@"k%d", i]]] toInt], i);
+    XCTAssertTrue([[t rawGet:[LOLuaValue valueOfString:@"k10"]] isNil]);
+
+    int count = 0;
+    LOTValue key = LO_NIL, value;
+    while (LOTableNext(t, &key, &value)) {
+        XCTAssertEqual(LOTValueGetInt(value) % 2, 1);
+        count++;
+    }
+    XCTAssertEqual(count, 100);
+
+    XCTAssertThrowsSpecific([t rawSet:LOLuaValue.NIL value:[LOLuaValue valueOfInt:1]], LOLuaError);
+}
+
+#pragma mark - unboxed numeric arrays
+
+- (void)testNumericArraysPromoteOnlyWhenTheyMust
+{
+    int values[] = { 3, 1, 4, 1, 5 };
+    LOLuaTable *t = [[LOLuaTable alloc] initWithInts:values count:5];
+    int count = 0;
+    const int *ints = LOTableIntArray(t, &count);
+    XCTAssertTrue(ints != NULL);
+    XCTAssertEqual(count, 5);
+    XCTAssertEqual(ints[2], 4);
+
+    [t rawSet:[LOLuaValue valueOfInt:6] value:[LOLuaValue valueOfInt:9]];
+    XCTAssertTrue(t->_arrayKind == LOTableArrayKindInt);
+    XCTAssertEqual([[t rawGet:[LOLuaValue valueOfInt:6]] toInt], 9);
+
+    // a double turns the ints into doubles, in place of boxing them
+    [t rawSet:[LOLuaValue valueOfInt:2] value:[LOLuaValue valueOfDouble:0.5]];
+    XCTAssertTrue(t->_arrayKind == LOTableArrayKindDouble);
+    XCTAssertTrue(LOTableIntArray(t, &count) == NULL);
+    const double *doubles = LOTableDoubleArray(t, &count);
+    XCTAssertTrue(doubles != NULL);
+    XCTAssertEqual(doubles[0], 3.0);
+    XCTAssertEqual(doubles[1], 0.5);
+    XCTAssertEqual([[t rawGet:[LOLuaValue valueOfInt:1]] toInt], 3);
+
+    // anything else needs generic slots
+    [t rawSet:[LOLuaValue valueOfInt:3] value:[LOLuaValue valueOfString:@"four"]];
+    XCTAssertTrue(t->_arrayKind == LOTableArrayKindValue);
+    XCTAssertTrue(LOTableDoubleArray(t, &count) == NULL);
+    XCTAssertEqualObjects([[t rawGet:[LOLuaValue valueOfInt:3]] toNSString], @"four");
+    XCTAssertEqual([[t rawGet:[LOLuaValue valueOfInt:2]] toDouble], 0.5);
+    XCTAssertEqual([[t rawGet:[LOLuaValue valueOfInt:5]] toInt], 5);
+}
+
+- (void)testIntArraysStayUnboxedUntilAFloatArrives
+{
+    int values[] = { 3, 1, 4, 1, 5 };
+    LOLuaTable *t = [[LOLuaTable alloc] initWithInts:values count:5];
+    int count = 0;
+    const int *ints = LOTableIntArray(t, &count);
+    XCTAssertTrue(ints != NULL);
+    XCTAssertEqual(count, 5);
+    XCTAssertEqual(ints[2], 4);
+
+    [self.globals rawSet:[LOLuaValue valueOfString:@"t"] value:t];
+    LOVarargs *r = [self run:@"local s = 0 for i = 1, #t do s = s + t[i] end\n"
+                              "t[6] = 9 t[2] = 0.5\n"
+                              "return s, t[6], t[2], t[1]"];
+    XCTAssertEqual([r toInt:1], 14);
+    XCTAssertEqual([r toInt:2], 9);
+    XCTAssertEqual([r toDouble:3], 0.5);
+    XCTAssertEqual([r toInt:4], 3);
+
+    XCTAssertTrue(t->_arrayKind == LOTableArrayKindDouble);
+    XCTAssertTrue(LOTableIntArray(t, &count) == NULL);
+    const double *doubles = LOTableDoubleArray(t, &count);
+    XCTAssertTrue(doubles != NULL);
+    XCTAssertEqual(doubles[0], 3.0);
+    XCTAssertEqual(doubles[1], 0.5);
+}
+
+- (void)testOtherValuesPromoteTheArrayToGenericSlots
+{
+    LOVarargs *r = [self run:@"local t = {1, 2, 3}\n"
+                              "t[4] = -2147483648\n"
+                              "t[2] = 'two'\n"
+                              "return t, t[1], t[2], t[3], t[4], #t"];
+    LOLuaTable *t = (LOLuaTable *)[r arg1];
+    XCTAssertTrue(t->_arrayKind == LOTableArrayKindValue);
+    XCTAssertEqual([r toInt:2], 1);
+    XCTAssertEqualObjects([r toNSString:3], @"two");
+    XCTAssertEqual([r toInt:4], 3);
+    XCTAssertEqual([r toDouble:5], -2147483648.0);
+    XCTAssertEqual([r toInt:6], 4);
+}
+
+
+#pragma mark - field caches
+
+- (void)testFieldCachesFollowTheTableAtHand
+{
+    LOLuaString *x = [LOLuaString valueOf:@"x"];
+    LOLuaTable *a = [LOLuaTable new], *b = [LOLuaTable new], *c = [LOLuaTable new];
+    [a rawSet:x value:[LOLuaValue valueOfInt:1]];
+    [b rawSet:[LOLuaValue valueOfString:@"y"] value:[LOLuaValue valueOfInt:0]];
+    [b rawSet:x value:[LOLuaValue valueOfInt:2]];
+
+    LOFieldCache cache = { 0 };
+    XCTAssertEqual(LOTValueGetInt(LOTableGetStrCached(a, x, &cache)), 1);
+    XCTAssertTrue(cache.entry & 1);
+    // a slot cached for one table is checked against the next one
+    XCTAssertEqual(LOTValueGetInt(LOTableGetStrCached(b, x, &cache)), 2);
+    XCTAssertEqual(LOTValueGetInt(LOTableGetStrCached(a, x, &cache)), 1);
+
+    XCTAssertTrue(LOTValueIsNil(LOTableGetStrCached(c, x, &cache)));
+    XCTAssertEqual(cache.entry, LOFieldCacheAbsent(c->_version));
+    [c rawSet:x value:[LOLuaValue valueOfInt:3]];
+    XCTAssertEqual(LOTValueGetInt(LOTableGetStrCached(c, x, &cache)), 3);
+
+    // stores through the cache update the slot in place
+    LOTableSetStrCached(c, x, LOTValueFromInt(4), &cache);
+    XCTAssertEqual([[c rawGet:x] toInt], 4);
+    [c rawSet:x value:LOLuaValue.NIL];
+    XCTAssertTrue(LOTValueIsNil(LOTableGetStrCached(c, x, &cache)));
+}
+
+- (void)testFieldCachesFollowEveryTableShape
+{
+    LOVarargs *r = [self run:@"local function get(t) return t.x end\n"
+                              "local a, b = { x = 1 }, { y = 0, x = 2 }\n"
+                              "local seen = {}\n"
+                              "for i = 1, 4 do seen[#seen + 1] = get(a) seen[#seen + 1] = get(b) end\n"
+                              "local c = {}\n"
+                              "local before = get(c)\n"
+                              "c.x = 3\n"
+                              "local after = get(c)\n"
+                              "for i = 1, 100 do a['k' .. i] = i end\n"
+                              "local grown = get(a)\n"
+                              "a.x = nil\n"
+                              "local removed = get(a)\n"
+                              "a.x = 4\n"
+                              "return seen[7], seen[8], before, after, grown, removed, get(a)"];
+    XCTAssertEqual([r toInt:1], 1);
+    XCTAssertEqual([r toInt:2], 2);
+    XCTAssertTrue([r isNil:3]);
+    XCTAssertEqual([r toInt:4], 3);
+    XCTAssertEqual([r toInt:5], 1);
+    XCTAssertTrue([r isNil:6]);
+    XCTAssertEqual([r toInt:7], 4);
+}
+
+- (void)testGlobalCachesSeeStoresFromOutsideLua
+{
+    LOLuaClosure *f = [LOLuaC load:[@"counter = (counter or 0) + 1 return counter, missing"
+                                     dataUsingEncoding:NSUTF8StringEncoding]
+                              name:@"=test" env:self.globals];
+    XCTAssertEqual([[f invoke:LOLuaValue.NONE] toInt:1], 1);
+    XCTAssertEqual([[f invoke:LOLuaValue.NONE] toInt:1], 2);
+
+    [self.globals rawSet:[LOLuaValue valueOfString:@"counter"] value:[LOLuaValue valueOfInt:10]];
+    [self.globals rawSet:[LOLuaValue valueOfString:@"missing"] value:[LOLuaValue valueOfString:@"here"]];
+    LOVarargs *r = [f invoke:LOLuaValue.NONE];
+    XCTAssertEqual([r toInt:1], 11);
+    XCTAssertEqualObjects([r toNSString:2], @"here");
+
+    [self.globals rawSet:[LOLuaValue valueOfString:@"missing"] value:LOLuaValue.NIL];
+    XCTAssertTrue([[f invoke:LOLuaValue.NONE] isNil:2]);
+}
+
+
+#pragma mark - metatables
+
+- (void)testMissingMetatagsAreRememberedUntilAStringKeyIsStored
+{
+    LOLuaTable *t = [LOLuaTable new], *mt = [LOLuaTable new];
+    [t setmetatable:mt];
+    LOLuaValue *key = [LOLuaValue valueOfString:@"missing"];
+    XCTAssertTrue([[t get:key] isNil]);
+    XCTAssertTrue(mt->_flags & (1u << LOTagMethodIndex));
+    XCTAssertTrue(LOTValueIsNil(LOTableFastTM(mt, LOTagMethodIndex)));
+
+    LOLuaTable *defaults = [LOLuaTable new];
+    [defaults rawSet:key value:[LOLuaValue valueOfString:@"found"]];
+    [mt rawSet:[LOLuaValue valueOfString:@"__index"] value:defaults];
+    XCTAssertEqual(mt->_flags, 0u);
+    XCTAssertEqualObjects([[t get:key] toNSString], @"found");
+    XCTAssertTrue(LOTValueGetObject(LOTableFastTM(mt, LOTagMethodIndex)) == defaults);
+
+    [mt rawSet:[LOLuaValue valueOfString:@"__index"] value:LOLuaValue.NIL];
+    XCTAssertTrue([[t get:key] isNil]);
+}
+
+- (void)testMetatagsAddedAfterAMissAreFound
+{
+    LOLuaTable *t = [LOLuaTable new], *mt = [LOLuaTable new];
+    [t setmetatable:mt];
+    [self.globals rawSet:[LOLuaValue valueOfString:@"t"] value:t];
+    LOLuaClosure *f = [LOLuaC load:[@"return t.missing, #t" dataUsingEncoding:NSUTF8StringEncoding]
+                              name:@"=test" env:self.globals];
+
+    // the misses mark __index and __len as absent in mt
+    LOVarargs *r = [f invoke:LOLuaValue.NONE];
+    XCTAssertTrue([r isNil:1]);
+    XCTAssertEqual([r toInt:2], 0);
+
+    LOLuaTable *defaults = [LOLuaTable new];
+    [defaults rawSet:[LOLuaValue valueOfString:@"missing"] value:[LOLuaValue valueOfString:@"found"]];
+    [mt rawSet:[LOLuaValue valueOfString:@"__index"] value:defaults];
+    [self.globals rawSet:[LOLuaValue valueOfString:@"mt"] value:mt];
+    [self run:@"mt.__len = function() return 99 end"];
+    r = [f invoke:LOLuaValue.NONE];
+    XCTAssertEqualObjects([r toNSString:1], @"found");
+    XCTAssertEqual([r toInt:2], 99);
+
+    [mt rawSet:[LOLuaValue valueOfString:@"__index"] value:LOLuaValue.NIL];
+    XCTAssertTrue([[f invoke:LOLuaValue.NONE] isNil:1]);
+}
+
+- (void)testArithmeticAndCallMetatags
+{
+    LOLuaTable *mt = [LOLuaTable new];
+    [self.globals rawSet:[LOLuaValue valueOfString:@"mt"] value:mt];
+    [self run:@"mt.__add = function(a, b) return a.v + b.v end\n"
+               "mt.__call = function(self, x) return self.v * x end\n"
+               "mt.__eq = function(a, b) return a.v == b.v end\n"
+               "mt.__lt = function(a, b) return a.v < b.v end"];
+    LOLuaTable *a = [LOLuaTable new], *b = [LOLuaTable new];
+    [a rawSet:[LOLuaValue valueOfString:@"v"] value:[LOLuaValue valueOfInt:2]];
+    [b rawSet:[LOLuaValue valueOfString:@"v"] value:[LOLuaValue valueOfInt:2]];
+    [a setmetatable:mt];
+    [b setmetatable:mt];
+    [self.globals rawSet:[LOLuaValue valueOfString:@"a"] value:a];
+    [self.globals rawSet:[LOLuaValue valueOfString:@"b"] value:b];
+
+    LOVarargs *r = [self run:@"return a + b, a(21), a == b, a < b"];
+    XCTAssertEqual([r toInt:1], 4);
+    XCTAssertEqual([r toInt:2], 42);
+    XCTAssertTrue([r toBoolean:3]);
+    XCTAssertFalse([r toBoolean:4]);
+    XCTAssertThrowsSpecific([self run:@"return a .. b"], LOLuaError);
+}
+
+@end
@@ -0,0 +1,32 @@
+//
+//  LOTestCase.h
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import <XCTest/XCTest.h>
+#import "LOGlobals.h"
+#import "LOVarargs.h"
+
+@class LOLuaValue;
+
+/**
+ * Base class of the specs: each test gets fresh globals with the base and
+ * coroutine libraries installed, and runs lua source in them.
+ */
+@interface LOTestCase : XCTestCase
+
+/** The environment the snippets run in, new for every test */
+@property (nonatomic, strong) LOGlobals *globals;
+
+/**
+ * Compile {@code source} as the chunk "=test" and call it with no arguments.
+ * @return all the results of the chunk
+ */
+- (LOVarargs *)run:(NSString *)source;
+
+/** The first result of running {@code source}, or NIL */
+- (LOLuaValue *)eval:(NSString *)source;
+
+@end
@@ -0,0 +1,42 @@
+//
+//  LOTestCase.m
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import "LOTestCase.h"
+#import "LOLuaC.h"
+#import "LOLuaClosure.h"
+#import "LOBaseLib.h"
+#import "LOCoroutineLib.h"
+
+@implementation LOTestCase
+
+- (void)setUp
+{
+    [super setUp];
+    self.globals = [LOGlobals new];
+    [[LOBaseLib new] invoke:[LOLuaValue varargsOf:LOLuaValue.NIL varargs:self.globals]];
+    [[LOCoroutineLib new] invoke:[LOLuaValue varargsOf:LOLuaValue.NIL varargs:self.globals]];
+}
+
+- (void)tearDown
+{
+    self.globals = nil;
+    [super tearDown];
+}
+
+- (LOVarargs *)run:(NSString *)source
+{
+    NSData *chunk = [source dataUsingEncoding:NSUTF8StringEncoding];
+    LOLuaClosure *f = [LOLuaC load:chunk name:@"=test" env:self.globals];
+    return [f invoke:LOLuaValue.NONE];
+}
+
+- (LOLuaValue *)eval:(NSString *)source
+{
+    return [[self run:source] arg1] ?: LOLuaValue.NIL;
+}
+
+@end
@@ -0,0 +1,312 @@
+//
+//  LOVMTests.m
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import "LOTestCase.h"
+#import "LOLuaError.h"
+#import "LOLua.h"
+#import "LOLuaClosure.h"
+#import "LOLuaTable.h"
+#import "LOLuaThread.h"
+#import "LOUpValue.h"
+#import "LOPrototype.h"
+#import "LODumpState.h"
+#import "LOJIT.h"
+
+@interface LOVMTests : LOTestCase
+@end
+
+/** The current opcode of the first instruction of {@code f} whose generic form is {@code op} */
+static LOOpCode LOQuickenedOpCode(LOLuaClosure *f, LOOpCode op)
+{
+    LOPrototype *p = f->_p;
+    for (int pc = 0; pc < p->_codeSize; pc++) {
+        LOOpCode o = (LOOpCode)LO_GET_OPCODE(p->_code[pc]);
+        if (LOOpCodeGeneric(o) == op)
+            return o;
+    }
+    return (LOOpCode)-1;
+}
+
+@implementation LOVMTests
+
+#pragma mark - interpreter loop
+
+- (void)testControlFlowAndCalls
+{
+    LOVarargs *r = [self run:@"local function range(n)\n"
+                              "  return function(_, i) if i < n then return i + 1 end end, nil, 0\n"
+                              "end\n"
+                              "local sum = 0\n"
+                              "for i in range(10) do sum = sum + i end\n"
+                              "for i = 10, 1, -3 do sum = sum + i end\n"
+                              "local n = 0\n"
+                              "while true do n = n + 1 if n >= 5 then break end end\n"
+                              "repeat n = n * 2 until n > 100\n"
+                              "return sum, n, 1 < 2, 'a' < 'b', 2 <= 1, 3 == 3.0, 'x' .. 1 .. 2.5"];
+    XCTAssertEqual([r toInt:1], 55 + 10 + 7 + 4 + 1);
+    XCTAssertEqual([r toInt:2], 160);
+    XCTAssertTrue([r toBoolean:3]);
+    XCTAssertTrue([r toBoolean:4]);
+    XCTAssertFalse([r toBoolean:5]);
+    XCTAssertTrue([r toBoolean:6]);
+    XCTAssertEqualObjects([r toNSString:7], @"x12.5");
+}
+
+- (void)testLuaCallsDoNotGrowTheNativeStack
+{
+    // deep enough that one native frame per lua call would overflow
+    LOVarargs *r = [self run:@"local function depth(n) if n == 0 then return 0 end return 1 + depth(n - 1) end\n"
+                              "local function loop(n, acc) if n == 0 then return acc end return loop(n - 1, acc + 1) end\n"
+                              "return depth(20000), loop(1000000, 0)"];
+    XCTAssertEqual([r toInt:1], 20000);
+    XCTAssertEqual([r toInt:2], 1000000);
+}
+
+- (void)testMultipleResultsAndConstructors
+{
+    LOVarargs *r = [self run:@"local function three() return 1, 2, 3 end\n"
+                              "local obj = { n = 10 }\n"
+                              "function obj:add(k) return self.n + k end\n"
+                              "local t = { three(), three() }\n"
+                              "local u = { three(), (three()) }\n"
+                              "local big = {}\n"
+                              "for i = 1, 120 do big[i] = i end\n"
+                              "local copy = { table = big, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,\n"
+                              "  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, three() }\n"
+                              "local a, b, c, d = three()\n"
+                              "return #t, #u, obj:add(5), #copy, copy[53], d"];
+    XCTAssertEqual([r toInt:1], 4);
+    XCTAssertEqual([r toInt:2], 2);
+    XCTAssertEqual([r toInt:3], 15);
+    XCTAssertEqual([r toInt:4], 53);
+    XCTAssertEqual([r toInt:5], 3);
+    XCTAssertTrue([r isNil:6]);
+}
+
+- (void)testRuntimeErrorsStopTheLoop
+{
+    XCTAssertThrowsSpecific([self run:@"local t = nil return t.x"], LOLuaError);
+    XCTAssertThrowsSpecific([self run:@"return {} + 1"], LOLuaError);
+    XCTAssertThrowsSpecific([self run:@"return #5"], LOLuaError);
+    XCTAssertThrowsSpecific([self run:@"return 1 < 'x'"], LOLuaError);
+    // the thread is left usable
+    XCTAssertEqual([[self eval:@"return 6 * 7"] toInt], 42);
+}
+
+
+#pragma mark - upvalues
+
+- (void)testOpenUpvaluesAreSharedAndClosedOffTheStack
+{
+    LOLuaThread *L = [LOLuaThread new];
+    int base = LOLuaThreadReserve(L, 3);
+    L->_stack[base + 1] = LOTValueFromInt(1);
+    LOUpValue *a = LOLuaThreadFindUpvalue(L, base + 1);
+    LOUpValue *b = LOLuaThreadFindUpvalue(L, base + 2);
+    XCTAssertTrue(LOLuaThreadFindUpvalue(L, base + 1) == a);
+    // highest slot first
+    XCTAssertTrue(L->_openUpvalues == b);
+    XCTAssertTrue(b->next == a);
+
+    // an open upvalue reads and writes the slot itself
+    LOUpValueRetain(a);
+    XCTAssertTrue(LOUpValueIsOpen(a));
+    LOUpValueSet(a, LOTValueFromInt(2));
+    XCTAssertEqual(LOTValueGetInt(L->_stack[base + 1]), 2);
+
+    LOLuaThreadCloseUpvalues(L, base + 1);
+    XCTAssertTrue(L->_openUpvalues == NULL);
+    XCTAssertFalse(LOUpValueIsOpen(a));
+    L->_stack[base + 1] = LOTValueFromInt(3);
+    XCTAssertEqual(LOTValueGetInt(LOUpValueGet(a)), 2);
+    LOUpValueRelease(a);
+    LOLuaThreadPopTo(L, base);
+}
+
+- (void)testClosuresInALoopCaptureFreshLocals
+{
+    LOVarargs *r = [self run:@"local fs = {}\n"
+                              "for i = 1, 3 do fs[i] = function() return i end end\n"
+                              "local gs = {}\n"
+                              "local j = 0\n"
+                              "while j < 3 do j = j + 1 local k = j * 10 gs[j] = function() k = k + 1 return k end end\n"
+                              "return fs[1](), fs[2](), fs[3](), gs[1](), gs[1](), gs[3]()"];
+    XCTAssertEqual([r toInt:1], 1);
+    XCTAssertEqual([r toInt:2], 2);
+    XCTAssertEqual([r toInt:3], 3);
+    XCTAssertEqual([r toInt:4], 11);
+    XCTAssertEqual([r toInt:5], 12);
+    XCTAssertEqual([r toInt:6], 31);
+}
+
+- (void)testClosuresShareTheirUpvalues
+{
+    LOVarargs *r = [self run:@"local function counter()\n"
+                              "  local n = 0\n"
+                              "  local function inc() n = n + 1 return n end\n"
+                              "  local function get() return n end\n"
+                              "  inc()\n"
+                              "  return inc, get, n\n"
+                              "end\n"
+                              "local inc, get, before = counter()\n"
+                              "inc() inc()\n"
+                              "local inc2, get2 = counter()\n"
+                              "return get(), before, get2(), (function() local x = 1 local function f() return x end x = 2 return f() end)()"];
+    XCTAssertEqual([r toInt:1], 3);
+    XCTAssertEqual([r toInt:2], 1);
+    XCTAssertEqual([r toInt:3], 1);
+    XCTAssertEqual([r toInt:4], 2);
+}
+
+
+#pragma mark - quickening
+
+- (void)testArithmeticQuickensAndFallsBack
+{
+    LOLuaClosure *add = (LOLuaClosure *)[self eval:@"return function(a, b) return a + b end"];
+    NSData *generic = [LODumpState dump:add->_p stripDebug:NO];
+    XCTAssertTrue(LOQuickenedOpCode(add, LO_OP_ADD) == LO_OP_ADD);
+
+    LOLuaValue *r = [add call:[LOLuaValue valueOfInt:1] arg2:[LOLuaValue valueOfInt:2]];
+    XCTAssertTrue(r.isIntType);
+    XCTAssertEqual(r.toInt, 3);
+    XCTAssertTrue(LOQuickenedOpCode(add, LO_OP_ADD) == LO_OP_ADD_II);
+
+    // an int overflow stays in the int form and gives the exact double
+    r = [add call:[LOLuaValue valueOfInt:INT_MAX] arg2:[LOLuaValue valueOfInt:1]];
+    XCTAssertEqual(r.toDouble, 2147483648.0);
+    XCTAssertTrue(LOQuickenedOpCode(add, LO_OP_ADD) == LO_OP_ADD_II);
+
+    r = [add call:[LOLuaValue valueOfDouble:1.5] arg2:[LOLuaValue valueOfInt:2]];
+    XCTAssertEqual(r.toDouble, 3.5);
+    XCTAssertTrue(LOQuickenedOpCode(add, LO_OP_ADD) == LO_OP_ADD_FF);
+
+    // two ints through the number form still give an int
+    r = [add call:[LOLuaValue valueOfInt:2] arg2:[LOLuaValue valueOfInt:3]];
+    XCTAssertTrue(r.isIntType);
+    XCTAssertEqual(r.toInt, 5);
+
+    r = [add call:[LOLuaValue valueOfString:@"10"] arg2:[LOLuaValue valueOfInt:1]];
+    XCTAssertEqual(r.toInt, 11);
+    XCTAssertTrue(LOQuickenedOpCode(add, LO_OP_ADD) == LO_OP_ADD);
+    XCTAssertThrowsSpecific([add call:[LOLuaTable new] arg2:[LOLuaValue valueOfInt:1]], LOLuaError);
+
+    // what runs is never what is dumped
+    [add call:[LOLuaValue valueOfInt:1] arg2:[LOLuaValue valueOfInt:2]];
+    XCTAssertEqualObjects([LODumpState dump:add->_p stripDebug:NO], generic);
+}
+
+- (void)testQuickenedFormsKeepTheGenericResults
+{
+    LOVarargs *r = [self run:@"local function f(a, b) return 1 / (a * b), a - b end\n"
+                              "f(0.5, 2)\n"
+                              "local x, y = f(0, -5)\n"
+                              "local function g(a, b) return 1 / (a * b) end\n"
+                              "g(2, 3)\n"
+                              "return x, y, g(0, -5)"];
+    XCTAssertEqual([r toDouble:1], INFINITY);
+    XCTAssertEqual([r toInt:2], 5);
+    XCTAssertEqual([r toDouble:3], INFINITY);
+}
+
+- (void)testArrayReadsQuickenAndFallBack
+{
+    LOLuaClosure *get = (LOLuaClosure *)[self eval:@"return function(t, k) return t[k] end"];
+    LOLuaTable *array = [[self eval:@"return {10, 20, 30}"] checkTable];
+    XCTAssertEqual([[get call:array arg2:[LOLuaValue valueOfInt:2]] toInt], 20);
+    XCTAssertTrue(LOQuickenedOpCode(get, LO_OP_GETTABLE) == LO_OP_GETTABLE_ARR);
+
+    // a miss with an __index handler leaves the array form
+    LOLuaTable *mt = [LOLuaTable new], *defaults = [LOLuaTable new];
+    [defaults rawSet:[LOLuaValue valueOfInt:3] value:[LOLuaValue valueOfString:@"default"]];
+    [mt rawSet:[LOLuaValue valueOfString:@"__index"] value:defaults];
+    LOLuaTable *sparse = [[self eval:@"return {1, 2}"] checkTable];
+    [sparse setmetatable:mt];
+    XCTAssertEqualObjects([[get call:sparse arg2:[LOLuaValue valueOfInt:3]] toNSString], @"default");
+    XCTAssertTrue([[get call:array arg2:[LOLuaValue valueOfString:@"x"]] isNil]);
+    XCTAssertTrue([[get call:array arg2:[LOLuaValue valueOfInt:4]] isNil]);
+    XCTAssertEqual([[get call:array arg2:[LOLuaValue valueOfInt:3]] toInt], 30);
+}
+
+- (void)testThreadsQuickeningSharedCodeAgree
+{
+    LOLuaClosure *add = (LOLuaClosure *)[self eval:@"return function(a, b) return a + b end"];
+    __block int wrong = 0;
+    // each OS thread flips the instruction between the int and number forms
+    dispatch_apply(8, dispatch_get_global_queue(DISPATCH_QUEUE_PRIORITY_DEFAULT, 0), ^(size_t n) {
+        for (int j = 0; j < 5000; j++) {
+            BOOL ints = (j + n) % 2 == 0;
+            LOLuaValue *a = ints ? [LOLuaValue valueOfInt:j] : [LOLuaValue valueOfDouble:j + 0.5];
+            LOLuaValue *r = [add call:a arg2:[LOLuaValue valueOfInt:1]];
+            if (r.toDouble != (ints ? j + 1 : j + 1.5) || r.isIntType != ints)
+                __atomic_add_fetch(&wrong, 1, __ATOMIC_RELAXED);
+        }
+    });
+    XCTAssertEqual(wrong, 0);
+    LOOpCode op = LOQuickenedOpCode(add, LO_OP_ADD);
+    XCTAssertTrue(op == LO_OP_ADD_II || op == LO_OP_ADD_FF);
+}
+
+
+#pragma mark - baseline compiler
+
+- (void)testCompiledCodeGivesTheInterpreterResults
+{
+    NSArray<NSString *> *programs = @[
+        @"local s = 0 for i = 1, 100000 do s = s + i end return s",
+        @"local s = 2147483000 for i = 1, 2000 do s = s + i end return s, s - 2147483000",
+        @"local n, steps = 27, 0 while n ~= 1 do if n % 2 == 0 then n = n / 2 else n = 3 * n + 1 end steps = steps + 1 end return steps",
+        @"local x = 0.5 for i = 1, 1000 do x = x * 1.001 - 0.0001 end return x",
+        @"local t = {} for i = 1, 500 do t[i] = i * i end local s = 0 for i = 1, #t do s = s + t[i] end return s",
+        @"local function sq(x) return x * x end local s = 0 for i = 1, 3000 do s = s + sq(i % 7) end return s",
+        @"local a, b, z, m = 0, 1, 0, -5 for i = 1, 70 do a, b = b, a + b end return a, z * m, 1 / (z * m)",
+        @"local s = '' for i = 1, 300 do if i % 100 == 0 then s = s .. i end end return s",
+    ];
+    BOOL enabled = LOJIT.enabled;
+    int threshold = LOJIT.threshold;
+    LOJIT.enabled = NO;
+    NSMutableArray<NSString *> *interpreted = [NSMutableArray array];
+    for (NSString *program in programs)
+        [interpreted addObject:[[self run:program] toNSString]];
+
+    LOJIT.enabled = YES;
+    LOJIT.threshold = 1;
+    @try {
+        XCTAssertEqual(LOJIT.enabled, LOJIT.available);
+        // twice: the first run may compile halfway through a loop
+        for (int round = 0; round < 2; round++) {
+            for (NSUInteger i = 0; i < programs.count; i++)
+                XCTAssertEqualObjects([[self run:programs[i]] toNSString], interpreted[i], @"%@", programs[i]);
+        }
+    } @finally {
+        LOJIT.enabled = enabled;
+        LOJIT.threshold = threshold;
+    }
+    XCTAssertEqualObjects(interpreted[1], @"(2149484000,2001000)");
+    XCTAssertEqualObjects(interpreted[6], @"(190392490709135,0,inf)");
+}
+
+- (void)testSwitchingTheCompilerOffMidwayKeepsRunning
+{
+    BOOL enabled = LOJIT.enabled;
+    int threshold = LOJIT.threshold;
+    LOJIT.enabled = YES;
+    LOJIT.threshold = 1;
+    @try {
+        LOLuaClosure *sum = (LOLuaClosure *)[self eval:@"return function(n) local s = 0 for i = 1, n do s = s + i end return s end"];
+        XCTAssertEqual([[sum call:[LOLuaValue valueOfInt:1000]] toInt], 500500);
+        LOJIT.enabled = NO;
+        XCTAssertEqual([[sum call:[LOLuaValue valueOfInt:1000]] toInt], 500500);
+        LOJIT.enabled = YES;
+        XCTAssertEqual([[sum call:[LOLuaValue valueOfInt:2000]] toInt], 2001000);
+    } @finally {
+        LOJIT.enabled = enabled;
+        LOJIT.threshold = threshold;
+    }
+}
+
+@end
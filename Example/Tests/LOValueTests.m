@@ -0,0 +1,174 @@
+//
+//  LOValueTests.m
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import "LOTestCase.h"
+#import "LOLuaValue.h"
+#import "LOLuaInteger.h"
+#import "LOLuaDouble.h"
+#import "LOLuaBoolean.h"
+#import "LOLuaNil.h"
+#import "LOLuaString.h"
+#import "LOLuaTable.h"
+#import "LOLuaError.h"
+
+@interface LOValueTests : LOTestCase
+@end
+
+@implementation LOValueTests
+
+#pragma mark - immediates
+
+- (void)testNumbersBooleansAndNilAreImmediates
+{
+    LOTValue i = LOTValueFromInt(-7);
+    XCTAssertTrue(LOTValueIsInt(i));
+    XCTAssertFalse(LOTValueIsObject(i));
+    XCTAssertEqual(LOTValueGetInt(i), -7);
+
+    LOTValue d = LOTValueFromDouble(0.5);
+    XCTAssertTrue(LOTValueIsDouble(d));
+    XCTAssertEqual(LOTValueGetDouble(d), 0.5);
+
+    // a NaN with a payload must not read back as a tagged value
+    uint64_t bits = 0xFFFF800000000001ULL;
+    double nan;
+    memcpy(&nan, &bits, sizeof(nan));
+    XCTAssertTrue(LOTValueIsDouble(LOTValueFromDouble(nan)));
+
+    XCTAssertTrue(LOTValueIsNil(LO_NIL));
+    XCTAssertTrue(LOTValueToBoolean(LO_TRUE));
+    XCTAssertFalse(LOTValueToBoolean(LO_FALSE));
+    XCTAssertFalse(LOTValueToBoolean(LO_NIL));
+
+    XCTAssertTrue(LOTValueIsInt(LOTValueFromNumber(3.0)));
+    XCTAssertTrue(LOTValueIsDouble(LOTValueFromNumber(-0.0)));
+    XCTAssertTrue(LOTValueIsDouble(LOTValueFromNumber(4294967296.0)));
+}
+
+- (void)testBoxingRoundTrips
+{
+    XCTAssertTrue([LOTValueBox(LOTValueFromInt(42)) isKindOfClass:[LOLuaInteger class]]);
+    XCTAssertEqual(((LOLuaInteger *)LOTValueBox(LOTValueFromInt(42))).v, 42);
+    XCTAssertTrue([LOTValueBox(LOTValueFromDouble(2.5)) isKindOfClass:[LOLuaDouble class]]);
+    XCTAssertTrue(LOTValueBox(LO_NIL) == LOLuaValue.NIL);
+    XCTAssertTrue(LOTValueBox(LO_TRUE) == [LOLuaBoolean defaultTrue]);
+
+    XCTAssertEqual(LOTValueUnbox([LOLuaValue valueOfInt:42]), LOTValueFromInt(42));
+    XCTAssertEqual(LOTValueUnbox([LOLuaValue valueOfDouble:2.5]), LOTValueFromDouble(2.5));
+    XCTAssertEqual(LOTValueUnbox(nil), LO_NIL);
+    XCTAssertEqual(LOTValueUnbox([LOLuaBoolean defaultFalse]), LO_FALSE);
+}
+
+- (void)testLuaArithmeticKeepsIntsAsInts
+{
+    LOVarargs *r = [self run:@"local a, b = 40, 2 return a + b, a / b, a / 3, 2147483647 + 1, nil, true"];
+    XCTAssertTrue([[r arg:1] isIntType]);
+    XCTAssertEqual([r toInt:1], 42);
+    XCTAssertTrue([[r arg:2] isIntType]);
+    XCTAssertEqual([r toInt:2], 20);
+    XCTAssertFalse([[r arg:3] isIntType]);
+    XCTAssertEqualWithAccuracy([r toDouble:3], 40.0 / 3, 1e-12);
+    // overflowing an int gives the exact double
+    XCTAssertEqual([r toDouble:4], 2147483648.0);
+    XCTAssertTrue([r isNil:5]);
+    XCTAssertTrue([r toBoolean:6]);
+}
+
+#pragma mark - pooled constructors
+
+- (void)testSmallIntsArePooled
+{
+    XCTAssertTrue([LOLuaInteger valueOf:LOLuaIntegerCacheMin] == [LOLuaValue valueOfInt:LOLuaIntegerCacheMin]);
+    XCTAssertTrue([LOLuaInteger valueOf:LOLuaIntegerCacheMax] == [LOLuaInteger valueOf:LOLuaIntegerCacheMax]);
+    XCTAssertTrue([LOLuaValue valueOfDouble:7.0] == [LOLuaInteger valueOf:7]);
+    XCTAssertEqual([LOLuaInteger valueOf:LOLuaIntegerCacheMax + 1].v, LOLuaIntegerCacheMax + 1);
+    XCTAssertTrue([[LOLuaValue valueOfDouble:0.25] isKindOfClass:[LOLuaDouble class]]);
+}
+
+- (void)testShortStringsAreInterned
+{
+    LOLuaString *key = [LOLuaString valueOf:@"pooled"];
+    XCTAssertTrue([LOLuaString valueOf:@"pooled"] == key);
+    XCTAssertTrue([LOLuaString valueOfBytes:"pooled" length:6] == key);
+    // strings lua builds at run time are the same instances
+    XCTAssertTrue([self eval:@"local a = 'poo' return a .. 'led'"] == key);
+
+    NSString *text = [@"" stringByPaddingToLength:LOLuaStringMaxShortLength + 1 withString:@"x" startingAtIndex:0];
+    LOLuaString *a = [LOLuaString valueOf:text], *b = [LOLuaString valueOf:text];
+    XCTAssertTrue(LOLuaStringEquals(a, b));
+    XCTAssertEqual(LOLuaStringHash(a), LOLuaStringHash(b));
+}
+
+#pragma mark - varargs
+
+- (void)testVarargsOfPicksTheSmallestForm
+{
+    LOLuaValue *a = [LOLuaValue valueOfInt:1], *b = [LOLuaValue valueOfString:@"b"], *c = [LOLuaValue valueOfDouble:2.5];
+    XCTAssertTrue([LOLuaValue varargsOf:@[]] == LOLuaValue.NONE);
+    XCTAssertEqual(LOLuaValue.NONE.narg, 0);
+    XCTAssertTrue([LOLuaValue varargsOf:@[a]] == a);
+
+    LOVarargs *pair = [LOLuaValue varargsOf:@[a, b]];
+    XCTAssertEqual(pair.narg, 2);
+    XCTAssertTrue([pair arg:2] == b);
+    XCTAssertTrue([[pair arg:3] isNil]);
+    XCTAssertTrue([pair subArgs:2] == b);
+
+    LOVarargs *three = [LOLuaValue varargsOf:@[a, b, c]];
+    LOVarargs *tail = [three subArgs:2];
+    XCTAssertEqual(tail.narg, 2);
+    XCTAssertTrue([tail arg1] == b);
+    XCTAssertEqual([tail toDouble:2], 2.5);
+    XCTAssertEqual([three subArgs:4].narg, 0);
+
+    LOVarargs *prepended = [LOLuaValue varargsOf:c varargs:pair];
+    XCTAssertEqual(prepended.narg, 3);
+    XCTAssertTrue([prepended arg:3] == b);
+}
+
+- (void)testLuaVarargsPassThrough
+{
+    LOVarargs *r = [self run:@"local function f(...) return ... end\n"
+                              "local function g(a, ...) return f(...) end\n"
+                              "return g(1, 2, 3, nil)"];
+    XCTAssertEqual(r.narg, 3);
+    XCTAssertEqual([r toInt:1], 2);
+    XCTAssertEqual([r toInt:2], 3);
+    XCTAssertTrue([r isNil:3]);
+    XCTAssertEqual([self run:@"local function f(...) return ... end return f()"].narg, 0);
+}
+
+#pragma mark - argument accessors
+
+- (void)testAccessorsDispatchOnTheArgumentTypes
+{
+    LOLuaTable *t = [[LOLuaTable alloc] initWithArraySize:0 hashSize:0];
+    LOVarargs *args = [LOLuaValue varargsOf:@[[LOLuaValue valueOfInt:3], [LOLuaValue valueOfDouble:2.75],
+                                              [LOLuaValue valueOfString:@"12"], t, LOLuaValue.NIL]];
+    XCTAssertEqual([args type:1], LOLuaTypeNumber);
+    XCTAssertEqual([args type:2], LOLuaTypeNumber);
+    XCTAssertEqual([args type:3], LOLuaTypeString);
+    XCTAssertEqual([args type:4], LOLuaTypeTable);
+    XCTAssertEqual([args type:5], LOLuaTypeNil);
+
+    XCTAssertEqual([args checkInt:1], 3);
+    XCTAssertEqual([args checkInt:2], 2);
+    XCTAssertEqual([args checkDouble:2], 2.75);
+    XCTAssertTrue([args isNumber:3]);
+    XCTAssertEqual([args checkInt:3], 12);
+    XCTAssertTrue([args isString:1]);
+    XCTAssertFalse([args isString:4]);
+    XCTAssertTrue([args checkTable:4] == t);
+    XCTAssertTrue([args isNil:5]);
+    XCTAssertTrue([args isNoneOrNil:6]);
+    XCTAssertEqual([args optInt:6 defval:9], 9);
+
+    XCTAssertThrowsSpecific([args checkInt:4], LOLuaError);
+    XCTAssertThrowsSpecific([args checkTable:1], LOLuaError);
+}
+
+@end
@@ -0,0 +1,32 @@
+//
+//  LOArrayVarargs.h
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import "LOVarargs.h"
+#import "LOTValue.h"
+
+/** Varargs implementation backed by a slice of an array of values,
+ * followed by an optional Varargs with the remaining values.
+ * <p>
+ * This is an internal class not intended to be used directly.
+ * Instead use the corresponding static methods on LuaValue.
+ * <p>
+ * The values are held in an immutable buffer shared between all slices of it,
+ * so {@link #subArgs:} returns a view with a new offset and never copies.
+ *
+ * @see LuaValue#varargsOf(LuaValue[], int, int)
+ * @see LuaValue#varargsOf(LuaValue[], int, int, Varargs)
+ */
+@interface LOArrayVarargs : LOVarargs
+
+/** Construct a Varargs from a copy of {@code count} values followed by {@code more}.
+ * @param values the values to copy, they are retained by the new buffer
+ * @param count number of values
+ * @param more the values that follow, or nil for none
+ */
+- (instancetype)initWithValues:(const LOTValue *)values count:(int)count more:(LOVarargs *)more;
+
+@end
@@ -0,0 +1,112 @@
+//
+//  LOArrayVarargs.m
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import "LOArrayVarargs.h"
+#import "LOLuaValue.h"
+
+/** Immutable, shared backing store of an array varargs and all its slices */
+@interface LOArrayVarargsBuffer : NSObject {
+@public
+    LOTValue *_values;
+    int _count;
+}
+@end
+@implementation LOArrayVarargsBuffer
+
+- (void)dealloc
+{
+    for (int i = 0; i < _count; i++)
+        LOTValueRelease(_values[i]);
+    free(_values);
+}
+
+@end
+
+@interface LOArrayVarargs ()
+
+@property (nonatomic, strong) LOArrayVarargsBuffer *buffer;
+@property (nonatomic, assign) int offset;
+@property (nonatomic, assign) int length;
+@property (nonatomic, strong) LOVarargs *more;
+
+@end
+@implementation LOArrayVarargs
+
+- (instancetype)initWithValues:(const LOTValue *)values count:(int)count more:(LOVarargs *)more
+{
+    LOArrayVarargsBuffer *buffer = [[LOArrayVarargsBuffer alloc] init];
+    buffer->_values = malloc(count * sizeof(LOTValue));
+    buffer->_count = count;
+    for (int i = 0; i < count; i++) {
+        LOTValueRetain(values[i]);
+        buffer->_values[i] = values[i];
+    }
+    return [self initWithBuffer:buffer offset:0 length:count more:more];
+}
+
+- (instancetype)initWithBuffer:(LOArrayVarargsBuffer *)buffer offset:(int)offset length:(int)length more:(LOVarargs *)more
+{
+    if (self = [super init]) {
+        _buffer = buffer;
+        _offset = offset;
+        _length = length;
+        _more = more ?: LOLuaValue.NONE;
+        _slots = &buffer->_values;
+        _slotsBase = offset;
+        _slotsCount = length;
+    }
+    return self;
+}
+
+- (LOLuaValue *)arg:(int)i
+{
+    if (i < 1)
+        return LOLuaValue.NIL;
+    if (i <= _length)
+        return LOTValueBox(_buffer->_values[_offset + i - 1]);
+    return [_more arg:i - _length];
+}
+
+- (LOTValue)argValue:(int)i
+{
+    if (i < 1)
+        return LO_NIL;
+    if (i <= _length)
+        return _buffer->_values[_offset + i - 1];
+    return LOVarargsArgValue(_more, i - _length);
+}
+
+- (int)narg
+{
+    return _length + _more.narg;
+}
+
+- (LOLuaValue *)arg1
+{
+    return _length > 0 ? LOTValueBox(_buffer->_values[_offset]) : _more.arg1;
+}
+
+- (LOVarargs *)subArgs:(int)start
+{
+    if (start <= 0)
+        return [LOLuaValue argError:1 msg:@"start must be > 0"];
+    if (start == 1)
+        return self;
+    if (start > _length)
+        return [_more subArgs:start - _length];
+    if (start == _length && _more.narg == 0)
+        return LOTValueBox(_buffer->_values[_offset + start - 1]);
+    return [[LOArrayVarargs alloc] initWithBuffer:_buffer offset:_offset + start - 1 length:_length - (start - 1) more:_more];
+}
+
+- (LOVarargs *)dealias
+{
+    LOVarargs *more = [_more dealias];
+    return more == _more ? self : [[LOArrayVarargs alloc] initWithBuffer:_buffer offset:_offset length:_length more:more];
+}
+
+@end
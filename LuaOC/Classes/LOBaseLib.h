@@ -0,0 +1,34 @@
+//
+//  LOBaseLib.h
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import "LOLuaFunction.h"
+
+/**
+ * Subclass of {@link LOLuaFunction} that implements the lua basic library functions
+ * that convert values to and from strings: {@code print}, {@code tostring}
+ * and {@code tonumber}, along with the protected call functions {@code pcall}
+ * and {@code error}.
+ * <p>
+ * Calling it with a table as the second argument installs the functions into
+ * that environment, and returns the environment.
+ * <p>
+ * Both serialize their arguments into the thread's {@link LOStringBuilder},
+ * so formatting a line costs no temporary string per value; {@code print}
+ * writes the bytes of the line to the output in one go.  {@code tonumber}
+ * reads numerals with {@link LOLuaNumberParse}.
+ * <p>
+ * {@code error} records its value on the thread with {@link LOLuaThreadSetError}
+ * instead of throwing; {@code pcall} runs its function under
+ * {@link LOLuaThread#pcall:args:}, which collects both recorded and thrown errors.
+ * @see LOStringBuilder
+ */
+@interface LOBaseLib : LOLuaFunction
+
+/** Where {@code print} writes, standard output by default */
+@property (class, nonatomic, assign) FILE *output;
+
+@end
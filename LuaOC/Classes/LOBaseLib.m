@@ -0,0 +1,143 @@
+//
+//  LOBaseLib.m
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import "LOBaseLib.h"
+#import "LOLuaTable.h"
+#import "LOLuaString.h"
+#import "LOLuaNumber.h"
+#import "LOVarargs.h"
+#import "LOLuaThread.h"
+
+typedef NS_ENUM(int, LOBaseOp) {
+    LOBaseOpPrint = 0,
+    LOBaseOpToString,
+    LOBaseOpToNumber,
+    LOBaseOpPCall,
+    LOBaseOpError,
+};
+
+static FILE *_output;
+
+/** One function of the library, dispatching on its op */
+@interface LOBaseFunction : LOLuaFunction {
+@public
+    LOBaseOp _op;
+}
+@end
+
+@implementation LOBaseLib
+
++ (FILE *)output
+{
+    return _output ?: stdout;
+}
+
++ (void)setOutput:(FILE *)output
+{
+    _output = output;
+}
+
+- (LOVarargs *)invoke:(LOVarargs *)args
+{
+    static NSString *const names[] = { @"print", @"tostring", @"tonumber", @"pcall", @"error" };
+    LOLuaTable *env = [args checkTable:2];
+    for (int op = LOBaseOpPrint; op <= LOBaseOpError; op++) {
+        LOBaseFunction *f = [LOBaseFunction new];
+        f->_op = op;
+        [env rawSet:[LOLuaValue valueOfString:names[op]] value:f];
+    }
+    return env;
+}
+
+@end
+
+/** {@code tonumber(s, base)}: an integer numeral in {@code base}, NIL if {@code s} is not one */
+static LOLuaValue *LOBaseToNumberInBase(LOLuaString *s, int base)
+{
+    const unsigned char *p = LOLuaStringBytes(s), *end = p + s->_length;
+    while (p < end && isspace(*p))
+        p++;
+    BOOL negative = p < end && *p == '-';
+    if (negative)
+        p++;
+    double n = 0;
+    const unsigned char *first = p;
+    for (; p < end && isalnum(*p); p++) {
+        int digit = isdigit(*p) ? *p - '0' : (toupper(*p) - 'A') + 10;
+        if (digit >= base)
+            return LOLuaValue.NIL;
+        n = n * base + digit;
+    }
+    while (p < end && isspace(*p))
+        p++;
+    if (p == first || p != end)
+        return LOLuaValue.NIL;
+    return [LOLuaValue valueOfDouble:negative ? -n : n];
+}
+
+@implementation LOBaseFunction
+
+- (NSString *)toNSString
+{
+    return [NSString stringWithFormat:@"function: builtin: %p", self];
+}
+
+- (LOVarargs *)invoke:(LOVarargs *)args
+{
+    switch (_op) {
+        case LOBaseOpPrint: {
+            LOStringBuilder *sb = LOStringBuilderAcquire();
+            @try {
+                for (int i = 1, n = args.narg; i <= n; i++) {
+                    if (i > 1)
+                        LOStringBuilderAppendChar(sb, '\t');
+                    LOTValueAppendToString(sb, LOVarargsArgValue(args, i));
+                }
+                LOStringBuilderAppendChar(sb, '\n');
+                FILE *output = LOBaseLib.output;
+                fwrite(sb->bytes, 1, sb->length, output);
+                fflush(output);
+            } @finally {
+                LOStringBuilderRelease(sb);
+            }
+            return LOLuaValue.NONE;
+        }
+        case LOBaseOpToString:
+            [args checkValue:1];
+            return LOTValueToLuaString(LOVarargsArgValue(args, 1));
+        case LOBaseOpToNumber: {
+            LOTValue v = LOVarargsArgValue(args, 1);
+            if ([args isNil:2]) {
+                [args checkValue:1];
+                if (LOTValueIsNumber(v))
+                    return LOTValueBox(v);
+                LOTValue n;
+                if (LOTValueIsObject(v) && LOTValueType(v) == LOLuaTypeString
+                    && LOLuaNumberParse(LOLuaStringBytes((LOLuaString *)LOTValueGetObject(v)), ((LOLuaString *)LOTValueGetObject(v))->_length, &n))
+                    return LOTValueBox(n);
+                return LOLuaValue.NIL;
+            }
+            int base = [args checkInt:2];
+            [args argCheck:base >= 2 && base <= 36 index:2 message:@"base out of range"];
+            return LOBaseToNumberInBase([args checkString:1], base);
+        }
+        case LOBaseOpPCall:
+            return [LOLuaThreadCurrent() pcall:[args checkValue:1] args:[args subArgs:2]];
+        case LOBaseOpError: {
+            // recorded rather than thrown: the call returning to lua raises it unless protected
+            LOLuaThread *L = LOLuaThreadCurrent();
+            LOLuaValue *message = [args arg1];
+            int level = [args optInt:2 defval:1];
+            if ([args isString:1] && level > 0)
+                message = LOLuaStringConcat([LOLuaString valueOf:LOLuaThreadWhere(L, level)], LOTValueToLuaString(LOVarargsArgValue(args, 1)));
+            return LOLuaThreadSetError(L, message);
+        }
+    }
+    return LOLuaValue.NONE;
+}
+
+@end
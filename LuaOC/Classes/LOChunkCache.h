@@ -0,0 +1,75 @@
+//
+//  LOChunkCache.h
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import <Foundation/Foundation.h>
+
+@class LOPrototype, LOLuaClosure, LOLuaValue;
+
+#define LOChunkCacheDigestLength 32
+
+/** The built-in SHA-256 of {@code length} bytes, used where CommonCrypto is missing */
+FOUNDATION_EXTERN void LOChunkCacheSHA256(const void *bytes, size_t length, uint8_t digest[LOChunkCacheDigestLength]);
+
+/** Continue the CRC-32 {@code crc}, the one of zlib, over {@code length} bytes; start with 0 */
+FOUNDATION_EXTERN uint32_t LOChunkCacheCRC32(uint32_t crc, const void *bytes, size_t length);
+
+/**
+ * Persistent cache of compiled chunks in a directory.
+ * <p>
+ * The first time a source is loaded it is compiled with {@link LOLuaC} and
+ * its prototypes are written to the directory as a binary chunk; later
+ * loads of the same source, also by later processes, memory map that file
+ * and undump it with {@link LOLoadState} instead of compiling again.
+ * <p>
+ * An entry is keyed by the SHA-256 of the source and by {@link LO_VM_VERSION}.
+ * The file is named after the digest and starts with a small header
+ * repeating the key, followed by the length and CRC-32 of the binary
+ * chunk.  Nothing is trusted from the file name alone, and the chunk is
+ * checked before it is undumped, since bytecode is not verified: a truncated
+ * or damaged entry is never run.  The check guards against accidents, not
+ * against whoever can write the cache directory, so a hit costs the digest
+ * of the source plus one CRC-32 pass over the chunk.  CommonCrypto computes
+ * the digest where it exists, {@link LOChunkCacheSHA256} elsewhere.
+ * The chunk name is not part of the key: entries are written without
+ * source names and take the name given to the load.
+ * <p>
+ * Entries are written atomically, so concurrent loaders in one or several
+ * processes only ever see whole files.  An unreadable or corrupted entry is
+ * compiled again and replaced.  Failing to write the cache is not an error.
+ * @see LOLuaC
+ * @see LODumpState
+ */
+@interface LOChunkCache : NSObject
+
+/** The directory holding the entries */
+@property (nonatomic, copy, readonly) NSString *directory;
+
+/**
+ * Create a cache in {@code directory}, creating the directory if needed.
+ */
+- (instancetype)initWithDirectory:(NSString *)directory;
+
+/**
+ * The compiled main function of {@code source}, from the cache if it is
+ * there, else compiled and stored.
+ * @param source the lua source text
+ * @param name the chunk name, e.g. {@code @file.lua}
+ * @throws LuaError if the source has a syntax error
+ */
+- (LOPrototype *)prototypeForSource:(NSData *)source name:(NSString *)name;
+
+/**
+ * Load a chunk, either lua source, through the cache, or a precompiled
+ * binary chunk, into a closure ready to call.
+ * @see LOLuaC#load:name:env:
+ */
+- (LOLuaClosure *)load:(NSData *)chunk name:(NSString *)name env:(LOLuaValue *)env;
+
+/** Remove every entry of the cache */
+- (void)removeAllEntries;
+
+@end
@@ -0,0 +1,205 @@
+//
+//  LOChunkCache.m
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import "LOChunkCache.h"
+#import "LOLua.h"
+#import "LOLuaC.h"
+#import "LOLoadState.h"
+#import "LODumpState.h"
+#import "LOLuaClosure.h"
+#import "LOLuaError.h"
+
+/* Apple platforms hash sources with CommonCrypto, others with the SHA-256 below */
+#if __has_include(<CommonCrypto/CommonDigest.h>)
+#import <CommonCrypto/CommonDigest.h>
+#define LO_HAVE_COMMONCRYPTO 1
+#else
+#define LO_HAVE_COMMONCRYPTO 0
+#endif
+
+/* SHA-256, FIPS 180-4 */
+static const uint32_t LOSHA256K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#define LOSHA256Rotr(x, n)  (((x) >> (n)) | ((x) << (32 - (n))))
+
+static void LOSHA256Block(uint32_t h[8], const uint8_t *p)
+{
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++)
+        w[i] = (uint32_t)p[4 * i] << 24 | (uint32_t)p[4 * i + 1] << 16 | (uint32_t)p[4 * i + 2] << 8 | p[4 * i + 3];
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = LOSHA256Rotr(w[i - 15], 7) ^ LOSHA256Rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = LOSHA256Rotr(w[i - 2], 17) ^ LOSHA256Rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4], f = h[5], g = h[6], k = h[7];
+    for (int i = 0; i < 64; i++) {
+        uint32_t t1 = k + (LOSHA256Rotr(e, 6) ^ LOSHA256Rotr(e, 11) ^ LOSHA256Rotr(e, 25)) + ((e & f) ^ (~e & g)) + LOSHA256K[i] + w[i];
+        uint32_t t2 = (LOSHA256Rotr(a, 2) ^ LOSHA256Rotr(a, 13) ^ LOSHA256Rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        k = g; g = f; f = e; e = d + t1;
+        d = c; c = b; b = a; a = t1 + t2;
+    }
+    h[0] += a; h[1] += b; h[2] += c; h[3] += d;
+    h[4] += e; h[5] += f; h[6] += g; h[7] += k;
+}
+
+void LOChunkCacheSHA256(const void *bytes, size_t length, uint8_t digest[LOChunkCacheDigestLength])
+{
+    uint32_t h[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    const uint8_t *p = bytes;
+    size_t n = length;
+    for (; n >= 64; p += 64, n -= 64)
+        LOSHA256Block(h, p);
+    // the tail, a 1 bit, zeros and the bit length fill one or two more blocks
+    uint8_t tail[128] = {0};
+    memcpy(tail, p, n);
+    tail[n] = 0x80;
+    size_t end = n < 56 ? 64 : 128;
+    uint64_t bits = (uint64_t)length * 8;
+    for (int i = 0; i < 8; i++)
+        tail[end - 1 - i] = (uint8_t)(bits >> (8 * i));
+    for (size_t i = 0; i < end; i += 64)
+        LOSHA256Block(h, tail + i);
+    for (int i = 0; i < 8; i++) {
+        digest[4 * i] = (uint8_t)(h[i] >> 24);
+        digest[4 * i + 1] = (uint8_t)(h[i] >> 16);
+        digest[4 * i + 2] = (uint8_t)(h[i] >> 8);
+        digest[4 * i + 3] = (uint8_t)h[i];
+    }
+}
+
+/** SHA-256 of {@code length} bytes, the key of a source */
+static void LOChunkCacheDigest(const void *bytes, size_t length, uint8_t digest[LOChunkCacheDigestLength])
+{
+#if LO_HAVE_COMMONCRYPTO
+    CC_SHA256_CTX ctx;
+    CC_SHA256_Init(&ctx);
+    // CC_LONG is 32 bits
+    for (size_t offset = 0; offset < length; offset += UINT32_MAX)
+        CC_SHA256_Update(&ctx, (const uint8_t *)bytes + offset, (CC_LONG)MIN(length - offset, UINT32_MAX));
+    CC_SHA256_Final(digest, &ctx);
+#else
+    LOChunkCacheSHA256(bytes, length, digest);
+#endif
+}
+
+/* CRC-32 of ISO 3309 and zlib, reflected polynomial 0xEDB88320 */
+static uint32_t LOCRC32Table[256];
+
+static void LOCRC32InitTable(void *context)
+{
+    for (uint32_t i = 0; i < 256; i++) {
+        uint32_t c = i;
+        for (int k = 0; k < 8; k++)
+            c = c & 1 ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        LOCRC32Table[i] = c;
+    }
+}
+
+uint32_t LOChunkCacheCRC32(uint32_t crc, const void *bytes, size_t length)
+{
+    static dispatch_once_t once;
+    dispatch_once_f(&once, NULL, LOCRC32InitTable);
+    const uint8_t *p = bytes;
+    crc = ~crc;
+    for (size_t i = 0; i < length; i++)
+        crc = LOCRC32Table[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+/**
+ * Header of a cache entry, followed by the binary chunk.  The fields up to
+ * {@code chunkLength} are the key; the length and CRC-32 of the chunk catch
+ * a truncated or damaged file before it is undumped and run.
+ */
+typedef struct LOChunkCacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t sourceLength;
+    uint8_t digest[LOChunkCacheDigestLength];
+    uint64_t chunkLength;
+    uint32_t chunkCRC;
+    uint32_t reserved;
+} LOChunkCacheHeader;
+
+static const char LOChunkCacheMagic[4] = {'L', 'O', 'C', 'C'};
+
+@implementation LOChunkCache
+
+- (instancetype)initWithDirectory:(NSString *)directory
+{
+    if (self = [super init]) {
+        _directory = [directory copy];
+        [[NSFileManager defaultManager] createDirectoryAtPath:_directory withIntermediateDirectories:YES attributes:nil error:NULL];
+    }
+    return self;
+}
+
+- (LOPrototype *)prototypeForSource:(NSData *)source name:(NSString *)name
+{
+    LOChunkCacheHeader header = {{0}};
+    memcpy(header.magic, LOChunkCacheMagic, 4);
+    header.version = LO_VM_VERSION;
+    header.sourceLength = source.length;
+    LOChunkCacheDigest(source.bytes, source.length, header.digest);
+    const size_t keyLength = offsetof(LOChunkCacheHeader, chunkLength);
+
+    NSMutableString *file = [NSMutableString stringWithCapacity:LOChunkCacheDigestLength * 2 + 5];
+    for (int i = 0; i < LOChunkCacheDigestLength; i++)
+        [file appendFormat:@"%02x", header.digest[i]];
+    [file appendString:@".luac"];
+    NSString *path = [_directory stringByAppendingPathComponent:file];
+
+    NSData *entry = [NSData dataWithContentsOfFile:path options:NSDataReadingMappedIfSafe error:NULL];
+    if (entry.length > sizeof(header) && memcmp(entry.bytes, &header, keyLength) == 0) {
+        LOChunkCacheHeader stored;
+        memcpy(&stored, entry.bytes, sizeof(stored));
+        if (stored.chunkLength == entry.length - sizeof(stored)
+            && stored.chunkCRC == LOChunkCacheCRC32(0, (const uint8_t *)entry.bytes + sizeof(stored), (size_t)stored.chunkLength)) {
+            @try {
+                return [LOLoadState undump:entry offset:sizeof(stored) name:name];
+            } @catch (LOLuaError *e) {
+                // an entry of an incompatible build, compile again and replace it
+            }
+        }
+    }
+
+    LOPrototype *p = [LOLuaC compile:source name:name];
+    NSMutableData *data = [NSMutableData dataWithLength:sizeof(header)];
+    [LODumpState dump:p into:data stripDebug:NO omitSource:YES];
+    header.chunkLength = data.length - sizeof(header);
+    header.chunkCRC = LOChunkCacheCRC32(0, (const uint8_t *)data.bytes + sizeof(header), (size_t)header.chunkLength);
+    [data replaceBytesInRange:NSMakeRange(0, sizeof(header)) withBytes:&header];
+    [data writeToFile:path options:NSDataWritingAtomic error:NULL];
+    return p;
+}
+
+- (LOLuaClosure *)load:(NSData *)chunk name:(NSString *)name env:(LOLuaValue *)env
+{
+    LOPrototype *p = [LOLoadState isBinaryChunk:chunk] ? [LOLoadState undump:chunk name:name] : [self prototypeForSource:chunk name:name];
+    return [[LOLuaClosure alloc] initWithPrototype:p env:env];
+}
+
+- (void)removeAllEntries
+{
+    NSFileManager *fm = [NSFileManager defaultManager];
+    for (NSString *file in [fm contentsOfDirectoryAtPath:_directory error:NULL]) {
+        if ([file.pathExtension isEqualToString:@"luac"])
+            [fm removeItemAtPath:[_directory stringByAppendingPathComponent:file] error:NULL];
+    }
+}
+
+@end
@@ -0,0 +1,27 @@
+//
+//  LOCoroutineLib.h
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import "LOLuaFunction.h"
+
+/**
+ * Subclass of {@link LOLuaFunction} that implements the lua standard {@code coroutine}
+ * library.
+ * <p>
+ * Calling it with a table as the second argument installs
+ * {@code create}, {@code resume}, {@code running}, {@code status}, {@code wrap}
+ * and {@code yield} into a new {@code coroutine} table of that environment,
+ * and returns the library table.  It also installs lua 5.4's {@code close},
+ * which ends a suspended stackful coroutine's OS thread.
+ * <p>
+ * Coroutines whose body is a {@link LOLuaClosure} are stackless, see
+ * {@link LOLuaThread}; {@code coroutine.create(f, true)} asks for a stackful
+ * one that may also yield from inside native functions.
+ * @see LOLuaThread
+ */
+@interface LOCoroutineLib : LOLuaFunction
+
+@end
@@ -0,0 +1,109 @@
+//
+//  LOCoroutineLib.m
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import "LOCoroutineLib.h"
+#import "LOLuaTable.h"
+#import "LOLuaThread.h"
+#import "LOLuaBoolean.h"
+#import "LOVarargs.h"
+
+typedef NS_ENUM(int, LOCoroutineOp) {
+    LOCoroutineOpCreate = 0,
+    LOCoroutineOpResume,
+    LOCoroutineOpRunning,
+    LOCoroutineOpStatus,
+    LOCoroutineOpWrap,
+    LOCoroutineOpYield,
+    LOCoroutineOpClose,
+};
+
+/** One function of the library, dispatching on its op */
+@interface LOCoroutineFunction : LOLuaFunction {
+@public
+    LOCoroutineOp _op;
+}
+@end
+
+/** The function returned by {@code coroutine.wrap}, resuming its thread */
+@interface LOCoroutineWrapper : LOLuaFunction {
+@public
+    LOLuaThread *_thread;
+}
+@end
+
+@implementation LOCoroutineLib
+
+- (LOVarargs *)invoke:(LOVarargs *)args
+{
+    static NSString *const names[] = { @"create", @"resume", @"running", @"status", @"wrap", @"yield", @"close" };
+    LOLuaTable *coroutine = [[LOLuaTable alloc] initWithArraySize:0 hashSize:7];
+    for (int op = LOCoroutineOpCreate; op <= LOCoroutineOpClose; op++) {
+        LOCoroutineFunction *f = [LOCoroutineFunction new];
+        f->_op = op;
+        [coroutine rawSet:[LOLuaValue valueOfString:names[op]] value:f];
+    }
+    LOLuaTable *env = [args optTable:2 defval:nil];
+    if (env)
+        [env rawSet:[LOLuaValue valueOfString:@"coroutine"] value:coroutine];
+    return coroutine;
+}
+
+@end
+
+@implementation LOCoroutineFunction
+
+- (NSString *)toNSString
+{
+    return [NSString stringWithFormat:@"function: builtin: %p", self];
+}
+
+- (LOVarargs *)invoke:(LOVarargs *)args
+{
+    switch (_op) {
+        case LOCoroutineOpCreate: {
+            LOLuaFunction *f = [args checkFunction:1];
+            return [[LOLuaThread alloc] initWithFunction:f stackful:[args optBoolean:2 defval:NO]];
+        }
+        case LOCoroutineOpResume: {
+            LOLuaThread *t = [args checkThread:1];
+            return [t resume:[args subArgs:2]];
+        }
+        case LOCoroutineOpRunning: {
+            LOLuaThread *r = LOLuaThreadCurrent();
+            return [LOLuaValue varargsOf:r varargs:[LOLuaValue valueOfBoolean:r.isMainThread]];
+        }
+        case LOCoroutineOpStatus:
+            return [LOLuaValue valueOfString:[[args checkThread:1] statusName]];
+        case LOCoroutineOpWrap: {
+            LOLuaFunction *f = [args checkFunction:1];
+            LOCoroutineWrapper *w = [LOCoroutineWrapper new];
+            w->_thread = [[LOLuaThread alloc] initWithFunction:f];
+            return w;
+        }
+        case LOCoroutineOpYield:
+            return [LOLuaThread yield:args];
+        case LOCoroutineOpClose:
+            [[args checkThread:1] close];
+            return [LOLuaBoolean defaultTrue];
+    }
+    return LOLuaValue.NONE;
+}
+
+@end
+
+@implementation LOCoroutineWrapper
+
+- (LOVarargs *)invoke:(LOVarargs *)args
+{
+    LOVarargs *result = [_thread resume:args];
+    if ([result arg1].toBoolean)
+        return [result subArgs:2];
+    // raise the error of the body, unchanged, in the resumer
+    return LOLuaThreadSetError(LOLuaThreadCurrent(), [result arg:2]);
+}
+
+@end
@@ -0,0 +1,45 @@
+//
+//  LODumpState.h
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import <Foundation/Foundation.h>
+
+@class LOPrototype;
+
+/**
+ * Class to dump a {@link LOPrototype} into a binary chunk, the inverse of
+ * {@link LOLoadState}.
+ * <p>
+ * The chunk has the standard lua 5.2 format, as written by {@code luac}
+ * or {@code string.dump}, in the native byte order of the host, with 8
+ * byte {@code size_t} and all numbers as doubles, so it can be read back
+ * with {@link LOLoadState#undump:name:} or by the C lua 5.2 runtime.
+ * <p>
+ * A prototype can be dumped after it has run: the instructions the
+ * interpreter has quickened in place are written in their generic form.
+ * @see LOLoadState
+ */
+@interface LODumpState : NSObject
+
+/**
+ * Dump a function prototype as a binary chunk.
+ * @param f the main function prototype of the chunk
+ * @param stripDebug YES to leave out the debug information, as {@code luac -s}
+ * @return the binary chunk
+ */
++ (NSData *)dump:(LOPrototype *)f stripDebug:(BOOL)stripDebug;
+
+/**
+ * Append the binary chunk of a function prototype to {@code data}.
+ * @param f the main function prototype of the chunk
+ * @param data the data to append to
+ * @param stripDebug YES to leave out the debug information, as {@code luac -s}
+ * @param omitSource YES to leave out only the source names, so the loader
+ * takes the name it is given instead
+ */
++ (void)dump:(LOPrototype *)f into:(NSMutableData *)data stripDebug:(BOOL)stripDebug omitSource:(BOOL)omitSource;
+
+@end
@@ -0,0 +1,184 @@
+//
+//  LODumpState.m
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import "LODumpState.h"
+#import "LOLoadState.h"
+#import "LOPrototype.h"
+#import "LOLuaString.h"
+#import "LOLua.h"
+
+/* constant types in a chunk, as in lua */
+#define LODumpStateTypeNil 0
+#define LODumpStateTypeBoolean 1
+#define LODumpStateTypeNumber 3
+#define LODumpStateTypeString 4
+
+typedef struct LODumpWriter {
+    __unsafe_unretained NSMutableData *data;
+    BOOL strip;
+    BOOL omitSource;
+} LODumpWriter;
+
+static inline void LODumpBlock(LODumpWriter *D, const void *bytes, size_t n)
+{
+    [D->data appendBytes:bytes length:n];
+}
+
+static inline void LODumpByte(LODumpWriter *D, int b)
+{
+    uint8_t c = (uint8_t)b;
+    LODumpBlock(D, &c, 1);
+}
+
+static inline void LODumpInt(LODumpWriter *D, int i)
+{
+    LODumpBlock(D, &i, 4);
+}
+
+static void LODumpString(LODumpWriter *D, LOLuaString *s)
+{
+    if (s == nil) {
+        uint64_t size = 0;
+        LODumpBlock(D, &size, 8);
+        return;
+    }
+    // the dumped size counts the terminating NUL
+    uint64_t size = (uint64_t)s->_length + 1;
+    LODumpBlock(D, &size, 8);
+    LODumpBlock(D, LOLuaStringBytes(s), s->_length);
+    LODumpByte(D, 0);
+}
+
+static void LODumpFunction(LODumpWriter *D, LOPrototype *f);
+
+/** The instructions, with the ones quickened by the interpreter back in their generic form */
+static void LODumpCode(LODumpWriter *D, LOPrototype *f)
+{
+    NSUInteger offset = D->data.length;
+    LODumpBlock(D, f->_code, f->_codeSize * 4);
+    // the chunk is not aligned: copy each instruction in and out
+    uint8_t *code = (uint8_t *)D->data.mutableBytes + offset;
+    for (int pc = 0; pc < f->_codeSize; pc++) {
+        int i;
+        memcpy(&i, code + 4 * pc, 4);
+        if (LO_ISQUICK(LO_GET_OPCODE(i))) {
+            LO_SET_OPCODE(i, LOOpCodeGeneric(LO_GET_OPCODE(i)));
+            memcpy(code + 4 * pc, &i, 4);
+        }
+    }
+}
+
+static void LODumpConstants(LODumpWriter *D, LOPrototype *f)
+{
+    LODumpInt(D, f->_kSize);
+    for (int i = 0; i < f->_kSize; i++) {
+        LOTValue v = f->_k[i];
+        if (LOTValueIsNil(v)) {
+            LODumpByte(D, LODumpStateTypeNil);
+        } else if (LOTValueIsBoolean(v)) {
+            LODumpByte(D, LODumpStateTypeBoolean);
+            LODumpByte(D, LOTValueToBoolean(v));
+        } else if (LOTValueIsNumber(v)) {
+            double d = LOTValueToDouble(v);
+            LODumpByte(D, LODumpStateTypeNumber);
+            LODumpBlock(D, &d, 8);
+        } else {
+            LODumpByte(D, LODumpStateTypeString);
+            LODumpString(D, (LOLuaString *)LOTValueGetObject(v));
+        }
+    }
+
+    LODumpInt(D, (int)f->_p.count);
+    for (LOPrototype *p in f->_p)
+        LODumpFunction(D, p);
+}
+
+static void LODumpUpvalues(LODumpWriter *D, LOPrototype *f)
+{
+    LODumpInt(D, f->_upvaluesSize);
+    for (int i = 0; i < f->_upvaluesSize; i++) {
+        LODumpByte(D, f->_upvalues[i].instack);
+        LODumpByte(D, f->_upvalues[i].idx);
+    }
+}
+
+static void LODumpDebug(LODumpWriter *D, LOPrototype *f)
+{
+    LODumpString(D, D->strip || D->omitSource ? nil : f->_source);
+
+    int n = D->strip ? 0 : f->_lineinfoSize;
+    LODumpInt(D, n);
+    LODumpBlock(D, f->_lineinfo, n * 4);
+
+    n = D->strip ? 0 : f->_locvarsSize;
+    LODumpInt(D, n);
+    for (int i = 0; i < n; i++) {
+        LODumpString(D, (LOLuaString *)LOTValueGetObject(f->_locvars[i].varname));
+        LODumpInt(D, f->_locvars[i].startpc);
+        LODumpInt(D, f->_locvars[i].endpc);
+    }
+
+    n = D->strip ? 0 : f->_upvaluesSize;
+    LODumpInt(D, n);
+    for (int i = 0; i < n; i++) {
+        LOTValue name = f->_upvalues[i].name;
+        LODumpString(D, LOTValueIsNil(name) ? nil : (LOLuaString *)LOTValueGetObject(name));
+    }
+}
+
+static void LODumpFunction(LODumpWriter *D, LOPrototype *f)
+{
+    LODumpInt(D, f->_linedefined);
+    LODumpInt(D, f->_lastlinedefined);
+    LODumpByte(D, f->_numparams);
+    LODumpByte(D, f->_isVararg);
+    LODumpByte(D, f->_maxstacksize);
+
+    LODumpInt(D, f->_codeSize);
+    LODumpCode(D, f);
+
+    LODumpConstants(D, f);
+    LODumpUpvalues(D, f);
+    LODumpDebug(D, f);
+}
+
+static void LODumpHeader(LODumpWriter *D)
+{
+    uint16_t probe = 1;
+    LODumpBlock(D, LOLoadStateSignature, 4);
+    LODumpByte(D, LOLoadStateVersion);
+    LODumpByte(D, LOLoadStateFormat);
+    LODumpByte(D, *(uint8_t *)&probe);  // endianness, 1 for little
+    LODumpByte(D, sizeof(int));
+    LODumpByte(D, 8);  // size_t
+    LODumpByte(D, 4);  // instruction
+    LODumpByte(D, sizeof(double));
+    LODumpByte(D, LOLoadStateNumberFormatFloatsOrDoubles);
+    LODumpBlock(D, LOLoadStateTail, 6);
+}
+
+@implementation LODumpState
+
++ (NSData *)dump:(LOPrototype *)f stripDebug:(BOOL)stripDebug
+{
+    NSMutableData *data = [NSMutableData data];
+    [self dump:f into:data stripDebug:stripDebug omitSource:NO];
+    return data;
+}
+
++ (void)dump:(LOPrototype *)f into:(NSMutableData *)data stripDebug:(BOOL)stripDebug omitSource:(BOOL)omitSource
+{
+    LODumpWriter D = {
+        .data = data,
+        .strip = stripDebug,
+        .omitSource = omitSource,
+    };
+    LODumpHeader(&D);
+    LODumpFunction(&D, f);
+}
+
+@end
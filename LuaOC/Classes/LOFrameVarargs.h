@@ -0,0 +1,36 @@
+//
+//  LOFrameVarargs.h
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import "LOVarargs.h"
+#import "LOTValue.h"
+
+@class LOLuaThread;
+
+/** Varargs implementation that is a window onto a thread's value stack.
+ * <p>
+ * This is an internal class not intended to be used directly.
+ * Instances are pooled by {@link LOLuaThread} and handed to functions
+ * as their arguments, so reading arguments costs no copy and a call costs
+ * no allocation.  A window is only valid while its call is active, and is
+ * reused by the next call at the same depth; a function that keeps its
+ * arguments must keep a copy made by {@link #dealias}.
+ *
+ * @see LOLuaThread#call:base:nargs:
+ */
+@interface LOFrameVarargs : LOVarargs {
+@public
+    __unsafe_unretained LOLuaThread *_thread;
+    int _base;
+    int _count;
+}
+
+- (instancetype)initWithThread:(LOLuaThread *)thread;
+
+@end
+
+/** Pointer to the first value of the window, valid until the stack next changes */
+FOUNDATION_EXTERN LOTValue *LOFrameVarargsValues(LOFrameVarargs *frame);
@@ -0,0 +1,70 @@
+//
+//  LOFrameVarargs.m
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import "LOFrameVarargs.h"
+#import "LOLuaThread.h"
+#import "LOSubVarargs.h"
+#import "LOArrayVarargs.h"
+
+LOTValue *LOFrameVarargsValues(LOFrameVarargs *frame)
+{
+    return frame->_thread->_stack + frame->_base;
+}
+
+@implementation LOFrameVarargs
+
+- (instancetype)initWithThread:(LOLuaThread *)thread
+{
+    if (self = [super init]) {
+        _thread = thread;
+    }
+    return self;
+}
+
+- (LOVarargs *)dealias
+{
+    if (_count == 0)
+        return LOLuaValue.NONE;
+    if (_count == 1)
+        return self.arg1;
+    return [[LOArrayVarargs alloc] initWithValues:LOFrameVarargsValues(self) count:_count more:nil];
+}
+
+- (LOLuaValue *)arg:(int)i
+{
+    return (unsigned)(i - 1) < (unsigned)_count ? LOTValueBox(LOFrameVarargsValues(self)[i - 1]) : LOLuaValue.NIL;
+}
+
+- (LOTValue)argValue:(int)i
+{
+    return (unsigned)(i - 1) < (unsigned)_count ? LOFrameVarargsValues(self)[i - 1] : LO_NIL;
+}
+
+- (int)narg
+{
+    return _count;
+}
+
+- (LOLuaValue *)arg1
+{
+    return _count > 0 ? LOTValueBox(LOFrameVarargsValues(self)[0]) : LOLuaValue.NIL;
+}
+
+- (LOVarargs *)subArgs:(int)start
+{
+    if (start <= 0)
+        return [LOLuaValue argError:1 msg:@"start must be > 0"];
+    if (start == 1)
+        return self;
+    if (start > _count)
+        return LOLuaValue.NONE;
+    if (start == _count)
+        return [self arg:start];
+    return [[LOSubVarargs alloc] initWithVarargs:self start:start end:_count];
+}
+
+@end
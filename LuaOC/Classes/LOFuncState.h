@@ -0,0 +1,199 @@
+//
+//  LOFuncState.h
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import "LOLexState.h"
+#import "LOLua.h"
+
+/** marks the end of a patch list. It is an invalid value both as an absolute address, and as a list link (would link an element to itself). */
+#define LO_NO_JUMP (-1)
+
+/** maximum number of upvalues in a closure (both C and Lua) (Value must fit in an unsigned char) */
+#define LO_MAXUPVAL 255
+
+/** maximum number of local variables per function (must be smaller than 250, due to the bytecode format) */
+#define LO_MAXVARS 200
+
+/** maximum stack for a Lua function */
+#define LO_MAXSTACK 250
+
+/** maximum depth for nested C calls and syntactical nested non-terminals in a program */
+#define LO_MAXCCALLS 200
+
+/** kinds of variables/expressions */
+typedef enum LOExpKind {
+    LO_VVOID,       /* no value */
+    LO_VNIL,
+    LO_VTRUE,
+    LO_VFALSE,
+    LO_VK,          /* info = index of constant in `k' */
+    LO_VKNUM,       /* nval = numerical value */
+    LO_VNONRELOC,   /* info = result register */
+    LO_VLOCAL,      /* info = local register */
+    LO_VUPVAL,      /* info = index of upvalue in 'upvalues' */
+    LO_VINDEXED,    /* t = table R/K; idx = index R/K */
+    LO_VJMP,        /* info = instruction pc */
+    LO_VRELOCABLE,  /* info = instruction pc */
+    LO_VCALL,       /* info = instruction pc */
+    LO_VVARARG      /* info = instruction pc */
+} LOExpKind;
+
+#define LO_VKISVAR(k)   (LO_VLOCAL <= (k) && (k) <= LO_VINDEXED)
+#define LO_VKISINREG(k) ((k) == LO_VNONRELOC || (k) == LO_VLOCAL)
+
+/**
+ * Description of an expression being compiled: where its value is, or
+ * will be, and its pending jumps.  Expressions are never built as trees:
+ * the parser keeps at most a few of these on the C stack and the code
+ * generator decides the register of a value as late as possible, so
+ * constants fold and results land directly in their final registers.
+ */
+typedef struct LOExpDesc {
+    LOExpKind k;
+    union {
+        /* for indexed variables (VINDEXED) */
+        struct {
+            /** index (R/K) */
+            short idx;
+            /** table (register or upvalue) */
+            uint8_t t;
+            /** whether 't' is register (VLOCAL) or upvalue (VUPVAL) */
+            uint8_t vt;
+        } ind;
+        /** for generic use */
+        int info;
+        /** for VKNUM */
+        double nval;
+    } u;
+    /** patch list of `exit when true' */
+    int t;
+    /** patch list of `exit when false' */
+    int f;
+} LOExpDesc;
+
+/** nodes for block list (list of active blocks) */
+typedef struct LOBlockCnt {
+    struct LOBlockCnt *previous;
+    /** index of first label in this block */
+    short firstlabel;
+    /** index of first pending goto in this block */
+    short firstgoto;
+    /** # active locals outside the block */
+    uint8_t nactvar;
+    /** true if some variable in the block is an upvalue */
+    uint8_t upval;
+    /** true if `block' is a loop */
+    uint8_t isloop;
+} LOBlockCnt;
+
+/**
+ * State needed to generate code for a given function, as lua's FuncState.
+ * <p>
+ * The code, constants, locals and upvalues are written straight into the
+ * arrays of the {@link LOPrototype} being built, grown by doubling, and
+ * trimmed when the function is closed.
+ */
+typedef struct LOFuncState {
+    /** current function header */
+    __unsafe_unretained LOPrototype *f;
+    /** table to find (and reuse) elements in `k' */
+    LOConstantTable *h;
+    /** enclosing function */
+    struct LOFuncState *prev;
+    /** lexical state */
+    LOLexState *ls;
+    /** chain of current blocks */
+    LOBlockCnt *bl;
+    /** next position to code (equivalent to `ncode') */
+    int pc;
+    /** `label' of last `jump label' */
+    int lasttarget;
+    /** list of pending jumps to `pc' */
+    int jpc;
+    /** number of elements in `k' */
+    int nk;
+    /** number of elements in `p' */
+    int np;
+    /** index of first child prototype in the dynamic data */
+    int firstproto;
+    /** index of first local var (in Dyndata array) */
+    int firstlocal;
+    /** number of elements in `locvars' */
+    short nlocvars;
+    /** number of active local variables */
+    uint8_t nactvar;
+    /** number of upvalues */
+    uint8_t nups;
+    /** first free register */
+    int freereg;
+    /** nesting level of the function, the index of its constant table */
+    int level;
+    /* allocated sizes of the prototype's arrays */
+    int sizecode;
+    int sizek;
+    int sizelocvars;
+    int sizeupvalues;
+} LOFuncState;
+
+/** binary operators, ORDER OPR */
+typedef enum LOBinOpr {
+    LO_OPR_ADD, LO_OPR_SUB, LO_OPR_MUL, LO_OPR_DIV, LO_OPR_MOD, LO_OPR_POW,
+    LO_OPR_CONCAT,
+    LO_OPR_EQ, LO_OPR_LT, LO_OPR_LE,
+    LO_OPR_NE, LO_OPR_GT, LO_OPR_GE,
+    LO_OPR_AND, LO_OPR_OR,
+    LO_OPR_NOBINOPR
+} LOBinOpr;
+
+typedef enum LOUnOpr { LO_OPR_MINUS, LO_OPR_NOT, LO_OPR_LEN, LO_OPR_NOUNOPR } LOUnOpr;
+
+#define LOCodeGetCode(fs,e)     ((fs)->f->_code[(e)->u.info])
+#define LOCodeAsBx(fs,o,A,sBx)  LOCodeABx(fs, o, A, (sBx) + LO_MAXARG_sBx)
+#define LOCodeSetMultRet(fs,e)  LOCodeSetReturns(fs, e, LO_MULTRET)
+#define LOCodeJumpTo(fs,t)      LOCodePatchList(fs, LOCodeJump(fs), t)
+
+FOUNDATION_EXTERN int LOCodeABx(LOFuncState *fs, LOOpCode o, int A, unsigned int Bx);
+FOUNDATION_EXTERN int LOCodeABC(LOFuncState *fs, LOOpCode o, int A, int B, int C);
+FOUNDATION_EXTERN int LOCodeK(LOFuncState *fs, int reg, int k);
+FOUNDATION_EXTERN void LOCodeFixLine(LOFuncState *fs, int line);
+FOUNDATION_EXTERN void LOCodeNil(LOFuncState *fs, int from, int n);
+FOUNDATION_EXTERN void LOCodeReserveRegs(LOFuncState *fs, int n);
+FOUNDATION_EXTERN void LOCodeCheckStack(LOFuncState *fs, int n);
+FOUNDATION_EXTERN int LOCodeStringK(LOFuncState *fs, LOLuaString *s);
+FOUNDATION_EXTERN int LOCodeNumberK(LOFuncState *fs, double r);
+FOUNDATION_EXTERN void LOCodeDischargeVars(LOFuncState *fs, LOExpDesc *e);
+FOUNDATION_EXTERN int LOCodeExp2AnyReg(LOFuncState *fs, LOExpDesc *e);
+FOUNDATION_EXTERN void LOCodeExp2AnyRegUp(LOFuncState *fs, LOExpDesc *e);
+FOUNDATION_EXTERN void LOCodeExp2NextReg(LOFuncState *fs, LOExpDesc *e);
+FOUNDATION_EXTERN void LOCodeExp2Val(LOFuncState *fs, LOExpDesc *e);
+FOUNDATION_EXTERN int LOCodeExp2RK(LOFuncState *fs, LOExpDesc *e);
+FOUNDATION_EXTERN void LOCodeSelf(LOFuncState *fs, LOExpDesc *e, LOExpDesc *key);
+FOUNDATION_EXTERN void LOCodeIndexed(LOFuncState *fs, LOExpDesc *t, LOExpDesc *k);
+FOUNDATION_EXTERN void LOCodeGoIfTrue(LOFuncState *fs, LOExpDesc *e);
+FOUNDATION_EXTERN void LOCodeGoIfFalse(LOFuncState *fs, LOExpDesc *e);
+FOUNDATION_EXTERN void LOCodeStoreVar(LOFuncState *fs, LOExpDesc *var, LOExpDesc *e);
+FOUNDATION_EXTERN void LOCodeSetReturns(LOFuncState *fs, LOExpDesc *e, int nresults);
+FOUNDATION_EXTERN void LOCodeSetOneRet(LOFuncState *fs, LOExpDesc *e);
+FOUNDATION_EXTERN int LOCodeJump(LOFuncState *fs);
+FOUNDATION_EXTERN void LOCodeRet(LOFuncState *fs, int first, int nret);
+FOUNDATION_EXTERN void LOCodePatchList(LOFuncState *fs, int list, int target);
+FOUNDATION_EXTERN void LOCodePatchToHere(LOFuncState *fs, int list);
+FOUNDATION_EXTERN void LOCodePatchClose(LOFuncState *fs, int list, int level);
+FOUNDATION_EXTERN void LOCodeConcat(LOFuncState *fs, int *l1, int l2);
+FOUNDATION_EXTERN int LOCodeGetLabel(LOFuncState *fs);
+FOUNDATION_EXTERN void LOCodePrefix(LOFuncState *fs, LOUnOpr op, LOExpDesc *v, int line);
+FOUNDATION_EXTERN void LOCodeInfix(LOFuncState *fs, LOBinOpr op, LOExpDesc *v);
+FOUNDATION_EXTERN void LOCodePosfix(LOFuncState *fs, LOBinOpr op, LOExpDesc *v1, LOExpDesc *v2, int line);
+FOUNDATION_EXTERN void LOCodeSetList(LOFuncState *fs, int base, int nelems, int tostore);
+
+/** Start a new function at the next nesting level, coding into {@code f} */
+FOUNDATION_EXTERN void LOFuncStateOpen(LOLexState *ls, LOFuncState *fs, LOPrototype *f);
+/** Trim the arrays of the function's prototype and hand it its child prototypes */
+FOUNDATION_EXTERN void LOFuncStateClose(LOLexState *ls, LOFuncState *fs);
+/** Anchor a new child prototype of the current function */
+FOUNDATION_EXTERN LOPrototype *LOFuncStateAddPrototype(LOLexState *ls);
+/** Grow a C array of the prototype or the parser to hold at least {@code n + 1} elements */
+FOUNDATION_EXTERN void *LOFuncStateGrowVector(LOLexState *ls, void *block, int n, int *size, size_t elementSize, int limit, const char *what);
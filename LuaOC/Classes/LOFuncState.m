@@ -0,0 +1,962 @@
+//
+//  LOFuncState.m
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import "LOFuncState.h"
+#import "LOPrototype.h"
+#import "LOLuaString.h"
+
+#define LO_HASJUMPS(e) ((e)->t != (e)->f)
+
+/** opcodes that test a condition and are followed by a jump */
+#define LO_TESTTMODE(op) ((op) >= LO_OP_EQ && (op) <= LO_OP_TESTSET)
+
+static inline BOOL LOCodeIsNumeral(LOExpDesc *e)
+{
+    return e->k == LO_VKNUM && e->t == LO_NO_JUMP && e->f == LO_NO_JUMP;
+}
+
+#pragma mark - vectors
+
+void *LOFuncStateGrowVector(LOLexState *ls, void *block, int n, int *size, size_t elementSize, int limit, const char *what)
+{
+    if (n + 1 <= *size)
+        return block;
+    int newsize;
+    if (*size >= limit / 2) {  /* cannot double it? */
+        if (*size >= limit)  /* cannot grow even a little? */
+            [LOLuaValue error:[NSString stringWithFormat:@"too many %s (limit is %d)", what, limit]];
+        newsize = limit;  /* still have at least one free place */
+    } else {
+        newsize = *size * 2;
+        if (newsize < 4)  /* minimum size */
+            newsize = 4;
+    }
+    block = realloc(block, newsize * elementSize);
+    *size = newsize;
+    return block;
+}
+
+#pragma mark - jumps
+
+void LOCodeNil(LOFuncState *fs, int from, int n)
+{
+    int l = from + n - 1;  /* last register to set nil */
+    if (fs->pc > fs->lasttarget) {  /* no jumps to current position? */
+        int *previous = &fs->f->_code[fs->pc - 1];
+        if (LO_GET_OPCODE(*previous) == LO_OP_LOADNIL) {
+            int pfrom = LO_GETARG_A(*previous);
+            int pl = pfrom + LO_GETARG_B(*previous);
+            if ((pfrom <= from && from <= pl + 1) || (from <= pfrom && pfrom <= l + 1)) {  /* can connect both? */
+                if (pfrom < from)
+                    from = pfrom;  /* from = min(from, pfrom) */
+                if (pl > l)
+                    l = pl;  /* l = max(l, pl) */
+                LO_SETARG_A(*previous, from);
+                LO_SETARG_B(*previous, l - from);
+                return;
+            }
+        }  /* else go through */
+    }
+    LOCodeABC(fs, LO_OP_LOADNIL, from, n - 1, 0);  /* else no optimization */
+}
+
+int LOCodeJump(LOFuncState *fs)
+{
+    int jpc = fs->jpc;  /* save list of jumps to here */
+    fs->jpc = LO_NO_JUMP;
+    int j = LOCodeAsBx(fs, LO_OP_JMP, 0, LO_NO_JUMP);
+    LOCodeConcat(fs, &j, jpc);  /* keep them on hold */
+    return j;
+}
+
+void LOCodeRet(LOFuncState *fs, int first, int nret)
+{
+    LOCodeABC(fs, LO_OP_RETURN, first, nret + 1, 0);
+}
+
+static int LOCodeCondJump(LOFuncState *fs, LOOpCode op, int A, int B, int C)
+{
+    LOCodeABC(fs, op, A, B, C);
+    return LOCodeJump(fs);
+}
+
+static void LOCodeFixJump(LOFuncState *fs, int pc, int dest)
+{
+    int *jmp = &fs->f->_code[pc];
+    int offset = dest - (pc + 1);
+    if (abs(offset) > LO_MAXARG_sBx)
+        LOLexSyntaxError(fs->ls, "control structure too long");
+    LO_SETARG_sBx(*jmp, offset);
+}
+
+/** returns current `pc' and marks it as a jump target (to avoid wrong optimizations with consecutive instructions not in the same basic block). */
+int LOCodeGetLabel(LOFuncState *fs)
+{
+    fs->lasttarget = fs->pc;
+    return fs->pc;
+}
+
+static int LOCodeGetJump(LOFuncState *fs, int pc)
+{
+    int offset = LO_GETARG_sBx(fs->f->_code[pc]);
+    if (offset == LO_NO_JUMP)  /* point to itself represents end of list */
+        return LO_NO_JUMP;  /* end of list */
+    return (pc + 1) + offset;  /* turn offset into absolute position */
+}
+
+static int *LOCodeGetJumpControl(LOFuncState *fs, int pc)
+{
+    int *pi = &fs->f->_code[pc];
+    if (pc >= 1 && LO_TESTTMODE(LO_GET_OPCODE(*(pi - 1))))
+        return pi - 1;
+    return pi;
+}
+
+/** check whether list has any jump that do not produce a value (or produce an inverted value) */
+static BOOL LOCodeNeedValue(LOFuncState *fs, int list)
+{
+    for (; list != LO_NO_JUMP; list = LOCodeGetJump(fs, list)) {
+        int i = *LOCodeGetJumpControl(fs, list);
+        if (LO_GET_OPCODE(i) != LO_OP_TESTSET)
+            return YES;
+    }
+    return NO;  /* not found */
+}
+
+static BOOL LOCodePatchTestReg(LOFuncState *fs, int node, int reg)
+{
+    int *i = LOCodeGetJumpControl(fs, node);
+    if (LO_GET_OPCODE(*i) != LO_OP_TESTSET)
+        return NO;  /* cannot patch other instructions */
+    if (reg != LO_NO_REG && reg != LO_GETARG_B(*i))
+        LO_SETARG_A(*i, reg);
+    else  /* no register to put value or register already has the value */
+        *i = LO_CREATE_ABC(LO_OP_TEST, LO_GETARG_B(*i), 0, LO_GETARG_C(*i));
+    return YES;
+}
+
+static void LOCodeRemoveValues(LOFuncState *fs, int list)
+{
+    for (; list != LO_NO_JUMP; list = LOCodeGetJump(fs, list))
+        LOCodePatchTestReg(fs, list, LO_NO_REG);
+}
+
+static void LOCodePatchListAux(LOFuncState *fs, int list, int vtarget, int reg, int dtarget)
+{
+    while (list != LO_NO_JUMP) {
+        int next = LOCodeGetJump(fs, list);
+        if (LOCodePatchTestReg(fs, list, reg))
+            LOCodeFixJump(fs, list, vtarget);
+        else
+            LOCodeFixJump(fs, list, dtarget);  /* jump to default target */
+        list = next;
+    }
+}
+
+static void LOCodeDischargeJpc(LOFuncState *fs)
+{
+    LOCodePatchListAux(fs, fs->jpc, fs->pc, LO_NO_REG, fs->pc);
+    fs->jpc = LO_NO_JUMP;
+}
+
+void LOCodePatchList(LOFuncState *fs, int list, int target)
+{
+    if (target == fs->pc)
+        LOCodePatchToHere(fs, list);
+    else
+        LOCodePatchListAux(fs, list, target, LO_NO_REG, target);
+}
+
+void LOCodePatchClose(LOFuncState *fs, int list, int level)
+{
+    level++;  /* argument is +1 to reserve 0 as non-op */
+    while (list != LO_NO_JUMP) {
+        int next = LOCodeGetJump(fs, list);
+        LO_SETARG_A(fs->f->_code[list], level);
+        list = next;
+    }
+}
+
+void LOCodePatchToHere(LOFuncState *fs, int list)
+{
+    LOCodeGetLabel(fs);
+    LOCodeConcat(fs, &fs->jpc, list);
+}
+
+void LOCodeConcat(LOFuncState *fs, int *l1, int l2)
+{
+    if (l2 == LO_NO_JUMP)
+        return;
+    if (*l1 == LO_NO_JUMP) {
+        *l1 = l2;
+        return;
+    }
+    int list = *l1;
+    int next;
+    while ((next = LOCodeGetJump(fs, list)) != LO_NO_JUMP)  /* find last element */
+        list = next;
+    LOCodeFixJump(fs, list, l2);
+}
+
+#pragma mark - instructions
+
+static int LOCodeCode(LOFuncState *fs, int i)
+{
+    LOPrototype *f = fs->f;
+    LOCodeDischargeJpc(fs);  /* `pc' will change */
+    if (fs->pc >= fs->sizecode) {
+        /* code and line info grow together */
+        int size = fs->sizecode;
+        f->_code = LOFuncStateGrowVector(fs->ls, f->_code, fs->pc, &fs->sizecode, sizeof(int), INT_MAX, "opcodes");
+        f->_lineinfo = LOFuncStateGrowVector(fs->ls, f->_lineinfo, fs->pc, &size, sizeof(int), INT_MAX, "opcodes");
+    }
+    f->_code[fs->pc] = i;
+    f->_lineinfo[fs->pc] = fs->ls->lastline;
+    return fs->pc++;
+}
+
+int LOCodeABC(LOFuncState *fs, LOOpCode o, int a, int b, int c)
+{
+    return LOCodeCode(fs, LO_CREATE_ABC(o, a, b, c));
+}
+
+int LOCodeABx(LOFuncState *fs, LOOpCode o, int a, unsigned int bc)
+{
+    return LOCodeCode(fs, LO_CREATE_ABx(o, a, bc));
+}
+
+static int LOCodeExtraArg(LOFuncState *fs, int a)
+{
+    return LOCodeCode(fs, LO_CREATE_Ax(LO_OP_EXTRAARG, a));
+}
+
+int LOCodeK(LOFuncState *fs, int reg, int k)
+{
+    if (k <= LO_MAXARG_Bx)
+        return LOCodeABx(fs, LO_OP_LOADK, reg, k);
+    int p = LOCodeABx(fs, LO_OP_LOADKX, reg, 0);
+    LOCodeExtraArg(fs, k);
+    return p;
+}
+
+void LOCodeCheckStack(LOFuncState *fs, int n)
+{
+    int newstack = fs->freereg + n;
+    if (newstack > fs->f->_maxstacksize) {
+        if (newstack >= LO_MAXSTACK)
+            LOLexSyntaxError(fs->ls, "function or expression too complex");
+        fs->f->_maxstacksize = newstack;
+    }
+}
+
+void LOCodeReserveRegs(LOFuncState *fs, int n)
+{
+    LOCodeCheckStack(fs, n);
+    fs->freereg += n;
+}
+
+static void LOCodeFreeReg(LOFuncState *fs, int reg)
+{
+    if (!LO_ISK(reg) && reg >= fs->nactvar)
+        fs->freereg--;
+}
+
+static void LOCodeFreeExp(LOFuncState *fs, LOExpDesc *e)
+{
+    if (e->k == LO_VNONRELOC)
+        LOCodeFreeReg(fs, e->u.info);
+}
+
+#pragma mark - constants
+
+static inline int LOConstantTableHash(LOTValue key, int mask)
+{
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdULL;
+    key ^= key >> 33;
+    return (int)(key & mask);
+}
+
+static void LOConstantTableResize(LOConstantTable *h)
+{
+    int capacity = h->capacity ? h->capacity * 2 : 64;
+    LOConstantSlot *slots = calloc(capacity, sizeof(LOConstantSlot));
+    for (int i = 0; i < h->capacity; i++) {
+        LOConstantSlot *s = &h->slots[i];
+        if (s->generation == h->generation) {
+            int j = LOConstantTableHash(s->key, capacity - 1);
+            while (slots[j].generation)
+                j = (j + 1) & (capacity - 1);
+            slots[j] = *s;
+            slots[j].generation = 1;
+        }
+    }
+    free(h->slots);
+    h->slots = slots;
+    h->capacity = capacity;
+    h->generation = 1;
+}
+
+/**
+ * The index of the constant {@code v} in the function's `k', added if new.
+ * Constants are keyed by the bits of their {@link LOTValue}: strings are
+ * interned by the lexer so equal ones share a pointer, and 0, -0 and NaN
+ * are kept apart as lua does.
+ */
+static int LOCodeAddK(LOFuncState *fs, LOTValue v)
+{
+    LOConstantTable *h = fs->h;
+    if (2 * (h->count + 1) > h->capacity)
+        LOConstantTableResize(h);
+    int mask = h->capacity - 1;
+    int i = LOConstantTableHash(v, mask);
+    for (LOConstantSlot *s = &h->slots[i]; s->generation == h->generation; s = &h->slots[i = (i + 1) & mask]) {
+        if (s->key == v)
+            return s->idx;
+    }
+    LOConstantSlot *s = &h->slots[i];
+    s->key = v;
+    s->idx = fs->nk;
+    s->generation = h->generation;
+    h->count++;
+    /* constant not found; create a new entry */
+    LOPrototype *f = fs->f;
+    f->_k = LOFuncStateGrowVector(fs->ls, f->_k, fs->nk, &fs->sizek, sizeof(LOTValue), LO_MAXARG_Ax, "constants");
+    LOTValueRetain(v);
+    f->_k[fs->nk] = v;
+    f->_kSize = fs->nk + 1;
+    return fs->nk++;
+}
+
+int LOCodeStringK(LOFuncState *fs, LOLuaString *s)
+{
+    return LOCodeAddK(fs, LOTValueFromPointer((__bridge void *)s));
+}
+
+int LOCodeNumberK(LOFuncState *fs, double r)
+{
+    return LOCodeAddK(fs, LOTValueFromNumber(r));
+}
+
+static int LOCodeBoolK(LOFuncState *fs, BOOL b)
+{
+    return LOCodeAddK(fs, LOTValueFromBoolean(b));
+}
+
+static int LOCodeNilK(LOFuncState *fs)
+{
+    return LOCodeAddK(fs, LO_NIL);
+}
+
+#pragma mark - expressions
+
+void LOCodeSetReturns(LOFuncState *fs, LOExpDesc *e, int nresults)
+{
+    if (e->k == LO_VCALL) {  /* expression is an open function call? */
+        LO_SETARG_C(LOCodeGetCode(fs, e), nresults + 1);
+    } else if (e->k == LO_VVARARG) {
+        LO_SETARG_B(LOCodeGetCode(fs, e), nresults + 1);
+        LO_SETARG_A(LOCodeGetCode(fs, e), fs->freereg);
+        LOCodeReserveRegs(fs, 1);
+    }
+}
+
+void LOCodeSetOneRet(LOFuncState *fs, LOExpDesc *e)
+{
+    if (e->k == LO_VCALL) {  /* expression is an open function call? */
+        e->k = LO_VNONRELOC;
+        e->u.info = LO_GETARG_A(LOCodeGetCode(fs, e));
+    } else if (e->k == LO_VVARARG) {
+        LO_SETARG_B(LOCodeGetCode(fs, e), 2);
+        e->k = LO_VRELOCABLE;  /* can relocate its simple result */
+    }
+}
+
+void LOCodeDischargeVars(LOFuncState *fs, LOExpDesc *e)
+{
+    switch (e->k) {
+        case LO_VLOCAL: {
+            e->k = LO_VNONRELOC;
+            break;
+        }
+        case LO_VUPVAL: {
+            e->u.info = LOCodeABC(fs, LO_OP_GETUPVAL, 0, e->u.info, 0);
+            e->k = LO_VRELOCABLE;
+            break;
+        }
+        case LO_VINDEXED: {
+            LOOpCode op = LO_OP_GETTABUP;  /* assume 't' is in an upvalue */
+            LOCodeFreeReg(fs, e->u.ind.idx);
+            if (e->u.ind.vt == LO_VLOCAL) {  /* 't' is in a register? */
+                LOCodeFreeReg(fs, e->u.ind.t);
+                op = LO_OP_GETTABLE;
+            }
+            e->u.info = LOCodeABC(fs, op, 0, e->u.ind.t, e->u.ind.idx);
+            e->k = LO_VRELOCABLE;
+            break;
+        }
+        case LO_VVARARG:
+        case LO_VCALL: {
+            LOCodeSetOneRet(fs, e);
+            break;
+        }
+        default:
+            break;  /* there is one value available (somewhere) */
+    }
+}
+
+static int LOCodeLabel(LOFuncState *fs, int A, int b, int jump)
+{
+    LOCodeGetLabel(fs);  /* those instructions may be jump targets */
+    return LOCodeABC(fs, LO_OP_LOADBOOL, A, b, jump);
+}
+
+static void LOCodeDischarge2Reg(LOFuncState *fs, LOExpDesc *e, int reg)
+{
+    LOCodeDischargeVars(fs, e);
+    switch (e->k) {
+        case LO_VNIL: {
+            LOCodeNil(fs, reg, 1);
+            break;
+        }
+        case LO_VFALSE: case LO_VTRUE: {
+            LOCodeABC(fs, LO_OP_LOADBOOL, reg, e->k == LO_VTRUE, 0);
+            break;
+        }
+        case LO_VK: {
+            LOCodeK(fs, reg, e->u.info);
+            break;
+        }
+        case LO_VKNUM: {
+            LOCodeK(fs, reg, LOCodeNumberK(fs, e->u.nval));
+            break;
+        }
+        case LO_VRELOCABLE: {
+            /* the instruction computing the value writes it straight to reg */
+            LO_SETARG_A(LOCodeGetCode(fs, e), reg);
+            break;
+        }
+        case LO_VNONRELOC: {
+            if (reg != e->u.info)
+                LOCodeABC(fs, LO_OP_MOVE, reg, e->u.info, 0);
+            break;
+        }
+        default:
+            return;  /* VVOID or VJMP, nothing to do... */
+    }
+    e->u.info = reg;
+    e->k = LO_VNONRELOC;
+}
+
+static void LOCodeDischarge2AnyReg(LOFuncState *fs, LOExpDesc *e)
+{
+    if (e->k != LO_VNONRELOC) {
+        LOCodeReserveRegs(fs, 1);
+        LOCodeDischarge2Reg(fs, e, fs->freereg - 1);
+    }
+}
+
+static void LOCodeExp2Reg(LOFuncState *fs, LOExpDesc *e, int reg)
+{
+    LOCodeDischarge2Reg(fs, e, reg);
+    if (e->k == LO_VJMP)
+        LOCodeConcat(fs, &e->t, e->u.info);  /* put this jump in `t' list */
+    if (LO_HASJUMPS(e)) {
+        int p_f = LO_NO_JUMP;  /* position of an eventual LOAD false */
+        int p_t = LO_NO_JUMP;  /* position of an eventual LOAD true */
+        if (LOCodeNeedValue(fs, e->t) || LOCodeNeedValue(fs, e->f)) {
+            int fj = (e->k == LO_VJMP) ? LO_NO_JUMP : LOCodeJump(fs);
+            p_f = LOCodeLabel(fs, reg, 0, 1);
+            p_t = LOCodeLabel(fs, reg, 1, 0);
+            LOCodePatchToHere(fs, fj);
+        }
+        int final = LOCodeGetLabel(fs);  /* position after whole expression */
+        LOCodePatchListAux(fs, e->f, final, reg, p_f);
+        LOCodePatchListAux(fs, e->t, final, reg, p_t);
+    }
+    e->f = e->t = LO_NO_JUMP;
+    e->u.info = reg;
+    e->k = LO_VNONRELOC;
+}
+
+void LOCodeExp2NextReg(LOFuncState *fs, LOExpDesc *e)
+{
+    LOCodeDischargeVars(fs, e);
+    LOCodeFreeExp(fs, e);
+    LOCodeReserveRegs(fs, 1);
+    LOCodeExp2Reg(fs, e, fs->freereg - 1);
+}
+
+int LOCodeExp2AnyReg(LOFuncState *fs, LOExpDesc *e)
+{
+    LOCodeDischargeVars(fs, e);
+    if (e->k == LO_VNONRELOC) {
+        if (!LO_HASJUMPS(e))
+            return e->u.info;  /* exp is already in a register */
+        if (e->u.info >= fs->nactvar) {  /* reg. is not a local? */
+            LOCodeExp2Reg(fs, e, e->u.info);  /* put value on it */
+            return e->u.info;
+        }
+    }
+    LOCodeExp2NextReg(fs, e);  /* default */
+    return e->u.info;
+}
+
+void LOCodeExp2AnyRegUp(LOFuncState *fs, LOExpDesc *e)
+{
+    if (e->k != LO_VUPVAL || LO_HASJUMPS(e))
+        LOCodeExp2AnyReg(fs, e);
+}
+
+void LOCodeExp2Val(LOFuncState *fs, LOExpDesc *e)
+{
+    if (LO_HASJUMPS(e))
+        LOCodeExp2AnyReg(fs, e);
+    else
+        LOCodeDischargeVars(fs, e);
+}
+
+int LOCodeExp2RK(LOFuncState *fs, LOExpDesc *e)
+{
+    LOCodeExp2Val(fs, e);
+    switch (e->k) {
+        case LO_VTRUE:
+        case LO_VFALSE:
+        case LO_VNIL: {
+            if (fs->nk <= LO_MAXINDEXRK) {  /* constant fits in RK operand? */
+                e->u.info = (e->k == LO_VNIL) ? LOCodeNilK(fs) : LOCodeBoolK(fs, e->k == LO_VTRUE);
+                e->k = LO_VK;
+                return LO_RKASK(e->u.info);
+            }
+            break;
+        }
+        case LO_VKNUM: {
+            e->u.info = LOCodeNumberK(fs, e->u.nval);
+            e->k = LO_VK;
+            /* go through */
+        }
+        case LO_VK: {
+            if (e->u.info <= LO_MAXINDEXRK)  /* constant fits in argC? */
+                return LO_RKASK(e->u.info);
+            break;
+        }
+        default:
+            break;
+    }
+    /* not a constant in the right range: put it in a register */
+    return LOCodeExp2AnyReg(fs, e);
+}
+
+void LOCodeStoreVar(LOFuncState *fs, LOExpDesc *var, LOExpDesc *ex)
+{
+    switch (var->k) {
+        case LO_VLOCAL: {
+            LOCodeFreeExp(fs, ex);
+            LOCodeExp2Reg(fs, ex, var->u.info);
+            return;
+        }
+        case LO_VUPVAL: {
+            int e = LOCodeExp2AnyReg(fs, ex);
+            LOCodeABC(fs, LO_OP_SETUPVAL, e, var->u.info, 0);
+            break;
+        }
+        case LO_VINDEXED: {
+            LOOpCode op = (var->u.ind.vt == LO_VLOCAL) ? LO_OP_SETTABLE : LO_OP_SETTABUP;
+            int e = LOCodeExp2RK(fs, ex);
+            LOCodeABC(fs, op, var->u.ind.t, var->u.ind.idx, e);
+            break;
+        }
+        default:
+            break;  /* invalid var kind to store */
+    }
+    LOCodeFreeExp(fs, ex);
+}
+
+void LOCodeSelf(LOFuncState *fs, LOExpDesc *e, LOExpDesc *key)
+{
+    LOCodeExp2AnyReg(fs, e);
+    int ereg = e->u.info;  /* register where 'e' was placed */
+    LOCodeFreeExp(fs, e);
+    e->u.info = fs->freereg;  /* base register for op_self */
+    e->k = LO_VNONRELOC;
+    LOCodeReserveRegs(fs, 2);  /* function and 'self' produced by op_self */
+    LOCodeABC(fs, LO_OP_SELF, e->u.info, ereg, LOCodeExp2RK(fs, key));
+    LOCodeFreeExp(fs, key);
+}
+
+static void LOCodeInvertJump(LOFuncState *fs, LOExpDesc *e)
+{
+    int *pc = LOCodeGetJumpControl(fs, e->u.info);
+    LO_SETARG_A(*pc, !(LO_GETARG_A(*pc)));
+}
+
+static int LOCodeJumpOnCond(LOFuncState *fs, LOExpDesc *e, int cond)
+{
+    if (e->k == LO_VRELOCABLE) {
+        int ie = LOCodeGetCode(fs, e);
+        if (LO_GET_OPCODE(ie) == LO_OP_NOT) {
+            fs->pc--;  /* remove previous OP_NOT */
+            return LOCodeCondJump(fs, LO_OP_TEST, LO_GETARG_B(ie), 0, !cond);
+        }
+        /* else go through */
+    }
+    LOCodeDischarge2AnyReg(fs, e);
+    LOCodeFreeExp(fs, e);
+    return LOCodeCondJump(fs, LO_OP_TESTSET, LO_NO_REG, e->u.info, cond);
+}
+
+void LOCodeGoIfTrue(LOFuncState *fs, LOExpDesc *e)
+{
+    int pc;  /* pc of last jump */
+    LOCodeDischargeVars(fs, e);
+    switch (e->k) {
+        case LO_VJMP: {
+            LOCodeInvertJump(fs, e);
+            pc = e->u.info;
+            break;
+        }
+        case LO_VK: case LO_VKNUM: case LO_VTRUE: {
+            pc = LO_NO_JUMP;  /* always true; do nothing */
+            break;
+        }
+        default: {
+            pc = LOCodeJumpOnCond(fs, e, 0);
+            break;
+        }
+    }
+    LOCodeConcat(fs, &e->f, pc);  /* insert last jump in `f' list */
+    LOCodePatchToHere(fs, e->t);
+    e->t = LO_NO_JUMP;
+}
+
+void LOCodeGoIfFalse(LOFuncState *fs, LOExpDesc *e)
+{
+    int pc;  /* pc of last jump */
+    LOCodeDischargeVars(fs, e);
+    switch (e->k) {
+        case LO_VJMP: {
+            pc = e->u.info;
+            break;
+        }
+        case LO_VNIL: case LO_VFALSE: {
+            pc = LO_NO_JUMP;  /* always false; do nothing */
+            break;
+        }
+        default: {
+            pc = LOCodeJumpOnCond(fs, e, 1);
+            break;
+        }
+    }
+    LOCodeConcat(fs, &e->t, pc);  /* insert last jump in `t' list */
+    LOCodePatchToHere(fs, e->f);
+    e->f = LO_NO_JUMP;
+}
+
+static void LOCodeNot(LOFuncState *fs, LOExpDesc *e)
+{
+    LOCodeDischargeVars(fs, e);
+    switch (e->k) {
+        case LO_VNIL: case LO_VFALSE: {
+            e->k = LO_VTRUE;
+            break;
+        }
+        case LO_VK: case LO_VKNUM: case LO_VTRUE: {
+            e->k = LO_VFALSE;
+            break;
+        }
+        case LO_VJMP: {
+            LOCodeInvertJump(fs, e);
+            break;
+        }
+        case LO_VRELOCABLE:
+        case LO_VNONRELOC: {
+            LOCodeDischarge2AnyReg(fs, e);
+            LOCodeFreeExp(fs, e);
+            e->u.info = LOCodeABC(fs, LO_OP_NOT, 0, e->u.info, 0);
+            e->k = LO_VRELOCABLE;
+            break;
+        }
+        default:
+            break;  /* cannot happen */
+    }
+    /* interchange true and false lists */
+    int temp = e->f;
+    e->f = e->t;
+    e->t = temp;
+    LOCodeRemoveValues(fs, e->f);
+    LOCodeRemoveValues(fs, e->t);
+}
+
+void LOCodeIndexed(LOFuncState *fs, LOExpDesc *t, LOExpDesc *k)
+{
+    t->u.ind.t = (uint8_t)t->u.info;
+    t->u.ind.idx = (short)LOCodeExp2RK(fs, k);
+    t->u.ind.vt = (t->k == LO_VUPVAL) ? LO_VUPVAL : LO_VLOCAL;
+    t->k = LO_VINDEXED;
+}
+
+/** lua's luaO_arith on two numerals */
+static double LOCodeArith(LOOpCode op, double a, double b)
+{
+    switch (op) {
+        case LO_OP_ADD: return a + b;
+        case LO_OP_SUB: return a - b;
+        case LO_OP_MUL: return a * b;
+        case LO_OP_DIV: return a / b;
+        case LO_OP_MOD: return a - floor(a / b) * b;
+        case LO_OP_POW: return pow(a, b);
+        case LO_OP_UNM: return -a;
+        default: return 0;
+    }
+}
+
+/** Fold an arithmetic operation on two numerals into a numeral, when it cannot raise an error */
+static BOOL LOCodeConstFolding(LOOpCode op, LOExpDesc *e1, LOExpDesc *e2)
+{
+    if (!LOCodeIsNumeral(e1) || !LOCodeIsNumeral(e2))
+        return NO;
+    if ((op == LO_OP_DIV || op == LO_OP_MOD) && e2->u.nval == 0)
+        return NO;  /* do not attempt to divide by 0 */
+    e1->u.nval = LOCodeArith(op, e1->u.nval, e2->u.nval);
+    return YES;
+}
+
+static void LOCodeArithOp(LOFuncState *fs, LOOpCode op, LOExpDesc *e1, LOExpDesc *e2, int line)
+{
+    if (LOCodeConstFolding(op, e1, e2))
+        return;
+    int o2 = (op != LO_OP_UNM && op != LO_OP_LEN) ? LOCodeExp2RK(fs, e2) : 0;
+    int o1 = LOCodeExp2RK(fs, e1);
+    if (o1 > o2) {
+        LOCodeFreeExp(fs, e1);
+        LOCodeFreeExp(fs, e2);
+    } else {
+        LOCodeFreeExp(fs, e2);
+        LOCodeFreeExp(fs, e1);
+    }
+    e1->u.info = LOCodeABC(fs, op, 0, o1, o2);
+    e1->k = LO_VRELOCABLE;
+    LOCodeFixLine(fs, line);
+}
+
+static void LOCodeComp(LOFuncState *fs, LOOpCode op, int cond, LOExpDesc *e1, LOExpDesc *e2)
+{
+    int o1 = LOCodeExp2RK(fs, e1);
+    int o2 = LOCodeExp2RK(fs, e2);
+    LOCodeFreeExp(fs, e2);
+    LOCodeFreeExp(fs, e1);
+    if (cond == 0 && op != LO_OP_EQ) {
+        /* exchange args to replace by `<' or `<=' */
+        int temp = o1;
+        o1 = o2;
+        o2 = temp;
+        cond = 1;
+    }
+    e1->u.info = LOCodeCondJump(fs, op, cond, o1, o2);
+    e1->k = LO_VJMP;
+}
+
+void LOCodePrefix(LOFuncState *fs, LOUnOpr op, LOExpDesc *e, int line)
+{
+    LOExpDesc e2;
+    e2.t = e2.f = LO_NO_JUMP;
+    e2.k = LO_VKNUM;
+    e2.u.nval = 0;
+    switch (op) {
+        case LO_OPR_MINUS: {
+            if (LOCodeIsNumeral(e))  /* minus constant? */
+                e->u.nval = -e->u.nval;  /* fold it */
+            else {
+                LOCodeExp2AnyReg(fs, e);
+                LOCodeArithOp(fs, LO_OP_UNM, e, &e2, line);
+            }
+            break;
+        }
+        case LO_OPR_NOT:
+            LOCodeNot(fs, e);
+            break;
+        case LO_OPR_LEN: {
+            LOCodeExp2AnyReg(fs, e);  /* cannot operate on constants */
+            LOCodeArithOp(fs, LO_OP_LEN, e, &e2, line);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void LOCodeInfix(LOFuncState *fs, LOBinOpr op, LOExpDesc *v)
+{
+    switch (op) {
+        case LO_OPR_AND: {
+            LOCodeGoIfTrue(fs, v);
+            break;
+        }
+        case LO_OPR_OR: {
+            LOCodeGoIfFalse(fs, v);
+            break;
+        }
+        case LO_OPR_CONCAT: {
+            LOCodeExp2NextReg(fs, v);  /* operand must be on the `stack' */
+            break;
+        }
+        case LO_OPR_ADD: case LO_OPR_SUB: case LO_OPR_MUL: case LO_OPR_DIV:
+        case LO_OPR_MOD: case LO_OPR_POW: {
+            /* keep numerals as they are, they may fold with the second operand */
+            if (!LOCodeIsNumeral(v))
+                LOCodeExp2RK(fs, v);
+            break;
+        }
+        default: {
+            LOCodeExp2RK(fs, v);
+            break;
+        }
+    }
+}
+
+void LOCodePosfix(LOFuncState *fs, LOBinOpr op, LOExpDesc *e1, LOExpDesc *e2, int line)
+{
+    switch (op) {
+        case LO_OPR_AND: {
+            LOCodeDischargeVars(fs, e2);
+            LOCodeConcat(fs, &e2->f, e1->f);
+            *e1 = *e2;
+            break;
+        }
+        case LO_OPR_OR: {
+            LOCodeDischargeVars(fs, e2);
+            LOCodeConcat(fs, &e2->t, e1->t);
+            *e1 = *e2;
+            break;
+        }
+        case LO_OPR_CONCAT: {
+            LOCodeExp2Val(fs, e2);
+            if (e2->k == LO_VRELOCABLE && LO_GET_OPCODE(LOCodeGetCode(fs, e2)) == LO_OP_CONCAT) {
+                /* a..b..c is one CONCAT over consecutive registers */
+                LOCodeFreeExp(fs, e1);
+                LO_SETARG_B(LOCodeGetCode(fs, e2), e1->u.info);
+                e1->k = LO_VRELOCABLE;
+                e1->u.info = e2->u.info;
+            } else {
+                LOCodeExp2NextReg(fs, e2);  /* operand must be on the 'stack' */
+                LOCodeArithOp(fs, LO_OP_CONCAT, e1, e2, line);
+            }
+            break;
+        }
+        case LO_OPR_ADD: case LO_OPR_SUB: case LO_OPR_MUL: case LO_OPR_DIV:
+        case LO_OPR_MOD: case LO_OPR_POW: {
+            LOCodeArithOp(fs, (LOOpCode)(op - LO_OPR_ADD + LO_OP_ADD), e1, e2, line);
+            break;
+        }
+        case LO_OPR_EQ: case LO_OPR_LT: case LO_OPR_LE: {
+            LOCodeComp(fs, (LOOpCode)(op - LO_OPR_EQ + LO_OP_EQ), 1, e1, e2);
+            break;
+        }
+        case LO_OPR_NE: case LO_OPR_GT: case LO_OPR_GE: {
+            LOCodeComp(fs, (LOOpCode)(op - LO_OPR_NE + LO_OP_EQ), 0, e1, e2);
+            break;
+        }
+        default:
+            break;
+    }
+}
+
+void LOCodeFixLine(LOFuncState *fs, int line)
+{
+    fs->f->_lineinfo[fs->pc - 1] = line;
+}
+
+void LOCodeSetList(LOFuncState *fs, int base, int nelems, int tostore)
+{
+    int c = (nelems - 1) / LO_LFIELDS_PER_FLUSH + 1;
+    int b = (tostore == LO_MULTRET) ? 0 : tostore;
+    if (c <= LO_MAXARG_C)
+        LOCodeABC(fs, LO_OP_SETLIST, base, b, c);
+    else if (c <= LO_MAXARG_Ax) {
+        LOCodeABC(fs, LO_OP_SETLIST, base, b, 0);
+        LOCodeExtraArg(fs, c);
+    } else
+        LOLexSyntaxError(fs->ls, "constructor too long");
+    fs->freereg = base + 1;  /* free registers with list values */
+}
+
+#pragma mark - functions
+
+void LOFuncStateOpen(LOLexState *ls, LOFuncState *fs, LOPrototype *f)
+{
+    LODyndata *dyd = ls->dyd;
+    fs->prev = ls->fs;  /* linked list of funcstates */
+    fs->ls = ls;
+    ls->fs = fs;
+    fs->f = f;
+    fs->pc = 0;
+    fs->lasttarget = 0;
+    fs->jpc = LO_NO_JUMP;
+    fs->freereg = 0;
+    fs->nk = 0;
+    fs->np = 0;
+    fs->nups = 0;
+    fs->nlocvars = 0;
+    fs->nactvar = 0;
+    fs->firstlocal = dyd->actvar.n;
+    fs->firstproto = dyd->protos.n;
+    fs->bl = NULL;
+    fs->sizecode = fs->sizek = fs->sizelocvars = fs->sizeupvalues = 0;
+    f->_source = ls->source;
+    f->_maxstacksize = 2;  /* registers 0/1 are always valid */
+
+    /* the functions at one nesting level take turns with one constant table */
+    fs->level = fs->prev ? fs->prev->level + 1 : 0;
+    if (fs->level >= dyd->nkTables) {
+        dyd->kTables = realloc(dyd->kTables, (fs->level + 1) * sizeof(LOConstantTable));
+        memset(&dyd->kTables[dyd->nkTables], 0, (fs->level + 1 - dyd->nkTables) * sizeof(LOConstantTable));
+        dyd->nkTables = fs->level + 1;
+        for (LOFuncState *o = fs->prev; o; o = o->prev)
+            o->h = &dyd->kTables[o->level];
+    }
+    fs->h = &dyd->kTables[fs->level];
+    fs->h->count = 0;
+    if (++fs->h->generation == 0) {  /* wrapped: stale slots could look live */
+        memset(fs->h->slots, 0, fs->h->capacity * sizeof(LOConstantSlot));
+        fs->h->generation = 1;
+    }
+}
+
+void LOFuncStateClose(LOLexState *ls, LOFuncState *fs)
+{
+    LODyndata *dyd = ls->dyd;
+    LOPrototype *f = fs->f;
+    f->_code = realloc(f->_code, MAX(fs->pc, 1) * sizeof(int));
+    f->_codeSize = fs->pc;
+    f->_lineinfo = realloc(f->_lineinfo, MAX(fs->pc, 1) * sizeof(int));
+    f->_lineinfoSize = fs->pc;
+    f->_k = realloc(f->_k, MAX(fs->nk, 1) * sizeof(LOTValue));
+    f->_locvars = realloc(f->_locvars, MAX(fs->nlocvars, 1) * sizeof(LOLocVar));
+    f->_upvalues = realloc(f->_upvalues, MAX(fs->nups, 1) * sizeof(LOUpvalDesc));
+
+    /* hand the children over from the dynamic data */
+    CFArrayRef p = CFArrayCreate(NULL, (const void **)&dyd->protos.arr[fs->firstproto], fs->np, &kCFTypeArrayCallBacks);
+    f->_p = CFBridgingRelease(p);
+    for (int i = fs->firstproto; i < dyd->protos.n; i++)
+        CFRelease(dyd->protos.arr[i]);
+    dyd->protos.n = fs->firstproto;
+
+    ls->fs = fs->prev;
+}
+
+LOPrototype *LOFuncStateAddPrototype(LOLexState *ls)
+{
+    LOFuncState *fs = ls->fs;
+    LODyndata *dyd = ls->dyd;
+    if (fs->np >= LO_MAXARG_Bx)
+        [LOLuaValue error:[NSString stringWithFormat:@"too many functions (limit is %d)", LO_MAXARG_Bx]];
+    LOPrototype *clp = [[LOPrototype alloc] init];
+    dyd->protos.arr = LOFuncStateGrowVector(ls, dyd->protos.arr, dyd->protos.n, &dyd->protos.size, sizeof(CFTypeRef), INT_MAX, "functions");
+    dyd->protos.arr[dyd->protos.n++] = CFBridgingRetain(clp);
+    fs->np++;
+    return clp;
+}
@@ -7,6 +7,15 @@
 
 #import "LOLuaTable.h"
 
+/**
+ * Global environment used by lua chunks, the first upvalue of a main chunk.
+ * <p>
+ * Global reads and writes compile to GETTABUP and SETTABUP with constant
+ * string keys, which the interpreter runs through per instruction
+ * {@link LOFieldCache}s: until the table is rehashed, a lookup of
+ * {@code print} or {@code math} in a loop is a key compare and a load.
+ * @see LOLuaTable
+ */
 @interface LOGlobals : LOLuaTable
 
 @end
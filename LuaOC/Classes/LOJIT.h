@@ -0,0 +1,87 @@
+//
+//  LOJIT.h
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import <Foundation/Foundation.h>
+#import "LOPrototype.h"
+
+/*
+ * Whether the baseline compiler is built: it emits x86-64 code and needs
+ * pages it can make executable, which iOS does not hand out to apps.
+ */
+#ifndef LOVM_JIT
+#if defined(__x86_64__) && !(defined(TARGET_OS_IPHONE) && TARGET_OS_IPHONE)
+#define LOVM_JIT 1
+#else
+#define LOVM_JIT 0
+#endif
+#endif
+
+/**
+ * Compiled code of a prototype: runs the function's instructions from
+ * {@code pc} on the registers at {@code base} with the constants {@code k},
+ * and returns the pc of the first instruction left to the interpreter.
+ */
+typedef int (*LOJITFunction)(LOTValue *base, const LOTValue *k, int pc);
+
+/**
+ * Baseline compiler of hot prototypes to x86-64 machine code.
+ * <p>
+ * The interpreter counts the frame entries and loop iterations of each
+ * prototype; once a prototype reaches the {@link #threshold} it is
+ * compiled, one template of machine code per instruction, and from then on
+ * the interpreter enters the compiled code on frame entry, on loop back
+ * edges and after native calls.
+ * <p>
+ * Templates cover moves, constants, int arithmetic, comparisons, tests,
+ * jumps and numeric for loops, on values that are not objects, so they
+ * never retain, release, allocate or raise.  Every other instruction, and
+ * every instruction whose operands fail the guards of its template, e.g.
+ * an int addition that overflows or a register holding a table, returns
+ * to the interpreter, which executes it and carries on from there.
+ * <p>
+ * The compiler is only built for x86-64 outside iOS, see {@code LOVM_JIT},
+ * and is off until {@link #enabled} is set; it can be switched at any
+ * time, frames already running compiled code return to the interpreter at
+ * their next exit.
+ */
+@interface LOJIT : NSObject
+
+/** Whether this build has the compiler */
+@property (class, nonatomic, readonly, getter=isAvailable) BOOL available;
+
+/** Whether hot prototypes are compiled and run as machine code, NO by default; stays NO when not available */
+@property (class, nonatomic, assign, getter=isEnabled) BOOL enabled;
+
+/** Frame entries plus loop iterations after which a prototype is compiled, 1000 by default */
+@property (class, nonatomic, assign) int threshold;
+
+@end
+
+/* the state behind the class properties, read by the interpreter */
+FOUNDATION_EXTERN BOOL LOJITEnabled;
+FOUNDATION_EXTERN int LOJITThreshold;
+
+/**
+ * Compile {@code p}, once; on failure the prototype keeps being interpreted.
+ * @return the compiled code, or NULL
+ */
+FOUNDATION_EXTERN LOJITFunction LOJITCompile(LOPrototype *p);
+
+/** Free the compiled code of a prototype being deallocated */
+FOUNDATION_EXTERN void LOJITFree(LOPrototype *p);
+
+/** The compiled code of {@code p}, compiling it when it becomes hot; NULL to interpret */
+static inline LOJITFunction LOJITCode(LOPrototype *p)
+{
+    if (!LOJITEnabled)
+        return NULL;
+    if (p->_jitCode != NULL)
+        return (LOJITFunction)p->_jitCode;
+    if (++p->_hotness < LOJITThreshold)
+        return NULL;
+    return LOJITCompile(p);
+}
@@ -0,0 +1,557 @@
+//
+//  LOJIT.m
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import "LOJIT.h"
+#import "LOLua.h"
+#if LOVM_JIT
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+BOOL LOJITEnabled = NO;
+int LOJITThreshold = 1000;
+
+@implementation LOJIT
+
++ (BOOL)isAvailable
+{
+    return LOVM_JIT;
+}
+
++ (BOOL)isEnabled
+{
+    return LOJITEnabled;
+}
+
++ (void)setEnabled:(BOOL)enabled
+{
+    LOJITEnabled = enabled && LOVM_JIT;
+}
+
++ (int)threshold
+{
+    return LOJITThreshold;
+}
+
++ (void)setThreshold:(int)threshold
+{
+    LOJITThreshold = threshold;
+}
+
+@end
+
+#if LOVM_JIT
+
+#pragma mark - assembler
+
+/* x86-64 registers; the compiled code only uses scratch registers and never touches the C stack */
+enum { LO_RAX = 0, LO_RCX = 1, LO_RDX = 2, LO_RSI = 6, LO_RDI = 7, LO_R8 = 8 };
+
+/* the arguments of a LOJITFunction stay in their registers */
+#define LO_BASE     LO_RDI
+#define LO_KST      LO_RSI
+
+/* condition codes of jcc */
+enum { LO_CC_O = 0x0, LO_CC_E = 0x4, LO_CC_NE = 0x5, LO_CC_BE = 0x6, LO_CC_L = 0xC, LO_CC_GE = 0xD, LO_CC_LE = 0xE, LO_CC_G = 0xF };
+
+/** A rel32 at {@code site} to patch with the distance to a label */
+typedef struct LOJITFixup {
+    int site;
+    int label;
+} LOJITFixup;
+
+/**
+ * The code being assembled.  Labels 0 to n - 1 are the entries of the
+ * instructions, n to 2n - 1 their exits to the interpreter, 2n the table of
+ * entries, and any further ones are local to a template.
+ */
+typedef struct LOJITAssembler {
+    uint8_t *code;
+    int length;
+    int size;
+    /* position of each label, -1 while unbound */
+    int *labels;
+    int nlabels;
+    int sizelabels;
+    LOJITFixup *fixups;
+    int nfixups;
+    int sizefixups;
+} LOJITAssembler;
+
+static void *LOJITGrow(void *block, int n, int *size, size_t elementSize)
+{
+    if (n < *size)
+        return block;
+    *size = MAX(*size * 2, 64);
+    return realloc(block, *size * elementSize);
+}
+
+static void LOJITEmit8(LOJITAssembler *a, int b)
+{
+    a->code = LOJITGrow(a->code, a->length, &a->size, 1);
+    a->code[a->length++] = (uint8_t)b;
+}
+
+static void LOJITEmit32(LOJITAssembler *a, uint32_t v)
+{
+    for (int j = 0; j < 4; j++)
+        LOJITEmit8(a, (v >> (8 * j)) & 0xff);
+}
+
+static void LOJITEmit64(LOJITAssembler *a, uint64_t v)
+{
+    LOJITEmit32(a, (uint32_t)v);
+    LOJITEmit32(a, (uint32_t)(v >> 32));
+}
+
+static int LOJITNewLabel(LOJITAssembler *a)
+{
+    a->labels = LOJITGrow(a->labels, a->nlabels, &a->sizelabels, sizeof(int));
+    a->labels[a->nlabels] = -1;
+    return a->nlabels++;
+}
+
+static void LOJITBind(LOJITAssembler *a, int label)
+{
+    a->labels[label] = a->length;
+}
+
+/** A rel32 to {@code label}, patched when the code is complete */
+static void LOJITEmitRel32(LOJITAssembler *a, int label)
+{
+    a->fixups = LOJITGrow(a->fixups, a->nfixups, &a->sizefixups, sizeof(LOJITFixup));
+    a->fixups[a->nfixups++] = (LOJITFixup){a->length, label};
+    LOJITEmit32(a, 0);
+}
+
+/** REX prefix for a 64 bit operation when {@code w}, and for registers r8 and up */
+static void LOJITRex(LOJITAssembler *a, int w, int reg, int rm)
+{
+    int rex = 0x40 | (w << 3) | ((reg >> 3) << 2) | (rm >> 3);
+    if (rex != 0x40)
+        LOJITEmit8(a, rex);
+}
+
+static void LOJITOpcode(LOJITAssembler *a, int op)
+{
+    if (op > 0xff)
+        LOJITEmit8(a, op >> 8);
+    LOJITEmit8(a, op & 0xff);
+}
+
+/** {@code op} with a register operand {@code rm} */
+static void LOJITOpRR(LOJITAssembler *a, int w, int op, int reg, int rm)
+{
+    LOJITRex(a, w, reg, rm);
+    LOJITOpcode(a, op);
+    LOJITEmit8(a, 0xc0 | ((reg & 7) << 3) | (rm & 7));
+}
+
+/** {@code op} with a memory operand at {@code disp} from {@code base} */
+static void LOJITOpRM(LOJITAssembler *a, int w, int op, int reg, int base, int disp)
+{
+    LOJITRex(a, w, reg, base);
+    LOJITOpcode(a, op);
+    LOJITEmit8(a, 0x80 | ((reg & 7) << 3) | (base & 7));
+    LOJITEmit32(a, (uint32_t)disp);
+}
+
+/* mov reg, [base + 8 * index] */
+static void LOJITLoad(LOJITAssembler *a, int reg, int base, int index)
+{
+    LOJITOpRM(a, 1, 0x8b, reg, base, 8 * index);
+}
+
+/* mov [base + 8 * index], reg */
+static void LOJITStore(LOJITAssembler *a, int base, int index, int reg)
+{
+    LOJITOpRM(a, 1, 0x89, reg, base, 8 * index);
+}
+
+/* mov reg, imm64 */
+static void LOJITMovImm64(LOJITAssembler *a, int reg, uint64_t v)
+{
+    LOJITRex(a, 1, 0, reg);
+    LOJITEmit8(a, 0xb8 + (reg & 7));
+    LOJITEmit64(a, v);
+}
+
+static void LOJITJcc(LOJITAssembler *a, int cc, int label)
+{
+    LOJITEmit8(a, 0x0f);
+    LOJITEmit8(a, 0x80 | cc);
+    LOJITEmitRel32(a, label);
+}
+
+static void LOJITJmp(LOJITAssembler *a, int label)
+{
+    LOJITEmit8(a, 0xe9);
+    LOJITEmitRel32(a, label);
+}
+
+/* return pc to the interpreter: mov eax, pc; ret */
+static void LOJITExit(LOJITAssembler *a, int pc)
+{
+    LOJITEmit8(a, 0xb8);
+    LOJITEmit32(a, (uint32_t)pc);
+    LOJITEmit8(a, 0xc3);
+}
+
+/* jump to label when reg32 compares cc to imm: cmp reg32, imm; jcc label */
+static void LOJITCmpJcc(LOJITAssembler *a, int reg, uint32_t imm, int cc, int label)
+{
+    LOJITRex(a, 0, 0, reg);
+    LOJITEmit8(a, 0x81);
+    LOJITEmit8(a, 0xf8 | (reg & 7));
+    LOJITEmit32(a, imm);
+    LOJITJcc(a, cc, label);
+}
+
+/** Jump to {@code label} when the tag of {@code reg} compares {@code cc} to {@code tag}; the tag is left in {@code tmp} */
+static void LOJITTagTest(LOJITAssembler *a, int reg, int tmp, uint32_t tag, int cc, int label)
+{
+    if (tmp != reg)
+        LOJITOpRR(a, 1, 0x89, reg, tmp);        /* mov tmp, reg */
+    LOJITRex(a, 1, 0, tmp);                     /* shr tmp, 47 */
+    LOJITEmit8(a, 0xc1);
+    LOJITEmit8(a, 0xe8 | (tmp & 7));
+    LOJITEmit8(a, LOTVALUE_TAG_SHIFT);
+    LOJITCmpJcc(a, tmp, tag, cc, label);
+}
+
+/* R(A) := reg, leaving to the interpreter when R(A) holds an object to release */
+static void LOJITStoreChecked(LOJITAssembler *a, int index, int reg, int tmp, int exit)
+{
+    LOJITLoad(a, tmp, LO_BASE, index);
+    LOJITTagTest(a, tmp, tmp, LOTVALUE_TAG_OBJECT, LO_CC_E, exit);
+    LOJITStore(a, LO_BASE, index, reg);
+}
+
+static void LOJITLoadRK(LOJITAssembler *a, int reg, int rk)
+{
+    if (LO_ISK(rk))
+        LOJITLoad(a, reg, LO_KST, LO_INDEXK(rk));
+    else
+        LOJITLoad(a, reg, LO_BASE, rk);
+}
+
+/* box the int in the low half of reg */
+static void LOJITBoxInt(LOJITAssembler *a, int reg, int tmp)
+{
+    LOJITOpRR(a, 0, 0x89, reg, reg);            /* mov reg32, reg32 clears the high half */
+    LOJITMovImm64(a, tmp, LOTVALUE_MAKE(LOTVALUE_TAG_INT, 0));
+    LOJITOpRR(a, 1, 0x09, tmp, reg);            /* or reg, tmp */
+}
+
+/* jump to falsy when reg is nil or false; clobbers tmp */
+static void LOJITTestFalsy(LOJITAssembler *a, int reg, int tmp, int falsy)
+{
+    LOJITMovImm64(a, tmp, LO_NIL);
+    LOJITOpRR(a, 1, 0x39, tmp, reg);            /* cmp reg, tmp */
+    LOJITJcc(a, LO_CC_E, falsy);
+    LOJITMovImm64(a, tmp, LO_FALSE);
+    LOJITOpRR(a, 1, 0x39, tmp, reg);
+    LOJITJcc(a, LO_CC_E, falsy);
+}
+
+#pragma mark - templates
+
+/**
+ * Emit the template of instruction {@code pc}.
+ * @return NO if the code jumps outside the function
+ */
+static BOOL LOJITEmitInstruction(LOJITAssembler *a, const int *code, int n, int pc)
+{
+    // the interpreter may be quickening the word meanwhile, see LOLuaClosure.m
+    int i = __atomic_load_n(&code[pc], __ATOMIC_RELAXED);
+    int A = LO_GETARG_A(i), B = LO_GETARG_B(i), C = LO_GETARG_C(i);
+    int exit = n + pc;
+    int skip = pc + 2;
+    switch (LOOpCodeGeneric(LO_GET_OPCODE(i))) {
+        case LO_OP_MOVE:
+            LOJITLoad(a, LO_RAX, LO_BASE, B);
+            LOJITTagTest(a, LO_RAX, LO_RDX, LOTVALUE_TAG_OBJECT, LO_CC_E, exit);
+            LOJITStoreChecked(a, A, LO_RAX, LO_RDX, exit);
+            return YES;
+        case LO_OP_LOADK:
+            LOJITLoad(a, LO_RAX, LO_KST, LO_GETARG_Bx(i));
+            LOJITTagTest(a, LO_RAX, LO_RDX, LOTVALUE_TAG_OBJECT, LO_CC_E, exit);
+            LOJITStoreChecked(a, A, LO_RAX, LO_RDX, exit);
+            return YES;
+        case LO_OP_LOADBOOL:
+            if (C && skip >= n)
+                return NO;
+            LOJITMovImm64(a, LO_RAX, LOTValueFromBoolean(B != 0));
+            LOJITStoreChecked(a, A, LO_RAX, LO_RDX, exit);
+            if (C)
+                LOJITJmp(a, skip);
+            return YES;
+        case LO_OP_LOADNIL:
+            LOJITMovImm64(a, LO_RAX, LO_NIL);
+            for (int j = 0; j <= B; j++)
+                LOJITStoreChecked(a, A + j, LO_RAX, LO_RDX, exit);
+            return YES;
+        case LO_OP_ADD:
+        case LO_OP_SUB:
+        case LO_OP_MUL: {
+            LOJITLoadRK(a, LO_RAX, B);
+            LOJITTagTest(a, LO_RAX, LO_RDX, LOTVALUE_TAG_INT, LO_CC_NE, exit);
+            LOJITLoadRK(a, LO_RCX, C);
+            LOJITTagTest(a, LO_RCX, LO_RDX, LOTVALUE_TAG_INT, LO_CC_NE, exit);
+            int op = LOOpCodeGeneric(LO_GET_OPCODE(i));
+            if (op == LO_OP_ADD)
+                LOJITOpRR(a, 0, 0x01, LO_RCX, LO_RAX);      /* add eax, ecx */
+            else if (op == LO_OP_SUB)
+                LOJITOpRR(a, 0, 0x29, LO_RCX, LO_RAX);      /* sub eax, ecx */
+            else
+                LOJITOpRR(a, 0, 0x0faf, LO_RAX, LO_RCX);    /* imul eax, ecx */
+            // the interpreter makes a double of an overflow
+            LOJITJcc(a, LO_CC_O, exit);
+            LOJITBoxInt(a, LO_RAX, LO_RDX);
+            LOJITStoreChecked(a, A, LO_RAX, LO_RDX, exit);
+            return YES;
+        }
+        case LO_OP_UNM:
+            LOJITLoad(a, LO_RAX, LO_BASE, B);
+            LOJITTagTest(a, LO_RAX, LO_RDX, LOTVALUE_TAG_INT, LO_CC_NE, exit);
+            LOJITOpRR(a, 0, 0xf7, 3, LO_RAX);               /* neg eax */
+            // -INT_MIN and -0 are doubles
+            LOJITJcc(a, LO_CC_O, exit);
+            LOJITJcc(a, LO_CC_E, exit);
+            LOJITBoxInt(a, LO_RAX, LO_RDX);
+            LOJITStoreChecked(a, A, LO_RAX, LO_RDX, exit);
+            return YES;
+        case LO_OP_NOT: {
+            int done = LOJITNewLabel(a);
+            LOJITLoad(a, LO_RCX, LO_BASE, B);
+            LOJITMovImm64(a, LO_RAX, LO_TRUE);
+            LOJITTestFalsy(a, LO_RCX, LO_RDX, done);
+            LOJITMovImm64(a, LO_RAX, LO_FALSE);
+            LOJITBind(a, done);
+            LOJITStoreChecked(a, A, LO_RAX, LO_RDX, exit);
+            return YES;
+        }
+        case LO_OP_JMP: {
+            int target = pc + 1 + LO_GETARG_sBx(i);
+            if ((unsigned)target >= (unsigned)n)
+                return NO;
+            if (A > 0) {
+                // closing upvalues is left to the interpreter
+                LOJITExit(a, pc);
+                return YES;
+            }
+            LOJITJmp(a, target);
+            return YES;
+        }
+        case LO_OP_EQ:
+            if (skip >= n)
+                return NO;
+            // raw equality is equality of the bits for all but doubles and objects
+            LOJITLoadRK(a, LO_RAX, B);
+            LOJITTagTest(a, LO_RAX, LO_RDX, LOTVALUE_TAG_MAXDOUBLE, LO_CC_BE, exit);
+            LOJITCmpJcc(a, LO_RDX, LOTVALUE_TAG_OBJECT, LO_CC_E, exit);
+            LOJITLoadRK(a, LO_RCX, C);
+            LOJITTagTest(a, LO_RCX, LO_RDX, LOTVALUE_TAG_MAXDOUBLE, LO_CC_BE, exit);
+            LOJITCmpJcc(a, LO_RDX, LOTVALUE_TAG_OBJECT, LO_CC_E, exit);
+            LOJITOpRR(a, 1, 0x39, LO_RCX, LO_RAX);          /* cmp rax, rcx */
+            LOJITJcc(a, A ? LO_CC_NE : LO_CC_E, skip);
+            return YES;
+        case LO_OP_LT:
+        case LO_OP_LE:
+            if (skip >= n)
+                return NO;
+            LOJITLoadRK(a, LO_RAX, B);
+            LOJITTagTest(a, LO_RAX, LO_RDX, LOTVALUE_TAG_INT, LO_CC_NE, exit);
+            LOJITLoadRK(a, LO_RCX, C);
+            LOJITTagTest(a, LO_RCX, LO_RDX, LOTVALUE_TAG_INT, LO_CC_NE, exit);
+            LOJITOpRR(a, 0, 0x39, LO_RCX, LO_RAX);          /* cmp eax, ecx */
+            if (LOOpCodeGeneric(LO_GET_OPCODE(i)) == LO_OP_LT)
+                LOJITJcc(a, A ? LO_CC_GE : LO_CC_L, skip);
+            else
+                LOJITJcc(a, A ? LO_CC_G : LO_CC_LE, skip);
+            return YES;
+        case LO_OP_TEST: {
+            if (skip >= n)
+                return NO;
+            int falsy = LOJITNewLabel(a);
+            LOJITLoad(a, LO_RAX, LO_BASE, A);
+            LOJITTestFalsy(a, LO_RAX, LO_RDX, falsy);
+            LOJITJmp(a, C ? pc + 1 : skip);
+            LOJITBind(a, falsy);
+            LOJITJmp(a, C ? skip : pc + 1);
+            return YES;
+        }
+        case LO_OP_TESTSET: {
+            if (skip >= n)
+                return NO;
+            int falsy = LOJITNewLabel(a);
+            LOJITLoad(a, LO_RAX, LO_BASE, B);
+            LOJITTagTest(a, LO_RAX, LO_RDX, LOTVALUE_TAG_OBJECT, LO_CC_E, exit);
+            LOJITLoad(a, LO_RCX, LO_BASE, A);
+            LOJITTagTest(a, LO_RCX, LO_RCX, LOTVALUE_TAG_OBJECT, LO_CC_E, exit);
+            LOJITTestFalsy(a, LO_RAX, LO_RDX, falsy);
+            if (C)
+                LOJITStore(a, LO_BASE, A, LO_RAX);
+            LOJITJmp(a, C ? pc + 1 : skip);
+            LOJITBind(a, falsy);
+            if (!C)
+                LOJITStore(a, LO_BASE, A, LO_RAX);
+            LOJITJmp(a, C ? skip : pc + 1);
+            return YES;
+        }
+        case LO_OP_FORLOOP: {
+            int target = pc + 1 + LO_GETARG_sBx(i);
+            if ((unsigned)target >= (unsigned)n || pc + 1 >= n)
+                return NO;
+            int down = LOJITNewLabel(a), loop = LOJITNewLabel(a);
+            // the loop over ints; a double index, limit or step is left to the interpreter
+            LOJITLoad(a, LO_RAX, LO_BASE, A);
+            LOJITTagTest(a, LO_RAX, LO_R8, LOTVALUE_TAG_INT, LO_CC_NE, exit);
+            LOJITLoad(a, LO_RCX, LO_BASE, A + 2);
+            LOJITTagTest(a, LO_RCX, LO_R8, LOTVALUE_TAG_INT, LO_CC_NE, exit);
+            LOJITLoad(a, LO_RDX, LO_BASE, A + 1);
+            LOJITTagTest(a, LO_RDX, LO_R8, LOTVALUE_TAG_INT, LO_CC_NE, exit);
+            LOJITOpRR(a, 1, 0x63, LO_RAX, LO_RAX);          /* movsxd rax, eax */
+            LOJITOpRR(a, 1, 0x63, LO_RCX, LO_RCX);
+            LOJITOpRR(a, 1, 0x63, LO_RDX, LO_RDX);
+            LOJITOpRR(a, 1, 0x01, LO_RCX, LO_RAX);          /* add rax, rcx */
+            LOJITOpRR(a, 1, 0x85, LO_RCX, LO_RCX);          /* test rcx, rcx */
+            LOJITJcc(a, LO_CC_LE, down);
+            LOJITOpRR(a, 1, 0x39, LO_RDX, LO_RAX);          /* cmp rax, rdx */
+            LOJITJcc(a, LO_CC_G, pc + 1);
+            LOJITJmp(a, loop);
+            LOJITBind(a, down);
+            LOJITOpRR(a, 1, 0x39, LO_RDX, LO_RAX);
+            LOJITJcc(a, LO_CC_L, pc + 1);
+            LOJITBind(a, loop);
+            // the new index lies between the old one and the limit, so it is an int
+            LOJITLoad(a, LO_R8, LO_BASE, A + 3);
+            LOJITTagTest(a, LO_R8, LO_R8, LOTVALUE_TAG_OBJECT, LO_CC_E, exit);
+            LOJITBoxInt(a, LO_RAX, LO_RDX);
+            LOJITStore(a, LO_BASE, A, LO_RAX);
+            LOJITStore(a, LO_BASE, A + 3, LO_RAX);
+            LOJITJmp(a, target);
+            return YES;
+        }
+        default:
+            LOJITExit(a, pc);
+            return YES;
+    }
+}
+
+/**
+ * Assemble the instructions into {@code a}: an entry that jumps to the
+ * instruction at the pc argument through a table of offsets, the
+ * templates, and the exits of the instructions.
+ * @return NO if the code cannot be compiled
+ */
+static BOOL LOJITAssemble(LOJITAssembler *a, const int *code, int n)
+{
+    for (int j = 0; j <= 2 * n; j++)
+        LOJITNewLabel(a);
+    int table = 2 * n;
+
+    LOJITEmit8(a, 0x48);                            /* lea rax, [rip + table] */
+    LOJITEmit8(a, 0x8d);
+    LOJITEmit8(a, 0x05);
+    LOJITEmitRel32(a, table);
+    LOJITOpRR(a, 1, 0x63, LO_RDX, LO_RDX);          /* movsxd rdx, edx */
+    LOJITEmit8(a, 0x48);                            /* movsxd rcx, dword [rax + 4 * rdx] */
+    LOJITEmit8(a, 0x63);
+    LOJITEmit8(a, 0x0c);
+    LOJITEmit8(a, 0x90);
+    LOJITOpRR(a, 1, 0x01, LO_RAX, LO_RCX);          /* add rcx, rax */
+    LOJITEmit8(a, 0xff);                            /* jmp rcx */
+    LOJITEmit8(a, 0xe1);
+
+    for (int pc = 0; pc < n; pc++) {
+        LOJITBind(a, pc);
+        if (!LOJITEmitInstruction(a, code, n, pc))
+            return NO;
+    }
+    for (int pc = 0; pc < n; pc++) {
+        LOJITBind(a, n + pc);
+        LOJITExit(a, pc);
+    }
+    while (a->length % 4 != 0)
+        LOJITEmit8(a, 0xcc);                        /* int3 */
+    LOJITBind(a, table);
+    for (int pc = 0; pc < n; pc++)
+        LOJITEmit32(a, (uint32_t)(a->labels[pc] - a->labels[table]));
+
+    for (int j = 0; j < a->nfixups; j++) {
+        LOJITFixup *f = &a->fixups[j];
+        int32_t rel = a->labels[f->label] - (f->site + 4);
+        memcpy(a->code + f->site, &rel, 4);
+    }
+    return YES;
+}
+
+/** Assemble the code into new executable pages, NULL on failure */
+static void *LOJITAssembleCode(const int *code, int n, size_t *size)
+{
+    LOJITAssembler a = {0};
+    void *pages = NULL;
+    if (n > 0 && LOJITAssemble(&a, code, n)) {
+        size_t pageSize = (size_t)getpagesize();
+        *size = ((size_t)a.length + pageSize - 1) / pageSize * pageSize;
+        int flags = MAP_PRIVATE | MAP_ANON;
+#ifdef MAP_JIT
+        flags |= MAP_JIT;
+#endif
+        pages = mmap(NULL, *size, PROT_READ | PROT_WRITE, flags, -1, 0);
+        if (pages == MAP_FAILED) {
+            pages = NULL;
+        } else {
+            // never writable and executable at once
+            memcpy(pages, a.code, a.length);
+            if (mprotect(pages, *size, PROT_READ | PROT_EXEC) != 0) {
+                munmap(pages, *size);
+                pages = NULL;
+            }
+        }
+    }
+    free(a.code);
+    free(a.labels);
+    free(a.fixups);
+    return pages;
+}
+
+LOJITFunction LOJITCompile(LOPrototype *p)
+{
+    size_t size = 0;
+    void *code = LOJITAssembleCode(p->_code, p->_codeSize, &size);
+    if (code == NULL) {
+        // not counted again
+        p->_hotness = INT_MIN;
+        return NULL;
+    }
+    if (__sync_bool_compare_and_swap(&p->_jitCode, NULL, code))
+        p->_jitSize = size;
+    else
+        munmap(code, size);  /* compiled meanwhile by another thread */
+    return (LOJITFunction)p->_jitCode;
+}
+
+void LOJITFree(LOPrototype *p)
+{
+    if (p->_jitCode != NULL)
+        munmap(p->_jitCode, p->_jitSize);
+}
+
+#else
+
+LOJITFunction LOJITCompile(LOPrototype *p)
+{
+    return NULL;
+}
+
+void LOJITFree(LOPrototype *p)
+{
+}
+
+#endif
@@ -0,0 +1,207 @@
+//
+//  LOLexState.h
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import <Foundation/Foundation.h>
+#import "LOTValue.h"
+
+@class LOLuaString, LOPrototype;
+struct LOFuncState;
+
+/** First token value after the single byte tokens */
+#define LO_FIRST_RESERVED 257
+
+/*
+ * WARNING: if you change the order of this enumeration,
+ * grep "ORDER RESERVED"
+ */
+typedef enum LOReservedToken {
+    /* terminal symbols denoted by reserved words */
+    LO_TK_AND = LO_FIRST_RESERVED, LO_TK_BREAK,
+    LO_TK_DO, LO_TK_ELSE, LO_TK_ELSEIF, LO_TK_END, LO_TK_FALSE, LO_TK_FOR, LO_TK_FUNCTION,
+    LO_TK_GOTO, LO_TK_IF, LO_TK_IN, LO_TK_LOCAL, LO_TK_NIL, LO_TK_NOT, LO_TK_OR, LO_TK_REPEAT,
+    LO_TK_RETURN, LO_TK_THEN, LO_TK_TRUE, LO_TK_UNTIL, LO_TK_WHILE,
+    /* other terminal symbols */
+    LO_TK_CONCAT, LO_TK_DOTS, LO_TK_EQ, LO_TK_GE, LO_TK_LE, LO_TK_NE, LO_TK_DBCOLON, LO_TK_EOS,
+    LO_TK_NUMBER, LO_TK_NAME, LO_TK_STRING
+} LOReservedToken;
+
+/** maximum size of the source name shown in messages, as lua's LUA_IDSIZE */
+#define LO_IDSIZE 60
+
+/** number of reserved words */
+#define LO_NUM_RESERVED ((int)(LO_TK_WHILE - LO_FIRST_RESERVED + 1))
+
+/** A token and its semantic value: the number of a numeral, the string of a name or string literal */
+typedef struct LOToken {
+    int token;
+    double r;
+    __unsafe_unretained LOLuaString *ts;
+} LOToken;
+
+/** description of an active local variable */
+typedef struct LOVarDesc {
+    /** variable index in the prototype's locvars */
+    short idx;
+} LOVarDesc;
+
+/** description of pending goto statements and label statements */
+typedef struct LOLabelDesc {
+    /** label identifier */
+    __unsafe_unretained LOLuaString *name;
+    /** position in code */
+    int pc;
+    /** line where it appeared */
+    int line;
+    /** local level where it appears in current block */
+    uint8_t nactvar;
+} LOLabelDesc;
+
+/** list of labels or gotos */
+typedef struct LOLabelList {
+    LOLabelDesc *arr;
+    int n;
+    int size;
+} LOLabelList;
+
+/** One slot of the table of the constants of a function, see {@link LOFuncState} */
+typedef struct LOConstantSlot {
+    LOTValue key;
+    int idx;
+    /** the slot is in use if this is the generation of its table */
+    unsigned generation;
+} LOConstantSlot;
+
+/** Table mapping each constant of a function to its index, cleared by a new generation */
+typedef struct LOConstantTable {
+    LOConstantSlot *slots;
+    int capacity;
+    int count;
+    unsigned generation;
+} LOConstantTable;
+
+/**
+ * Dynamic structures used by the parser, shared by all the functions of the
+ * chunk: the active locals, gotos and labels of the open functions are
+ * stacks in one array each, the prototypes are anchored here while being
+ * built, and each nesting level has a constant table that the functions at
+ * that level reuse.
+ */
+typedef struct LODyndata {
+    /* list of active local variables */
+    struct {
+        LOVarDesc *arr;
+        int n;
+        int size;
+    } actvar;
+    /** list of pending gotos */
+    LOLabelList gt;
+    /** list of active labels */
+    LOLabelList label;
+    /** the prototypes being built and their children, retained */
+    struct {
+        CFTypeRef *arr;
+        int n;
+        int size;
+    } protos;
+    /** constant tables, one per function nesting level */
+    LOConstantTable *kTables;
+    int nkTables;
+} LODyndata;
+
+/** One entry of the table of the names and strings of a chunk, interning them for the parse */
+typedef struct LOLexString {
+    const unsigned char *bytes;
+    int length;
+    NSUInteger hash;
+    /** the string, retained, or NULL for a reserved word */
+    CFTypeRef string;
+    /** the token of a reserved word, 0 otherwise */
+    int reserved;
+} LOLexString;
+
+/**
+ * State of the lexer plus state of the parser when shared by all
+ * functions, as lua's LexState.
+ * <p>
+ * The whole source is in memory and is scanned in place: tokens are read
+ * from the source bytes, and string literals are only gathered into a
+ * buffer when they contain escapes.  Every name and string is looked up in
+ * the lexer's own table first, so each distinct one becomes a
+ * {@link LOLuaString} once, which copies its bytes and, for a short one,
+ * takes the process wide intern lock; later occurrences are found in the
+ * table without either, and the parser compares names by pointer.
+ * @see LOFuncState
+ */
+typedef struct LOLexState {
+    /** current character (charint) */
+    int current;
+    /** next byte to read, and end of the source */
+    const unsigned char *p;
+    const unsigned char *end;
+    /** first byte of the token being read, for error messages */
+    const unsigned char *tokenStart;
+    /** input line counter */
+    int linenumber;
+    /** line of last token `consumed' */
+    int lastline;
+    /** current token */
+    LOToken t;
+    /** look ahead token */
+    LOToken lookahead;
+    /** current function (parser) */
+    struct LOFuncState *fs;
+    /** dynamic structures used by the parser */
+    LODyndata *dyd;
+    /** current source name */
+    __unsafe_unretained LOLuaString *source;
+    /** environment variable name */
+    __unsafe_unretained LOLuaString *envn;
+    /** label name of the implicit gotos of break statements */
+    __unsafe_unretained LOLuaString *breakn;
+    /** source name as shown in messages */
+    char chunkid[LO_IDSIZE];
+    /** buffer for string literals with escapes */
+    unsigned char *buff;
+    int nbuff;
+    int buffsize;
+    /** intern table of names and strings, open addressed */
+    LOLexString *strings;
+    int nstrings;
+    int stringsSize;
+    /** nesting of the parse, against C stack overflow */
+    int nCcalls;
+} LOLexState;
+
+/**
+ * Set up the lexer to read {@code length} bytes of source.
+ * @param source the chunk name, '@' or '=' prefixed as in lua
+ */
+FOUNDATION_EXTERN void LOLexSetInput(LOLexState *ls, LODyndata *dyd, const unsigned char *bytes, int length, LOLuaString *source);
+
+/** Free the buffers of the lexer and release its strings */
+FOUNDATION_EXTERN void LOLexFree(LOLexState *ls);
+
+/** The interned string with these bytes, owned by the lexer */
+FOUNDATION_EXTERN LOLuaString *LOLexNewString(LOLexState *ls, const void *bytes, int length);
+
+FOUNDATION_EXTERN void LOLexNext(LOLexState *ls);
+FOUNDATION_EXTERN int LOLexLookahead(LOLexState *ls);
+
+/** Raise "chunk:line: msg near 'token'" for the current token */
+FOUNDATION_EXTERN void LOLexSyntaxError(LOLexState *ls, const char *msg) __attribute__((noreturn));
+
+/** The text of {@code token} for error messages, e.g. {@code 'end'} */
+FOUNDATION_EXTERN const char *LOLexToken2Str(LOLexState *ls, int token, char *buffer, int size);
+
+/**
+ * Parse a whole chunk into the main function {@code main}, an empty
+ * prototype anchored as the first prototype in the dynamic data.
+ */
+FOUNDATION_EXTERN void LOLexParseChunk(LOLexState *ls, LOPrototype *main);
+
+/** Free the dynamic data and release the prototypes anchored in it */
+FOUNDATION_EXTERN void LODyndataFree(LODyndata *dyd);
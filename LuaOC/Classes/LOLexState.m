@@ -0,0 +1,2112 @@
+//
+//  LOLexState.m
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import "LOLexState.h"
+#import "LOFuncState.h"
+#import "LOPrototype.h"
+#import "LOLuaString.h"
+#import "LOLuaNumber.h"
+#import "LOStringBuilder.h"
+
+#define LO_EOZ (-1)
+
+/* ORDER RESERVED */
+static const char *const LOLexTokens[] = {
+    "and", "break", "do", "else", "elseif",
+    "end", "false", "for", "function", "goto", "if",
+    "in", "local", "nil", "not", "or", "repeat",
+    "return", "then", "true", "until", "while",
+    "..", "...", "==", ">=", "<=", "~=", "::", "<eof>",
+    "<number>", "<name>", "<string>"
+};
+
+#pragma mark - characters
+
+static inline BOOL LOLexIsDigit(int c)
+{
+    return (unsigned)(c - '0') < 10;
+}
+
+static inline BOOL LOLexIsAlpha(int c)
+{
+    return (unsigned)((c | 0x20) - 'a') < 26 || c == '_';
+}
+
+static inline BOOL LOLexIsAlnum(int c)
+{
+    return LOLexIsAlpha(c) || LOLexIsDigit(c);
+}
+
+static inline BOOL LOLexIsXDigit(int c)
+{
+    return LOLexIsDigit(c) || (unsigned)((c | 0x20) - 'a') < 6;
+}
+
+static inline BOOL LOLexIsSpace(int c)
+{
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+static inline int LOLexHexValue(int c)
+{
+    return LOLexIsDigit(c) ? c - '0' : (c | 0x20) - 'a' + 10;
+}
+
+static inline void LOLexNextChar(LOLexState *ls)
+{
+    ls->current = ls->p < ls->end ? *ls->p++ : LO_EOZ;
+}
+
+/** Address of the current character */
+static inline const unsigned char *LOLexPosition(LOLexState *ls)
+{
+    return ls->current == LO_EOZ ? ls->end : ls->p - 1;
+}
+
+static inline BOOL LOLexCurrIsNewline(LOLexState *ls)
+{
+    return ls->current == '\n' || ls->current == '\r';
+}
+
+static inline void LOLexSave(LOLexState *ls, int c)
+{
+    if (ls->nbuff >= ls->buffsize) {
+        ls->buffsize = ls->buffsize ? ls->buffsize * 2 : 64;
+        ls->buff = realloc(ls->buff, ls->buffsize);
+    }
+    ls->buff[ls->nbuff++] = (unsigned char)c;
+}
+
+static inline void LOLexSaveAndNext(LOLexState *ls)
+{
+    LOLexSave(ls, ls->current);
+    LOLexNextChar(ls);
+}
+
+#pragma mark - errors
+
+/** luaO_chunkid: the source name as shown in messages */
+static void LOLexChunkId(char *out, const char *source, size_t l, size_t bufflen)
+{
+    static const char PRE[] = "[string \"", POS[] = "\"]", RETS[] = "...";
+    if (l > 0 && *source == '=') {  /* 'literal' source */
+        size_t n = MIN(l - 1, bufflen - 1);
+        memcpy(out, source + 1, n);
+        out[n] = '\0';
+    } else if (l > 0 && *source == '@') {  /* file name */
+        if (l <= bufflen) {
+            memcpy(out, source + 1, l - 1);
+            out[l - 1] = '\0';
+        } else {  /* add '...' before rest of name */
+            memcpy(out, RETS, 3);
+            bufflen -= 3;
+            memcpy(out + 3, source + 1 + l - bufflen, bufflen - 1);
+            out[3 + bufflen - 1] = '\0';
+        }
+    } else {  /* string; format as [string "source"] */
+        const char *nl = memchr(source, '\n', l);
+        char *o = out;
+        memcpy(o, PRE, sizeof(PRE) - 1);
+        o += sizeof(PRE) - 1;
+        bufflen -= (sizeof(PRE) - 1) + (sizeof(RETS) - 1) + (sizeof(POS) - 1) + 1;
+        if (l < bufflen && nl == NULL) {  /* small one-line source? */
+            memcpy(o, source, l);
+            o += l;
+        } else {
+            if (nl != NULL)
+                l = nl - source;
+            if (l > bufflen)
+                l = bufflen;
+            memcpy(o, source, l);
+            o += l;
+            memcpy(o, RETS, sizeof(RETS) - 1);
+            o += sizeof(RETS) - 1;
+        }
+        memcpy(o, POS, sizeof(POS));
+    }
+}
+
+const char *LOLexToken2Str(LOLexState *ls, int token, char *buffer, int size)
+{
+    if (token < LO_FIRST_RESERVED) {  /* single-byte symbols? */
+        if (token >= ' ' && token < 127)
+            snprintf(buffer, size, "'%c'", token);
+        else
+            snprintf(buffer, size, "char(%d)", token);
+    } else {
+        const char *s = LOLexTokens[token - LO_FIRST_RESERVED];
+        if (token < LO_TK_EOS)  /* fixed format (symbols and reserved words)? */
+            snprintf(buffer, size, "'%s'", s);
+        else  /* names, strings, and numerals */
+            return s;
+    }
+    return buffer;
+}
+
+/** Raise "chunk:line: msg", followed by "near " and {@code near} unless it is NULL */
+static void LOLexRaise(LOLexState *ls, const char *msg, const char *near, const unsigned char *text, int textLength) __attribute__((noreturn));
+
+static void LOLexRaise(LOLexState *ls, const char *msg, const char *near, const unsigned char *text, int textLength)
+{
+    LOStringBuilder *sb = LOStringBuilderAcquire();
+    LOStringBuilderAppendCString(sb, ls->chunkid);
+    LOStringBuilderAppendChar(sb, ':');
+    LOStringBuilderAppendInt(sb, ls->linenumber);
+    LOStringBuilderAppendCString(sb, ": ");
+    LOStringBuilderAppendCString(sb, msg);
+    if (near) {
+        LOStringBuilderAppendCString(sb, " near ");
+        LOStringBuilderAppendCString(sb, near);
+    } else if (text) {
+        LOStringBuilderAppendCString(sb, " near '");
+        LOStringBuilderAppendBytes(sb, text, textLength);
+        LOStringBuilderAppendChar(sb, '\'');
+    }
+    NSString *message = LOStringBuilderToNSString(sb);
+    LOStringBuilderRelease(sb);
+    [LOLuaValue error:message];
+    __builtin_unreachable();
+}
+
+static void LOLexError(LOLexState *ls, const char *msg, int token) __attribute__((noreturn));
+
+static void LOLexError(LOLexState *ls, const char *msg, int token)
+{
+    switch (token) {
+        case 0:
+            LOLexRaise(ls, msg, NULL, NULL, 0);
+        case LO_TK_NAME: case LO_TK_STRING: case LO_TK_NUMBER: {
+            /* the text of the token as far as it was read */
+            const unsigned char *end = LOLexPosition(ls);
+            LOLexRaise(ls, msg, NULL, ls->tokenStart, (int)(end - ls->tokenStart));
+        }
+        default: {
+            char buffer[32];
+            LOLexRaise(ls, msg, LOLexToken2Str(ls, token, buffer, sizeof(buffer)), NULL, 0);
+        }
+    }
+}
+
+void LOLexSyntaxError(LOLexState *ls, const char *msg)
+{
+    LOLexError(ls, msg, ls->t.token);
+}
+
+#pragma mark - strings
+
+static void LOLexResizeStrings(LOLexState *ls)
+{
+    int size = ls->stringsSize ? ls->stringsSize * 2 : 256;
+    LOLexString *strings = calloc(size, sizeof(LOLexString));
+    for (int i = 0; i < ls->stringsSize; i++) {
+        LOLexString *e = &ls->strings[i];
+        if (e->bytes) {
+            int j = (int)(e->hash & (size - 1));
+            while (strings[j].bytes)
+                j = (j + 1) & (size - 1);
+            strings[j] = *e;
+        }
+    }
+    free(ls->strings);
+    ls->strings = strings;
+    ls->stringsSize = size;
+}
+
+/** The entry of the intern table for these bytes, a new empty one if there is none */
+static LOLexString *LOLexIntern(LOLexState *ls, const unsigned char *bytes, int length)
+{
+    NSUInteger hash = LOLuaStringHashBytes(bytes, length);
+    int mask = ls->stringsSize - 1;
+    int i = (int)(hash & mask);
+    for (LOLexString *e = &ls->strings[i]; e->bytes; e = &ls->strings[i = (i + 1) & mask]) {
+        if (e->hash == hash && e->length == length && memcmp(e->bytes, bytes, length) == 0)
+            return e;
+    }
+    if (2 * (ls->nstrings + 1) > ls->stringsSize) {
+        LOLexResizeStrings(ls);
+        mask = ls->stringsSize - 1;
+        for (i = (int)(hash & mask); ls->strings[i].bytes; i = (i + 1) & mask)
+            ;
+    }
+    ls->nstrings++;
+    LOLexString *e = &ls->strings[i];
+    e->bytes = bytes;
+    e->length = length;
+    e->hash = hash;
+    return e;
+}
+
+static LOLuaString *LOLexStringOf(LOLexString *e, const unsigned char *bytes, int length)
+{
+    if (e->string == NULL) {
+        LOLuaString *s = [LOLuaString valueOfBytes:bytes length:length];
+        e->string = CFBridgingRetain(s);
+        /* the bytes may be in the lexer's buffer; the string's own stay put */
+        e->bytes = s->_bytes;
+    }
+    return (__bridge LOLuaString *)e->string;
+}
+
+LOLuaString *LOLexNewString(LOLexState *ls, const void *bytes, int length)
+{
+    return LOLexStringOf(LOLexIntern(ls, bytes, length), bytes, length);
+}
+
+void LOLexSetInput(LOLexState *ls, LODyndata *dyd, const unsigned char *bytes, int length, LOLuaString *source)
+{
+    memset(ls, 0, sizeof(*ls));
+    ls->dyd = dyd;
+    ls->p = bytes;
+    ls->end = bytes + length;
+    ls->linenumber = 1;
+    ls->lastline = 1;
+    ls->lookahead.token = LO_TK_EOS;  /* no look-ahead token */
+    ls->source = source;
+    LOLexChunkId(ls->chunkid, (const char *)LOLuaStringBytes(source), source->_length, sizeof(ls->chunkid));
+    LOLexResizeStrings(ls);
+    for (int i = 0; i < LO_NUM_RESERVED; i++) {
+        const char *word = LOLexTokens[i];
+        LOLexIntern(ls, (const unsigned char *)word, (int)strlen(word))->reserved = LO_FIRST_RESERVED + i;
+    }
+    ls->envn = LOLexNewString(ls, "_ENV", 4);
+    ls->breakn = LOLexNewString(ls, "break", 5);
+    LOLexNextChar(ls);
+    /* skip a first line starting with '#', as lua's loadfile does */
+    if (ls->current == '#') {
+        while (ls->current != LO_EOZ && !LOLexCurrIsNewline(ls))
+            LOLexNextChar(ls);
+    }
+}
+
+void LOLexFree(LOLexState *ls)
+{
+    for (int i = 0; i < ls->stringsSize; i++) {
+        if (ls->strings[i].string)
+            CFRelease(ls->strings[i].string);
+    }
+    free(ls->strings);
+    free(ls->buff);
+    ls->strings = NULL;
+    ls->buff = NULL;
+}
+
+#pragma mark - lexical analyzer
+
+static void LOLexIncLineNumber(LOLexState *ls)
+{
+    int old = ls->current;
+    LOLexNextChar(ls);  /* skip `\n' or `\r' */
+    if (LOLexCurrIsNewline(ls) && ls->current != old)
+        LOLexNextChar(ls);  /* skip `\n\r' or `\r\n' */
+    if (++ls->linenumber >= INT_MAX)
+        LOLexSyntaxError(ls, "chunk has too many lines");
+}
+
+static void LOLexReadNumeral(LOLexState *ls, LOToken *seminfo)
+{
+    int expo = 'e';
+    int first = ls->current;
+    LOLexNextChar(ls);
+    if (first == '0' && (ls->current | 0x20) == 'x') {  /* hexadecimal? */
+        expo = 'p';
+        LOLexNextChar(ls);
+    }
+    for (;;) {
+        if ((ls->current | 0x20) == expo) {  /* exponent part? */
+            LOLexNextChar(ls);
+            if (ls->current == '+' || ls->current == '-')  /* optional exponent sign */
+                LOLexNextChar(ls);
+        }
+        if (LOLexIsXDigit(ls->current) || ls->current == '.')
+            LOLexNextChar(ls);
+        else
+            break;
+    }
+    /* the numeral is read in place; the C locale never applies */
+    LOTValue v;
+    const unsigned char *end = LOLexPosition(ls);
+    if (!LOLuaNumberParse(ls->tokenStart, (int)(end - ls->tokenStart), &v))
+        LOLexError(ls, "malformed number", LO_TK_NUMBER);
+    seminfo->r = LOTValueToDouble(v);
+}
+
+/** skip a sequence '[=*[' or ']=*]' and return its number of '='s, or (-count) - 1 if it is not followed by the bracket */
+static int LOLexSkipSep(LOLexState *ls)
+{
+    int count = 0;
+    int s = ls->current;
+    LOLexNextChar(ls);
+    while (ls->current == '=') {
+        LOLexNextChar(ls);
+        count++;
+    }
+    return ls->current == s ? count : (-count) - 1;
+}
+
+static void LOLexReadLongString(LOLexState *ls, LOToken *seminfo, int sep)
+{
+    BOOL sawCR = NO;
+    LOLexNextChar(ls);  /* skip 2nd `[' */
+    if (LOLexCurrIsNewline(ls))  /* string starts with a newline? */
+        LOLexIncLineNumber(ls);  /* skip it */
+    const unsigned char *start = LOLexPosition(ls), *end;
+    for (;;) {
+        switch (ls->current) {
+            case LO_EOZ:
+                LOLexError(ls, seminfo ? "unfinished long string" : "unfinished long comment", LO_TK_EOS);
+            case ']': {
+                end = LOLexPosition(ls);
+                if (LOLexSkipSep(ls) == sep) {
+                    LOLexNextChar(ls);  /* skip 2nd `]' */
+                    goto endloop;
+                }
+                break;
+            }
+            case '\r':
+                sawCR = YES;
+                LOLexIncLineNumber(ls);
+                break;
+            case '\n':
+                LOLexIncLineNumber(ls);
+                break;
+            default:
+                LOLexNextChar(ls);
+        }
+    }
+endloop:
+    if (!seminfo)
+        return;
+    if (!sawCR) {
+        seminfo->ts = LOLexNewString(ls, start, (int)(end - start));
+        return;
+    }
+    /* every kind of line break reads as '\n' */
+    ls->nbuff = 0;
+    for (const unsigned char *q = start; q < end; q++) {
+        if (*q == '\n' || *q == '\r') {
+            if (q + 1 < end && (q[1] == '\n' || q[1] == '\r') && q[1] != q[0])
+                q++;
+            LOLexSave(ls, '\n');
+        } else
+            LOLexSave(ls, *q);
+    }
+    seminfo->ts = LOLexNewString(ls, ls->buff, ls->nbuff);
+}
+
+static void LOLexEscError(LOLexState *ls, const unsigned char *from, const char *msg) __attribute__((noreturn));
+
+static void LOLexEscError(LOLexState *ls, const unsigned char *from, const char *msg)
+{
+    const unsigned char *to = LOLexPosition(ls);
+    if (ls->current != LO_EOZ && to < ls->end)
+        to++;  /* include the offending character */
+    LOLexRaise(ls, msg, NULL, from, (int)(to - from));
+}
+
+static int LOLexReadHexaEsc(LOLexState *ls, const unsigned char *escape)
+{
+    int r = 0;
+    for (int i = 1; i < 3; i++) {  /* read two hexadecimal digits */
+        LOLexNextChar(ls);
+        if (!LOLexIsXDigit(ls->current))
+            LOLexEscError(ls, escape, "hexadecimal digit expected");
+        r = (r << 4) + LOLexHexValue(ls->current);
+    }
+    return r;
+}
+
+static int LOLexReadDecEsc(LOLexState *ls, const unsigned char *escape)
+{
+    int i, r = 0;
+    for (i = 0; i < 3 && LOLexIsDigit(ls->current); i++) {  /* read up to 3 digits */
+        r = 10 * r + ls->current - '0';
+        LOLexNextChar(ls);
+    }
+    if (r > UCHAR_MAX) {
+        const unsigned char *to = LOLexPosition(ls);
+        LOLexRaise(ls, "decimal escape too large", NULL, escape, (int)(to - escape));
+    }
+    return r;
+}
+
+static void LOLexReadString(LOLexState *ls, int del, LOToken *seminfo)
+{
+    /* most literals have no escapes and are interned straight from the source */
+    const unsigned char *q = ls->p;
+    while (q < ls->end && *q != del && *q != '\\' && *q != '\n' && *q != '\r')
+        q++;
+    if (q < ls->end && *q == del) {
+        seminfo->ts = LOLexNewString(ls, ls->p, (int)(q - ls->p));
+        ls->p = q + 1;
+        LOLexNextChar(ls);
+        return;
+    }
+
+    ls->nbuff = 0;
+    LOLexNextChar(ls);  /* skip the delimiter */
+    while (ls->current != del) {
+        switch (ls->current) {
+            case LO_EOZ:
+                LOLexError(ls, "unfinished string", LO_TK_EOS);
+            case '\n':
+            case '\r':
+                LOLexError(ls, "unfinished string", LO_TK_STRING);
+            case '\\': {  /* escape sequences */
+                const unsigned char *escape = LOLexPosition(ls);
+                int c;  /* final character to be saved */
+                LOLexNextChar(ls);  /* do not save the `\' */
+                switch (ls->current) {
+                    case 'a': c = '\a'; goto read_save;
+                    case 'b': c = '\b'; goto read_save;
+                    case 'f': c = '\f'; goto read_save;
+                    case 'n': c = '\n'; goto read_save;
+                    case 'r': c = '\r'; goto read_save;
+                    case 't': c = '\t'; goto read_save;
+                    case 'v': c = '\v'; goto read_save;
+                    case 'x': c = LOLexReadHexaEsc(ls, escape); goto read_save;
+                    case '\n': case '\r':
+                        LOLexIncLineNumber(ls);
+                        c = '\n';
+                        goto only_save;
+                    case '\\': case '\"': case '\'':
+                        c = ls->current;
+                        goto read_save;
+                    case LO_EOZ:
+                        goto no_save;  /* will raise an error next loop */
+                    case 'z': {  /* zap following span of spaces */
+                        LOLexNextChar(ls);
+                        while (LOLexIsSpace(ls->current)) {
+                            if (LOLexCurrIsNewline(ls))
+                                LOLexIncLineNumber(ls);
+                            else
+                                LOLexNextChar(ls);
+                        }
+                        goto no_save;
+                    }
+                    default: {
+                        if (!LOLexIsDigit(ls->current))
+                            LOLexEscError(ls, escape, "invalid escape sequence");
+                        /* digital escape \ddd */
+                        c = LOLexReadDecEsc(ls, escape);
+                        goto only_save;
+                    }
+                }
+            read_save:
+                LOLexNextChar(ls);
+            only_save:
+                LOLexSave(ls, c);
+            no_save:
+                break;
+            }
+            default:
+                LOLexSaveAndNext(ls);
+        }
+    }
+    LOLexNextChar(ls);  /* skip delimiter */
+    seminfo->ts = LOLexNewString(ls, ls->buff, ls->nbuff);
+}
+
+static int LOLexLex(LOLexState *ls, LOToken *seminfo)
+{
+    for (;;) {
+        ls->tokenStart = LOLexPosition(ls);
+        switch (ls->current) {
+            case '\n': case '\r': {  /* line breaks */
+                LOLexIncLineNumber(ls);
+                break;
+            }
+            case ' ': case '\f': case '\t': case '\v': {  /* spaces */
+                LOLexNextChar(ls);
+                break;
+            }
+            case '-': {  /* '-' or '--' (comment) */
+                LOLexNextChar(ls);
+                if (ls->current != '-')
+                    return '-';
+                /* else is a comment */
+                LOLexNextChar(ls);
+                if (ls->current == '[') {  /* long comment? */
+                    int sep = LOLexSkipSep(ls);
+                    if (sep >= 0) {
+                        LOLexReadLongString(ls, NULL, sep);  /* skip long comment */
+                        break;
+                    }
+                }
+                /* else short comment */
+                const unsigned char *q = LOLexPosition(ls);
+                while (q < ls->end && *q != '\n' && *q != '\r')
+                    q++;
+                ls->p = q;
+                LOLexNextChar(ls);
+                break;
+            }
+            case '[': {  /* long string or simply '[' */
+                int sep = LOLexSkipSep(ls);
+                if (sep >= 0) {
+                    LOLexReadLongString(ls, seminfo, sep);
+                    return LO_TK_STRING;
+                } else if (sep == -1)
+                    return '[';
+                else
+                    LOLexError(ls, "invalid long string delimiter", LO_TK_STRING);
+            }
+            case '=': {
+                LOLexNextChar(ls);
+                if (ls->current != '=')
+                    return '=';
+                LOLexNextChar(ls);
+                return LO_TK_EQ;
+            }
+            case '<': {
+                LOLexNextChar(ls);
+                if (ls->current != '=')
+                    return '<';
+                LOLexNextChar(ls);
+                return LO_TK_LE;
+            }
+            case '>': {
+                LOLexNextChar(ls);
+                if (ls->current != '=')
+                    return '>';
+                LOLexNextChar(ls);
+                return LO_TK_GE;
+            }
+            case '~': {
+                LOLexNextChar(ls);
+                if (ls->current != '=')
+                    return '~';
+                LOLexNextChar(ls);
+                return LO_TK_NE;
+            }
+            case ':': {
+                LOLexNextChar(ls);
+                if (ls->current != ':')
+                    return ':';
+                LOLexNextChar(ls);
+                return LO_TK_DBCOLON;
+            }
+            case '"': case '\'': {  /* short literal strings */
+                LOLexReadString(ls, ls->current, seminfo);
+                return LO_TK_STRING;
+            }
+            case '.': {  /* '.', '..', '...', or number */
+                LOLexNextChar(ls);
+                if (ls->current == '.') {
+                    LOLexNextChar(ls);
+                    if (ls->current == '.') {
+                        LOLexNextChar(ls);
+                        return LO_TK_DOTS;  /* '...' */
+                    }
+                    return LO_TK_CONCAT;  /* '..' */
+                } else if (!LOLexIsDigit(ls->current))
+                    return '.';
+                LOLexReadNumeral(ls, seminfo);
+                return LO_TK_NUMBER;
+            }
+            case '0': case '1': case '2': case '3': case '4':
+            case '5': case '6': case '7': case '8': case '9': {
+                LOLexReadNumeral(ls, seminfo);
+                return LO_TK_NUMBER;
+            }
+            case LO_EOZ: {
+                return LO_TK_EOS;
+            }
+            default: {
+                if (LOLexIsAlpha(ls->current)) {  /* identifier or reserved word? */
+                    const unsigned char *start = ls->tokenStart, *q = ls->p;
+                    while (q < ls->end && LOLexIsAlnum(*q))
+                        q++;
+                    ls->p = q;
+                    LOLexNextChar(ls);
+                    LOLexString *e = LOLexIntern(ls, start, (int)(q - start));
+                    if (e->reserved)
+                        return e->reserved;
+                    seminfo->ts = LOLexStringOf(e, start, (int)(q - start));
+                    return LO_TK_NAME;
+                } else {  /* single-char tokens (+ - / ...) */
+                    int c = ls->current;
+                    LOLexNextChar(ls);
+                    return c;
+                }
+            }
+        }
+    }
+}
+
+void LOLexNext(LOLexState *ls)
+{
+    ls->lastline = ls->linenumber;
+    if (ls->lookahead.token != LO_TK_EOS) {  /* is there a look-ahead token? */
+        ls->t = ls->lookahead;  /* use this one */
+        ls->lookahead.token = LO_TK_EOS;  /* and discharge it */
+    } else
+        ls->t.token = LOLexLex(ls, &ls->t);  /* read next token */
+}
+
+int LOLexLookahead(LOLexState *ls)
+{
+    ls->lookahead.token = LOLexLex(ls, &ls->lookahead);
+    return ls->lookahead.token;
+}
+
+#pragma mark - parser
+
+#define LO_HASMULTRET(k) ((k) == LO_VCALL || (k) == LO_VVARARG)
+
+static void LOParseStatement(LOLexState *ls);
+static void LOParseExpr(LOLexState *ls, LOExpDesc *v);
+
+/** Raise a semantic error, without the 'near' part */
+static void LOParseSemError(LOLexState *ls, const char *msg) __attribute__((noreturn));
+
+static void LOParseSemError(LOLexState *ls, const char *msg)
+{
+    ls->t.token = 0;  /* remove 'near to' from final message */
+    LOLexSyntaxError(ls, msg);
+}
+
+static void LOParseErrorExpected(LOLexState *ls, int token) __attribute__((noreturn));
+
+static void LOParseErrorExpected(LOLexState *ls, int token)
+{
+    char buffer[32], msg[64];
+    snprintf(msg, sizeof(msg), "%s expected", LOLexToken2Str(ls, token, buffer, sizeof(buffer)));
+    LOLexSyntaxError(ls, msg);
+}
+
+static void LOParseErrorLimit(LOFuncState *fs, int limit, const char *what) __attribute__((noreturn));
+
+static void LOParseErrorLimit(LOFuncState *fs, int limit, const char *what)
+{
+    char where[48], msg[128];
+    int line = fs->f->_linedefined;
+    if (line == 0)
+        snprintf(where, sizeof(where), "main function");
+    else
+        snprintf(where, sizeof(where), "function at line %d", line);
+    snprintf(msg, sizeof(msg), "too many %s (limit is %d) in %s", what, limit, where);
+    LOLexSyntaxError(fs->ls, msg);
+}
+
+static inline void LOParseCheckLimit(LOFuncState *fs, int v, int l, const char *what)
+{
+    if (v > l)
+        LOParseErrorLimit(fs, l, what);
+}
+
+static inline BOOL LOParseTestNext(LOLexState *ls, int c)
+{
+    if (ls->t.token == c) {
+        LOLexNext(ls);
+        return YES;
+    }
+    return NO;
+}
+
+static inline void LOParseCheck(LOLexState *ls, int c)
+{
+    if (ls->t.token != c)
+        LOParseErrorExpected(ls, c);
+}
+
+static inline void LOParseCheckNext(LOLexState *ls, int c)
+{
+    LOParseCheck(ls, c);
+    LOLexNext(ls);
+}
+
+static inline void LOParseCheckCondition(LOLexState *ls, BOOL c, const char *msg)
+{
+    if (!c)
+        LOLexSyntaxError(ls, msg);
+}
+
+static void LOParseCheckMatch(LOLexState *ls, int what, int who, int where)
+{
+    if (!LOParseTestNext(ls, what)) {
+        if (where == ls->linenumber)
+            LOParseErrorExpected(ls, what);
+        else {
+            char whatBuffer[32], whoBuffer[32], msg[128];
+            snprintf(msg, sizeof(msg), "%s expected (to close %s at line %d)",
+                     LOLexToken2Str(ls, what, whatBuffer, sizeof(whatBuffer)),
+                     LOLexToken2Str(ls, who, whoBuffer, sizeof(whoBuffer)), where);
+            LOLexSyntaxError(ls, msg);
+        }
+    }
+}
+
+static LOLuaString *LOParseStrCheckName(LOLexState *ls)
+{
+    LOParseCheck(ls, LO_TK_NAME);
+    LOLuaString *ts = ls->t.ts;
+    LOLexNext(ls);
+    return ts;
+}
+
+static inline void LOParseInitExp(LOExpDesc *e, LOExpKind k, int i)
+{
+    e->f = e->t = LO_NO_JUMP;
+    e->k = k;
+    e->u.info = i;
+}
+
+static void LOParseCodeString(LOLexState *ls, LOExpDesc *e, LOLuaString *s)
+{
+    LOParseInitExp(e, LO_VK, LOCodeStringK(ls->fs, s));
+}
+
+static void LOParseCheckName(LOLexState *ls, LOExpDesc *e)
+{
+    LOParseCodeString(ls, e, LOParseStrCheckName(ls));
+}
+
+static int LOParseRegisterLocalVar(LOLexState *ls, LOLuaString *varname)
+{
+    LOFuncState *fs = ls->fs;
+    LOPrototype *f = fs->f;
+    f->_locvars = LOFuncStateGrowVector(ls, f->_locvars, fs->nlocvars, &fs->sizelocvars, sizeof(LOLocVar), SHRT_MAX, "local variables");
+    LOTValue name = LOTValueFromPointer((__bridge void *)varname);
+    LOTValueRetain(name);
+    f->_locvars[fs->nlocvars].varname = name;
+    f->_locvars[fs->nlocvars].startpc = 0;
+    f->_locvars[fs->nlocvars].endpc = 0;
+    f->_locvarsSize = fs->nlocvars + 1;
+    return fs->nlocvars++;
+}
+
+static void LOParseNewLocalVar(LOLexState *ls, LOLuaString *name)
+{
+    LOFuncState *fs = ls->fs;
+    LODyndata *dyd = ls->dyd;
+    int reg = LOParseRegisterLocalVar(ls, name);
+    LOParseCheckLimit(fs, dyd->actvar.n + 1 - fs->firstlocal, LO_MAXVARS, "local variables");
+    dyd->actvar.arr = LOFuncStateGrowVector(ls, dyd->actvar.arr, dyd->actvar.n, &dyd->actvar.size, sizeof(LOVarDesc), INT_MAX, "local variables");
+    dyd->actvar.arr[dyd->actvar.n++].idx = (short)reg;
+}
+
+#define LOParseNewLocalVarLiteral(ls,v) LOParseNewLocalVar(ls, LOLexNewString(ls, "" v, (int)(sizeof(v) - 1)))
+
+static LOLocVar *LOParseGetLocVar(LOFuncState *fs, int i)
+{
+    int idx = fs->ls->dyd->actvar.arr[fs->firstlocal + i].idx;
+    return &fs->f->_locvars[idx];
+}
+
+static void LOParseAdjustLocalVars(LOLexState *ls, int nvars)
+{
+    LOFuncState *fs = ls->fs;
+    fs->nactvar = (uint8_t)(fs->nactvar + nvars);
+    for (; nvars; nvars--)
+        LOParseGetLocVar(fs, fs->nactvar - nvars)->startpc = fs->pc;
+}
+
+static void LOParseRemoveVars(LOFuncState *fs, int tolevel)
+{
+    fs->ls->dyd->actvar.n -= (fs->nactvar - tolevel);
+    while (fs->nactvar > tolevel)
+        LOParseGetLocVar(fs, --fs->nactvar)->endpc = fs->pc;
+}
+
+static int LOParseSearchUpvalue(LOFuncState *fs, LOLuaString *name)
+{
+    LOUpvalDesc *up = fs->f->_upvalues;
+    LOTValue n = LOTValueFromPointer((__bridge void *)name);
+    for (int i = 0; i < fs->nups; i++) {
+        if (up[i].name == n)
+            return i;
+    }
+    return -1;  /* not found */
+}
+
+static int LOParseNewUpvalue(LOFuncState *fs, LOLuaString *name, LOExpDesc *v)
+{
+    LOPrototype *f = fs->f;
+    LOParseCheckLimit(fs, fs->nups + 1, LO_MAXUPVAL, "upvalues");
+    f->_upvalues = LOFuncStateGrowVector(fs->ls, f->_upvalues, fs->nups, &fs->sizeupvalues, sizeof(LOUpvalDesc), LO_MAXUPVAL, "upvalues");
+    LOTValue n = LOTValueFromPointer((__bridge void *)name);
+    LOTValueRetain(n);
+    f->_upvalues[fs->nups].instack = (v->k == LO_VLOCAL);
+    f->_upvalues[fs->nups].idx = (uint8_t)v->u.info;
+    f->_upvalues[fs->nups].name = n;
+    f->_upvaluesSize = fs->nups + 1;
+    return fs->nups++;
+}
+
+static int LOParseSearchVar(LOFuncState *fs, LOLuaString *n)
+{
+    LOTValue name = LOTValueFromPointer((__bridge void *)n);
+    for (int i = (int)fs->nactvar - 1; i >= 0; i--) {
+        if (name == LOParseGetLocVar(fs, i)->varname)
+            return i;
+    }
+    return -1;  /* not found */
+}
+
+/** Mark block where variable at given level was defined (to emit close instructions later) */
+static void LOParseMarkUpval(LOFuncState *fs, int level)
+{
+    LOBlockCnt *bl = fs->bl;
+    while (bl->nactvar > level)
+        bl = bl->previous;
+    bl->upval = 1;
+}
+
+/** Find variable with given name 'n'. If it is an upvalue, add this upvalue into all intermediate functions. */
+static LOExpKind LOParseSingleVarAux(LOFuncState *fs, LOLuaString *n, LOExpDesc *var, BOOL base)
+{
+    if (fs == NULL)  /* no more levels? */
+        return LO_VVOID;  /* default is global */
+    int v = LOParseSearchVar(fs, n);  /* look up locals at current level */
+    if (v >= 0) {  /* found? */
+        LOParseInitExp(var, LO_VLOCAL, v);  /* variable is local */
+        if (!base)
+            LOParseMarkUpval(fs, v);  /* local will be used as an upval */
+        return LO_VLOCAL;
+    }
+    /* not found as local at current level; try upvalues */
+    int idx = LOParseSearchUpvalue(fs, n);
+    if (idx < 0) {  /* not found? */
+        if (LOParseSingleVarAux(fs->prev, n, var, NO) == LO_VVOID)  /* try upper levels */
+            return LO_VVOID;  /* not found; is a global */
+        /* else was LOCAL or UPVAL */
+        idx = LOParseNewUpvalue(fs, n, var);  /* will be a new upvalue */
+    }
+    LOParseInitExp(var, LO_VUPVAL, idx);
+    return LO_VUPVAL;
+}
+
+static void LOParseSingleVar(LOLexState *ls, LOExpDesc *var)
+{
+    LOLuaString *varname = LOParseStrCheckName(ls);
+    LOFuncState *fs = ls->fs;
+    if (LOParseSingleVarAux(fs, varname, var, YES) == LO_VVOID) {  /* global name? */
+        LOExpDesc key;
+        LOParseSingleVarAux(fs, ls->envn, var, YES);  /* get environment variable */
+        LOParseCodeString(ls, &key, varname);
+        LOCodeIndexed(fs, var, &key);  /* env[varname] */
+    }
+}
+
+static void LOParseAdjustAssign(LOLexState *ls, int nvars, int nexps, LOExpDesc *e)
+{
+    LOFuncState *fs = ls->fs;
+    int extra = nvars - nexps;
+    if (LO_HASMULTRET(e->k)) {
+        extra++;  /* includes call itself */
+        if (extra < 0)
+            extra = 0;
+        LOCodeSetReturns(fs, e, extra);  /* last exp. provides the difference */
+        if (extra > 1)
+            LOCodeReserveRegs(fs, extra - 1);
+    } else {
+        if (e->k != LO_VVOID)  /* at least one expression? */
+            LOCodeExp2NextReg(fs, e);  /* close last expression */
+        if (extra > 0) {
+            int reg = fs->freereg;
+            LOCodeReserveRegs(fs, extra);
+            LOCodeNil(fs, reg, extra);
+        }
+    }
+}
+
+static inline void LOParseEnterLevel(LOLexState *ls)
+{
+    ++ls->nCcalls;
+    LOParseCheckLimit(ls->fs, ls->nCcalls, LO_MAXCCALLS, "C levels");
+}
+
+#define LOParseLeaveLevel(ls) ((ls)->nCcalls--)
+
+static void LOParseCloseGoto(LOLexState *ls, int g, LOLabelDesc *label)
+{
+    LOFuncState *fs = ls->fs;
+    LOLabelList *gl = &ls->dyd->gt;
+    LOLabelDesc *gt = &gl->arr[g];
+    if (gt->nactvar < label->nactvar) {
+        LOLuaString *vname = (LOLuaString *)LOTValueGetObject(LOParseGetLocVar(fs, gt->nactvar)->varname);
+        char msg[256];
+        snprintf(msg, sizeof(msg), "<goto %.*s> at line %d jumps into the scope of local '%.*s'",
+                 gt->name->_length, (const char *)gt->name->_bytes, gt->line, vname->_length, (const char *)vname->_bytes);
+        LOParseSemError(ls, msg);
+    }
+    LOCodePatchList(fs, gt->pc, label->pc);
+    /* remove goto from pending list */
+    for (int i = g; i < gl->n - 1; i++)
+        gl->arr[i] = gl->arr[i + 1];
+    gl->n--;
+}
+
+/** try to close a goto with existing labels; this solves backward jumps */
+static BOOL LOParseFindLabel(LOLexState *ls, int g)
+{
+    LOBlockCnt *bl = ls->fs->bl;
+    LODyndata *dyd = ls->dyd;
+    LOLabelDesc *gt = &dyd->gt.arr[g];
+    /* check labels in current block for a match */
+    for (int i = bl->firstlabel; i < dyd->label.n; i++) {
+        LOLabelDesc *lb = &dyd->label.arr[i];
+        if (lb->name == gt->name) {  /* correct label? */
+            if (gt->nactvar > lb->nactvar && (bl->upval || dyd->label.n > bl->firstlabel))
+                LOCodePatchClose(ls->fs, gt->pc, lb->nactvar);
+            LOParseCloseGoto(ls, g, lb);  /* close it */
+            return YES;
+        }
+    }
+    return NO;  /* label not found; cannot close goto */
+}
+
+static int LOParseNewLabelEntry(LOLexState *ls, LOLabelList *l, LOLuaString *name, int line, int pc)
+{
+    int n = l->n;
+    l->arr = LOFuncStateGrowVector(ls, l->arr, n, &l->size, sizeof(LOLabelDesc), SHRT_MAX, "labels/gotos");
+    l->arr[n].name = name;
+    l->arr[n].line = line;
+    l->arr[n].nactvar = ls->fs->nactvar;
+    l->arr[n].pc = pc;
+    l->n++;
+    return n;
+}
+
+/** check whether new label 'lb' matches any pending gotos in current block; solves forward jumps */
+static void LOParseFindGotos(LOLexState *ls, LOLabelDesc *lb)
+{
+    LOLabelList *gl = &ls->dyd->gt;
+    int i = ls->fs->bl->firstgoto;
+    while (i < gl->n) {
+        if (gl->arr[i].name == lb->name)
+            LOParseCloseGoto(ls, i, lb);
+        else
+            i++;
+    }
+}
+
+/**
+ * "export" pending gotos to outer level, to check them against
+ * outer labels; if the block being exited has upvalues, and
+ * the goto exits the scope of any variable (which can be the
+ * upvalue), close those variables being exited.
+ */
+static void LOParseMoveGotosOut(LOFuncState *fs, LOBlockCnt *bl)
+{
+    int i = bl->firstgoto;
+    LOLabelList *gl = &fs->ls->dyd->gt;
+    /* correct pending gotos to current block and try to close it with visible labels */
+    while (i < gl->n) {
+        LOLabelDesc *gt = &gl->arr[i];
+        if (gt->nactvar > bl->nactvar) {
+            if (bl->upval)
+                LOCodePatchClose(fs, gt->pc, bl->nactvar);
+            gt->nactvar = bl->nactvar;
+        }
+        if (!LOParseFindLabel(fs->ls, i))
+            i++;  /* move to next one */
+    }
+}
+
+static void LOParseEnterBlock(LOFuncState *fs, LOBlockCnt *bl, uint8_t isloop)
+{
+    bl->isloop = isloop;
+    bl->nactvar = fs->nactvar;
+    bl->firstlabel = (short)fs->ls->dyd->label.n;
+    bl->firstgoto = (short)fs->ls->dyd->gt.n;
+    bl->upval = 0;
+    bl->previous = fs->bl;
+    fs->bl = bl;
+}
+
+/** create a label named "break" to resolve break statements */
+static void LOParseBreakLabel(LOLexState *ls)
+{
+    int l = LOParseNewLabelEntry(ls, &ls->dyd->label, ls->breakn, 0, ls->fs->pc);
+    LOParseFindGotos(ls, &ls->dyd->label.arr[l]);
+}
+
+/** generates an error for an undefined 'goto'; choose appropriate message when label name is a reserved word (which can only be 'break') */
+static void LOParseUndefGoto(LOLexState *ls, LOLabelDesc *gt) __attribute__((noreturn));
+
+static void LOParseUndefGoto(LOLexState *ls, LOLabelDesc *gt)
+{
+    char msg[256];
+    if (gt->name == ls->breakn)
+        snprintf(msg, sizeof(msg), "<%.*s> at line %d not inside a loop", gt->name->_length, (const char *)gt->name->_bytes, gt->line);
+    else
+        snprintf(msg, sizeof(msg), "no visible label '%.*s' for <goto> at line %d", gt->name->_length, (const char *)gt->name->_bytes, gt->line);
+    LOParseSemError(ls, msg);
+}
+
+static void LOParseLeaveBlock(LOFuncState *fs)
+{
+    LOBlockCnt *bl = fs->bl;
+    LOLexState *ls = fs->ls;
+    if (bl->previous && bl->upval) {
+        /* create a 'jump to here' to close upvalues */
+        int j = LOCodeJump(fs);
+        LOCodePatchClose(fs, j, bl->nactvar);
+        LOCodePatchToHere(fs, j);
+    }
+    if (bl->isloop)
+        LOParseBreakLabel(ls);  /* close pending breaks */
+    fs->bl = bl->previous;
+    LOParseRemoveVars(fs, bl->nactvar);
+    fs->freereg = fs->nactvar;  /* free registers */
+    ls->dyd->label.n = bl->firstlabel;  /* remove local labels */
+    if (bl->previous)  /* inner block? */
+        LOParseMoveGotosOut(fs, bl);  /* update pending gotos to outer block */
+    else if (bl->firstgoto < ls->dyd->gt.n)  /* pending gotos in outer block? */
+        LOParseUndefGoto(ls, &ls->dyd->gt.arr[bl->firstgoto]);  /* error */
+}
+
+/** codes instruction to create new closure in parent function */
+static void LOParseCodeClosure(LOLexState *ls, LOExpDesc *v)
+{
+    LOFuncState *fs = ls->fs->prev;
+    LOParseInitExp(v, LO_VRELOCABLE, LOCodeABx(fs, LO_OP_CLOSURE, 0, fs->np - 1));
+    LOCodeExp2NextReg(fs, v);  /* fix it at stack top (for GC) */
+}
+
+static void LOParseOpenFunc(LOLexState *ls, LOFuncState *fs, LOPrototype *f, LOBlockCnt *bl)
+{
+    LOFuncStateOpen(ls, fs, f);
+    LOParseEnterBlock(fs, bl, 0);
+}
+
+static void LOParseCloseFunc(LOLexState *ls)
+{
+    LOFuncState *fs = ls->fs;
+    LOCodeRet(fs, 0, 0);  /* final return */
+    LOParseLeaveBlock(fs);
+    LOFuncStateClose(ls, fs);
+}
+
+#pragma mark - GRAMMAR RULES
+
+/** check whether current token is in the follow set of a block. 'until' closes syntactical blocks, but do not close scope, so it handled in separate. */
+static BOOL LOParseBlockFollow(LOLexState *ls, BOOL withuntil)
+{
+    switch (ls->t.token) {
+        case LO_TK_ELSE: case LO_TK_ELSEIF:
+        case LO_TK_END: case LO_TK_EOS:
+            return YES;
+        case LO_TK_UNTIL:
+            return withuntil;
+        default:
+            return NO;
+    }
+}
+
+static void LOParseStatList(LOLexState *ls)
+{
+    /* statlist -> { stat [`;'] } */
+    while (!LOParseBlockFollow(ls, YES)) {
+        if (ls->t.token == LO_TK_RETURN) {
+            LOParseStatement(ls);
+            return;  /* 'return' must be last statement */
+        }
+        LOParseStatement(ls);
+    }
+}
+
+static void LOParseFieldSel(LOLexState *ls, LOExpDesc *v)
+{
+    /* fieldsel -> ['.' | ':'] NAME */
+    LOFuncState *fs = ls->fs;
+    LOExpDesc key;
+    LOCodeExp2AnyRegUp(fs, v);
+    LOLexNext(ls);  /* skip the dot or colon */
+    LOParseCheckName(ls, &key);
+    LOCodeIndexed(fs, v, &key);
+}
+
+static void LOParseYIndex(LOLexState *ls, LOExpDesc *v)
+{
+    /* index -> '[' expr ']' */
+    LOLexNext(ls);  /* skip the '[' */
+    LOParseExpr(ls, v);
+    LOCodeExp2Val(ls->fs, v);
+    LOParseCheckNext(ls, ']');
+}
+
+/*
+** {======================================================================
+** Rules for Constructors
+** =======================================================================
+*/
+
+typedef struct LOConsControl {
+    /** last list item read */
+    LOExpDesc v;
+    /** table descriptor */
+    LOExpDesc *t;
+    /** total number of `record' elements */
+    int nh;
+    /** total number of array elements */
+    int na;
+    /** number of array elements pending to be stored */
+    int tostore;
+} LOConsControl;
+
+static void LOParseRecField(LOLexState *ls, LOConsControl *cc)
+{
+    /* recfield -> (NAME | `['exp1`]') = exp1 */
+    LOFuncState *fs = ls->fs;
+    int reg = ls->fs->freereg;
+    LOExpDesc key, val;
+    if (ls->t.token == LO_TK_NAME) {
+        LOParseCheckLimit(fs, cc->nh, INT_MAX, "items in a constructor");
+        LOParseCheckName(ls, &key);
+    } else  /* ls->t.token == '[' */
+        LOParseYIndex(ls, &key);
+    cc->nh++;
+    LOParseCheckNext(ls, '=');
+    int rkkey = LOCodeExp2RK(fs, &key);
+    LOParseExpr(ls, &val);
+    LOCodeABC(fs, LO_OP_SETTABLE, cc->t->u.info, rkkey, LOCodeExp2RK(fs, &val));
+    fs->freereg = reg;  /* free registers */
+}
+
+static void LOParseCloseListField(LOFuncState *fs, LOConsControl *cc)
+{
+    if (cc->v.k == LO_VVOID)
+        return;  /* there is no list item */
+    LOCodeExp2NextReg(fs, &cc->v);
+    cc->v.k = LO_VVOID;
+    if (cc->tostore == LO_LFIELDS_PER_FLUSH) {
+        LOCodeSetList(fs, cc->t->u.info, cc->na, cc->tostore);  /* flush */
+        cc->tostore = 0;  /* no more items pending */
+    }
+}
+
+static void LOParseLastListField(LOFuncState *fs, LOConsControl *cc)
+{
+    if (cc->tostore == 0)
+        return;
+    if (LO_HASMULTRET(cc->v.k)) {
+        LOCodeSetMultRet(fs, &cc->v);
+        LOCodeSetList(fs, cc->t->u.info, cc->na, LO_MULTRET);
+        cc->na--;  /* do not count last expression (unknown number of elements) */
+    } else {
+        if (cc->v.k != LO_VVOID)
+            LOCodeExp2NextReg(fs, &cc->v);
+        LOCodeSetList(fs, cc->t->u.info, cc->na, cc->tostore);
+    }
+}
+
+static void LOParseListField(LOLexState *ls, LOConsControl *cc)
+{
+    /* listfield -> exp */
+    LOParseExpr(ls, &cc->v);
+    LOParseCheckLimit(ls->fs, cc->na, INT_MAX, "items in a constructor");
+    cc->na++;
+    cc->tostore++;
+}
+
+static void LOParseField(LOLexState *ls, LOConsControl *cc)
+{
+    /* field -> listfield | recfield */
+    switch (ls->t.token) {
+        case LO_TK_NAME: {  /* may be 'listfield' or 'recfield' */
+            if (LOLexLookahead(ls) != '=')  /* expression? */
+                LOParseListField(ls, cc);
+            else
+                LOParseRecField(ls, cc);
+            break;
+        }
+        case '[': {
+            LOParseRecField(ls, cc);
+            break;
+        }
+        default: {
+            LOParseListField(ls, cc);
+            break;
+        }
+    }
+}
+
+/** converts an integer to a "floating point byte", as lua's luaO_int2fb */
+static int LOParseInt2fb(unsigned int x)
+{
+    int e = 0;  /* exponent */
+    if (x < 8)
+        return x;
+    while (x >= 0x10) {
+        x = (x + 1) >> 1;
+        e++;
+    }
+    return ((e + 1) << 3) | ((int)x - 8);
+}
+
+static void LOParseConstructor(LOLexState *ls, LOExpDesc *t)
+{
+    /* constructor -> '{' [ field { sep field } [sep] ] '}' sep -> ',' | ';' */
+    LOFuncState *fs = ls->fs;
+    int line = ls->linenumber;
+    int pc = LOCodeABC(fs, LO_OP_NEWTABLE, 0, 0, 0);
+    LOConsControl cc;
+    cc.na = cc.nh = cc.tostore = 0;
+    cc.t = t;
+    LOParseInitExp(t, LO_VRELOCABLE, pc);
+    LOParseInitExp(&cc.v, LO_VVOID, 0);  /* no value (yet) */
+    LOCodeExp2NextReg(ls->fs, t);  /* fix it at stack top */
+    LOParseCheckNext(ls, '{');
+    do {
+        if (ls->t.token == '}')
+            break;
+        LOParseCloseListField(fs, &cc);
+        LOParseField(ls, &cc);
+    } while (LOParseTestNext(ls, ',') || LOParseTestNext(ls, ';'));
+    LOParseCheckMatch(ls, '}', '{', line);
+    LOParseLastListField(fs, &cc);
+    LO_SETARG_B(fs->f->_code[pc], LOParseInt2fb(cc.na));  /* set initial array size */
+    LO_SETARG_C(fs->f->_code[pc], LOParseInt2fb(cc.nh));  /* set initial table size */
+}
+
+/* }====================================================================== */
+
+static void LOParseParList(LOLexState *ls)
+{
+    /* parlist -> [ param { `,' param } ] */
+    LOFuncState *fs = ls->fs;
+    LOPrototype *f = fs->f;
+    int nparams = 0;
+    f->_isVararg = NO;
+    if (ls->t.token != ')') {  /* is `parlist' not empty? */
+        do {
+            switch (ls->t.token) {
+                case LO_TK_NAME: {  /* param -> NAME */
+                    LOParseNewLocalVar(ls, LOParseStrCheckName(ls));
+                    nparams++;
+                    break;
+                }
+                case LO_TK_DOTS: {  /* param -> `...' */
+                    LOLexNext(ls);
+                    f->_isVararg = YES;
+                    break;
+                }
+                default:
+                    LOLexSyntaxError(ls, "<name> or '...' expected");
+            }
+        } while (!f->_isVararg && LOParseTestNext(ls, ','));
+    }
+    LOParseAdjustLocalVars(ls, nparams);
+    f->_numparams = fs->nactvar;
+    LOCodeReserveRegs(fs, fs->nactvar);  /* reserve register for parameters */
+}
+
+static void LOParseBody(LOLexState *ls, LOExpDesc *e, BOOL ismethod, int line)
+{
+    /* body ->  `(' parlist `)' block END */
+    LOFuncState new_fs;
+    LOBlockCnt bl;
+    LOPrototype *f = LOFuncStateAddPrototype(ls);
+    f->_linedefined = line;
+    LOParseOpenFunc(ls, &new_fs, f, &bl);
+    LOParseCheckNext(ls, '(');
+    if (ismethod) {
+        LOParseNewLocalVarLiteral(ls, "self");  /* create 'self' parameter */
+        LOParseAdjustLocalVars(ls, 1);
+    }
+    LOParseParList(ls);
+    LOParseCheckNext(ls, ')');
+    LOParseStatList(ls);
+    f->_lastlinedefined = ls->linenumber;
+    LOParseCheckMatch(ls, LO_TK_END, LO_TK_FUNCTION, line);
+    LOParseCodeClosure(ls, e);
+    LOParseCloseFunc(ls);
+}
+
+static int LOParseExpList(LOLexState *ls, LOExpDesc *v)
+{
+    /* explist -> expr { `,' expr } */
+    int n = 1;  /* at least one expression */
+    LOParseExpr(ls, v);
+    while (LOParseTestNext(ls, ',')) {
+        LOCodeExp2NextReg(ls->fs, v);
+        LOParseExpr(ls, v);
+        n++;
+    }
+    return n;
+}
+
+static void LOParseFuncArgs(LOLexState *ls, LOExpDesc *f, int line)
+{
+    LOFuncState *fs = ls->fs;
+    LOExpDesc args;
+    int base, nparams;
+    switch (ls->t.token) {
+        case '(': {  /* funcargs -> `(' [ explist ] `)' */
+            LOLexNext(ls);
+            if (ls->t.token == ')')  /* arg list is empty? */
+                args.k = LO_VVOID;
+            else {
+                LOParseExpList(ls, &args);
+                LOCodeSetMultRet(fs, &args);
+            }
+            LOParseCheckMatch(ls, ')', '(', line);
+            break;
+        }
+        case '{': {  /* funcargs -> constructor */
+            LOParseConstructor(ls, &args);
+            break;
+        }
+        case LO_TK_STRING: {  /* funcargs -> STRING */
+            LOParseCodeString(ls, &args, ls->t.ts);
+            LOLexNext(ls);  /* must use `seminfo' before `next' */
+            break;
+        }
+        default: {
+            LOLexSyntaxError(ls, "function arguments expected");
+        }
+    }
+    base = f->u.info;  /* base register for call */
+    if (LO_HASMULTRET(args.k))
+        nparams = LO_MULTRET;  /* open call */
+    else {
+        if (args.k != LO_VVOID)
+            LOCodeExp2NextReg(fs, &args);  /* close last argument */
+        nparams = fs->freereg - (base + 1);
+    }
+    LOParseInitExp(f, LO_VCALL, LOCodeABC(fs, LO_OP_CALL, base, nparams + 1, 2));
+    LOCodeFixLine(fs, line);
+    fs->freereg = base + 1;  /* call remove function and arguments and leaves (unless changed) one result */
+}
+
+/*
+** {======================================================================
+** Expression parsing
+** =======================================================================
+*/
+
+static void LOParsePrimaryExp(LOLexState *ls, LOExpDesc *v)
+{
+    /* primaryexp -> NAME | '(' expr ')' */
+    switch (ls->t.token) {
+        case '(': {
+            int line = ls->linenumber;
+            LOLexNext(ls);
+            LOParseExpr(ls, v);
+            LOParseCheckMatch(ls, ')', '(', line);
+            LOCodeDischargeVars(ls->fs, v);
+            return;
+        }
+        case LO_TK_NAME: {
+            LOParseSingleVar(ls, v);
+            return;
+        }
+        default: {
+            LOLexSyntaxError(ls, "unexpected symbol");
+        }
+    }
+}
+
+/**
+ * suffixedexp -> primaryexp { '.' NAME | '[' exp ']' | ':' NAME funcargs | funcargs }
+ * <p>
+ * A chain like {@code a.b.c} stays in one register: each step is a
+ * pending VINDEXED that is discharged into the register freed by the
+ * table it indexes, so {@code local x = a.b.c} is GETTABUP then two
+ * GETTABLEs, all targeting the new local's register.
+ */
+static void LOParseSuffixedExp(LOLexState *ls, LOExpDesc *v)
+{
+    LOFuncState *fs = ls->fs;
+    int line = ls->linenumber;
+    LOParsePrimaryExp(ls, v);
+    for (;;) {
+        switch (ls->t.token) {
+            case '.': {  /* fieldsel */
+                LOParseFieldSel(ls, v);
+                break;
+            }
+            case '[': {  /* `[' exp1 `]' */
+                LOExpDesc key;
+                LOCodeExp2AnyRegUp(fs, v);
+                LOParseYIndex(ls, &key);
+                LOCodeIndexed(fs, v, &key);
+                break;
+            }
+            case ':': {  /* `:' NAME funcargs */
+                LOExpDesc key;
+                LOLexNext(ls);
+                LOParseCheckName(ls, &key);
+                LOCodeSelf(fs, v, &key);
+                LOParseFuncArgs(ls, v, line);
+                break;
+            }
+            case '(': case LO_TK_STRING: case '{': {  /* funcargs */
+                LOCodeExp2NextReg(fs, v);
+                LOParseFuncArgs(ls, v, line);
+                break;
+            }
+            default:
+                return;
+        }
+    }
+}
+
+static void LOParseSimpleExp(LOLexState *ls, LOExpDesc *v)
+{
+    /* simpleexp -> NUMBER | STRING | NIL | TRUE | FALSE | ... | constructor | FUNCTION body | suffixedexp */
+    switch (ls->t.token) {
+        case LO_TK_NUMBER: {
+            LOParseInitExp(v, LO_VKNUM, 0);
+            v->u.nval = ls->t.r;
+            break;
+        }
+        case LO_TK_STRING: {
+            LOParseCodeString(ls, v, ls->t.ts);
+            break;
+        }
+        case LO_TK_NIL: {
+            LOParseInitExp(v, LO_VNIL, 0);
+            break;
+        }
+        case LO_TK_TRUE: {
+            LOParseInitExp(v, LO_VTRUE, 0);
+            break;
+        }
+        case LO_TK_FALSE: {
+            LOParseInitExp(v, LO_VFALSE, 0);
+            break;
+        }
+        case LO_TK_DOTS: {  /* vararg */
+            LOFuncState *fs = ls->fs;
+            LOParseCheckCondition(ls, fs->f->_isVararg, "cannot use '...' outside a vararg function");
+            LOParseInitExp(v, LO_VVARARG, LOCodeABC(fs, LO_OP_VARARG, 0, 1, 0));
+            break;
+        }
+        case '{': {  /* constructor */
+            LOParseConstructor(ls, v);
+            return;
+        }
+        case LO_TK_FUNCTION: {
+            LOLexNext(ls);
+            LOParseBody(ls, v, NO, ls->linenumber);
+            return;
+        }
+        default: {
+            LOParseSuffixedExp(ls, v);
+            return;
+        }
+    }
+    LOLexNext(ls);
+}
+
+static LOUnOpr LOParseGetUnOpr(int op)
+{
+    switch (op) {
+        case LO_TK_NOT: return LO_OPR_NOT;
+        case '-': return LO_OPR_MINUS;
+        case '#': return LO_OPR_LEN;
+        default: return LO_OPR_NOUNOPR;
+    }
+}
+
+static LOBinOpr LOParseGetBinOpr(int op)
+{
+    switch (op) {
+        case '+': return LO_OPR_ADD;
+        case '-': return LO_OPR_SUB;
+        case '*': return LO_OPR_MUL;
+        case '/': return LO_OPR_DIV;
+        case '%': return LO_OPR_MOD;
+        case '^': return LO_OPR_POW;
+        case LO_TK_CONCAT: return LO_OPR_CONCAT;
+        case LO_TK_NE: return LO_OPR_NE;
+        case LO_TK_EQ: return LO_OPR_EQ;
+        case '<': return LO_OPR_LT;
+        case LO_TK_LE: return LO_OPR_LE;
+        case '>': return LO_OPR_GT;
+        case LO_TK_GE: return LO_OPR_GE;
+        case LO_TK_AND: return LO_OPR_AND;
+        case LO_TK_OR: return LO_OPR_OR;
+        default: return LO_OPR_NOBINOPR;
+    }
+}
+
+/** ORDER OPR */
+static const struct {
+    uint8_t left;  /* left priority for each binary operator */
+    uint8_t right;  /* right priority */
+} LOParsePriority[] = {
+    {6, 6}, {6, 6}, {7, 7}, {7, 7}, {7, 7},  /* `+' `-' `*' `/' `%' */
+    {10, 9}, {5, 4},                         /* ^, .. (right associative) */
+    {3, 3}, {3, 3}, {3, 3},                  /* ==, <, <= */
+    {3, 3}, {3, 3}, {3, 3},                  /* ~=, >, >= */
+    {2, 2}, {1, 1}                           /* and, or */
+};
+
+/** priority for unary operators */
+#define LO_UNARY_PRIORITY 8
+
+/**
+ * subexpr -> (simpleexp | unop subexpr) { binop subexpr }
+ * where `binop' is any binary operator with a priority higher than `limit'
+ */
+static LOBinOpr LOParseSubExpr(LOLexState *ls, LOExpDesc *v, int limit)
+{
+    LOParseEnterLevel(ls);
+    LOUnOpr uop = LOParseGetUnOpr(ls->t.token);
+    if (uop != LO_OPR_NOUNOPR) {
+        int line = ls->linenumber;
+        LOLexNext(ls);
+        LOParseSubExpr(ls, v, LO_UNARY_PRIORITY);
+        LOCodePrefix(ls->fs, uop, v, line);
+    } else
+        LOParseSimpleExp(ls, v);
+    /* expand while operators have priorities higher than `limit' */
+    LOBinOpr op = LOParseGetBinOpr(ls->t.token);
+    while (op != LO_OPR_NOBINOPR && LOParsePriority[op].left > limit) {
+        LOExpDesc v2;
+        int line = ls->linenumber;
+        LOLexNext(ls);
+        LOCodeInfix(ls->fs, op, v);
+        /* read sub-expression with higher priority */
+        LOBinOpr nextop = LOParseSubExpr(ls, &v2, LOParsePriority[op].right);
+        LOCodePosfix(ls->fs, op, v, &v2, line);
+        op = nextop;
+    }
+    LOParseLeaveLevel(ls);
+    return op;  /* return first untreated operator */
+}
+
+static void LOParseExpr(LOLexState *ls, LOExpDesc *v)
+{
+    LOParseSubExpr(ls, v, 0);
+}
+
+/* }==================================================================== */
+
+/*
+** {======================================================================
+** Rules for Statements
+** =======================================================================
+*/
+
+static void LOParseBlock(LOLexState *ls)
+{
+    /* block -> statlist */
+    LOFuncState *fs = ls->fs;
+    LOBlockCnt bl;
+    LOParseEnterBlock(fs, &bl, 0);
+    LOParseStatList(ls);
+    LOParseLeaveBlock(fs);
+}
+
+/** structure to chain all variables in the left-hand side of an assignment */
+typedef struct LOLHSAssign {
+    struct LOLHSAssign *prev;
+    /** variable (global, local, upvalue, or indexed) */
+    LOExpDesc v;
+} LOLHSAssign;
+
+/**
+ * check whether, in an assignment to an upvalue/local variable, the
+ * upvalue/local variable is begin used in a previous assignment to a
+ * table. If so, save original upvalue/local value in a safe place and
+ * use this safe copy in the previous assignment.
+ */
+static void LOParseCheckConflict(LOLexState *ls, LOLHSAssign *lh, LOExpDesc *v)
+{
+    LOFuncState *fs = ls->fs;
+    int extra = fs->freereg;  /* eventual position to save local variable */
+    BOOL conflict = NO;
+    for (; lh; lh = lh->prev) {  /* check all previous assignments */
+        if (lh->v.k == LO_VINDEXED) {  /* assigning to a table? */
+            /* table is the upvalue/local being assigned now? */
+            if (lh->v.u.ind.vt == v->k && lh->v.u.ind.t == v->u.info) {
+                conflict = YES;
+                lh->v.u.ind.vt = LO_VLOCAL;
+                lh->v.u.ind.t = (uint8_t)extra;  /* previous assignment will use safe copy */
+            }
+            /* index is the local being assigned? (index cannot be upvalue) */
+            if (v->k == LO_VLOCAL && lh->v.u.ind.idx == v->u.info) {
+                conflict = YES;
+                lh->v.u.ind.idx = (short)extra;  /* previous assignment will use safe copy */
+            }
+        }
+    }
+    if (conflict) {
+        /* copy upvalue/local value to a temporary (in position 'extra') */
+        LOOpCode op = (v->k == LO_VLOCAL) ? LO_OP_MOVE : LO_OP_GETUPVAL;
+        LOCodeABC(fs, op, extra, v->u.info, 0);
+        LOCodeReserveRegs(fs, 1);
+    }
+}
+
+static void LOParseAssignment(LOLexState *ls, LOLHSAssign *lh, int nvars)
+{
+    LOExpDesc e;
+    LOParseCheckCondition(ls, LO_VKISVAR(lh->v.k), "syntax error");
+    if (LOParseTestNext(ls, ',')) {  /* assignment -> ',' suffixedexp assignment */
+        LOLHSAssign nv;
+        nv.prev = lh;
+        LOParseSuffixedExp(ls, &nv.v);
+        if (nv.v.k != LO_VINDEXED)
+            LOParseCheckConflict(ls, lh, &nv.v);
+        LOParseCheckLimit(ls->fs, nvars + ls->nCcalls, LO_MAXCCALLS, "C levels");
+        LOParseAssignment(ls, &nv, nvars + 1);
+    } else {  /* assignment -> `=' explist */
+        LOParseCheckNext(ls, '=');
+        int nexps = LOParseExpList(ls, &e);
+        if (nexps != nvars) {
+            LOParseAdjustAssign(ls, nvars, nexps, &e);
+            if (nexps > nvars)
+                ls->fs->freereg -= nexps - nvars;  /* remove extra values */
+        } else {
+            LOCodeSetOneRet(ls->fs, &e);  /* close last expression */
+            LOCodeStoreVar(ls->fs, &lh->v, &e);
+            return;  /* avoid default */
+        }
+    }
+    LOParseInitExp(&e, LO_VNONRELOC, ls->fs->freereg - 1);  /* default assignment */
+    LOCodeStoreVar(ls->fs, &lh->v, &e);
+}
+
+static int LOParseCond(LOLexState *ls)
+{
+    /* cond -> exp */
+    LOExpDesc v;
+    LOParseExpr(ls, &v);  /* read condition */
+    if (v.k == LO_VNIL)
+        v.k = LO_VFALSE;  /* `falses' are all equal here */
+    LOCodeGoIfTrue(ls->fs, &v);
+    return v.f;
+}
+
+static void LOParseGotoStat(LOLexState *ls, int pc)
+{
+    int line = ls->linenumber;
+    LOLuaString *label;
+    if (LOParseTestNext(ls, LO_TK_GOTO))
+        label = LOParseStrCheckName(ls);
+    else {
+        LOLexNext(ls);  /* skip break */
+        label = ls->breakn;
+    }
+    int g = LOParseNewLabelEntry(ls, &ls->dyd->gt, label, line, pc);
+    LOParseFindLabel(ls, g);  /* close it if label already defined */
+}
+
+/** check for repeated labels on the same block */
+static void LOParseCheckRepeated(LOFuncState *fs, LOLabelList *ll, LOLuaString *label)
+{
+    for (int i = fs->bl->firstlabel; i < ll->n; i++) {
+        if (label == ll->arr[i].name) {
+            char msg[256];
+            snprintf(msg, sizeof(msg), "label '%.*s' already defined on line %d", label->_length, (const char *)label->_bytes, ll->arr[i].line);
+            LOParseSemError(fs->ls, msg);
+        }
+    }
+}
+
+/** skip no-op statements */
+static void LOParseSkipNoopStat(LOLexState *ls)
+{
+    while (ls->t.token == ';' || ls->t.token == LO_TK_DBCOLON)
+        LOParseStatement(ls);
+}
+
+static void LOParseLabelStat(LOLexState *ls, LOLuaString *label, int line)
+{
+    /* label -> '::' NAME '::' */
+    LOFuncState *fs = ls->fs;
+    LOLabelList *ll = &ls->dyd->label;
+    LOParseCheckRepeated(fs, ll, label);  /* check for repeated labels */
+    LOParseCheckNext(ls, LO_TK_DBCOLON);  /* skip double colon */
+    /* create new entry for this label */
+    int l = LOParseNewLabelEntry(ls, ll, label, line, fs->pc);
+    LOParseSkipNoopStat(ls);  /* skip other no-op statements */
+    if (LOParseBlockFollow(ls, NO)) {  /* label is last no-op statement in the block? */
+        /* assume that locals are already out of scope */
+        ll->arr[l].nactvar = fs->bl->nactvar;
+    }
+    LOParseFindGotos(ls, &ll->arr[l]);
+}
+
+static void LOParseWhileStat(LOLexState *ls, int line)
+{
+    /* whilestat -> WHILE cond DO block END */
+    LOFuncState *fs = ls->fs;
+    LOBlockCnt bl;
+    LOLexNext(ls);  /* skip WHILE */
+    int whileinit = LOCodeGetLabel(fs);
+    int condexit = LOParseCond(ls);
+    LOParseEnterBlock(fs, &bl, 1);
+    LOParseCheckNext(ls, LO_TK_DO);
+    LOParseBlock(ls);
+    LOCodeJumpTo(fs, whileinit);
+    LOParseCheckMatch(ls, LO_TK_END, LO_TK_WHILE, line);
+    LOParseLeaveBlock(fs);
+    LOCodePatchToHere(fs, condexit);  /* false conditions finish the loop */
+}
+
+static void LOParseRepeatStat(LOLexState *ls, int line)
+{
+    /* repeatstat -> REPEAT block UNTIL cond */
+    LOFuncState *fs = ls->fs;
+    int repeat_init = LOCodeGetLabel(fs);
+    LOBlockCnt bl1, bl2;
+    LOParseEnterBlock(fs, &bl1, 1);  /* loop block */
+    LOParseEnterBlock(fs, &bl2, 0);  /* scope block */
+    LOLexNext(ls);  /* skip REPEAT */
+    LOParseStatList(ls);
+    LOParseCheckMatch(ls, LO_TK_UNTIL, LO_TK_REPEAT, line);
+    int condexit = LOParseCond(ls);  /* read condition (inside scope block) */
+    if (bl2.upval)  /* upvalues? */
+        LOCodePatchClose(fs, condexit, bl2.nactvar);
+    LOParseLeaveBlock(fs);  /* finish scope */
+    LOCodePatchList(fs, condexit, repeat_init);  /* close the loop */
+    LOParseLeaveBlock(fs);  /* finish loop */
+}
+
+static int LOParseExp1(LOLexState *ls)
+{
+    LOExpDesc e;
+    LOParseExpr(ls, &e);
+    LOCodeExp2NextReg(ls->fs, &e);
+    return e.u.info;
+}
+
+static void LOParseForBody(LOLexState *ls, int base, int line, int nvars, BOOL isnum)
+{
+    /* forbody -> DO block */
+    LOBlockCnt bl;
+    LOFuncState *fs = ls->fs;
+    int prep, endfor;
+    LOParseAdjustLocalVars(ls, 3);  /* control variables */
+    LOParseCheckNext(ls, LO_TK_DO);
+    prep = isnum ? LOCodeAsBx(fs, LO_OP_FORPREP, base, LO_NO_JUMP) : LOCodeJump(fs);
+    LOParseEnterBlock(fs, &bl, 0);  /* scope for declared variables */
+    LOParseAdjustLocalVars(ls, nvars);
+    LOCodeReserveRegs(fs, nvars);
+    LOParseBlock(ls);
+    LOParseLeaveBlock(fs);  /* end of scope for declared variables */
+    LOCodePatchToHere(fs, prep);
+    if (isnum)  /* numeric for? */
+        endfor = LOCodeAsBx(fs, LO_OP_FORLOOP, base, LO_NO_JUMP);
+    else {  /* generic for */
+        LOCodeABC(fs, LO_OP_TFORCALL, base, 0, nvars);
+        LOCodeFixLine(fs, line);
+        endfor = LOCodeAsBx(fs, LO_OP_TFORLOOP, base + 2, LO_NO_JUMP);
+    }
+    LOCodePatchList(fs, endfor, prep + 1);
+    LOCodeFixLine(fs, line);
+}
+
+static void LOParseForNum(LOLexState *ls, LOLuaString *varname, int line)
+{
+    /* fornum -> NAME = exp1,exp1[,exp1] forbody */
+    LOFuncState *fs = ls->fs;
+    int base = fs->freereg;
+    LOParseNewLocalVarLiteral(ls, "(for index)");
+    LOParseNewLocalVarLiteral(ls, "(for limit)");
+    LOParseNewLocalVarLiteral(ls, "(for step)");
+    LOParseNewLocalVar(ls, varname);
+    LOParseCheckNext(ls, '=');
+    LOParseExp1(ls);  /* initial value */
+    LOParseCheckNext(ls, ',');
+    LOParseExp1(ls);  /* limit */
+    if (LOParseTestNext(ls, ','))
+        LOParseExp1(ls);  /* optional step */
+    else {  /* default step = 1 */
+        LOCodeK(fs, fs->freereg, LOCodeNumberK(fs, 1));
+        LOCodeReserveRegs(fs, 1);
+    }
+    LOParseForBody(ls, base, line, 1, YES);
+}
+
+static void LOParseForList(LOLexState *ls, LOLuaString *indexname)
+{
+    /* forlist -> NAME {,NAME} IN explist forbody */
+    LOFuncState *fs = ls->fs;
+    LOExpDesc e;
+    int nvars = 4;  /* gen, state, control, plus at least one declared var */
+    int base = fs->freereg;
+    /* create control variables */
+    LOParseNewLocalVarLiteral(ls, "(for generator)");
+    LOParseNewLocalVarLiteral(ls, "(for state)");
+    LOParseNewLocalVarLiteral(ls, "(for control)");
+    /* create declared variables */
+    LOParseNewLocalVar(ls, indexname);
+    while (LOParseTestNext(ls, ',')) {
+        LOParseNewLocalVar(ls, LOParseStrCheckName(ls));
+        nvars++;
+    }
+    LOParseCheckNext(ls, LO_TK_IN);
+    int line = ls->linenumber;
+    LOParseAdjustAssign(ls, 3, LOParseExpList(ls, &e), &e);
+    LOCodeCheckStack(fs, 3);  /* extra space to call generator */
+    LOParseForBody(ls, base, line, nvars - 3, NO);
+}
+
+static void LOParseForStat(LOLexState *ls, int line)
+{
+    /* forstat -> FOR (fornum | forlist) END */
+    LOFuncState *fs = ls->fs;
+    LOBlockCnt bl;
+    LOParseEnterBlock(fs, &bl, 1);  /* scope for loop and control variables */
+    LOLexNext(ls);  /* skip `for' */
+    LOLuaString *varname = LOParseStrCheckName(ls);  /* first variable name */
+    switch (ls->t.token) {
+        case '=':
+            LOParseForNum(ls, varname, line);
+            break;
+        case ',': case LO_TK_IN:
+            LOParseForList(ls, varname);
+            break;
+        default:
+            LOLexSyntaxError(ls, "'=' or 'in' expected");
+    }
+    LOParseCheckMatch(ls, LO_TK_END, LO_TK_FOR, line);
+    LOParseLeaveBlock(fs);  /* loop scope (`break' jumps to this point) */
+}
+
+static void LOParseTestThenBlock(LOLexState *ls, int *escapelist)
+{
+    /* test_then_block -> [IF | ELSEIF] cond THEN block */
+    LOBlockCnt bl;
+    LOFuncState *fs = ls->fs;
+    LOExpDesc v;
+    int jf;  /* instruction to skip 'then' code (if condition is false) */
+    LOLexNext(ls);  /* skip IF or ELSEIF */
+    LOParseExpr(ls, &v);  /* read condition */
+    LOParseCheckNext(ls, LO_TK_THEN);
+    if (ls->t.token == LO_TK_GOTO || ls->t.token == LO_TK_BREAK) {
+        LOCodeGoIfFalse(ls->fs, &v);  /* will jump to label if condition is true */
+        LOParseEnterBlock(fs, &bl, 0);  /* must enter block before 'goto' */
+        LOParseGotoStat(ls, v.t);  /* handle goto/break */
+        LOParseSkipNoopStat(ls);  /* skip other no-op statements */
+        if (LOParseBlockFollow(ls, NO)) {  /* 'goto' is the entire block? */
+            LOParseLeaveBlock(fs);
+            return;  /* and that is it */
+        } else  /* must skip over 'then' part if condition is false */
+            jf = LOCodeJump(fs);
+    } else {  /* regular case (not goto/break) */
+        LOCodeGoIfTrue(ls->fs, &v);  /* skip over block if condition is false */
+        LOParseEnterBlock(fs, &bl, 0);
+        jf = v.f;
+    }
+    LOParseStatList(ls);  /* `then' part */
+    LOParseLeaveBlock(fs);
+    if (ls->t.token == LO_TK_ELSE || ls->t.token == LO_TK_ELSEIF)  /* followed by 'else'/'elseif'? */
+        LOCodeConcat(fs, escapelist, LOCodeJump(fs));  /* must jump over it */
+    LOCodePatchToHere(fs, jf);
+}
+
+static void LOParseIfStat(LOLexState *ls, int line)
+{
+    /* ifstat -> IF cond THEN block {ELSEIF cond THEN block} [ELSE block] END */
+    LOFuncState *fs = ls->fs;
+    int escapelist = LO_NO_JUMP;  /* exit list for finished parts */
+    LOParseTestThenBlock(ls, &escapelist);  /* IF cond THEN block */
+    while (ls->t.token == LO_TK_ELSEIF)
+        LOParseTestThenBlock(ls, &escapelist);  /* ELSEIF cond THEN block */
+    if (LOParseTestNext(ls, LO_TK_ELSE))
+        LOParseBlock(ls);  /* `else' part */
+    LOParseCheckMatch(ls, LO_TK_END, LO_TK_IF, line);
+    LOCodePatchToHere(fs, escapelist);  /* patch escape list to 'if' end */
+}
+
+static void LOParseLocalFunc(LOLexState *ls)
+{
+    LOExpDesc b;
+    LOFuncState *fs = ls->fs;
+    LOParseNewLocalVar(ls, LOParseStrCheckName(ls));  /* new local variable */
+    LOParseAdjustLocalVars(ls, 1);  /* enter its scope */
+    LOParseBody(ls, &b, NO, ls->linenumber);  /* function created in next register */
+    /* debug information will only see the variable after this point! */
+    LOParseGetLocVar(fs, b.u.info)->startpc = fs->pc;
+}
+
+static void LOParseLocalStat(LOLexState *ls)
+{
+    /* stat -> LOCAL NAME {`,' NAME} [`=' explist] */
+    int nvars = 0;
+    int nexps;
+    LOExpDesc e;
+    do {
+        LOParseNewLocalVar(ls, LOParseStrCheckName(ls));
+        nvars++;
+    } while (LOParseTestNext(ls, ','));
+    if (LOParseTestNext(ls, '='))
+        nexps = LOParseExpList(ls, &e);
+    else {
+        e.k = LO_VVOID;
+        nexps = 0;
+    }
+    LOParseAdjustAssign(ls, nvars, nexps, &e);
+    LOParseAdjustLocalVars(ls, nvars);
+}
+
+static BOOL LOParseFuncName(LOLexState *ls, LOExpDesc *v)
+{
+    /* funcname -> NAME {fieldsel} [`:' NAME] */
+    BOOL ismethod = NO;
+    LOParseSingleVar(ls, v);
+    while (ls->t.token == '.')
+        LOParseFieldSel(ls, v);
+    if (ls->t.token == ':') {
+        ismethod = YES;
+        LOParseFieldSel(ls, v);
+    }
+    return ismethod;
+}
+
+static void LOParseFuncStat(LOLexState *ls, int line)
+{
+    /* funcstat -> FUNCTION funcname body */
+    LOExpDesc v, b;
+    LOLexNext(ls);  /* skip FUNCTION */
+    BOOL ismethod = LOParseFuncName(ls, &v);
+    LOParseBody(ls, &b, ismethod, line);
+    LOCodeStoreVar(ls->fs, &v, &b);
+    LOCodeFixLine(ls->fs, line);  /* definition `happens' in the first line */
+}
+
+static void LOParseExprStat(LOLexState *ls)
+{
+    /* stat -> func | assignment */
+    LOFuncState *fs = ls->fs;
+    LOLHSAssign v;
+    LOParseSuffixedExp(ls, &v.v);
+    if (ls->t.token == '=' || ls->t.token == ',') {  /* stat -> assignment ? */
+        v.prev = NULL;
+        LOParseAssignment(ls, &v, 1);
+    } else {  /* stat -> func */
+        LOParseCheckCondition(ls, v.v.k == LO_VCALL, "syntax error");
+        LO_SETARG_C(LOCodeGetCode(fs, &v.v), 1);  /* call statement uses no results */
+    }
+}
+
+static void LOParseRetStat(LOLexState *ls)
+{
+    /* stat -> RETURN [explist] [';'] */
+    LOFuncState *fs = ls->fs;
+    LOExpDesc e;
+    int first, nret;  /* registers with returned values */
+    if (LOParseBlockFollow(ls, YES) || ls->t.token == ';')
+        first = nret = 0;  /* return no values */
+    else {
+        nret = LOParseExpList(ls, &e);  /* optional return values */
+        if (LO_HASMULTRET(e.k)) {
+            LOCodeSetMultRet(fs, &e);
+            if (e.k == LO_VCALL && nret == 1)  /* tail call? */
+                LO_SET_OPCODE(LOCodeGetCode(fs, &e), LO_OP_TAILCALL);
+            first = fs->nactvar;
+            nret = LO_MULTRET;  /* return all values */
+        } else {
+            if (nret == 1)  /* only one single value? */
+                first = LOCodeExp2AnyReg(fs, &e);
+            else {
+                LOCodeExp2NextReg(fs, &e);  /* values must go to the stack */
+                first = fs->nactvar;  /* return all `active' values */
+            }
+        }
+    }
+    LOCodeRet(fs, first, nret);
+    LOParseTestNext(ls, ';');  /* skip optional semicolon */
+}
+
+static void LOParseStatement(LOLexState *ls)
+{
+    int line = ls->linenumber;  /* may be needed for error messages */
+    LOParseEnterLevel(ls);
+    switch (ls->t.token) {
+        case ';': {  /* stat -> ';' (empty statement) */
+            LOLexNext(ls);  /* skip ';' */
+            break;
+        }
+        case LO_TK_IF: {  /* stat -> ifstat */
+            LOParseIfStat(ls, line);
+            break;
+        }
+        case LO_TK_WHILE: {  /* stat -> whilestat */
+            LOParseWhileStat(ls, line);
+            break;
+        }
+        case LO_TK_DO: {  /* stat -> DO block END */
+            LOLexNext(ls);  /* skip DO */
+            LOParseBlock(ls);
+            LOParseCheckMatch(ls, LO_TK_END, LO_TK_DO, line);
+            break;
+        }
+        case LO_TK_FOR: {  /* stat -> forstat */
+            LOParseForStat(ls, line);
+            break;
+        }
+        case LO_TK_REPEAT: {  /* stat -> repeatstat */
+            LOParseRepeatStat(ls, line);
+            break;
+        }
+        case LO_TK_FUNCTION: {  /* stat -> funcstat */
+            LOParseFuncStat(ls, line);
+            break;
+        }
+        case LO_TK_LOCAL: {  /* stat -> localstat */
+            LOLexNext(ls);  /* skip LOCAL */
+            if (LOParseTestNext(ls, LO_TK_FUNCTION))  /* local function? */
+                LOParseLocalFunc(ls);
+            else
+                LOParseLocalStat(ls);
+            break;
+        }
+        case LO_TK_DBCOLON: {  /* stat -> label */
+            LOLexNext(ls);  /* skip double colon */
+            LOParseLabelStat(ls, LOParseStrCheckName(ls), line);
+            break;
+        }
+        case LO_TK_RETURN: {  /* stat -> retstat */
+            LOLexNext(ls);  /* skip RETURN */
+            LOParseRetStat(ls);
+            break;
+        }
+        case LO_TK_BREAK:   /* stat -> breakstat */
+        case LO_TK_GOTO: {  /* stat -> 'goto' NAME */
+            LOParseGotoStat(ls, LOCodeJump(ls->fs));
+            break;
+        }
+        default: {  /* stat -> func | assignment */
+            LOParseExprStat(ls);
+            break;
+        }
+    }
+    ls->fs->freereg = ls->fs->nactvar;  /* free registers */
+    LOParseLeaveLevel(ls);
+}
+
+/* }====================================================================== */
+
+void LOLexParseChunk(LOLexState *ls, LOPrototype *main)
+{
+    /* compiles the main function, which is a regular vararg function with an upvalue named LUA_ENV */
+    LOFuncState fs;
+    LOBlockCnt bl;
+    LOExpDesc v;
+    LOParseOpenFunc(ls, &fs, main, &bl);
+    fs.f->_isVararg = YES;  /* main function is always vararg */
+    LOParseInitExp(&v, LO_VLOCAL, 0);  /* create and... */
+    LOParseNewUpvalue(&fs, ls->envn, &v);  /* ...set environment upvalue */
+    LOLexNext(ls);  /* read first token */
+    LOParseStatList(ls);  /* parse main body */
+    LOParseCheck(ls, LO_TK_EOS);
+    LOParseCloseFunc(ls);
+}
+
+void LODyndataFree(LODyndata *dyd)
+{
+    for (int i = 0; i < dyd->protos.n; i++)
+        CFRelease(dyd->protos.arr[i]);
+    for (int i = 0; i < dyd->nkTables; i++)
+        free(dyd->kTables[i].slots);
+    free(dyd->protos.arr);
+    free(dyd->kTables);
+    free(dyd->actvar.arr);
+    free(dyd->gt.arr);
+    free(dyd->label.arr);
+    memset(dyd, 0, sizeof(*dyd));
+}
@@ -0,0 +1,83 @@
+//
+//  LOLoadState.h
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import <Foundation/Foundation.h>
+
+@class LOPrototype;
+
+/** Signature byte indicating the file is a compiled binary chunk */
+#define LOLoadStateSignature "\033Lua"
+/** for header of binary files -- this is Lua 5.2 */
+#define LOLoadStateVersion 0x52
+/** for header of binary files -- this is the official format */
+#define LOLoadStateFormat 0
+/** data to catch conversion errors */
+#define LOLoadStateTail "\x19\x93\r\n\x1a\n"
+
+/** format corresponding to non-number-patched lua, all numbers are floats or doubles */
+#define LOLoadStateNumberFormatFloatsOrDoubles 0
+/** format corresponding to non-number-patched lua, all numbers are ints */
+#define LOLoadStateNumberFormatIntsOnly 1
+
+/**
+ * Class to undump compiled lua bytecode into a {@link LOPrototype} instances.
+ * <p>
+ * The {@link LoadState} class provides the standard lua 5.2 undump of
+ * precompiled chunks, as produced by {@code luac} or {@code string.dump}.
+ * Chunks of either byte order and with 4 or 8 byte {@code size_t} are accepted.
+ * <p>
+ * The chunk is parsed directly from the bytes of an {@link NSData}; a file
+ * loaded with {@link #undumpFile:error:} is memory mapped rather than read.
+ * Long string constants are not copied: they reference the chunk's bytes and
+ * keep the data alive, so a mapped file stays mapped while any of its
+ * prototypes or long constants is in use, and its pages are shared and never
+ * dirtied.  Short ones are copied and interned, as identifiers such as global
+ * keys outlive the chunk they first appeared in.
+ * Instructions and line info are copied, as they are read as aligned
+ * native ints and rewritten by the interpreter.
+ * <p>
+ * Malformed input raises a {@link LuaError}.
+ * @see LOPrototype
+ */
+@interface LOLoadState : NSObject
+
+/**
+ * Load a precompiled chunk.
+ * @param data the chunk, beginning with {@link LOLoadStateSignature}
+ * @param name name of the chunk, used when the chunk has no source name
+ * @return the main function prototype of the chunk
+ * @throws LuaError if the chunk is malformed or of an unsupported format
+ */
++ (LOPrototype *)undump:(NSData *)data name:(NSString *)name;
+
+/**
+ * Load a precompiled chunk that starts {@code offset} bytes into {@code data},
+ * after a header of the caller's own.  Long string constants still reference
+ * {@code data}.
+ * @param data the bytes holding the chunk
+ * @param offset where the chunk's {@link LOLoadStateSignature} is
+ * @param name name of the chunk, used when the chunk has no source name
+ * @return the main function prototype of the chunk
+ * @throws LuaError if the chunk is malformed or of an unsupported format
+ */
++ (LOPrototype *)undump:(NSData *)data offset:(NSUInteger)offset name:(NSString *)name;
+
+/**
+ * Memory map a precompiled chunk file and load it.
+ * @param path path of the chunk file, also the chunk name prefixed by '@'
+ * @param error receives the reason when the file cannot be mapped
+ * @return the main function prototype, or nil if the file cannot be mapped
+ * @throws LuaError if the chunk is malformed or of an unsupported format
+ */
++ (LOPrototype *)undumpFile:(NSString *)path error:(NSError **)error;
+
+/**
+ * Whether {@code data} starts with the binary chunk signature.
+ */
++ (BOOL)isBinaryChunk:(NSData *)data;
+
+@end
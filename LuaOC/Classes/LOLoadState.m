@@ -0,0 +1,277 @@
+//
+//  LOLoadState.m
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import "LOLoadState.h"
+#import "LOPrototype.h"
+#import "LOLuaString.h"
+
+/** Header size: signature, version, format, endianness, 5 sizes and the tail */
+#define LOLoadStateHeaderSize 18
+
+/* constant types in a chunk, as in lua */
+#define LOLoadStateTypeNil 0
+#define LOLoadStateTypeBoolean 1
+#define LOLoadStateTypeNumber 3
+#define LOLoadStateTypeString 4
+
+/** Cursor over the chunk bytes; the data is only read, never copied, except for code */
+typedef struct LOLoadCursor {
+    const uint8_t *p;
+    const uint8_t *end;
+    /** chunk byte order differs from ours */
+    BOOL swap;
+    int sizeofSizeT;
+    int sizeofNumber;
+    int numberFormat;
+    __unsafe_unretained NSData *owner;
+    __unsafe_unretained NSString *name;
+    /** source of functions whose debug info was stripped */
+    __unsafe_unretained LOLuaString *source;
+} LOLoadCursor;
+
+static void LOLoadError(LOLoadCursor *S, NSString *why)
+{
+    [LOLuaValue error:[NSString stringWithFormat:@"%@: %@ precompiled chunk", S->name, why]];
+}
+
+static inline const uint8_t *LOLoadBlock(LOLoadCursor *S, size_t n)
+{
+    if ((size_t)(S->end - S->p) < n)
+        LOLoadError(S, @"truncated");
+    const uint8_t *block = S->p;
+    S->p += n;
+    return block;
+}
+
+static inline int LOLoadByte(LOLoadCursor *S)
+{
+    return *LOLoadBlock(S, 1);
+}
+
+static inline int LOLoadInt(LOLoadCursor *S)
+{
+    uint32_t v;
+    memcpy(&v, LOLoadBlock(S, 4), 4);
+    return (int)(S->swap ? CFSwapInt32(v) : v);
+}
+
+static inline uint64_t LOLoadInt64(LOLoadCursor *S)
+{
+    uint64_t v;
+    memcpy(&v, LOLoadBlock(S, 8), 8);
+    return S->swap ? CFSwapInt64(v) : v;
+}
+
+static inline uint64_t LOLoadSizeT(LOLoadCursor *S)
+{
+    return S->sizeofSizeT == 8 ? LOLoadInt64(S) : (uint32_t)LOLoadInt(S);
+}
+
+/** A vector length, checked against the bytes left so a bad count cannot overallocate */
+static int LOLoadCount(LOLoadCursor *S, size_t elementSize)
+{
+    int n = LOLoadInt(S);
+    if (n < 0 || (size_t)n > (size_t)(S->end - S->p) / elementSize)
+        LOLoadError(S, @"bad");
+    return n;
+}
+
+static LOTValue LOLoadNumber(LOLoadCursor *S)
+{
+    if (S->numberFormat == LOLoadStateNumberFormatIntsOnly) {
+        if (S->sizeofNumber == 8)
+            return LOTValueFromNumber((double)(int64_t)LOLoadInt64(S));
+        return LOTValueFromInt(LOLoadInt(S));
+    }
+    if (S->sizeofNumber == 4) {
+        uint32_t bits = (uint32_t)LOLoadInt(S);
+        float f;
+        memcpy(&f, &bits, 4);
+        return LOTValueFromNumber(f);
+    }
+    uint64_t bits = LOLoadInt64(S);
+    double d;
+    memcpy(&d, &bits, 8);
+    return LOTValueFromNumber(d);
+}
+
+/** A string constant, referencing the chunk bytes if it is long, nil for a NULL string */
+static LOLuaString *LOLoadString(LOLoadCursor *S)
+{
+    uint64_t size = LOLoadSizeT(S);
+    if (size == 0)
+        return nil;
+    if (size > INT_MAX)
+        LOLoadError(S, @"bad");
+    const uint8_t *bytes = LOLoadBlock(S, (size_t)size);
+    // the dumped size counts the terminating NUL
+    return [LOLuaString valueOfBytesNoCopy:bytes length:(int)size - 1 owner:S->owner];
+}
+
+static int *LOLoadIntVector(LOLoadCursor *S, int n)
+{
+    int *v = malloc(MAX(n, 1) * sizeof(int));
+    memcpy(v, LOLoadBlock(S, n * 4), n * 4);
+    if (S->swap) {
+        for (int i = 0; i < n; i++)
+            v[i] = (int)CFSwapInt32((uint32_t)v[i]);
+    }
+    return v;
+}
+
+static LOPrototype *LOLoadFunction(LOLoadCursor *S);
+
+static void LOLoadConstants(LOLoadCursor *S, LOPrototype *f)
+{
+    int n = LOLoadCount(S, 1);
+    f->_k = calloc(MAX(n, 1), sizeof(LOTValue));
+    for (int i = 0; i < n; i++) {
+        LOTValue v = LO_NIL;
+        switch (LOLoadByte(S)) {
+            case LOLoadStateTypeNil:
+                break;
+            case LOLoadStateTypeBoolean:
+                v = LOTValueFromBoolean(LOLoadByte(S) != 0);
+                break;
+            case LOLoadStateTypeNumber:
+                v = LOLoadNumber(S);
+                break;
+            case LOLoadStateTypeString:
+                v = LOTValueUnbox(LOLoadString(S));
+                LOTValueRetain(v);
+                break;
+            default:
+                LOLoadError(S, @"bad constant in");
+        }
+        f->_k[i] = v;
+        f->_kSize = i + 1;
+    }
+
+    n = LOLoadCount(S, 1);
+    NSMutableArray<LOPrototype *> *p = [NSMutableArray arrayWithCapacity:n];
+    for (int i = 0; i < n; i++)
+        [p addObject:LOLoadFunction(S)];
+    f->_p = [p copy];
+}
+
+static void LOLoadUpvalues(LOLoadCursor *S, LOPrototype *f)
+{
+    int n = LOLoadCount(S, 2);
+    f->_upvalues = calloc(MAX(n, 1), sizeof(LOUpvalDesc));
+    f->_upvaluesSize = n;
+    for (int i = 0; i < n; i++) {
+        f->_upvalues[i].name = LO_NIL;
+        f->_upvalues[i].instack = LOLoadByte(S) != 0;
+        f->_upvalues[i].idx = (uint8_t)LOLoadByte(S);
+    }
+}
+
+static void LOLoadDebug(LOLoadCursor *S, LOPrototype *f)
+{
+    f->_source = LOLoadString(S) ?: S->source;
+
+    int n = LOLoadCount(S, 4);
+    f->_lineinfo = LOLoadIntVector(S, n);
+    f->_lineinfoSize = n;
+
+    n = LOLoadCount(S, 1);
+    f->_locvars = calloc(MAX(n, 1), sizeof(LOLocVar));
+    for (int i = 0; i < n; i++) {
+        LOTValue varname = LOTValueUnbox(LOLoadString(S));
+        LOTValueRetain(varname);
+        f->_locvars[i].varname = varname;
+        f->_locvarsSize = i + 1;
+        f->_locvars[i].startpc = LOLoadInt(S);
+        f->_locvars[i].endpc = LOLoadInt(S);
+    }
+
+    n = LOLoadCount(S, 1);
+    for (int i = 0; i < n; i++) {
+        LOTValue name = LOTValueUnbox(LOLoadString(S));
+        if (i < f->_upvaluesSize) {
+            LOTValueRetain(name);
+            f->_upvalues[i].name = name;
+        }
+    }
+}
+
+static LOPrototype *LOLoadFunction(LOLoadCursor *S)
+{
+    LOPrototype *f = [[LOPrototype alloc] init];
+    f->_linedefined = LOLoadInt(S);
+    f->_lastlinedefined = LOLoadInt(S);
+    f->_numparams = LOLoadByte(S);
+    f->_isVararg = LOLoadByte(S) != 0;
+    f->_maxstacksize = LOLoadByte(S);
+
+    int n = LOLoadCount(S, 4);
+    f->_code = LOLoadIntVector(S, n);
+    f->_codeSize = n;
+
+    LOLoadConstants(S, f);
+    LOLoadUpvalues(S, f);
+    LOLoadDebug(S, f);
+    return f;
+}
+
+static void LOLoadHeader(LOLoadCursor *S)
+{
+    const uint8_t *h = LOLoadBlock(S, LOLoadStateHeaderSize);
+    if (memcmp(h, LOLoadStateSignature, 4) != 0)
+        LOLoadError(S, @"not a");
+    if (h[4] != LOLoadStateVersion || h[5] != LOLoadStateFormat)
+        LOLoadError(S, @"version mismatch in");
+    uint16_t probe = 1;
+    BOOL littleEndian = *(uint8_t *)&probe == 1;
+    S->swap = (h[6] != 0) != littleEndian;
+    S->sizeofSizeT = h[8];
+    S->sizeofNumber = h[10];
+    S->numberFormat = h[11];
+    if (h[7] != 4 || (h[8] != 4 && h[8] != 8) || h[9] != 4 || (h[10] != 4 && h[10] != 8)
+        || (h[11] != LOLoadStateNumberFormatFloatsOrDoubles && h[11] != LOLoadStateNumberFormatIntsOnly))
+        LOLoadError(S, @"incompatible");
+    if (memcmp(h + 12, LOLoadStateTail, 6) != 0)
+        LOLoadError(S, @"corrupted");
+}
+
+@implementation LOLoadState
+
++ (BOOL)isBinaryChunk:(NSData *)data
+{
+    return data.length >= 4 && memcmp(data.bytes, LOLoadStateSignature, 4) == 0;
+}
+
++ (LOPrototype *)undump:(NSData *)data name:(NSString *)name
+{
+    return [self undump:data offset:0 name:name];
+}
+
++ (LOPrototype *)undump:(NSData *)data offset:(NSUInteger)offset name:(NSString *)name
+{
+    if (offset > data.length)
+        [LOLuaValue error:[NSString stringWithFormat:@"%@: truncated precompiled chunk", name]];
+    LOLoadCursor S = {
+        .p = (const uint8_t *)data.bytes + offset,
+        .end = (const uint8_t *)data.bytes + data.length,
+        .owner = data,
+        .name = name,
+    };
+    LOLoadHeader(&S);
+    LOLuaString *source = [LOLuaString valueOf:name];
+    S.source = source;
+    return LOLoadFunction(&S);
+}
+
++ (LOPrototype *)undumpFile:(NSString *)path error:(NSError **)error
+{
+    NSData *data = [NSData dataWithContentsOfFile:path options:NSDataReadingMappedAlways error:error];
+    if (!data)
+        return nil;
+    return [self undump:data name:[@"@" stringByAppendingString:path.lastPathComponent]];
+}
+
+@end
@@ -0,0 +1,232 @@
+//
+//  LOLua.h
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#ifndef LOLua_h
+#define LOLua_h
+
+/**
+ * Constants for lua limits and opcodes.
+ * <p>
+ * This is a direct translation of C lua distribution header file constants
+ * for bytecode creation and processing.
+ */
+
+/*===========================================================================
+  We assume that instructions are unsigned numbers.
+  All instructions have an opcode in the first 6 bits.
+  Instructions can have the following fields:
+	`A' : 8 bits
+	`B' : 9 bits
+	`C' : 9 bits
+	'Ax' : 26 bits ('A', 'B', and 'C' together)
+	`Bx' : 18 bits (`B' and `C' together)
+	`sBx' : signed Bx
+
+  A signed argument is represented in excess K; that is, the number
+  value is the unsigned value minus K. K is exactly the maximum value
+  for that argument (so that -max is represented by 0, and +max is
+  represented by 2*max), which is half the maximum for the corresponding
+  unsigned argument.
+===========================================================================*/
+
+#define LO_SIZE_C       9
+#define LO_SIZE_B       9
+#define LO_SIZE_Bx      (LO_SIZE_C + LO_SIZE_B)
+#define LO_SIZE_A       8
+#define LO_SIZE_Ax      (LO_SIZE_C + LO_SIZE_B + LO_SIZE_A)
+#define LO_SIZE_OP      6
+
+#define LO_POS_OP       0
+#define LO_POS_A        (LO_POS_OP + LO_SIZE_OP)
+#define LO_POS_C        (LO_POS_A + LO_SIZE_A)
+#define LO_POS_B        (LO_POS_C + LO_SIZE_C)
+#define LO_POS_Bx       LO_POS_C
+#define LO_POS_Ax       LO_POS_A
+
+#define LO_MAXARG_A     ((1 << LO_SIZE_A) - 1)
+#define LO_MAXARG_B     ((1 << LO_SIZE_B) - 1)
+#define LO_MAXARG_C     ((1 << LO_SIZE_C) - 1)
+#define LO_MAXARG_Bx    ((1 << LO_SIZE_Bx) - 1)
+#define LO_MAXARG_sBx   (LO_MAXARG_Bx >> 1)     /* `sBx' is signed */
+#define LO_MAXARG_Ax    ((1 << LO_SIZE_Ax) - 1)
+
+#define LO_GET_OPCODE(i)    ((int)((unsigned)(i) >> LO_POS_OP) & ((1 << LO_SIZE_OP) - 1))
+#define LO_GETARG_A(i)      ((int)((unsigned)(i) >> LO_POS_A) & LO_MAXARG_A)
+#define LO_GETARG_Ax(i)     ((int)((unsigned)(i) >> LO_POS_Ax) & LO_MAXARG_Ax)
+#define LO_GETARG_B(i)      ((int)((unsigned)(i) >> LO_POS_B) & LO_MAXARG_B)
+#define LO_GETARG_C(i)      ((int)((unsigned)(i) >> LO_POS_C) & LO_MAXARG_C)
+#define LO_GETARG_Bx(i)     ((int)((unsigned)(i) >> LO_POS_Bx) & LO_MAXARG_Bx)
+#define LO_GETARG_sBx(i)    (LO_GETARG_Bx(i) - LO_MAXARG_sBx)
+
+/** creates a mask with `n' 1 bits at position `p' */
+#define LO_MASK1(n,p)       ((~((~0u) << (n))) << (p))
+/** creates a mask with `n' 0 bits at position `p' */
+#define LO_MASK0(n,p)       (~LO_MASK1(n, p))
+
+#define LO_SETARG(i,v,pos,size) ((i) = (int)(((unsigned)(i) & LO_MASK0(size, pos)) | \
+                                    (((unsigned)(v) << (pos)) & LO_MASK1(size, pos))))
+#define LO_SET_OPCODE(i,o)  LO_SETARG(i, o, LO_POS_OP, LO_SIZE_OP)
+#define LO_SETARG_A(i,v)    LO_SETARG(i, v, LO_POS_A, LO_SIZE_A)
+#define LO_SETARG_B(i,v)    LO_SETARG(i, v, LO_POS_B, LO_SIZE_B)
+#define LO_SETARG_C(i,v)    LO_SETARG(i, v, LO_POS_C, LO_SIZE_C)
+#define LO_SETARG_Bx(i,v)   LO_SETARG(i, v, LO_POS_Bx, LO_SIZE_Bx)
+#define LO_SETARG_sBx(i,b)  LO_SETARG_Bx((i), (unsigned)(b) + LO_MAXARG_sBx)
+
+#define LO_CREATE_ABC(o,a,b,c)  ((int)(((unsigned)(o) << LO_POS_OP) | ((unsigned)(a) << LO_POS_A) | \
+                                    ((unsigned)(b) << LO_POS_B) | ((unsigned)(c) << LO_POS_C)))
+#define LO_CREATE_ABx(o,a,bc)   ((int)(((unsigned)(o) << LO_POS_OP) | ((unsigned)(a) << LO_POS_A) | \
+                                    ((unsigned)(bc) << LO_POS_Bx)))
+#define LO_CREATE_Ax(o,a)       ((int)(((unsigned)(o) << LO_POS_OP) | ((unsigned)(a) << LO_POS_Ax)))
+
+/** invalid register that fits in 8 bits */
+#define LO_NO_REG           LO_MAXARG_A
+
+/** option for multiple returns in CALL, RETURN and SETLIST */
+#define LO_MULTRET          (-1)
+
+/** this bit 1 means constant (0 means register) */
+#define LO_BITRK            (1 << (LO_SIZE_B - 1))
+/** test whether value is a constant */
+#define LO_ISK(x)           ((x) & LO_BITRK)
+/** gets the index of the constant */
+#define LO_INDEXK(r)        ((int)(r) & ~LO_BITRK)
+#define LO_MAXINDEXRK       (LO_BITRK - 1)
+/** code a constant index as a RK value */
+#define LO_RKASK(x)         ((x) | LO_BITRK)
+
+/** number of list items to accumulate before a SETLIST instruction */
+#define LO_LFIELDS_PER_FLUSH 50
+
+/*
+** R(x) - register
+** Kst(x) - constant (in constant table)
+** RK(x) == if ISK(x) then Kst(INDEXK(x)) else R(x)
+*/
+
+typedef enum LOOpCode {
+    LO_OP_MOVE,     /*	A B	R(A) := R(B)					*/
+    LO_OP_LOADK,    /*	A Bx	R(A) := Kst(Bx)					*/
+    LO_OP_LOADKX,   /*	A 	R(A) := Kst(extra arg)				*/
+    LO_OP_LOADBOOL, /*	A B C	R(A) := (Bool)B; if (C) pc++			*/
+    LO_OP_LOADNIL,  /*	A B	R(A) := ... := R(A+B) := nil			*/
+    LO_OP_GETUPVAL, /*	A B	R(A) := UpValue[B]				*/
+
+    LO_OP_GETTABUP, /*	A B C	R(A) := UpValue[B][RK(C)]			*/
+    LO_OP_GETTABLE, /*	A B C	R(A) := R(B)[RK(C)]				*/
+
+    LO_OP_SETTABUP, /*	A B C	UpValue[A][RK(B)] := RK(C)			*/
+    LO_OP_SETUPVAL, /*	A B	UpValue[B] := R(A)				*/
+    LO_OP_SETTABLE, /*	A B C	R(A)[RK(B)] := RK(C)				*/
+
+    LO_OP_NEWTABLE, /*	A B C	R(A) := {} (size = B,C)				*/
+
+    LO_OP_SELF,     /*	A B C	R(A+1) := R(B); R(A) := R(B)[RK(C)]		*/
+
+    LO_OP_ADD,      /*	A B C	R(A) := RK(B) + RK(C)				*/
+    LO_OP_SUB,      /*	A B C	R(A) := RK(B) - RK(C)				*/
+    LO_OP_MUL,      /*	A B C	R(A) := RK(B) * RK(C)				*/
+    LO_OP_DIV,      /*	A B C	R(A) := RK(B) / RK(C)				*/
+    LO_OP_MOD,      /*	A B C	R(A) := RK(B) % RK(C)				*/
+    LO_OP_POW,      /*	A B C	R(A) := RK(B) ^ RK(C)				*/
+    LO_OP_UNM,      /*	A B	R(A) := -R(B)					*/
+    LO_OP_NOT,      /*	A B	R(A) := not R(B)				*/
+    LO_OP_LEN,      /*	A B	R(A) := length of R(B)				*/
+
+    LO_OP_CONCAT,   /*	A B C	R(A) := R(B).. ... ..R(C)			*/
+
+    LO_OP_JMP,      /*	A sBx	pc+=sBx; if (A) close all upvalues >= R(A) + 1	*/
+    LO_OP_EQ,       /*	A B C	if ((RK(B) == RK(C)) ~= A) then pc++		*/
+    LO_OP_LT,       /*	A B C	if ((RK(B) <  RK(C)) ~= A) then pc++		*/
+    LO_OP_LE,       /*	A B C	if ((RK(B) <= RK(C)) ~= A) then pc++		*/
+
+    LO_OP_TEST,     /*	A C	if not (R(A) <=> C) then pc++			*/
+    LO_OP_TESTSET,  /*	A B C	if (R(B) <=> C) then R(A) := R(B) else pc++	*/
+
+    LO_OP_CALL,     /*	A B C	R(A), ... ,R(A+C-2) := R(A)(R(A+1), ... ,R(A+B-1)) */
+    LO_OP_TAILCALL, /*	A B C	return R(A)(R(A+1), ... ,R(A+B-1))		*/
+    LO_OP_RETURN,   /*	A B	return R(A), ... ,R(A+B-2)	(see note)	*/
+
+    LO_OP_FORLOOP,  /*	A sBx	R(A)+=R(A+2);
+                            if R(A) <?= R(A+1) then { pc+=sBx; R(A+3)=R(A) }*/
+    LO_OP_FORPREP,  /*	A sBx	R(A)-=R(A+2); pc+=sBx				*/
+
+    LO_OP_TFORCALL, /*	A C	R(A+3), ... ,R(A+2+C) := R(A)(R(A+1), R(A+2));	*/
+    LO_OP_TFORLOOP, /*	A sBx	if R(A+1) ~= nil then { R(A)=R(A+1); pc += sBx }*/
+
+    LO_OP_SETLIST,  /*	A B C	R(A)[(C-1)*FPF+i] := R(A+i), 1 <= i <= B	*/
+
+    LO_OP_CLOSURE,  /*	A Bx	R(A) := closure(KPROTO[Bx])			*/
+
+    LO_OP_VARARG,   /*	A B	R(A), R(A+1), ..., R(A+B-2) = vararg		*/
+
+    LO_OP_EXTRAARG, /*	Ax	extra (larger) argument for previous opcode	*/
+
+    /* quickened forms, only ever written by the interpreter (see note) */
+    LO_OP_ADD_II,   /*	A B C	R(A) := RK(B) + RK(C), both ints		*/
+    LO_OP_SUB_II,   /*	A B C	R(A) := RK(B) - RK(C), both ints		*/
+    LO_OP_MUL_II,   /*	A B C	R(A) := RK(B) * RK(C), both ints		*/
+    LO_OP_ADD_FF,   /*	A B C	R(A) := RK(B) + RK(C), both numbers		*/
+    LO_OP_SUB_FF,   /*	A B C	R(A) := RK(B) - RK(C), both numbers		*/
+    LO_OP_MUL_FF,   /*	A B C	R(A) := RK(B) * RK(C), both numbers		*/
+    LO_OP_GETTABLE_ARR, /*	A B C	R(A) := R(B)[RK(C)], in the array part	*/
+} LOOpCode;
+
+/** number of opcodes of the lua 5.2 instruction set, the quickened forms excluded */
+#define LO_NUM_OPCODES  ((int)LO_OP_EXTRAARG + 1)
+
+/** test whether an opcode is a quickened form */
+#define LO_ISQUICK(o)   ((int)(o) >= LO_NUM_OPCODES)
+
+/** the generic opcode a quickened form was rewritten from */
+static inline LOOpCode LOOpCodeGeneric(LOOpCode o)
+{
+    switch (o) {
+        case LO_OP_ADD_II: case LO_OP_ADD_FF: return LO_OP_ADD;
+        case LO_OP_SUB_II: case LO_OP_SUB_FF: return LO_OP_SUB;
+        case LO_OP_MUL_II: case LO_OP_MUL_FF: return LO_OP_MUL;
+        case LO_OP_GETTABLE_ARR: return LO_OP_GETTABLE;
+        default: return o;
+    }
+}
+
+/**
+ * Revision of the instruction set and code generator.  Bump it when an
+ * opcode changes meaning or the compiler output changes: it is part of the
+ * key of {@link LOChunkCache} entries, so stale compiled chunks are ignored.
+ */
+#define LO_VM_VERSION   1
+
+/*===========================================================================
+  Notes:
+  (*) In OP_CALL, if (B == 0) then B = top. If (C == 0), then `top' is
+  set to last_result+1, so next open instruction (OP_CALL, OP_RETURN,
+  OP_SETLIST) may use `top'.
+
+  (*) In OP_VARARG, if (B == 0) then use actual number of varargs and
+  set top (like in OP_CALL with C == 0).
+
+  (*) In OP_RETURN, if (B == 0) then return up to `top'.
+
+  (*) In OP_SETLIST, if (B == 0) then B = `top'; if (C == 0) then next
+  'instruction' is EXTRAARG(real C).
+
+  (*) In OP_LOADKX, the next 'instruction' is always EXTRAARG.
+
+  (*) For comparisons, A specifies what condition the test should accept
+  (true or false).
+
+  (*) All `skips' (pc++) assume that next instruction is a jump.
+
+  (*) The interpreter rewrites the opcode of an ADD, SUB, MUL or GETTABLE
+  in place into a quickened form specialized for the operands it has
+  seen, and back to the generic form when a later execution fails the
+  guard of the quickened one.  Arguments are never changed, quickened
+  forms never leave the interpreter: compilers, dumps and chunks only
+  ever contain the lua 5.2 opcodes.
+===========================================================================*/
+
+#endif /* LOLua_h */
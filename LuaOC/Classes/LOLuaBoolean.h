@@ -0,0 +1,27 @@
+//
+//  LOLuaBoolean.h
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import "LOLuaValue.h"
+
+/**
+ * Extension of {@link LuaValue} which can hold a Java boolean as its value.
+ * <p>
+ * These instance are not instantiated directly by clients.
+ * Instead, there are exactly two instances of this class,
+ * {@link #defaultTrue} and {@link #defaultFalse}
+ * representing the lua values {@code true} and {@code false}.
+ * Inside the runtime booleans are immediates, see {@link LOTValue}.
+ * @see LuaValue#valueOf(boolean)
+ */
+@interface LOLuaBoolean : LOLuaValue
+
+@property (nonatomic, assign, readonly) BOOL v;
+
++ (instancetype)defaultTrue;
++ (instancetype)defaultFalse;
+
+@end
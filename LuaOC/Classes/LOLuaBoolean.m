@@ -0,0 +1,75 @@
+//
+//  LOLuaBoolean.m
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import "LOLuaBoolean.h"
+
+@implementation LOLuaBoolean
+
+- (instancetype)initWithBool:(BOOL)v
+{
+    if (self = [super init]) {
+        _v = v;
+    }
+    return self;
+}
+
++ (instancetype)defaultTrue
+{
+    static LOLuaBoolean *_defaultTrue = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        _defaultTrue = [[LOLuaBoolean alloc] initWithBool:YES];
+    });
+    return _defaultTrue;
+}
+
++ (instancetype)defaultFalse
+{
+    static LOLuaBoolean *_defaultFalse = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        _defaultFalse = [[LOLuaBoolean alloc] initWithBool:NO];
+    });
+    return _defaultFalse;
+}
+
+- (int)type
+{
+    return LOLuaTypeBoolean;
+}
+
+- (BOOL)isBoolean
+{
+    return YES;
+}
+
+- (BOOL)toBoolean
+{
+    return _v;
+}
+
+- (NSString *)toNSString
+{
+    return _v ? @"true" : @"false";
+}
+
+- (void)appendTo:(LOStringBuilder *)sb
+{
+    LOStringBuilderAppendCString(sb, _v ? "true" : "false");
+}
+
+- (BOOL)optBoolean:(BOOL)defval
+{
+    return _v;
+}
+
+- (BOOL)checkBoolean
+{
+    return _v;
+}
+
+@end
@@ -0,0 +1,50 @@
+//
+//  LOLuaC.h
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import <Foundation/Foundation.h>
+
+@class LOPrototype, LOLuaClosure, LOLuaValue;
+
+/**
+ * Compiler for lua source.
+ * <p>
+ * This is a port of the lua 5.2 compiler: the lexer ({@link LOLexState}),
+ * the recursive descent parser and the code generator ({@link LOFuncState})
+ * run as one pass, and the bytecode is written straight into the arrays of
+ * the {@link LOPrototype}s handed to {@link LOLuaClosure}.  No syntax tree
+ * is built; an expression is at most a few descriptors on the C stack until
+ * the generator decides which register it goes to.  The output is the same
+ * bytecode as {@code luac} 5.2 would produce, constant folding included.
+ * <p>
+ * The source is scanned in place and names are interned in a table private
+ * to the compilation, so compiling only takes the process wide string intern
+ * lock once per distinct short name or string, not per occurrence.
+ * @see LOLoadState
+ */
+@interface LOLuaC : NSObject
+
+/**
+ * Compile lua source into its main function prototype.
+ * @param source the lua source text
+ * @param name the chunk name, e.g. {@code @file.lua} or {@code =stdin}
+ * @return the main function prototype of the chunk
+ * @throws LuaError with a lua style message if the source has a syntax error
+ */
++ (LOPrototype *)compile:(NSData *)source name:(NSString *)name;
+
+/**
+ * Load a chunk, either lua source or a precompiled binary chunk, into a
+ * closure ready to call.
+ * @param chunk the source or the binary chunk
+ * @param name the chunk name
+ * @param env the environment of the chunk, usually a {@link LOGlobals}
+ * @return the main function of the chunk
+ * @throws LuaError if the chunk cannot be compiled or undumped
+ */
++ (LOLuaClosure *)load:(NSData *)chunk name:(NSString *)name env:(LOLuaValue *)env;
+
+@end
@@ -0,0 +1,41 @@
+//
+//  LOLuaC.m
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import "LOLuaC.h"
+#import "LOLexState.h"
+#import "LOLoadState.h"
+#import "LOLuaClosure.h"
+#import "LOLuaString.h"
+#import "LOPrototype.h"
+
+@implementation LOLuaC
+
++ (LOPrototype *)compile:(NSData *)source name:(NSString *)name
+{
+    if (source.length > INT_MAX)
+        [LOLuaValue error:[NSString stringWithFormat:@"%@: chunk too large", name]];
+    LOLuaString *sourceName = [LOLuaString valueOf:name];
+    LOPrototype *main = [[LOPrototype alloc] init];
+    LODyndata dyd = {0};
+    LOLexState ls;
+    LOLexSetInput(&ls, &dyd, source.bytes, (int)source.length, sourceName);
+    @try {
+        LOLexParseChunk(&ls, main);
+    } @finally {
+        LOLexFree(&ls);
+        LODyndataFree(&dyd);
+    }
+    return main;
+}
+
++ (LOLuaClosure *)load:(NSData *)chunk name:(NSString *)name env:(LOLuaValue *)env
+{
+    LOPrototype *p = [LOLoadState isBinaryChunk:chunk] ? [LOLoadState undump:chunk name:name] : [self compile:chunk name:name];
+    return [[LOLuaClosure alloc] initWithPrototype:p env:env];
+}
+
+@end
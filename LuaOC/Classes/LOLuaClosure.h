@@ -6,7 +6,59 @@
 //
 
 #import "LOLuaFunction.h"
+#import "LOUpValue.h"
 
-@interface LOLuaClosure : LOLuaFunction
+@class LOPrototype, LOLuaThread;
+
+/**
+ * Extension of {@link LuaFunction} which executes lua bytecode.
+ * <p>
+ * A {@link LuaClosure} is a combination of a {@link Prototype}
+ * and a {@link LuaValue} to use as an environment for execution.
+ * Normally the {@link LuaValue} is a {@link Globals} in which case the environment
+ * will contain standard lua libraries.
+ * <p>
+ * The bytecode is run by a register machine over the value stack of the
+ * running {@link LOLuaThread}: the registers of a call are a range of stack
+ * slots, and calls from lua to lua push an activation record and continue
+ * in the same C loop instead of recursing.  Only calls into native functions
+ * go through {@link LOLuaThread#call:base:nargs:}.
+ * <p>
+ * The loop dispatches with computed gotos where the compiler supports them,
+ * and a switch otherwise.  Every opcode is handled inline in C, with
+ * slow paths (coercions, errors, concatenation) in plain C functions.
+ * <p>
+ * Captured locals are {@link LOUpValue} cells shared with the enclosing
+ * frame: they point into the stack until the frame returns and are closed
+ * then, so a closure costs its object and one small array, not an object
+ * per captured variable.
+ * @see LuaValue
+ * @see LuaFunction
+ * @see LOPrototype
+ */
+@interface LOLuaClosure : LOLuaFunction {
+@public
+    LOPrototype *_p;
+    /** one reference to each upvalue of the prototype, NULL when there are none */
+    LOUpValue **_upvals;
+    int _nupvals;
+}
+
+/** Create a closure around a Prototype with a specific environment.
+ * If the prototype has upvalues, the environment will be written into the first upvalue.
+ * @param p the Prototype to construct this Closure for.
+ * @param env the environment to associate with the closure.
+ */
+- (instancetype)initWithPrototype:(LOPrototype *)p env:(LOLuaValue *)env;
 
 @end
+
+/**
+ * Run the lua frames of the stackless coroutine {@code L} from where they stand:
+ * the body when it has not started yet, otherwise the frame suspended in the
+ * call to yield, which gets {@code args} as the results of that call.
+ * @return the results of the body, or NONE when it yields again or fails,
+ * with {@code _yielding} or the error set on {@code L}
+ * @see LOLuaThread#resume:
+ */
+FOUNDATION_EXTERN LOVarargs *LOLuaClosureResume(LOLuaThread *L, LOVarargs *args);
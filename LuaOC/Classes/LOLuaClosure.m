@@ -6,7 +6,1367 @@
 //
 
 #import "LOLuaClosure.h"
+#import "LOLua.h"
+#import "LOPrototype.h"
+#import "LOUpValue.h"
+#import "LOLuaThread.h"
+#import "LOLuaTable.h"
+#import "LOLuaString.h"
+#import "LOLuaNumber.h"
+#import "LOArrayVarargs.h"
+#import "LOJIT.h"
+#import <objc/runtime.h>
+
+/** Threaded dispatch through a table of label addresses, a GNU C extension */
+#ifndef LOVM_COMPUTED_GOTO
+#if defined(__GNUC__) || defined(__clang__)
+#define LOVM_COMPUTED_GOTO 1
+#else
+#define LOVM_COMPUTED_GOTO 0
+#endif
+#endif
+
+static Class _closureClass = Nil;
+
+static inline BOOL LOVMIsClosure(LOTValue v)
+{
+    return LOTValueIsObject(v) && object_getClass((__bridge id)LOTValueGetPointer(v)) == _closureClass;
+}
+
+#pragma mark - slow paths
+
+/*
+ * Errors of the interpreter are recorded on the thread rather than thrown:
+ * the slow path returns a placeholder and the instruction that called it
+ * returns NONE once it sees the error pending, unwinding to the native
+ * caller of the loop.  Errors raised by metamethods are still thrown.
+ */
+
+/** Record {@code message} as the pending error of {@code L} */
+static LOVarargs *LOVMError(LOLuaThread *L, NSString *message)
+{
+    return LOLuaThreadSetError(L, [LOLuaValue valueOfString:message]);
+}
+
+/** Record "attempt to {@code operation} a ... value" for {@code v}; returns nil to store */
+static LOTValue LOVMTypeError(LOLuaThread *L, LOTValue v, NSString *operation)
+{
+    LOVMError(L, [NSString stringWithFormat:@"attempt to %@ a %@ value", operation, LOLuaTypeName(LOTValueType(v))]);
+    return LO_NIL;
+}
+
+/** Number value of a number or of a string that converts to one */
+static BOOL LOVMToNumber(LOTValue v, double *d)
+{
+    if (LOTValueIsNumber(v)) {
+        *d = LOTValueToDouble(v);
+        return YES;
+    }
+    if (LOTValueIsObject(v) && LOTValueType(v) == LOLuaTypeString)
+        return LOLuaStringToNumber((LOLuaString *)LOTValueGetObject(v), d);
+    return NO;
+}
+
+static inline double LOVMArithDouble(int op, double a, double b)
+{
+    switch (op) {
+        case LO_OP_ADD: return a + b;
+        case LO_OP_SUB: return a - b;
+        case LO_OP_MUL: return a * b;
+        case LO_OP_DIV: return a / b;
+        case LO_OP_MOD: return a - floor(a / b) * b;
+        case LO_OP_POW: return pow(a, b);
+        case LO_OP_UNM: return -a;
+        default: return 0;
+    }
+}
+
+/** Arithmetic on operands that are not both numbers: coerce strings, else try the metatags; result retained */
+static LOTValue LOVMArith(LOLuaThread *L, int op, LOTValue a, LOTValue b)
+{
+    double x, y;
+    if (LOVMToNumber(a, &x) && LOVMToNumber(b, &y))
+        return LOTValueFromNumber(LOVMArithDouble(op, x, y));
+    LOTagMethod event = LOTagMethodAdd + (op - LO_OP_ADD);
+    LOTValue tm = LOTValueGetTM(a, event);  /* try first operand */
+    if (tm == LO_NIL)
+        tm = LOTValueGetTM(b, event);  /* try second operand */
+    if (tm == LO_NIL)
+        return LOVMTypeError(L, LOVMToNumber(a, &x) ? b : a, @"perform arithmetic on");
+    return LOTValueCallTM(tm, (LOTValue[]){a, b}, 2);
+}
+
+static int LOVMStringCompare(LOLuaString *a, LOLuaString *b)
+{
+    int c = memcmp(LOLuaStringBytes(a), LOLuaStringBytes(b), MIN(a->_length, b->_length));
+    return c != 0 ? c : a->_length - b->_length;
+}
+
+static BOOL LOVMBothStrings(LOTValue a, LOTValue b)
+{
+    return LOTValueIsObject(a) && LOTValueIsObject(b)
+        && LOTValueType(a) == LOLuaTypeString && LOTValueType(b) == LOLuaTypeString;
+}
+
+static BOOL LOVMOrderError(LOLuaThread *L, LOTValue a, LOTValue b)
+{
+    NSString *t1 = LOLuaTypeName(LOTValueType(a));
+    NSString *t2 = LOLuaTypeName(LOTValueType(b));
+    if ([t1 isEqualToString:t2])
+        LOVMError(L, [NSString stringWithFormat:@"attempt to compare two %@ values", t1]);
+    else
+        LOVMError(L, [NSString stringWithFormat:@"attempt to compare %@ with %@", t1, t2]);
+    return NO;
+}
+
+/** Call the order metatag of either operand; NO if neither has one */
+static BOOL LOVMCallOrderTM(LOTagMethod event, LOTValue a, LOTValue b, BOOL *result)
+{
+    LOTValue tm = LOTValueGetTM(a, event);  /* try first operand */
+    if (tm == LO_NIL)
+        tm = LOTValueGetTM(b, event);  /* try second operand */
+    if (tm == LO_NIL)
+        return NO;
+    LOTValue res = LOTValueCallTM(tm, (LOTValue[]){a, b}, 2);
+    *result = LOTValueToBoolean(res);
+    LOTValueRelease(res);
+    return YES;
+}
+
+static BOOL LOVMLessThan(LOLuaThread *L, LOTValue a, LOTValue b)
+{
+    if (LOTValueIsNumber(a) && LOTValueIsNumber(b))
+        return LOTValueToDouble(a) < LOTValueToDouble(b);
+    if (LOVMBothStrings(a, b))
+        return LOVMStringCompare((LOLuaString *)LOTValueGetObject(a), (LOLuaString *)LOTValueGetObject(b)) < 0;
+    BOOL res = NO;
+    if (!LOVMCallOrderTM(LOTagMethodLt, a, b, &res))
+        return LOVMOrderError(L, a, b);
+    return res;
+}
+
+static BOOL LOVMLessEqual(LOLuaThread *L, LOTValue a, LOTValue b)
+{
+    if (LOTValueIsNumber(a) && LOTValueIsNumber(b))
+        return LOTValueToDouble(a) <= LOTValueToDouble(b);
+    if (LOVMBothStrings(a, b))
+        return LOVMStringCompare((LOLuaString *)LOTValueGetObject(a), (LOLuaString *)LOTValueGetObject(b)) <= 0;
+    BOOL res = NO;
+    if (LOVMCallOrderTM(LOTagMethodLe, a, b, &res))  /* first try `le' */
+        return res;
+    if (!LOVMCallOrderTM(LOTagMethodLt, b, a, &res))  /* else try `lt' */
+        return LOVMOrderError(L, a, b);
+    return !res;
+}
+
+/** Primitive equality: numbers by value, strings by contents, anything else by identity */
+static inline BOOL LOVMRawEquals(LOTValue a, LOTValue b)
+{
+    if (LOTValueIsNumber(a) && LOTValueIsNumber(b))
+        return LOTValueIsInt(a) && LOTValueIsInt(b) ? a == b : LOTValueToDouble(a) == LOTValueToDouble(b);
+    if (a == b)
+        return YES;
+    return LOVMBothStrings(a, b) && LOLuaStringEquals((LOLuaString *)LOTValueGetObject(a), (LOLuaString *)LOTValueGetObject(b));
+}
+
+static inline BOOL LOVMBothTables(LOTValue a, LOTValue b)
+{
+    return LOTValueIsObject(a) && LOTValueIsObject(b)
+        && LOTValueType(a) == LOLuaTypeTable && LOTValueType(b) == LOLuaTypeTable;
+}
+
+/** Equality of two distinct tables through a {@code __eq} metatag both of them share */
+static BOOL LOVMEqualTM(LOTValue a, LOTValue b)
+{
+    __unsafe_unretained LOLuaTable *mt1 = ((__bridge LOLuaTable *)LOTValueGetPointer(a))->_metatable;
+    __unsafe_unretained LOLuaTable *mt2 = ((__bridge LOLuaTable *)LOTValueGetPointer(b))->_metatable;
+    LOTValue tm = LOTableFastTM(mt1, LOTagMethodEq);
+    if (tm == LO_NIL)
+        return NO;  /* no metamethod */
+    if (mt1 != mt2 && LOTableFastTM(mt2, LOTagMethodEq) != tm)
+        return NO;  /* different metamethods */
+    LOTValue res = LOTValueCallTM(tm, (LOTValue[]){a, b}, 2);
+    BOOL equal = LOTValueToBoolean(res);
+    LOTValueRelease(res);
+    return equal;
+}
+
+/** The length operator, with {@code __len} processing; result retained */
+static LOTValue LOVMLength(LOLuaThread *L, LOTValue v)
+{
+    LOTValue tm;
+    switch (LOTValueType(v)) {
+        case LOLuaTypeString:
+            return LOTValueFromInt(((LOLuaString *)LOTValueGetObject(v))->_length);
+        case LOLuaTypeTable: {
+            __unsafe_unretained LOLuaTable *h = (__bridge LOLuaTable *)LOTValueGetPointer(v);
+            tm = LOTableFastTM(h->_metatable, LOTagMethodLen);
+            if (tm == LO_NIL)  /* no metamethod? */
+                return LOTValueFromInt(LOTableLength(h));  /* primitive len */
+            break;
+        }
+        default:
+            tm = LOTValueGetTM(v, LOTagMethodLen);
+            if (tm == LO_NIL)
+                return LOVMTypeError(L, v, @"get length of");
+            break;
+    }
+    return LOTValueCallTM(tm, (LOTValue[]){v, LO_NIL}, 2);
+}
+
+static inline BOOL LOVMIsConcatenable(LOTValue v)
+{
+    return LOTValueIsNumber(v) || (LOTValueIsObject(v) && LOTValueType(v) == LOLuaTypeString);
+}
+
+/** Join the pieces [{@code from}, {@code to}) into one flat string */
+static LOLuaString *LOVMJoinPieces(const unsigned char *const *bytes, const int *lengths, int from, int to)
+{
+    size_t total = 0;
+    for (int i = from; i < to; i++)
+        total += lengths[i];
+    unsigned char *buffer = malloc(total + 1);
+    size_t offset = 0;
+    for (int i = from; i < to; i++) {
+        memcpy(buffer + offset, bytes[i], lengths[i]);
+        offset += lengths[i];
+    }
+    // the result takes the buffer instead of copying it
+    return LOLuaStringNewWithOwnedBytes(buffer, (int)total);
+}
+
+/**
+ * Concatenate {@code n} strings or numbers into a new string, returned retained,
+ * or nil with the error recorded.  A long result links the long operands into
+ * a rope and copies only the runs of short ones, so {@code s = s .. x} does not copy {@code s}.
+ */
+static LOTValue LOVMConcatStrings(LOLuaThread *L, const LOTValue *values, int n)
+{
+    const unsigned char *bytes[n];
+    int lengths[n];
+    char numbers[n][LOLuaNumberMaxFormatLength];
+    size_t total = 0;
+    for (int i = 0; i < n; i++) {
+        LOTValue v = values[i];
+        if (LOTValueIsObject(v) && LOTValueType(v) == LOLuaTypeString) {
+            LOLuaString *s = (LOLuaString *)LOTValueGetObject(v);
+            // long operands are linked rather than read, a rope stays unflattened
+            bytes[i] = s->_length >= LOLuaStringMinRopeLength ? NULL : s->_bytes;
+            lengths[i] = s->_length;
+        } else if (LOTValueIsInt(v)) {
+            lengths[i] = LOLuaNumberFormatInt(LOTValueGetInt(v), numbers[i]);
+            bytes[i] = (const unsigned char *)numbers[i];
+        } else if (LOTValueIsDouble(v)) {
+            lengths[i] = LOLuaNumberFormat(LOTValueGetDouble(v), numbers[i]);
+            bytes[i] = (const unsigned char *)numbers[i];
+        } else {
+            return LOVMTypeError(L, v, @"concatenate");
+        }
+        total += lengths[i];
+    }
+    if (total > INT_MAX) {
+        LOVMError(L, @"string length overflow");
+        return LO_NIL;
+    }
+    if (total < LOLuaStringMinRopeLength)
+        return LOTValueFromPointer(CFBridgingRetain(LOVMJoinPieces(bytes, lengths, 0, n)));
+
+    LOLuaString *acc = nil;
+    int run = 0;
+    for (int i = 0; i <= n; i++) {
+        if (i < n && bytes[i] != NULL)
+            continue;
+        if (run < i) {
+            LOLuaString *piece = LOVMJoinPieces(bytes, lengths, run, i);
+            acc = acc ? LOLuaStringConcat(acc, piece) : piece;
+        }
+        if (i < n) {
+            LOLuaString *piece = (LOLuaString *)LOTValueGetObject(values[i]);
+            acc = acc ? LOLuaStringConcat(acc, piece) : piece;
+        }
+        run = i + 1;
+    }
+    return LOTValueFromPointer(CFBridgingRetain(acc));
+}
+
+/**
+ * Concatenate {@code n} values, returned retained.  Runs of strings and numbers
+ * are joined in one go; other values go through {@code __concat} pairwise
+ * from the right, as in lua.
+ */
+static LOTValue LOVMConcat(LOLuaThread *L, const LOTValue *values, int n)
+{
+    int j = n;
+    while (j > 0 && LOVMIsConcatenable(values[j - 1]))
+        j--;
+    if (j == 0)
+        return LOVMConcatStrings(L, values, n);
+
+    // the stack may move while metamethods run, so work on a copy of the operands
+    LOTValue operands[n];
+    memcpy(operands, values, n * sizeof(LOTValue));
+    LOTValue acc;
+    if (j < n) {
+        acc = LOVMConcatStrings(L, &operands[j], n - j);
+        if (acc == LO_NIL)
+            return LO_NIL;
+    } else {
+        acc = operands[--j];
+        LOTValueRetain(acc);
+    }
+    while (j > 0) {
+        LOTValue a = operands[j - 1];
+        LOTValue res;
+        if (LOVMIsConcatenable(a) && LOVMIsConcatenable(acc)) {
+            int start = j - 1;
+            while (start > 0 && LOVMIsConcatenable(operands[start - 1]))
+                start--;
+            LOTValue run[j - start + 1];
+            memcpy(run, &operands[start], (j - start) * sizeof(LOTValue));
+            run[j - start] = acc;
+            res = LOVMConcatStrings(L, run, j - start + 1);
+            j = start;
+        } else {
+            LOTValue tm = LOTValueGetTM(a, LOTagMethodConcat);
+            if (tm == LO_NIL)
+                tm = LOTValueGetTM(acc, LOTagMethodConcat);
+            res = tm != LO_NIL
+                ? LOTValueCallTM(tm, (LOTValue[]){a, acc}, 2)
+                : LOVMTypeError(L, LOVMIsConcatenable(a) ? acc : a, @"concatenate");
+            j--;
+        }
+        LOTValueRelease(acc);
+        acc = res;
+        if (LOLuaThreadErrorPending(L))
+            return LO_NIL;
+    }
+    return acc;
+}
+
+static inline BOOL LOVMIsTable(LOTValue t)
+{
+    return LOTValueIsObject(t) && LOTValueType(t) == LOLuaTypeTable;
+}
+
+static inline BOOL LOVMIsStringKey(LOTValue key)
+{
+    return LOTValueIsObject(key) && LOTValueType(key) == LOLuaTypeString;
+}
+
+static inline BOOL LOVMIsNaN(LOTValue v)
+{
+    return LOTValueIsDouble(v) && isnan(LOTValueGetDouble(v));
+}
+
+/** Whether {@code key} is an int indexing the array part of the table {@code t} */
+static inline BOOL LOVMIsArrayIndex(LOTValue t, LOTValue key)
+{
+    if (!LOTValueIsInt(key) || !LOVMIsTable(t))
+        return NO;
+    __unsafe_unretained LOLuaTable *h = (__bridge LOLuaTable *)LOTValueGetPointer(t);
+    return (unsigned)(LOTValueGetInt(key) - 1) < (unsigned)h->_arraySize;
+}
+
+/**
+ * The index operation when no metatag gets involved: {@code t} is a table and
+ * either has the key or its metatable is known to lack {@code __index}.
+ * @return NO to fall back to {@link LOTValueGetTable}
+ */
+static inline BOOL LOVMFastGet(LOTValue t, LOTValue key, LOTValue *result)
+{
+    if (!LOVMIsTable(t))
+        return NO;
+    __unsafe_unretained LOLuaTable *h = (__bridge LOLuaTable *)LOTValueGetPointer(t);
+    LOTValue v = LOTValueIsInt(key) ? LOTableGetInt(h, LOTValueGetInt(key)) : LOTableGet(h, key);
+    if (v == LO_NIL && LOTableFastTM(h->_metatable, LOTagMethodIndex) != LO_NIL)
+        return NO;
+    *result = v;
+    return YES;
+}
+
+/** {@link LOVMFastGet} for a constant string key, through the inline cache of its instruction */
+static inline BOOL LOVMFastGetField(LOTValue t, LOTValue key, LOFieldCache *cache, LOTValue *result)
+{
+    if (!LOVMIsTable(t))
+        return NO;
+    __unsafe_unretained LOLuaTable *h = (__bridge LOLuaTable *)LOTValueGetPointer(t);
+    LOTValue v = LOTableGetStrCached(h, (__bridge LOLuaString *)LOTValueGetPointer(key), cache);
+    if (v == LO_NIL && LOTableFastTM(h->_metatable, LOTagMethodIndex) != LO_NIL)
+        return NO;
+    *result = v;
+    return YES;
+}
+
+/**
+ * The assignment when no metatag gets involved: {@code t} is a table whose
+ * metatable is known to lack {@code __newindex}.
+ * @return NO to fall back to {@link LOTValueSetTable}
+ */
+static inline BOOL LOVMFastSet(LOTValue t, LOTValue key, LOTValue value)
+{
+    if (!LOVMIsTable(t))
+        return NO;
+    __unsafe_unretained LOLuaTable *h = (__bridge LOLuaTable *)LOTValueGetPointer(t);
+    if (LOTableFastTM(h->_metatable, LOTagMethodNewIndex) != LO_NIL)
+        return NO;
+    if (LOTValueIsInt(key))
+        LOTableSetInt(h, LOTValueGetInt(key), value);
+    else if (key != LO_NIL && !LOVMIsNaN(key))
+        LOTableSet(h, key, value);
+    else
+        return NO;  /* nil or NaN: the slow path records the error */
+    return YES;
+}
+
+/** {@link LOVMFastSet} for a constant string key, through the inline cache of its instruction */
+static inline BOOL LOVMFastSetField(LOTValue t, LOTValue key, LOTValue value, LOFieldCache *cache)
+{
+    if (!LOVMIsTable(t))
+        return NO;
+    __unsafe_unretained LOLuaTable *h = (__bridge LOLuaTable *)LOTValueGetPointer(t);
+    if (LOTableFastTM(h->_metatable, LOTagMethodNewIndex) != LO_NIL)
+        return NO;
+    LOTableSetStrCached(h, (__bridge LOLuaString *)LOTValueGetPointer(key), value, cache);
+    return YES;
+}
+
+/** {@link LOTValueGetTable} recording the error of indexing a value that cannot be; result retained */
+static LOTValue LOVMGetTable(LOLuaThread *L, LOTValue t, LOTValue key)
+{
+    if (!LOVMIsTable(t) && LOTValueGetTM(t, LOTagMethodIndex) == LO_NIL)
+        return LOVMTypeError(L, t, @"index");
+    return LOTValueGetTable(t, key);
+}
+
+/** {@link LOTValueSetTable} recording the errors of an assignment that cannot be made */
+static void LOVMSetTable(LOLuaThread *L, LOTValue t, LOTValue key, LOTValue value)
+{
+    if (LOVMIsTable(t)) {
+        __unsafe_unretained LOLuaTable *h = (__bridge LOLuaTable *)LOTValueGetPointer(t);
+        // a nil or NaN key reaches the raw set unless __newindex takes it
+        if (LOTableFastTM(h->_metatable, LOTagMethodNewIndex) == LO_NIL) {
+            if (key == LO_NIL) {
+                LOVMError(L, @"table index is nil");
+                return;
+            }
+            if (LOVMIsNaN(key)) {
+                LOVMError(L, @"table index is NaN");
+                return;
+            }
+        }
+    } else if (LOTValueGetTM(t, LOTagMethodNewIndex) == LO_NIL) {
+        LOVMTypeError(L, t, @"index");
+        return;
+    }
+    LOTValueSetTable(t, key, value);
+}
+
+/** converts an integer from a "floating point byte", as lua's luaO_fb2int */
+static inline int LOVMFb2int(int x)
+{
+    int e = (x >> 3) & 0x1f;
+    return e == 0 ? x : ((x & 7) + 8) << (e - 1);
+}
+
+static LOTValue LOVMNewTable(int b, int c)
+{
+    LOLuaTable *t = [[LOLuaTable alloc] initWithArraySize:LOVMFb2int(b) hashSize:LOVMFb2int(c)];
+    return LOTValueFromPointer(CFBridgingRetain(t));
+}
+
+static LOTValue LOVMNewClosure(LOLuaThread *L, LOLuaClosure *cl, int bx, int base)
+{
+    LOPrototype *np = cl->_p->_p[bx];
+    LOLuaClosure *ncl = [[LOLuaClosure alloc] initWithPrototype:np env:nil];
+    for (int j = 0; j < np->_upvaluesSize; j++) {
+        LOUpvalDesc *desc = &np->_upvalues[j];
+        LOUpValue *uv = desc->instack ? LOLuaThreadFindUpvalue(L, base + desc->idx) : cl->_upvals[desc->idx];
+        ncl->_upvals[j] = LOUpValueRetain(uv);
+    }
+    return LOTValueFromPointer(CFBridgingRetain(ncl));
+}
+
+/** Store a value that is already retained into an owned slot */
+static inline void LOVMSetOwned(LOTValue *slot, LOTValue v)
+{
+    LOTValue old = *slot;
+    *slot = v;
+    LOTValueRelease(old);
+}
+
+#pragma mark - calls
+
+/**
+ * Set up the activation record of a lua call: {@code func} is the stack slot of
+ * the closure, followed by {@code nargs} arguments.
+ */
+static void LOVMEnter(LOLuaThread *L, LOLuaClosure *cl, int func, int nargs, int nresults)
+{
+    LOPrototype *p = cl->_p;
+    int nfixed = p->_numparams;
+    int base = p->_isVararg ? func + 1 + nargs : func + 1;
+    LOLuaThreadGrowTop(L, base + p->_maxstacksize);
+    LOTValue *stack = L->_stack;
+    if (p->_isVararg) {
+        // move the fixed parameters above the varargs, which stay where they are
+        for (int i = 0; i < nfixed; i++) {
+            LOTValue v = LO_NIL;
+            if (i < nargs) {
+                v = stack[func + 1 + i];
+                stack[func + 1 + i] = LO_NIL;
+            }
+            LOVMSetOwned(&stack[base + i], v);
+        }
+    } else {
+        for (int i = nargs; i < nfixed; i++)
+            LOTValueAssign(&stack[base + i], LO_NIL);
+    }
+    LOCallInfo *ci = LOLuaThreadPushCall(L, cl);
+    ci->func = func;
+    ci->base = base;
+    ci->nresults = nresults;
+    ci->pc = 0;
+}
+
+/**
+ * Call the non-closure in slot {@code func}, moving its results to {@code func} onwards.
+ * A value that cannot be called records the error and is not called.
+ * @return the stack index just past the last result
+ */
+static int LOVMCallNative(LOLuaThread *L, int func, int nargs, int nresults, int frameTop)
+{
+    if (LOTValueType(L->_stack[func]) != LOLuaTypeFunction) {
+        LOTValue tm = LOTValueGetTM(L->_stack[func], LOTagMethodCall);
+        if (tm == LO_NIL) {
+            LOVMTypeError(L, L->_stack[func], @"call");
+            return func;
+        }
+        // call the metamethod with the called object as first argument
+        LOLuaThreadGrowTop(L, func + nargs + 2);
+        LOTValue *stack = L->_stack;
+        for (int j = nargs; j >= 0; j--)
+            LOTValueAssign(&stack[func + 1 + j], stack[func + j]);
+        LOTValueAssign(&stack[func], tm);
+        nargs++;
+    }
+    LOLuaValue *function = LOTValueBox(L->_stack[func]);
+    LOVarargs *results = [L call:function base:func + 1 nargs:nargs];
+    // the call popped the arguments, the slots it freed are nil again
+    if (L->_top < frameTop)
+        L->_top = frameTop;
+    int n = results ? results.narg : 0;
+    int wanted = nresults < 0 ? n : nresults;
+    LOLuaThreadGrowTop(L, func + wanted);
+    LOTValue *stack = L->_stack;
+    for (int i = 0; i < wanted; i++)
+        LOTValueAssign(&stack[func + i], i < n ? LOVarargsArgValue(results, i + 1) : LO_NIL);
+    return func + n;
+}
+
+/** Return from the entry frame of {@link LOVMExecute} to native code */
+static LOVarargs *LOVMReturnToNative(LOLuaThread *L, int ra, int n)
+{
+    LOTValue *stack = L->_stack;
+    LOVarargs *results;
+    if (n == 0)
+        results = LOLuaValue.NONE;
+    else if (n == 1)
+        results = LOTValueBox(stack[ra]);
+    else
+        results = [[LOArrayVarargs alloc] initWithValues:&stack[ra] count:n more:nil];
+    int func = L->_callInfos[L->_callDepth - 1].func;
+    L->_callDepth--;
+    LOLuaThreadPopTo(L, func);
+    return results;
+}
+
+#pragma mark - interpreter
+
+/** Instruction {@code i} with its opcode replaced by {@code op} */
+static inline int LOVMWithOpcode(int i, int op)
+{
+    LO_SET_OPCODE(i, op);
+    return i;
+}
+
+#define R(x)        stack[base + (x)]
+#define RKB(i)      (LO_ISK(LO_GETARG_B(i)) ? k[LO_INDEXK(LO_GETARG_B(i))] : stack[base + LO_GETARG_B(i)])
+#define RKC(i)      (LO_ISK(LO_GETARG_C(i)) ? k[LO_INDEXK(LO_GETARG_C(i))] : stack[base + LO_GETARG_C(i)])
+/* whether B or C of the instruction is a constant string, the key of a cached field access */
+#define KSTRB(i)    (LO_ISK(LO_GETARG_B(i)) && LOVMIsStringKey(k[LO_INDEXK(LO_GETARG_B(i))]))
+#define KSTRC(i)    (LO_ISK(LO_GETARG_C(i)) && LOVMIsStringKey(k[LO_INDEXK(LO_GETARG_C(i))]))
+/* inline cache of the instruction being executed */
+#define FCACHE()    (&fc[pc - 1])
+#define SAVEPC()    (ci->pc = pc)
+/* after anything that may push activation records or grow the stack */
+#define RELOAD()    (ci = &L->_callInfos[L->_callDepth - 1], stack = L->_stack)
+/* the next instruction word, which other threads may be quickening, see below */
+#define vmfetch()   __atomic_load_n(&code[pc++], __ATOMIC_RELAXED)
+
+#if LOVM_COMPUTED_GOTO
+#define vmdispatch(o)   goto *dispatchTable[o];
+#define vmcase(op)      L_##op:
+#define vmbreak         { i = vmfetch(); ra = base + LO_GETARG_A(i); goto *dispatchTable[LO_GET_OPCODE(i)]; }
+#else
+#define vmdispatch(o)   switch (o)
+#define vmcase(op)      case op:
+#define vmbreak         continue
+#endif
+
+/*
+ * Run the compiled code of a hot prototype from pc: on frame entry, on loop
+ * back edges and after native calls.  It returns at the first instruction it
+ * leaves to the interpreter.
+ */
+#if LOVM_JIT
+#define vmjit() { \
+    LOJITFunction jit_ = LOJITCode(p); \
+    if (jit_ != NULL) \
+        pc = jit_(stack + base, k, pc); \
+}
+#else
+#define vmjit() ((void)0)
+#endif
+
+/* return to the native caller of the loop when the last slow path recorded an error */
+#define vmcheckerror() { \
+    if (LOLuaThreadMustUnwind(L)) \
+        return LOLuaValue.NONE; \
+}
+
+/* store the retained result of a slow path that may run metamethods or fail into R(A) */
+#define vmprotect(x) { \
+    SAVEPC(); \
+    LOTValue r_ = (x); \
+    RELOAD(); \
+    vmcheckerror(); \
+    LOVMSetOwned(&stack[ra], r_); \
+}
+
+/* R(A) := t[key], inline on a plain table, else with metatag processing */
+#define vmgettable(t, key) { \
+    LOTValue v_; \
+    if (KSTRC(i) ? LOVMFastGetField(t, key, FCACHE(), &v_) : LOVMFastGet(t, key, &v_)) \
+        LOTValueAssign(&stack[ra], v_); \
+    else \
+        vmprotect(LOVMGetTable(L, t, key)); \
+}
+
+/* t[key] := value, inline on a plain table, else with metatag processing */
+#define vmsettable(t, key, value) { \
+    SAVEPC(); \
+    if (!(KSTRB(i) ? LOVMFastSetField(t, key, value, FCACHE()) : LOVMFastSet(t, key, value))) { \
+        LOVMSetTable(L, t, key, value); \
+        RELOAD(); \
+        vmcheckerror(); \
+    } \
+}
+
+/*
+ * Quickening: a generic instruction rewrites its own opcode into the form
+ * specialized for the operands it met, which only checks that they are
+ * still of those kinds.  When the check fails the quickened form rewrites
+ * the instruction back and executes it again generically, which may
+ * quicken it anew.
+ * <p>
+ * Threads running the same prototype share its code, so a word may be
+ * rewritten while another thread fetches it.  Only the opcode bits ever
+ * change and every form computes the same result, so any word a fetch
+ * returns is correct, provided it is a whole word: the rewrite stores the
+ * word fetched with the new opcode in one relaxed atomic store, rather than
+ * updating the opcode bits of memory in place, and {@link vmfetch} loads
+ * with a relaxed atomic load.  No ordering is needed as nothing else is
+ * published with the word; on the supported targets both are plain aligned
+ * 32 bit moves.
+ */
+#define vmquicken(op)   __atomic_store_n(&code[pc - 1], LOVMWithOpcode(i, op), __ATOMIC_RELAXED)
+#define vmdeopt(op)     { vmquicken(op); pc--; vmbreak; }
+
+/* the int case of arithmetic, overflowing to a double */
+#define vmarithint(iop) { \
+    long long x = LOTValueGetInt(b), y = LOTValueGetInt(c); \
+    long long r = (iop); \
+    LOVMSetOwned(&stack[ra], r >= INT_MIN && r <= INT_MAX ? LOTValueFromInt((int)r) : LOTValueFromDouble((double)r)); \
+}
+
+/**
+ * Arithmetic with an int fast path; {@code iop} computes a long long from ints x and y.
+ * Numbers quicken the instruction into {@code opii} for two ints, else {@code opff}.
+ */
+#define vmarith(op, iop, opii, opff) { \
+    LOTValue b = RKB(i), c = RKC(i); \
+    if (LOTValueIsInt(b) && LOTValueIsInt(c)) { \
+        vmquicken(opii); \
+        vmarithint(iop); \
+    } else if (LOTValueIsNumber(b) && LOTValueIsNumber(c)) { \
+        vmquicken(opff); \
+        LOVMSetOwned(&stack[ra], LOTValueFromNumber(LOVMArithDouble(op, LOTValueToDouble(b), LOTValueToDouble(c)))); \
+    } else { \
+        vmprotect(LOVMArith(L, op, b, c)); \
+    } \
+}
+
+/* quickened arithmetic on two ints, the result as in {@link vmarith} */
+#define vmarithii(op, iop) { \
+    LOTValue b = RKB(i), c = RKC(i); \
+    if (!(LOTValueIsInt(b) && LOTValueIsInt(c))) \
+        vmdeopt(op); \
+    vmarithint(iop); \
+}
+
+/*
+ * quickened arithmetic on two numbers; two ints still take the int path,
+ * as in double arithmetic e.g. 0 * -5 would give -0
+ */
+#define vmarithff(op, iop) { \
+    LOTValue b = RKB(i), c = RKC(i); \
+    if (!(LOTValueIsNumber(b) && LOTValueIsNumber(c))) \
+        vmdeopt(op); \
+    if (LOTValueIsInt(b) && LOTValueIsInt(c)) \
+        vmarithint(iop) \
+    else \
+        LOVMSetOwned(&stack[ra], LOTValueFromNumber(LOVMArithDouble(op, LOTValueToDouble(b), LOTValueToDouble(c)))); \
+}
+
+/**
+ * Run lua frames until the one at call depth {@code entryDepth} returns.
+ * That frame must have been set up with {@link LOVMEnter}, or be suspended
+ * in a call whose results are in place; {@code vtop} is then the top of
+ * those results for a call that wants all of them.
+ * @return the results of the entry frame, or NONE with an error recorded on
+ * {@code L} or with the coroutine yielding
+ */
+static LOVarargs *LOVMExecute(LOLuaThread *L, int entryDepth, int vtop)
+{
+#if LOVM_COMPUTED_GOTO
+    static const void *const dispatchTable[1 << LO_SIZE_OP] = {
+        [0 ... (1 << LO_SIZE_OP) - 1] = &&L_invalid,
+        [LO_OP_MOVE] = &&L_LO_OP_MOVE,
+        [LO_OP_LOADK] = &&L_LO_OP_LOADK,
+        [LO_OP_LOADKX] = &&L_LO_OP_LOADKX,
+        [LO_OP_LOADBOOL] = &&L_LO_OP_LOADBOOL,
+        [LO_OP_LOADNIL] = &&L_LO_OP_LOADNIL,
+        [LO_OP_GETUPVAL] = &&L_LO_OP_GETUPVAL,
+        [LO_OP_GETTABUP] = &&L_LO_OP_GETTABUP,
+        [LO_OP_GETTABLE] = &&L_LO_OP_GETTABLE,
+        [LO_OP_SETTABUP] = &&L_LO_OP_SETTABUP,
+        [LO_OP_SETUPVAL] = &&L_LO_OP_SETUPVAL,
+        [LO_OP_SETTABLE] = &&L_LO_OP_SETTABLE,
+        [LO_OP_NEWTABLE] = &&L_LO_OP_NEWTABLE,
+        [LO_OP_SELF] = &&L_LO_OP_SELF,
+        [LO_OP_ADD] = &&L_LO_OP_ADD,
+        [LO_OP_SUB] = &&L_LO_OP_SUB,
+        [LO_OP_MUL] = &&L_LO_OP_MUL,
+        [LO_OP_DIV] = &&L_LO_OP_DIV,
+        [LO_OP_MOD] = &&L_LO_OP_MOD,
+        [LO_OP_POW] = &&L_LO_OP_POW,
+        [LO_OP_UNM] = &&L_LO_OP_UNM,
+        [LO_OP_NOT] = &&L_LO_OP_NOT,
+        [LO_OP_LEN] = &&L_LO_OP_LEN,
+        [LO_OP_CONCAT] = &&L_LO_OP_CONCAT,
+        [LO_OP_JMP] = &&L_LO_OP_JMP,
+        [LO_OP_EQ] = &&L_LO_OP_EQ,
+        [LO_OP_LT] = &&L_LO_OP_LT,
+        [LO_OP_LE] = &&L_LO_OP_LE,
+        [LO_OP_TEST] = &&L_LO_OP_TEST,
+        [LO_OP_TESTSET] = &&L_LO_OP_TESTSET,
+        [LO_OP_CALL] = &&L_LO_OP_CALL,
+        [LO_OP_TAILCALL] = &&L_LO_OP_TAILCALL,
+        [LO_OP_RETURN] = &&L_LO_OP_RETURN,
+        [LO_OP_FORLOOP] = &&L_LO_OP_FORLOOP,
+        [LO_OP_FORPREP] = &&L_LO_OP_FORPREP,
+        [LO_OP_TFORCALL] = &&L_LO_OP_TFORCALL,
+        [LO_OP_TFORLOOP] = &&L_LO_OP_TFORLOOP,
+        [LO_OP_SETLIST] = &&L_LO_OP_SETLIST,
+        [LO_OP_CLOSURE] = &&L_LO_OP_CLOSURE,
+        [LO_OP_VARARG] = &&L_LO_OP_VARARG,
+        [LO_OP_EXTRAARG] = &&L_LO_OP_EXTRAARG,
+        [LO_OP_ADD_II] = &&L_LO_OP_ADD_II,
+        [LO_OP_SUB_II] = &&L_LO_OP_SUB_II,
+        [LO_OP_MUL_II] = &&L_LO_OP_MUL_II,
+        [LO_OP_ADD_FF] = &&L_LO_OP_ADD_FF,
+        [LO_OP_SUB_FF] = &&L_LO_OP_SUB_FF,
+        [LO_OP_MUL_FF] = &&L_LO_OP_MUL_FF,
+        [LO_OP_GETTABLE_ARR] = &&L_LO_OP_GETTABLE_ARR,
+    };
+#endif
+    LOCallInfo *ci;
+    __unsafe_unretained LOLuaClosure *cl;
+    __unsafe_unretained LOPrototype *p;
+    int *code;
+    const LOTValue *k;
+    LOFieldCache *fc;
+    LOTValue *stack;
+    int base, pc, ra, i;
+
+newframe:
+    ci = &L->_callInfos[L->_callDepth - 1];
+    cl = (__bridge LOLuaClosure *)LOTValueGetPointer(ci->function);
+    p = cl->_p;
+    code = p->_code;
+    k = p->_k;
+    fc = LOPrototypeFieldCaches(p);
+    base = ci->base;
+    pc = ci->pc;
+    stack = L->_stack;
+    vmjit();
+
+    for (;;) {
+        i = vmfetch();
+        ra = base + LO_GETARG_A(i);
+        vmdispatch(LO_GET_OPCODE(i)) {
+            vmcase(LO_OP_MOVE) {
+                LOTValueAssign(&stack[ra], R(LO_GETARG_B(i)));
+                vmbreak;
+            }
+            vmcase(LO_OP_LOADK) {
+                LOTValueAssign(&stack[ra], k[LO_GETARG_Bx(i)]);
+                vmbreak;
+            }
+            vmcase(LO_OP_LOADKX) {
+                LOTValueAssign(&stack[ra], k[LO_GETARG_Ax(code[pc++])]);
+                vmbreak;
+            }
+            vmcase(LO_OP_LOADBOOL) {
+                LOVMSetOwned(&stack[ra], LOTValueFromBoolean(LO_GETARG_B(i) != 0));
+                if (LO_GETARG_C(i))
+                    pc++;
+                vmbreak;
+            }
+            vmcase(LO_OP_LOADNIL) {
+                for (int b = LO_GETARG_B(i); b >= 0; b--)
+                    LOVMSetOwned(&stack[ra + b], LO_NIL);
+                vmbreak;
+            }
+            vmcase(LO_OP_GETUPVAL) {
+                LOTValueAssign(&stack[ra], LOUpValueGet(cl->_upvals[LO_GETARG_B(i)]));
+                vmbreak;
+            }
+            vmcase(LO_OP_GETTABUP) {
+                LOTValue t = LOUpValueGet(cl->_upvals[LO_GETARG_B(i)]), key = RKC(i);
+                vmgettable(t, key);
+                vmbreak;
+            }
+            vmcase(LO_OP_GETTABLE) {
+                LOTValue t = R(LO_GETARG_B(i)), key = RKC(i);
+                if (LOVMIsArrayIndex(t, key))
+                    vmquicken(LO_OP_GETTABLE_ARR);
+                vmgettable(t, key);
+                vmbreak;
+            }
+            vmcase(LO_OP_SETTABUP) {
+                LOTValue t = LOUpValueGet(cl->_upvals[LO_GETARG_A(i)]), key = RKB(i), value = RKC(i);
+                vmsettable(t, key, value);
+                vmbreak;
+            }
+            vmcase(LO_OP_SETUPVAL) {
+                LOUpValueSet(cl->_upvals[LO_GETARG_B(i)], stack[ra]);
+                vmbreak;
+            }
+            vmcase(LO_OP_SETTABLE) {
+                LOTValue t = stack[ra], key = RKB(i), value = RKC(i);
+                vmsettable(t, key, value);
+                vmbreak;
+            }
+            vmcase(LO_OP_NEWTABLE) {
+                LOVMSetOwned(&stack[ra], LOVMNewTable(LO_GETARG_B(i), LO_GETARG_C(i)));
+                vmbreak;
+            }
+            vmcase(LO_OP_SELF) {
+                LOTValue rb = R(LO_GETARG_B(i)), key = RKC(i);
+                LOTValueAssign(&stack[ra + 1], rb);
+                vmgettable(rb, key);
+                vmbreak;
+            }
+            vmcase(LO_OP_ADD) {
+                vmarith(LO_OP_ADD, x + y, LO_OP_ADD_II, LO_OP_ADD_FF);
+                vmbreak;
+            }
+            vmcase(LO_OP_SUB) {
+                vmarith(LO_OP_SUB, x - y, LO_OP_SUB_II, LO_OP_SUB_FF);
+                vmbreak;
+            }
+            vmcase(LO_OP_MUL) {
+                vmarith(LO_OP_MUL, x * y, LO_OP_MUL_II, LO_OP_MUL_FF);
+                vmbreak;
+            }
+            vmcase(LO_OP_DIV) {
+                LOTValue b = RKB(i), c = RKC(i);
+                if (LOTValueIsNumber(b) && LOTValueIsNumber(c)) {
+                    LOVMSetOwned(&stack[ra], LOTValueFromNumber(LOTValueToDouble(b) / LOTValueToDouble(c)));
+                } else {
+                    vmprotect(LOVMArith(L, LO_OP_DIV, b, c));
+                }
+                vmbreak;
+            }
+            vmcase(LO_OP_MOD) {
+                LOTValue b = RKB(i), c = RKC(i);
+                if (LOTValueIsInt(b) && LOTValueIsInt(c) && LOTValueGetInt(c) != 0) {
+                    long long x = LOTValueGetInt(b), y = LOTValueGetInt(c);
+                    long long r = x % y;
+                    if (r != 0 && (r ^ y) < 0)
+                        r += y;
+                    LOVMSetOwned(&stack[ra], LOTValueFromInt((int)r));
+                } else if (LOTValueIsNumber(b) && LOTValueIsNumber(c)) {
+                    LOVMSetOwned(&stack[ra], LOTValueFromNumber(LOVMArithDouble(LO_OP_MOD, LOTValueToDouble(b), LOTValueToDouble(c))));
+                } else {
+                    vmprotect(LOVMArith(L, LO_OP_MOD, b, c));
+                }
+                vmbreak;
+            }
+            vmcase(LO_OP_POW) {
+                LOTValue b = RKB(i), c = RKC(i);
+                if (LOTValueIsNumber(b) && LOTValueIsNumber(c)) {
+                    LOVMSetOwned(&stack[ra], LOTValueFromNumber(pow(LOTValueToDouble(b), LOTValueToDouble(c))));
+                } else {
+                    vmprotect(LOVMArith(L, LO_OP_POW, b, c));
+                }
+                vmbreak;
+            }
+            vmcase(LO_OP_UNM) {
+                LOTValue b = R(LO_GETARG_B(i));
+                if (LOTValueIsInt(b) && LOTValueGetInt(b) != 0 && LOTValueGetInt(b) != INT_MIN) {
+                    LOVMSetOwned(&stack[ra], LOTValueFromInt(-LOTValueGetInt(b)));
+                } else if (LOTValueIsNumber(b)) {
+                    LOVMSetOwned(&stack[ra], LOTValueFromNumber(-LOTValueToDouble(b)));
+                } else {
+                    vmprotect(LOVMArith(L, LO_OP_UNM, b, b));
+                }
+                vmbreak;
+            }
+            vmcase(LO_OP_NOT) {
+                LOVMSetOwned(&stack[ra], LOTValueFromBoolean(!LOTValueToBoolean(R(LO_GETARG_B(i)))));
+                vmbreak;
+            }
+            vmcase(LO_OP_LEN) {
+                vmprotect(LOVMLength(L, R(LO_GETARG_B(i))));
+                vmbreak;
+            }
+            vmcase(LO_OP_CONCAT) {
+                int b = LO_GETARG_B(i);
+                vmprotect(LOVMConcat(L, &R(b), LO_GETARG_C(i) - b + 1));
+                vmbreak;
+            }
+            vmcase(LO_OP_JMP) {
+                int a = LO_GETARG_A(i);
+                if (a > 0)
+                    LOLuaThreadCloseUpvalues(L, base + a - 1);
+                pc += LO_GETARG_sBx(i);
+                if (LO_GETARG_sBx(i) < 0)
+                    vmjit();
+                vmbreak;
+            }
+            vmcase(LO_OP_EQ) {
+                LOTValue b = RKB(i), c = RKC(i);
+                BOOL equal = LOVMRawEquals(b, c);
+                if (!equal && LOVMBothTables(b, c)) {
+                    SAVEPC();
+                    equal = LOVMEqualTM(b, c);
+                    RELOAD();
+                }
+                if (equal != LO_GETARG_A(i))
+                    pc++;
+                vmbreak;
+            }
+            vmcase(LO_OP_LT) {
+                LOTValue b = RKB(i), c = RKC(i);
+                BOOL less;
+                if (LOTValueIsInt(b) && LOTValueIsInt(c)) {
+                    less = LOTValueGetInt(b) < LOTValueGetInt(c);
+                } else {
+                    SAVEPC();
+                    less = LOVMLessThan(L, b, c);
+                    RELOAD();
+                    vmcheckerror();
+                }
+                if (less != LO_GETARG_A(i))
+                    pc++;
+                vmbreak;
+            }
+            vmcase(LO_OP_LE) {
+                LOTValue b = RKB(i), c = RKC(i);
+                BOOL lessEqual;
+                if (LOTValueIsInt(b) && LOTValueIsInt(c)) {
+                    lessEqual = LOTValueGetInt(b) <= LOTValueGetInt(c);
+                } else {
+                    SAVEPC();
+                    lessEqual = LOVMLessEqual(L, b, c);
+                    RELOAD();
+                    vmcheckerror();
+                }
+                if (lessEqual != LO_GETARG_A(i))
+                    pc++;
+                vmbreak;
+            }
+            vmcase(LO_OP_TEST) {
+                if (LOTValueToBoolean(stack[ra]) != (LO_GETARG_C(i) != 0))
+                    pc++;
+                vmbreak;
+            }
+            vmcase(LO_OP_TESTSET) {
+                LOTValue rb = R(LO_GETARG_B(i));
+                if (LOTValueToBoolean(rb) == (LO_GETARG_C(i) != 0))
+                    LOTValueAssign(&stack[ra], rb);
+                else
+                    pc++;
+                vmbreak;
+            }
+            vmcase(LO_OP_CALL) {
+                int b = LO_GETARG_B(i);
+                int nresults = LO_GETARG_C(i) - 1;
+                int nargs = b != 0 ? b - 1 : vtop - ra - 1;
+                SAVEPC();
+                if (LOVMIsClosure(stack[ra])) {
+                    LOVMEnter(L, (__bridge LOLuaClosure *)LOTValueGetPointer(stack[ra]), ra, nargs, nresults);
+                    goto newframe;
+                }
+                vtop = LOVMCallNative(L, ra, nargs, nresults, base + p->_maxstacksize);
+                RELOAD();
+                if (LOLuaThreadMustUnwind(L))
+                    return LOLuaValue.NONE;
+                vmjit();
+                vmbreak;
+            }
+            vmcase(LO_OP_TAILCALL) {
+                int b = LO_GETARG_B(i);
+                int nargs = b != 0 ? b - 1 : vtop - ra - 1;
+                SAVEPC();
+                if (LOVMIsClosure(stack[ra])) {
+                    // reuse the activation record: move the callee and its arguments down
+                    int func = ci->func;
+                    int nresults = ci->nresults;
+                    LOLuaThreadCloseUpvalues(L, base);
+                    for (int j = 0; j <= nargs; j++)
+                        LOTValueAssign(&stack[func + j], stack[ra + j]);
+                    LOLuaThreadPopTo(L, func + 1 + nargs);
+                    L->_callDepth--;
+                    LOVMEnter(L, (__bridge LOLuaClosure *)LOTValueGetPointer(stack[func]), func, nargs, nresults);
+                    goto newframe;
+                }
+                // a native callee runs as an ordinary call; the RETURN that follows returns its results
+                vtop = LOVMCallNative(L, ra, nargs, -1, base + p->_maxstacksize);
+                RELOAD();
+                if (LOLuaThreadMustUnwind(L))
+                    return LOLuaValue.NONE;
+                vmbreak;
+            }
+            vmcase(LO_OP_RETURN) {
+                int b = LO_GETARG_B(i);
+                int n = b != 0 ? b - 1 : vtop - ra;
+                LOLuaThreadCloseUpvalues(L, base);
+                if (L->_callDepth - 1 == entryDepth)
+                    return LOVMReturnToNative(L, ra, n);
+                int func = ci->func;
+                int wanted = ci->nresults;
+                int count = wanted < 0 ? n : wanted;
+                for (int j = 0; j < count; j++)
+                    LOTValueAssign(&stack[func + j], j < n ? stack[ra + j] : LO_NIL);
+                L->_callDepth--;
+                ci = &L->_callInfos[L->_callDepth - 1];
+                __unsafe_unretained LOPrototype *caller = ((__bridge LOLuaClosure *)LOTValueGetPointer(ci->function))->_p;
+                LOLuaThreadPopTo(L, MAX(ci->base + caller->_maxstacksize, func + count));
+                if (wanted < 0)
+                    vtop = func + n;
+                goto newframe;
+            }
+            vmcase(LO_OP_FORLOOP) {
+                LOTValue idx = stack[ra], limit = stack[ra + 1], step = stack[ra + 2];
+                if (LOTValueIsInt(idx) && LOTValueIsInt(limit) && LOTValueIsInt(step)) {
+                    long long n = (long long)LOTValueGetInt(idx) + LOTValueGetInt(step);
+                    if (LOTValueGetInt(step) > 0 ? n <= LOTValueGetInt(limit) : LOTValueGetInt(limit) <= n) {
+                        // n lies between the old index and the limit, so it is an int
+                        stack[ra] = LOTValueFromInt((int)n);
+                        LOVMSetOwned(&stack[ra + 3], stack[ra]);
+                        pc += LO_GETARG_sBx(i);
+                        vmjit();
+                    }
+                } else {
+                    double n = LOTValueToDouble(idx) + LOTValueToDouble(step);
+                    if (LOTValueToDouble(step) > 0 ? n <= LOTValueToDouble(limit) : LOTValueToDouble(limit) <= n) {
+                        stack[ra] = LOTValueFromNumber(n);
+                        LOVMSetOwned(&stack[ra + 3], stack[ra]);
+                        pc += LO_GETARG_sBx(i);
+                        vmjit();
+                    }
+                }
+                vmbreak;
+            }
+            vmcase(LO_OP_FORPREP) {
+                double init, limit, step;
+                SAVEPC();
+                if (!LOVMToNumber(stack[ra], &init))
+                    return LOVMError(L, @"'for' initial value must be a number");
+                if (!LOVMToNumber(stack[ra + 1], &limit))
+                    return LOVMError(L, @"'for' limit must be a number");
+                if (!LOVMToNumber(stack[ra + 2], &step))
+                    return LOVMError(L, @"'for' step must be a number");
+                LOVMSetOwned(&stack[ra + 1], LOTValueFromNumber(limit));
+                LOVMSetOwned(&stack[ra + 2], LOTValueFromNumber(step));
+                LOVMSetOwned(&stack[ra], LOTValueFromNumber(init - step));
+                pc += LO_GETARG_sBx(i);
+                vmbreak;
+            }
+            vmcase(LO_OP_TFORCALL) {
+                int cb = ra + 3;  /* call base */
+                LOTValueAssign(&stack[cb + 2], stack[ra + 2]);
+                LOTValueAssign(&stack[cb + 1], stack[ra + 1]);
+                LOTValueAssign(&stack[cb], stack[ra]);
+                SAVEPC();
+                if (LOVMIsClosure(stack[cb])) {
+                    LOVMEnter(L, (__bridge LOLuaClosure *)LOTValueGetPointer(stack[cb]), cb, 2, LO_GETARG_C(i));
+                    goto newframe;
+                }
+                LOVMCallNative(L, cb, 2, LO_GETARG_C(i), base + p->_maxstacksize);
+                RELOAD();
+                if (LOLuaThreadMustUnwind(L))
+                    return LOLuaValue.NONE;
+                vmbreak;
+            }
+            vmcase(LO_OP_TFORLOOP) {
+                if (stack[ra + 1] != LO_NIL) {  /* continue loop? */
+                    LOTValueAssign(&stack[ra], stack[ra + 1]);  /* save control variable */
+                    pc += LO_GETARG_sBx(i);  /* jump back */
+                    vmjit();
+                }
+                vmbreak;
+            }
+            vmcase(LO_OP_SETLIST) {
+                int n = LO_GETARG_B(i);
+                int c = LO_GETARG_C(i);
+                if (n == 0)
+                    n = vtop - ra - 1;
+                if (c == 0)
+                    c = LO_GETARG_Ax(code[pc++]);
+                // the table was just created by NEWTABLE
+                __unsafe_unretained LOLuaTable *t = (__bridge LOLuaTable *)LOTValueGetPointer(stack[ra]);
+                int offset = (c - 1) * LO_LFIELDS_PER_FLUSH;
+                for (int j = 1; j <= n; j++)
+                    LOTableSetInt(t, offset + j, stack[ra + j]);
+                vmbreak;
+            }
+            vmcase(LO_OP_CLOSURE) {
+                LOVMSetOwned(&stack[ra], LOVMNewClosure(L, cl, LO_GETARG_Bx(i), base));
+                vmbreak;
+            }
+            vmcase(LO_OP_VARARG) {
+                int n = base - ci->func - 1 - p->_numparams;
+                int b = LO_GETARG_B(i) - 1;
+                if (n < 0)
+                    n = 0;
+                if (b < 0) {
+                    b = n;
+                    SAVEPC();
+                    LOLuaThreadGrowTop(L, ra + n);
+                    RELOAD();
+                    vtop = ra + n;
+                }
+                for (int j = 0; j < b; j++)
+                    LOTValueAssign(&stack[ra + j], j < n ? stack[base - n + j] : LO_NIL);
+                vmbreak;
+            }
+            vmcase(LO_OP_EXTRAARG) {
+                vmbreak;
+            }
+            vmcase(LO_OP_ADD_II) {
+                vmarithii(LO_OP_ADD, x + y);
+                vmbreak;
+            }
+            vmcase(LO_OP_SUB_II) {
+                vmarithii(LO_OP_SUB, x - y);
+                vmbreak;
+            }
+            vmcase(LO_OP_MUL_II) {
+                vmarithii(LO_OP_MUL, x * y);
+                vmbreak;
+            }
+            vmcase(LO_OP_ADD_FF) {
+                vmarithff(LO_OP_ADD, x + y);
+                vmbreak;
+            }
+            vmcase(LO_OP_SUB_FF) {
+                vmarithff(LO_OP_SUB, x - y);
+                vmbreak;
+            }
+            vmcase(LO_OP_MUL_FF) {
+                vmarithff(LO_OP_MUL, x * y);
+                vmbreak;
+            }
+            vmcase(LO_OP_GETTABLE_ARR) {
+                LOTValue t = R(LO_GETARG_B(i)), key = RKC(i);
+                if (!LOVMIsArrayIndex(t, key))
+                    vmdeopt(LO_OP_GETTABLE);
+                __unsafe_unretained LOLuaTable *h = (__bridge LOLuaTable *)LOTValueGetPointer(t);
+                LOTValue v = LOTableArrayGet(h, LOTValueGetInt(key) - 1);
+                if (v == LO_NIL && LOTableFastTM(h->_metatable, LOTagMethodIndex) != LO_NIL)
+                    vmdeopt(LO_OP_GETTABLE);
+                LOTValueAssign(&stack[ra], v);
+                vmbreak;
+            }
+#if !LOVM_COMPUTED_GOTO
+            default:
+                goto L_invalid;
+#endif
+        }
+    }
+
+L_invalid:
+    SAVEPC();
+    return LOVMError(L, [NSString stringWithFormat:@"invalid opcode %d", LO_GET_OPCODE(i)]);
+}
+
+#pragma mark - coroutines
+
+LOVarargs *LOLuaClosureResume(LOLuaThread *L, LOVarargs *args)
+{
+    int nargs = args.narg;
+    int vtop = 0;
+    if (L->_callDepth == 0) {
+        // first resume: call the body with the arguments
+        __unsafe_unretained LOLuaClosure *cl = (LOLuaClosure *)L->_function;
+        int func = LOLuaThreadReserve(L, 1 + nargs);
+        L->_stack[func] = LOTValueFromPointer(CFBridgingRetain(cl));
+        for (int i = 0; i < nargs; i++)
+            LOTValueAssign(&L->_stack[func + 1 + i], LOVarargsArgValue(args, i + 1));
+        LOVMEnter(L, cl, func, nargs, -1);
+    } else {
+        // the innermost frame is suspended in the call that yielded: the values become its results
+        LOCallInfo *ci = &L->_callInfos[L->_callDepth - 1];
+        __unsafe_unretained LOPrototype *p = ((__bridge LOLuaClosure *)LOTValueGetPointer(ci->function))->_p;
+        int i = p->_code[ci->pc - 1];
+        int func = ci->base + LO_GETARG_A(i);
+        int nresults;
+        switch (LO_GET_OPCODE(i)) {
+            case LO_OP_TFORCALL:
+                func += 3;
+                nresults = LO_GETARG_C(i);
+                break;
+            case LO_OP_TAILCALL:
+                nresults = -1;
+                break;
+            default:
+                nresults = LO_GETARG_C(i) - 1;
+                break;
+        }
+        int wanted = nresults < 0 ? nargs : nresults;
+        LOLuaThreadGrowTop(L, func + wanted);
+        for (int j = 0; j < wanted; j++)
+            LOTValueAssign(&L->_stack[func + j], j < nargs ? LOVarargsArgValue(args, j + 1) : LO_NIL);
+        vtop = func + nargs;
+    }
+    return LOVMExecute(L, 0, vtop);
+}
+
+/**
+ * Call {@code cl} from native code on the running thread, with the arguments
+ * either in {@code args} or, when that is nil, the {@code nargs} boxed values
+ * of {@code values}.
+ */
+static LOVarargs *LOLuaClosureCall(LOLuaClosure *cl, LOVarargs *args, LOLuaValue *__unsafe_unretained *values, int nargs)
+{
+    // borrowed, so that a stackful coroutine suspended in this call can be deallocated
+    __unsafe_unretained LOLuaThread *L = LOLuaThreadCurrent();
+    int depth = L->_callDepth;
+    int func = LOLuaThreadReserve(L, 1 + nargs);
+    L->_stack[func] = LOTValueFromPointer(CFBridgingRetain(cl));
+    for (int i = 0; i < nargs; i++)
+        LOTValueAssign(&L->_stack[func + 1 + i], args ? LOVarargsArgValue(args, i + 1) : LOTValueUnbox(values[i]));
+
+    __unsafe_unretained LOLuaThread *caller = LOLuaThreadSetRunning(L);
+    @try {
+        LOVMEnter(L, cl, func, nargs, -1);
+        LOVarargs *results = LOVMExecute(L, depth, 0);
+        // an error the interpreter recorded is raised here when nothing protects the call
+        if (L->_error && L->_nprotected == 0)
+            @throw LOLuaThreadTakeError(L);
+        return results;
+    } @finally {
+        // normally already done by the return; this unwinds after an error
+        LOLuaThreadCloseUpvalues(L, func);
+        L->_callDepth = depth;
+        LOLuaThreadPopTo(L, func);
+        LOLuaThreadSetRunning(caller);
+    }
+}
 
 @implementation LOLuaClosure
 
++ (void)initialize
+{
+    if (self == [LOLuaClosure class]) {
+        _closureClass = [LOLuaClosure class];
+    }
+}
+
+- (instancetype)initWithPrototype:(LOPrototype *)p env:(LOLuaValue *)env
+{
+    if (self = [super init]) {
+        _p = p;
+        _nupvals = p->_upvaluesSize;
+        _upvals = _nupvals > 0 ? calloc(_nupvals, sizeof(LOUpValue *)) : NULL;
+        if (env && _nupvals > 0)
+            _upvals[0] = LOUpValueNewClosed(LOTValueUnbox(env));
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    for (int i = 0; i < _nupvals; i++) {
+        if (_upvals[i])
+            LOUpValueRelease(_upvals[i]);
+    }
+    free(_upvals);
+}
+
+- (BOOL)isClosure
+{
+    return YES;
+}
+
+- (LOLuaClosure *)checkClosure
+{
+    return self;
+}
+
+- (LOLuaClosure *)optClosure:(LOLuaClosure *)defval
+{
+    return self;
+}
+
+- (NSString *)toNSString
+{
+    return [NSString stringWithFormat:@"function: %@", _p];
+}
+
+- (LOVarargs *)invoke:(LOVarargs *)args
+{
+    return LOLuaClosureCall(self, args, NULL, args.narg);
+}
+
+- (LOLuaValue *)call
+{
+    return [LOLuaClosureCall(self, nil, NULL, 0) arg1];
+}
+
+- (LOLuaValue *)call:(LOLuaValue *)arg
+{
+    return [LOLuaClosureCall(self, nil, (LOLuaValue *__unsafe_unretained[]){arg}, 1) arg1];
+}
+
+- (LOLuaValue *)call:(LOLuaValue *)arg1 arg2:(LOLuaValue *)arg2
+{
+    return [LOLuaClosureCall(self, nil, (LOLuaValue *__unsafe_unretained[]){arg1, arg2}, 2) arg1];
+}
+
+- (LOLuaValue *)call:(LOLuaValue *)arg1 arg2:(LOLuaValue *)arg2 arg3:(LOLuaValue *)arg3
+{
+    return [LOLuaClosureCall(self, nil, (LOLuaValue *__unsafe_unretained[]){arg1, arg2, arg3}, 3) arg1];
+}
+
+- (NSString *)fileLine:(int)pc
+{
+    int line = pc >= 0 && pc < _p->_lineinfoSize ? _p->_lineinfo[pc] : 0;
+    return [NSString stringWithFormat:@"%@:%d", _p.shortSource, line];
+}
+
 @end
@@ -0,0 +1,26 @@
+//
+//  LOLuaDouble.h
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import "LOLuaNumber.h"
+
+/**
+ * Extension of {@link LuaNumber} which can hold a double as its value.
+ * <p>
+ * Almost all API's implemented in {@link LuaDouble} are defined and documented in {@link LuaValue}.
+ * Inside the runtime doubles are immediates, see {@link LOTValue};
+ * instances are only created when a value crosses into the object API.
+ * @see LuaValue
+ * @see LuaNumber
+ * @see LuaInteger
+ */
+@interface LOLuaDouble : LOLuaNumber
+
+@property (nonatomic, assign, readonly) double v;
+
+- (instancetype)initWithDouble:(double)v;
+
+@end
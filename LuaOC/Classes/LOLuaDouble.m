@@ -0,0 +1,97 @@
+//
+//  LOLuaDouble.m
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import "LOLuaDouble.h"
+
+@implementation LOLuaDouble
+
+- (instancetype)initWithDouble:(double)v
+{
+    if (self = [super init]) {
+        _v = v;
+    }
+    return self;
+}
+
+- (BOOL)isInt
+{
+    return _v == (int)_v;
+}
+
+- (BOOL)isLong
+{
+    return _v == (long)_v;
+}
+
+- (BOOL)isValidKey
+{
+    return !isnan(_v);
+}
+
+- (Byte)toByte
+{
+    return (Byte)(long)_v;
+}
+
+- (char)toChar
+{
+    return (char)(long)_v;
+}
+
+- (double)toDouble
+{
+    return _v;
+}
+
+- (float)toFloat
+{
+    return (float)_v;
+}
+
+- (int)toInt
+{
+    return (int)(long)_v;
+}
+
+- (long)toLong
+{
+    return (long)_v;
+}
+
+- (short)toShort
+{
+    return (short)(long)_v;
+}
+
+- (NSString *)toNSString
+{
+    char buffer[LOLuaNumberMaxFormatLength];
+    int n = LOLuaNumberFormat(_v, buffer);
+    return [[NSString alloc] initWithBytes:buffer length:n encoding:NSASCIIStringEncoding];
+}
+
+- (void)appendTo:(LOStringBuilder *)sb
+{
+    LOStringBuilderAppendDouble(sb, _v);
+}
+
+- (NSUInteger)hash
+{
+    long l = (long)_v;
+    if (l == _v)
+        return (NSUInteger)l;
+    uint64_t bits;
+    memcpy(&bits, &_v, sizeof(bits));
+    return (NSUInteger)(bits ^ (bits >> 32));
+}
+
+- (BOOL)isEqual:(id)object
+{
+    return [object isKindOfClass:[LOLuaNumber class]] && [object toDouble] == _v;
+}
+
+@end
@@ -7,10 +7,46 @@
 
 #import <Foundation/Foundation.h>
 
+@class LOLuaValue;
+
+/**
+ * RuntimeException that is thrown and caught in response to a lua error.
+ * <p>
+ * {@link LuaError} is used wherever a lua call to {@code error()}
+ * would be used within a script.
+ * <p>
+ * Errors raised on the non-throwing path are recorded on the running
+ * {@link LOLuaThread} instead, see {@link LOLuaThread#pcall:args:};
+ * one is only turned into a {@link LuaError} when it reaches a caller
+ * that is not protected.
+ * <p>
+ * Raising an error only copies the running thread's activation records,
+ * function and pc per frame; {@link #fileLine} and {@link #traceback} are
+ * formatted from them on first access, so an error that is caught and
+ * dropped never builds any strings.
+ */
 @interface LOLuaError : NSException
 
+/** Level of the call the error is attributed to, 1 being the function that raised it */
 @property (nonatomic, assign) int level;
+/** "chunkname:line" of the call at {@link #level}, nil if that is not a lua function */
 @property (nonatomic, copy) NSString *fileLine;
+/** lua style "stack traceback:" of the captured call stack, nil if none was captured */
 @property (nonatomic, copy) NSString *traceback;
 
+/** The value passed to {@code error()}, or the message as a lua string */
+@property (nonatomic, strong, readonly) LOLuaValue *messageObject;
+
+/**
+ * Construct a LuaError carrying an arbitrary error value.
+ * @param object the error value, its string form becomes the reason
+ */
++ (instancetype)errorWithMessageObject:(LOLuaValue *)object;
+
+/**
+ * Capture the call stack of the running {@link LOLuaThread}, if any.
+ * Called by the raising functions just before the error is thrown.
+ */
+- (void)captureCallStack;
+
 @end
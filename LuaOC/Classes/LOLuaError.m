@@ -7,12 +7,94 @@
 
 #import "LOLuaError.h"
 #import "LOLuaValue.h"
+#import "LOLuaFunction.h"
+#import "LOLuaThread.h"
 
-@interface LOLuaError ()
+/** Frames kept from the top of the stack, as in lua's traceback */
+#define LOLuaErrorMaxFrames 22
+
+@interface LOLuaError () {
+    LOCallInfo *_frames;
+    int _frameCount;
+    BOOL _truncated;
+}
 
 @property (nonatomic, strong) LOLuaValue *object;
 
 @end
 @implementation LOLuaError
 
+@synthesize fileLine = _fileLine;
+@synthesize traceback = _traceback;
+
++ (instancetype)errorWithMessageObject:(LOLuaValue *)object
+{
+    LOLuaError *error = [self exceptionWithName:@"LuaError" reason:object.toNSString userInfo:nil];
+    error.object = object;
+    return error;
+}
+
+- (void)dealloc
+{
+    for (int i = 0; i < _frameCount; i++)
+        LOTValueRelease(_frames[i].function);
+    free(_frames);
+}
+
+- (LOLuaValue *)messageObject
+{
+    return _object ?: [LOLuaValue valueOfString:self.reason ?: @""];
+}
+
+- (void)captureCallStack
+{
+    LOLuaThread *L = LOLuaThreadRunning();
+    if (!L || _frames)
+        return;
+    int n = MIN(L->_callDepth, LOLuaErrorMaxFrames);
+    if (n == 0)
+        return;
+    _frames = malloc(n * sizeof(LOCallInfo));
+    for (int i = 0; i < n; i++) {
+        // innermost first
+        _frames[i] = L->_callInfos[L->_callDepth - 1 - i];
+        LOTValueRetain(_frames[i].function);
+    }
+    _frameCount = n;
+    _truncated = L->_callDepth > n;
+    if (_level == 0)
+        _level = 1;
+}
+
+static NSString *LOLuaErrorFrameFileLine(LOCallInfo *frame)
+{
+    LOLuaValue *function = LOTValueGetObject(frame->function);
+    if (frame->pc < 0 || function.type != LOLuaTypeFunction)
+        return nil;
+    // the saved pc is that of the next instruction
+    return [(LOLuaFunction *)function fileLine:MAX(frame->pc - 1, 0)];
+}
+
+- (NSString *)fileLine
+{
+    if (!_fileLine && _level > 0 && _level <= _frameCount)
+        _fileLine = [LOLuaErrorFrameFileLine(&_frames[_level - 1]) copy];
+    return _fileLine;
+}
+
+- (NSString *)traceback
+{
+    if (!_traceback && _frameCount > 0) {
+        NSMutableString *s = [NSMutableString stringWithString:@"stack traceback:"];
+        for (int i = 0; i < _frameCount; i++) {
+            NSString *fileLine = LOLuaErrorFrameFileLine(&_frames[i]);
+            [s appendFormat:@"\n\t%@: in %@", fileLine ?: @"[C]", LOTValueGetObject(_frames[i].function).toNSString];
+        }
+        if (_truncated)
+            [s appendString:@"\n\t..."];
+        _traceback = [s copy];
+    }
+    return _traceback;
+}
+
 @end
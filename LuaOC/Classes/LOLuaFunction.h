@@ -7,6 +7,54 @@
 
 #import "LOLuaValue.h"
 
+/**
+ * Base class for functions, lua closures and native functions alike.
+ * <p>
+ * As in LuaJ, a function can be called with variable arguments through
+ * {@link #invoke:}, or with up to three arguments through the fixed-arity
+ * {@code call} methods, which return the first result only.  A native
+ * function overrides either {@link #invoke:}, to see all its arguments and
+ * return several results, or just the {@code call} methods of the arities
+ * it takes:
+ * <ul>
+ * <li>{@link #invoke:} of a function that only overrides {@code call}
+ * methods passes the arguments to the one for their number, else the next
+ * larger one with the missing arguments NIL, else the largest one, which
+ * drops the extra arguments</li>
+ * <li>a {@code call} method the function does not override goes to its
+ * {@code call} methods in the same way, or to {@link #invoke:} if it
+ * overrides that, with the arguments pushed on the running thread's stack</li>
+ * </ul>
+ * So calling a native function of one to three arguments, from lua or
+ * through {@code call}, allocates no {@link LOVarargs}.
+ */
 @interface LOLuaFunction : LOLuaValue
 
+/** Call with no arguments.
+ * @return the first result, or {@link #NIL}
+ */
+- (LOLuaValue *)call;
+
+/** Call with one argument.
+ * @return the first result, or {@link #NIL}
+ */
+- (LOLuaValue *)call:(LOLuaValue *)arg;
+
+/** Call with two arguments.
+ * @return the first result, or {@link #NIL}
+ */
+- (LOLuaValue *)call:(LOLuaValue *)arg1 arg2:(LOLuaValue *)arg2;
+
+/** Call with three arguments.
+ * @return the first result, or {@link #NIL}
+ */
+- (LOLuaValue *)call:(LOLuaValue *)arg1 arg2:(LOLuaValue *)arg2 arg3:(LOLuaValue *)arg3;
+
+/**
+ * Source position of an instruction, used when formatting tracebacks.
+ * @param pc index of the instruction being executed
+ * @return "chunkname:line", or nil for functions that do not run lua bytecode
+ */
+- (NSString *)fileLine:(int)pc;
+
 @end
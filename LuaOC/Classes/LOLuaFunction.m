@@ -6,7 +6,161 @@
 //
 
 #import "LOLuaFunction.h"
+#import "LOLuaThread.h"
+#import <objc/runtime.h>
+
+/* bits of _arities: the call methods a class overrides, by number of arguments */
+#define LOFunctionArity(n)      (1 << (n))
+#define LOFunctionFixedArities  0x0f
+/* invoke: is overridden, or nothing is: calls go through invoke: */
+#define LOFunctionVarargs       0x10
+#define LOFunctionResolved      0x80
+
+@interface LOLuaFunction () {
+@public
+    /** what the class overrides, found on the first call */
+    uint8_t _arities;
+}
+@end
+
+static SEL LOFunctionCallSelector(int n)
+{
+    switch (n) {
+        case 0: return @selector(call);
+        case 1: return @selector(call:);
+        case 2: return @selector(call:arg2:);
+        default: return @selector(call:arg2:arg3:);
+    }
+}
+
+static BOOL LOFunctionOverrides(Class cls, SEL sel)
+{
+    return class_getMethodImplementation(cls, sel) != class_getMethodImplementation([LOLuaFunction class], sel);
+}
+
+static int LOFunctionArities(LOLuaFunction *f)
+{
+    if (f->_arities == 0) {
+        Class cls = object_getClass(f);
+        int arities = LOFunctionResolved;
+        for (int n = 0; n <= 3; n++) {
+            if (LOFunctionOverrides(cls, LOFunctionCallSelector(n)))
+                arities |= LOFunctionArity(n);
+        }
+        if (!(arities & LOFunctionFixedArities) || LOFunctionOverrides(cls, @selector(invoke:)))
+            arities |= LOFunctionVarargs;
+        f->_arities = arities;
+    }
+    return f->_arities;
+}
+
+/** The overridden call method for {@code n} arguments: that one, the next larger, else the largest */
+static int LOFunctionNearestArity(int arities, int n)
+{
+    for (int m = n; m <= 3; m++) {
+        if (arities & LOFunctionArity(m))
+            return m;
+    }
+    for (int m = n - 1; m >= 0; m--) {
+        if (arities & LOFunctionArity(m))
+            return m;
+    }
+    return -1;
+}
+
+/**
+ * A call method {@code f} does not override, with {@code n} arguments
+ * in {@code args}: passed on to the nearest one it overrides, or to its
+ * invoke: through the stack of the running thread.
+ */
+static LOLuaValue *LOFunctionCall(LOLuaFunction *f, int n, LOLuaValue *__unsafe_unretained args[3])
+{
+    int arities = LOFunctionArities(f);
+    if (arities & LOFunctionVarargs) {
+        LOTValue values[3];
+        for (int i = 0; i < n; i++)
+            values[i] = LOTValueUnbox(args[i]);
+        LOVarargs *results = [LOLuaThreadCurrent() call:f values:values count:n];
+        return [results arg1] ?: LOLuaValue.NIL;
+    }
+    LOLuaValue *a = args[0] ?: LOLuaValue.NIL, *b = args[1] ?: LOLuaValue.NIL, *c = args[2] ?: LOLuaValue.NIL;
+    switch (LOFunctionNearestArity(arities, n)) {
+        case 0: return [f call];
+        case 1: return [f call:a];
+        case 2: return [f call:a arg2:b];
+        default: return [f call:a arg2:b arg3:c];
+    }
+}
 
 @implementation LOLuaFunction
 
+- (int)type
+{
+    return LOLuaTypeFunction;
+}
+
+- (BOOL)isFunction
+{
+    return YES;
+}
+
+- (LOLuaFunction *)checkFunction
+{
+    return self;
+}
+
+- (LOLuaFunction *)optFunction:(LOLuaFunction *)defval
+{
+    return self;
+}
+
+- (NSString *)toNSString
+{
+    return [NSString stringWithFormat:@"function: %p", self];
+}
+
+- (LOVarargs *)invoke:(LOVarargs *)args
+{
+    int arities = LOFunctionArities(self);
+    if (arities & LOFunctionVarargs)
+        return LOLuaValue.NONE;
+    // the arguments of a native call are a window onto the stack: box the ones passed on
+    int n = MIN(args.narg, 3);
+    int m = LOFunctionNearestArity(arities, n);
+    LOLuaValue *a[3];
+    for (int i = 0; i < m; i++)
+        a[i] = LOTValueBox(i < n ? LOVarargsArgValue(args, i + 1) : LO_NIL);
+    switch (m) {
+        case 0: return [self call];
+        case 1: return [self call:a[0]];
+        case 2: return [self call:a[0] arg2:a[1]];
+        default: return [self call:a[0] arg2:a[1] arg3:a[2]];
+    }
+}
+
+- (LOLuaValue *)call
+{
+    return LOFunctionCall(self, 0, (LOLuaValue *__unsafe_unretained[3]){nil, nil, nil});
+}
+
+- (LOLuaValue *)call:(LOLuaValue *)arg
+{
+    return LOFunctionCall(self, 1, (LOLuaValue *__unsafe_unretained[3]){arg, nil, nil});
+}
+
+- (LOLuaValue *)call:(LOLuaValue *)arg1 arg2:(LOLuaValue *)arg2
+{
+    return LOFunctionCall(self, 2, (LOLuaValue *__unsafe_unretained[3]){arg1, arg2, nil});
+}
+
+- (LOLuaValue *)call:(LOLuaValue *)arg1 arg2:(LOLuaValue *)arg2 arg3:(LOLuaValue *)arg3
+{
+    return LOFunctionCall(self, 3, (LOLuaValue *__unsafe_unretained[3]){arg1, arg2, arg3});
+}
+
+- (NSString *)fileLine:(int)pc
+{
+    return nil;
+}
+
 @end
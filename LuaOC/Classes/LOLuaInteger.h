@@ -7,6 +7,36 @@
 
 #import "LOLuaNumber.h"
 
+/** Smallest and largest value served from the preallocated {@link #valueOf:} cache */
+#define LOLuaIntegerCacheMin  (-256)
+#define LOLuaIntegerCacheMax  1024
+
+/**
+ * Extension of {@link LuaNumber} which can hold a Java int as its value.
+ * <p>
+ * These instance are not instantiated directly by clients, but indirectly
+ * via the static functions {@link #valueOf:} or {@link LuaValue#valueOfInt:}.
+ * Values in [{@link LOLuaIntegerCacheMin}, {@link LOLuaIntegerCacheMax}] are
+ * preallocated and shared, so loop counters and small keys never allocate.
+ * <p>
+ * Inside the runtime ints are immediates, see {@link LOTValue};
+ * instances are only created when a value crosses into the object API.
+ * @see LuaValue
+ * @see LuaNumber
+ * @see LuaDouble
+ */
 @interface LOLuaInteger : LOLuaNumber
 
+@property (nonatomic, assign, readonly) int v;
+
+/**
+ * Return a LuaInteger that represents the value {@code i}, which may be a
+ * shared instance when {@code i} is in the cached range.
+ * @param i int value to box
+ * @return LuaInteger instance, possibly pooled, whose value is i
+ */
++ (LOLuaInteger *)valueOf:(int)i;
+
+- (instancetype)initWithInt:(int)v;
+
 @end
@@ -9,4 +9,112 @@
 
 @implementation LOLuaInteger
 
+static LOLuaInteger *_intValues[LOLuaIntegerCacheMax - LOLuaIntegerCacheMin + 1];
+
++ (void)initialize
+{
+    if (self == [LOLuaInteger class]) {
+        for (int i = LOLuaIntegerCacheMin; i <= LOLuaIntegerCacheMax; i++) {
+            _intValues[i - LOLuaIntegerCacheMin] = [[LOLuaInteger alloc] initWithInt:i];
+        }
+    }
+}
+
++ (LOLuaInteger *)valueOf:(int)i
+{
+    if (i >= LOLuaIntegerCacheMin && i <= LOLuaIntegerCacheMax)
+        return _intValues[i - LOLuaIntegerCacheMin];
+    return [[LOLuaInteger alloc] initWithInt:i];
+}
+
+- (instancetype)initWithInt:(int)v
+{
+    if (self = [super init]) {
+        _v = v;
+    }
+    return self;
+}
+
+- (BOOL)isInt
+{
+    return YES;
+}
+
+- (BOOL)isIntType
+{
+    return YES;
+}
+
+- (BOOL)isLong
+{
+    return YES;
+}
+
+- (Byte)toByte
+{
+    return (Byte)_v;
+}
+
+- (char)toChar
+{
+    return (char)_v;
+}
+
+- (double)toDouble
+{
+    return _v;
+}
+
+- (float)toFloat
+{
+    return _v;
+}
+
+- (int)toInt
+{
+    return _v;
+}
+
+- (long)toLong
+{
+    return _v;
+}
+
+- (short)toShort
+{
+    return (short)_v;
+}
+
+- (NSString *)toNSString
+{
+    char buffer[12];
+    int n = LOLuaNumberFormatInt(_v, buffer);
+    return [[NSString alloc] initWithBytes:buffer length:n encoding:NSASCIIStringEncoding];
+}
+
+- (void)appendTo:(LOStringBuilder *)sb
+{
+    LOStringBuilderAppendInt(sb, _v);
+}
+
+- (LOLuaInteger *)checkInteger
+{
+    return self;
+}
+
+- (LOLuaInteger *)optInteger:(LOLuaInteger *)defval
+{
+    return self;
+}
+
+- (NSUInteger)hash
+{
+    return (NSUInteger)_v;
+}
+
+- (BOOL)isEqual:(id)object
+{
+    return [object isKindOfClass:[LOLuaNumber class]] && [object toDouble] == _v;
+}
+
 @end
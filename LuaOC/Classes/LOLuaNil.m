@@ -19,4 +19,109 @@ static LOLuaNil *_defaultNil = nil;
     return _defaultNil;
 }
 
+- (int)type
+{
+    return LOLuaTypeNil;
+}
+
+- (BOOL)isNil
+{
+    return YES;
+}
+
+- (BOOL)toBoolean
+{
+    return NO;
+}
+
+- (NSString *)toNSString
+{
+    return @"nil";
+}
+
+- (BOOL)isValidKey
+{
+    return NO;
+}
+
+- (LOLuaValue *)checkNotNil
+{
+    return [self argError:@"value"];
+}
+
+- (BOOL)optBoolean:(BOOL)defval
+{
+    return defval;
+}
+
+- (LOLuaClosure *)optClosure:(LOLuaClosure *)defval
+{
+    return defval;
+}
+
+- (double)optDouble:(double)defval
+{
+    return defval;
+}
+
+- (LOLuaFunction *)optFunction:(LOLuaFunction *)defval
+{
+    return defval;
+}
+
+- (int)optInt:(int)defval
+{
+    return defval;
+}
+
+- (LOLuaInteger *)optInteger:(LOLuaInteger *)defval
+{
+    return defval;
+}
+
+- (long)optLong:(long)defval
+{
+    return defval;
+}
+
+- (LOLuaNumber *)optNumber:(LOLuaNumber *)defval
+{
+    return defval;
+}
+
+- (NSString *)optNSString:(NSString *)defval
+{
+    return defval;
+}
+
+- (LOLuaString *)optString:(LOLuaString *)defval
+{
+    return defval;
+}
+
+- (LOLuaTable *)optTable:(LOLuaTable *)defval
+{
+    return defval;
+}
+
+- (LOLuaThread *)optThread:(LOLuaThread *)defval
+{
+    return defval;
+}
+
+- (id)optUserData:(id)defval
+{
+    return defval;
+}
+
+- (id)optUserData:(Class)c defval:(id)defval
+{
+    return defval;
+}
+
+- (LOLuaValue *)optValue:(LOLuaValue *)defval
+{
+    return defval;
+}
+
 @end
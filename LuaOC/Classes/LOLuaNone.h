@@ -0,0 +1,22 @@
+//
+//  LOLuaNone.h
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import "LOLuaNil.h"
+
+/**
+ * Varargs instance with no values, {@link LuaValue#NONE}.
+ * <p>
+ * There is one instance of this class.  It is a nil for all value
+ * purposes, but reports zero arguments, so it can be returned from
+ * calls that produce no values without allocating.
+ * @see LuaValue#NONE
+ */
+@interface LOLuaNone : LOLuaNil
+
++ (instancetype)defaultNone;
+
+@end
@@ -0,0 +1,52 @@
+//
+//  LOLuaNone.m
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import "LOLuaNone.h"
+
+@implementation LOLuaNone
+
++ (instancetype)defaultNone
+{
+    static LOLuaNone *_defaultNone = nil;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        _defaultNone = [[LOLuaNone alloc] init];
+    });
+    return _defaultNone;
+}
+
+- (LOLuaValue *)arg:(int)i
+{
+    return LOLuaValue.NIL;
+}
+
+- (LOTValue)argValue:(int)i
+{
+    return LO_NIL;
+}
+
+- (int)narg
+{
+    return 0;
+}
+
+- (LOLuaValue *)arg1
+{
+    return LOLuaValue.NIL;
+}
+
+- (NSString *)toNSString
+{
+    return @"none";
+}
+
+- (LOVarargs *)subArgs:(int)start
+{
+    return start > 0 ? self : [LOLuaValue argError:1 msg:@"start must be > 0"];
+}
+
+@end
@@ -7,6 +7,48 @@
 
 #import "LOLuaValue.h"
 
+/** Room needed by {@link LOLuaNumberFormat}, enough for any double */
+#define LOLuaNumberMaxFormatLength 32
+
+/**
+ * Base class for representing numbers as lua values directly.
+ * <p>
+ * Conversion between numbers and strings does not go through the C library
+ * or Foundation, which are slow and follow the current locale:
+ * {@link LOLuaNumberFormat} writes the shortest digits that read back as
+ * the same double, and {@link LOLuaNumberParse} reads lua numerals by hand.
+ * @see LOLuaInteger
+ * @see LOLuaDouble
+ */
 @interface LOLuaNumber : LOLuaValue
 
 @end
+
+/**
+ * Format a double the way {@code tostring} does: the shortest digits that
+ * read back as the same double (Grisu2), in plain notation for magnitudes
+ * from 1e-4 up to 1e21 and in scientific notation otherwise, and
+ * {@code "nan"}, {@code "inf"}, {@code "-inf"} for the special values.
+ * Integral values print without a fraction.
+ * @param buffer receives the characters, at least {@link LOLuaNumberMaxFormatLength} bytes, not NUL terminated
+ * @return number of characters written
+ */
+FOUNDATION_EXTERN int LOLuaNumberFormat(double d, char *buffer);
+
+/**
+ * Format an int in decimal.
+ * @param buffer receives the characters, at least 12 bytes, not NUL terminated
+ * @return number of characters written
+ */
+FOUNDATION_EXTERN int LOLuaNumberFormatInt(int i, char *buffer);
+
+/**
+ * Convert a lua numeral to a number, as lua's string coercion does:
+ * an optional sign, decimal digits with an optional fraction and exponent or
+ * hexadecimal digits with an optional fraction and binary exponent,
+ * surrounded by optional whitespace.  A numeral without fraction or exponent
+ * that fits in an int becomes an int without any floating point arithmetic.
+ * @param result receives the number, an int or double {@link LOTValue}
+ * @return NO if the bytes are not a numeral
+ */
+FOUNDATION_EXTERN BOOL LOLuaNumberParse(const unsigned char *s, int length, LOTValue *result);
@@ -6,7 +6,486 @@
 //
 
 #import "LOLuaNumber.h"
+#import <xlocale.h>
+
+#pragma mark - formatting
+
+/** Normalized powers of ten 10^-348, 10^-340, ..., 10^340 as 64 bit significands */
+static const uint64_t LONumberCachedPowersF[] = {
+    0xfa8fd5a0081c0288ULL, 0xbaaee17fa23ebf76ULL, 0x8b16fb203055ac76ULL,
+    0xcf42894a5dce35eaULL, 0x9a6bb0aa55653b2dULL, 0xe61acf033d1a45dfULL,
+    0xab70fe17c79ac6caULL, 0xff77b1fcbebcdc4fULL, 0xbe5691ef416bd60cULL,
+    0x8dd01fad907ffc3cULL, 0xd3515c2831559a83ULL, 0x9d71ac8fada6c9b5ULL,
+    0xea9c227723ee8bcbULL, 0xaecc49914078536dULL, 0x823c12795db6ce57ULL,
+    0xc21094364dfb5637ULL, 0x9096ea6f3848984fULL, 0xd77485cb25823ac7ULL,
+    0xa086cfcd97bf97f4ULL, 0xef340a98172aace5ULL, 0xb23867fb2a35b28eULL,
+    0x84c8d4dfd2c63f3bULL, 0xc5dd44271ad3cdbaULL, 0x936b9fcebb25c996ULL,
+    0xdbac6c247d62a584ULL, 0xa3ab66580d5fdaf6ULL, 0xf3e2f893dec3f126ULL,
+    0xb5b5ada8aaff80b8ULL, 0x87625f056c7c4a8bULL, 0xc9bcff6034c13053ULL,
+    0x964e858c91ba2655ULL, 0xdff9772470297ebdULL, 0xa6dfbd9fb8e5b88fULL,
+    0xf8a95fcf88747d94ULL, 0xb94470938fa89bcfULL, 0x8a08f0f8bf0f156bULL,
+    0xcdb02555653131b6ULL, 0x993fe2c6d07b7facULL, 0xe45c10c42a2b3b06ULL,
+    0xaa242499697392d3ULL, 0xfd87b5f28300ca0eULL, 0xbce5086492111aebULL,
+    0x8cbccc096f5088ccULL, 0xd1b71758e219652cULL, 0x9c40000000000000ULL,
+    0xe8d4a51000000000ULL, 0xad78ebc5ac620000ULL, 0x813f3978f8940984ULL,
+    0xc097ce7bc90715b3ULL, 0x8f7e32ce7bea5c70ULL, 0xd5d238a4abe98068ULL,
+    0x9f4f2726179a2245ULL, 0xed63a231d4c4fb27ULL, 0xb0de65388cc8ada8ULL,
+    0x83c7088e1aab65dbULL, 0xc45d1df942711d9aULL, 0x924d692ca61be758ULL,
+    0xda01ee641a708deaULL, 0xa26da3999aef774aULL, 0xf209787bb47d6b85ULL,
+    0xb454e4a179dd1877ULL, 0x865b86925b9bc5c2ULL, 0xc83553c5c8965d3dULL,
+    0x952ab45cfa97a0b3ULL, 0xde469fbd99a05fe3ULL, 0xa59bc234db398c25ULL,
+    0xf6c69a72a3989f5cULL, 0xb7dcbf5354e9beceULL, 0x88fcf317f22241e2ULL,
+    0xcc20ce9bd35c78a5ULL, 0x98165af37b2153dfULL, 0xe2a0b5dc971f303aULL,
+    0xa8d9d1535ce3b396ULL, 0xfb9b7cd9a4a7443cULL, 0xbb764c4ca7a44410ULL,
+    0x8bab8eefb6409c1aULL, 0xd01fef10a657842cULL, 0x9b10a4e5e9913129ULL,
+    0xe7109bfba19c0c9dULL, 0xac2820d9623bf429ULL, 0x80444b5e7aa7cf85ULL,
+    0xbf21e44003acdd2dULL, 0x8e679c2f5e44ff8fULL, 0xd433179d9c8cb841ULL,
+    0x9e19db92b4e31ba9ULL, 0xeb96bf6ebadf77d9ULL, 0xaf87023b9bf0ee6bULL,
+};
+
+/** Binary exponents of {@code LONumberCachedPowersF} */
+static const int16_t LONumberCachedPowersE[] = {
+    -1220, -1193, -1166, -1140, -1113, -1087, -1060, -1034, -1007, -980, -954, -927,
+    -901, -874, -847, -821, -794, -768, -741, -715, -688, -661, -635, -608,
+    -582, -555, -529, -502, -475, -449, -422, -396, -369, -343, -316, -289,
+    -263, -236, -210, -183, -157, -130, -103, -77, -50, -24, 3, 30,
+    56, 83, 109, 136, 162, 189, 216, 242, 269, 295, 322, 348,
+    375, 402, 428, 455, 481, 508, 534, 561, 588, 614, 641, 667,
+    694, 720, 747, 774, 800, 827, 853, 880, 907, 933, 960, 986,
+    1013, 1039, 1066,
+};
+
+/** A "do it yourself" floating point number f * 2^e with a 64 bit significand */
+typedef struct LODiyFp {
+    uint64_t f;
+    int e;
+} LODiyFp;
+
+static inline LODiyFp LODiyFpMake(uint64_t f, int e)
+{
+    return (LODiyFp){ f, e };
+}
+
+/** Product rounded to the upper 64 bits */
+static inline LODiyFp LODiyFpMultiply(LODiyFp a, LODiyFp b)
+{
+    unsigned __int128 p = (unsigned __int128)a.f * b.f;
+    uint64_t h = (uint64_t)(p >> 64);
+    if ((uint64_t)p & (1ULL << 63))
+        h++;
+    return LODiyFpMake(h, a.e + b.e + 64);
+}
+
+static inline LODiyFp LODiyFpNormalize(LODiyFp v)
+{
+    int s = __builtin_clzll(v.f);
+    return LODiyFpMake(v.f << s, v.e - s);
+}
+
+#define LO_DP_SIGNIFICAND_MASK  0x000FFFFFFFFFFFFFULL
+#define LO_DP_HIDDEN_BIT        0x0010000000000000ULL
+#define LO_DP_EXPONENT_BIAS     1075
+
+/**
+ * Grisu2 by Florian Loitsch: the digits of a positive finite double, at
+ * most 17, such that reading them back gives the double again.  For nearly
+ * all doubles they are also the shortest such digits.
+ * @return number of digits written to {@code buffer}; {@code *K} receives
+ * the decimal exponent, the value being digits * 10^K
+ */
+static int LONumberGrisu2(double value, char *buffer, int *K)
+{
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    int biased = (int)((bits >> 52) & 0x7FF);
+    uint64_t significand = bits & LO_DP_SIGNIFICAND_MASK;
+    LODiyFp v = biased ? LODiyFpMake(significand + LO_DP_HIDDEN_BIT, biased - LO_DP_EXPONENT_BIAS)
+                       : LODiyFpMake(significand, 1 - LO_DP_EXPONENT_BIAS);
+
+    // boundaries halfway to the neighbouring doubles
+    LODiyFp plus = LODiyFpMake((v.f << 1) + 1, v.e - 1);
+    while (!(plus.f & (LO_DP_HIDDEN_BIT << 1))) {
+        plus.f <<= 1;
+        plus.e--;
+    }
+    plus.f <<= 64 - 52 - 2;
+    plus.e -= 64 - 52 - 2;
+    LODiyFp minus = v.f == LO_DP_HIDDEN_BIT ? LODiyFpMake((v.f << 2) - 1, v.e - 2)
+                                            : LODiyFpMake((v.f << 1) - 1, v.e - 1);
+    minus.f <<= minus.e - plus.e;
+    minus.e = plus.e;
+
+    // a cached power that brings the upper boundary into [2^-60, 2^-32) times 2^64
+    double dk = (-61 - plus.e) * 0.30102999566398114 + 347;
+    int k = (int)dk;
+    if (dk - k > 0.0)
+        k++;
+    int index = (k >> 3) + 1;
+    *K = -(-348 + index * 8);
+    LODiyFp c = LODiyFpMake(LONumberCachedPowersF[index], LONumberCachedPowersE[index]);
+
+    LODiyFp W = LODiyFpMultiply(LODiyFpNormalize(v), c);
+    LODiyFp Wp = LODiyFpMultiply(plus, c);
+    LODiyFp Wm = LODiyFpMultiply(minus, c);
+    Wm.f++;
+    Wp.f--;
+
+    static const uint64_t pow10[] = {
+        1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL, 100000000ULL,
+        1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+        100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL, 100000000000000000ULL,
+        1000000000000000000ULL, 10000000000000000000ULL,
+    };
+    uint64_t delta = Wp.f - Wm.f;
+    LODiyFp one = LODiyFpMake(1ULL << -Wp.e, Wp.e);
+    uint64_t wp_w = Wp.f - W.f;
+    uint32_t p1 = (uint32_t)(Wp.f >> -one.e);
+    uint64_t p2 = Wp.f & (one.f - 1);
+    int kappa = 1;
+    while (kappa < 10 && p1 >= pow10[kappa])
+        kappa++;
+    int len = 0;
+    uint64_t rest, tenKappa;
+    for (;;) {
+        if (kappa > 0) {
+            // integral part of the scaled upper boundary
+            uint32_t d = p1 / (uint32_t)pow10[kappa - 1];
+            p1 %= (uint32_t)pow10[kappa - 1];
+            if (d || len)
+                buffer[len++] = (char)('0' + d);
+            kappa--;
+            rest = ((uint64_t)p1 << -one.e) + p2;
+            if (rest <= delta) {
+                tenKappa = pow10[kappa] << -one.e;
+                break;
+            }
+        } else {
+            // fractional part
+            p2 *= 10;
+            delta *= 10;
+            char d = (char)(p2 >> -one.e);
+            if (d || len)
+                buffer[len++] = (char)('0' + d);
+            p2 &= one.f - 1;
+            kappa--;
+            if (p2 < delta) {
+                rest = p2;
+                tenKappa = one.f;
+                wp_w *= -kappa < 20 ? pow10[-kappa] : 0;
+                break;
+            }
+        }
+    }
+    *K += kappa;
+
+    // move the last digit towards the value while staying within the boundaries
+    while (rest < wp_w && delta - rest >= tenKappa
+           && (rest + tenKappa < wp_w || wp_w - rest > rest + tenKappa - wp_w)) {
+        buffer[len - 1]--;
+        rest += tenKappa;
+    }
+    return len;
+}
+
+int LOLuaNumberFormat(double d, char *buffer)
+{
+    char *p = buffer;
+    if (d != d)
+        return (int)(stpcpy(buffer, "nan") - buffer);
+    if (signbit(d)) {
+        *p++ = '-';
+        d = -d;
+    }
+    if (isinf(d))
+        return (int)(stpcpy(p, "inf") - buffer);
+    if (d == 0) {
+        *p++ = '0';
+        return (int)(p - buffer);
+    }
+
+    char digits[20];
+    int K;
+    int n = LONumberGrisu2(d, digits, &K);
+    // the value is 0.d1d2...dn * 10^exponent
+    int exponent = n + K;
+    if (exponent > 0 && exponent <= 21) {
+        if (K >= 0) {
+            // integral: the digits and trailing zeros
+            memcpy(p, digits, n);
+            memset(p + n, '0', K);
+            p += n + K;
+        } else {
+            memcpy(p, digits, exponent);
+            p += exponent;
+            *p++ = '.';
+            memcpy(p, digits + exponent, n - exponent);
+            p += n - exponent;
+        }
+    } else if (exponent <= 0 && exponent > -4) {
+        *p++ = '0';
+        *p++ = '.';
+        memset(p, '0', -exponent);
+        p += -exponent;
+        memcpy(p, digits, n);
+        p += n;
+    } else {
+        // scientific, with at least two exponent digits as printf's %g has
+        *p++ = digits[0];
+        if (n > 1) {
+            *p++ = '.';
+            memcpy(p, digits + 1, n - 1);
+            p += n - 1;
+        }
+        int e = exponent - 1;
+        *p++ = 'e';
+        *p++ = e < 0 ? '-' : '+';
+        if (e < 0)
+            e = -e;
+        if (e >= 100) {
+            *p++ = (char)('0' + e / 100);
+            e %= 100;
+        }
+        *p++ = (char)('0' + e / 10);
+        *p++ = (char)('0' + e % 10);
+    }
+    return (int)(p - buffer);
+}
+
+#pragma mark - parsing
+
+static inline BOOL LONumberIsSpace(unsigned char c)
+{
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+static inline int LONumberHexDigit(unsigned char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    c |= 0x20;
+    return c >= 'a' && c <= 'f' ? c - 'a' + 10 : -1;
+}
+
+/** Powers of ten that a double represents exactly */
+static const double LONumberExactPowers[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+};
+
+/** Slow path for decimal numerals with many digits or a large exponent: strtod in the C locale */
+static double LONumberStrtod(const unsigned char *s, const unsigned char *end)
+{
+    static locale_t cLocale;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        cLocale = newlocale(LC_ALL_MASK, "C", (locale_t)0);
+    });
+    size_t n = end - s;
+    char small[64];
+    char *buf = n < sizeof(small) ? small : malloc(n + 1);
+    memcpy(buf, s, n);
+    buf[n] = 0;
+    double d = strtod_l(buf, NULL, cLocale);
+    if (buf != small)
+        free(buf);
+    return d;
+}
+
+/** Read the decimal exponent digits after 'e' or 'p' and a sign, saturating */
+static const unsigned char *LONumberReadExponent(const unsigned char *p, const unsigned char *end, int *exponent)
+{
+    BOOL negative = NO;
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = *p++ == '-';
+    if (p == end || *p < '0' || *p > '9')
+        return NULL;
+    int e = 0;
+    for (; p < end && *p >= '0' && *p <= '9'; p++)
+        if (e < 100000)
+            e = e * 10 + (*p - '0');
+    *exponent += negative ? -e : e;
+    return p;
+}
+
+BOOL LOLuaNumberParse(const unsigned char *s, int length, LOTValue *result)
+{
+    const unsigned char *p = s, *end = s + length;
+    while (p < end && LONumberIsSpace(*p))
+        p++;
+    BOOL negative = NO;
+    if (p < end && (*p == '-' || *p == '+'))
+        negative = *p++ == '-';
+
+    double d;
+    BOOL integral = YES;
+    uint64_t mantissa = 0;
+    int exponent = 0, digits = 0;
+    if (end - p >= 2 && p[0] == '0' && (p[1] | 0x20) == 'x') {
+        // hexadecimal, with an optional fraction and binary exponent as lua_strx2number reads it
+        p += 2;
+        int h;
+        for (; p < end && (h = LONumberHexDigit(*p)) >= 0; p++, digits++) {
+            if (mantissa >> 60)
+                exponent += 4;  // the digit is below the precision of a double
+            else
+                mantissa = (mantissa << 4) | h;
+        }
+        if (p < end && *p == '.') {
+            for (p++; p < end && (h = LONumberHexDigit(*p)) >= 0; p++, digits++) {
+                if (!(mantissa >> 60)) {
+                    mantissa = (mantissa << 4) | h;
+                    exponent -= 4;
+                }
+            }
+        }
+        if (digits == 0)
+            return NO;
+        if (p < end && (*p | 0x20) == 'p' && !(p = LONumberReadExponent(p + 1, end, &exponent)))
+            return NO;
+        d = ldexp((double)mantissa, exponent);
+    } else {
+        // decimal, with up to 19 significant digits kept in an integer
+        const unsigned char *first = p;
+        for (; p < end && *p >= '0' && *p <= '9'; p++, digits++) {
+            if (mantissa < 1000000000000000000ULL)
+                mantissa = mantissa * 10 + (*p - '0');
+            else
+                exponent++;
+        }
+        if (p < end && *p == '.') {
+            integral = NO;
+            for (p++; p < end && *p >= '0' && *p <= '9'; p++, digits++) {
+                if (mantissa < 1000000000000000000ULL) {
+                    mantissa = mantissa * 10 + (*p - '0');
+                    exponent--;
+                }
+            }
+        }
+        if (digits == 0)
+            return NO;
+        if (p < end && (*p | 0x20) == 'e') {
+            integral = NO;
+            if (!(p = LONumberReadExponent(p + 1, end, &exponent)))
+                return NO;
+        }
+        if (integral && exponent == 0 && mantissa <= (uint64_t)INT_MAX + negative && !(negative && mantissa == 0)) {
+            // a plain integer needs no floating point at all
+            const unsigned char *q = p;
+            while (q < end && LONumberIsSpace(*q))
+                q++;
+            if (q != end)
+                return NO;
+            *result = LOTValueFromInt(negative ? (int)(0 - mantissa) : (int)mantissa);
+            return YES;
+        }
+        if (mantissa == 0)
+            d = 0;
+        else if (mantissa <= (1ULL << 53) && exponent >= -22 && exponent <= 22)
+            // both operands are exact, so the single rounding is the correct one
+            d = exponent >= 0 ? (double)mantissa * LONumberExactPowers[exponent]
+                              : (double)mantissa / LONumberExactPowers[-exponent];
+        else
+            d = LONumberStrtod(first, p);
+    }
+    while (p < end && LONumberIsSpace(*p))
+        p++;
+    if (p != end)
+        return NO;
+    *result = LOTValueFromNumber(negative ? -d : d);
+    return YES;
+}
+
+int LOLuaNumberFormatInt(int i, char *buffer)
+{
+    char digits[12];
+    char *p = digits + sizeof(digits);
+    unsigned u = i < 0 ? 0u - (unsigned)i : (unsigned)i;
+    do {
+        *--p = (char)('0' + u % 10);
+        u /= 10;
+    } while (u);
+    if (i < 0)
+        *--p = '-';
+    int n = (int)(digits + sizeof(digits) - p);
+    memcpy(buffer, p, n);
+    return n;
+}
 
 @implementation LOLuaNumber
 
+- (int)type
+{
+    return LOLuaTypeNumber;
+}
+
+- (BOOL)isNumber
+{
+    return YES;
+}
+
+- (BOOL)isString
+{
+    return YES;
+}
+
+- (LOLuaNumber *)toNumber
+{
+    return self;
+}
+
+- (double)optDouble:(double)defval
+{
+    return self.toDouble;
+}
+
+- (int)optInt:(int)defval
+{
+    return self.toInt;
+}
+
+- (long)optLong:(long)defval
+{
+    return self.toLong;
+}
+
+- (LOLuaNumber *)optNumber:(LOLuaNumber *)defval
+{
+    return self;
+}
+
+- (NSString *)optNSString:(NSString *)defval
+{
+    return self.toNSString;
+}
+
+- (double)checkDouble
+{
+    return self.toDouble;
+}
+
+- (int)checkInt
+{
+    return self.toInt;
+}
+
+- (long)checkLong
+{
+    return self.toLong;
+}
+
+- (LOLuaNumber *)checkNumber
+{
+    return self;
+}
+
+- (LOLuaNumber *)checkNumber:(NSString *)msg
+{
+    return self;
+}
+
+- (NSString *)checkNSString
+{
+    return self.toNSString;
+}
+
 @end
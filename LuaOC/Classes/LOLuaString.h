@@ -7,6 +7,155 @@
 
 #import "LOLuaValue.h"
 
-@interface LOLuaString : LOLuaValue
+/** Strings up to this many bytes are interned, see {@link LOLuaString#valueOf:} */
+#define LOLuaStringMaxShortLength 40
+
+/** Concatenations of at least this many bytes build a rope instead of copying */
+#define LOLuaStringMinRopeLength 128
+
+/**
+ * Subclass of {@link LuaValue} for representing lua strings.
+ * <p>
+ * Because lua string values are more nearly sequences of bytes than
+ * sequences of characters or unicode code points, the {@link LuaString}
+ * implementation holds the string value in an internal byte array.
+ * <p>
+ * Short strings (up to {@link LOLuaStringMaxShortLength} bytes) are interned
+ * in a process wide, thread-safe table keyed by their bytes, so equal short
+ * strings are always the same instance and compare by pointer.
+ * The hash of a short string is computed when it is interned; a long string
+ * computes its hash the first time it is used as a table key, and keeps it.
+ * <p>
+ * The strings are never transcoded for lua operations: concatenation,
+ * comparison and hashing work on the bytes.  {@link #toNSString} returns an
+ * {@link NSString} reading the bytes in place, which only decodes them into
+ * UTF-16 if asked for characters of a string that is not all ASCII.
+ * {@link #valueOf:} given such a string returns the original lua string.
+ * <p>
+ * A long substring is a view: it references the bytes of the string it was
+ * cut from, and keeps that string alive, instead of copying them.
+ * A long concatenation is a rope: it references its two halves and has no
+ * bytes of its own until something needs them contiguously (hashing,
+ * comparison, conversion), when the whole tree is flattened into one buffer
+ * at once.  Appending to a long string in a loop thus costs time proportional
+ * to the appended piece, and the final string is copied once; short pieces
+ * are gathered into leaves of up to {@link LOLuaStringMinRopeLength} bytes,
+ * so such a rope holds one node per leaf rather than per piece.  Use
+ * {@link LOLuaStringBytes} rather than {@code _bytes} to read the bytes.
+ * <p>
+ * Constructors are not exposed; use {@link #valueOf:} or {@link #valueOfBytes:length:}.
+ * @see LuaValue
+ * @see LuaValue#valueOf(String)
+ */
+@interface LOLuaString : LOLuaValue {
+@public
+    const unsigned char *_bytes;
+    int _length;
+    /** hash of the bytes, 0 until computed, see {@link LOLuaStringHash} */
+    NSUInteger _hashCode;
+    BOOL _interned;
+    /** halves of a rope, nil once flattened or for a flat string */
+    LOLuaString *_left;
+    LOLuaString *_right;
+}
+
+/** The number of bytes in the string */
+@property (nonatomic, assign, readonly) int length;
+
+/**
+ * Get a {@link LuaString} instance whose bytes match the UTF-8 encoding of {@code string}.
+ * @param string NSString containing characters to encode as UTF-8
+ * @return {@link LuaString} with UTF-8 bytes corresponding to the supplied String
+ */
++ (LOLuaString *)valueOf:(NSString *)string;
+
+/**
+ * Get a {@link LuaString} instance whose bytes are a copy of {@code bytes}.
+ * Short strings are looked up in the intern table first.
+ * @param bytes byte buffer, need not be NUL terminated
+ * @param length number of bytes to use from {@code bytes}
+ * @return {@link LuaString} wrapping a copy of the byte buffer
+ */
++ (LOLuaString *)valueOfBytes:(const void *)bytes length:(int)length;
+
+/**
+ * Get a {@link LuaString} instance that uses {@code bytes} in place, without copying.
+ * <p>
+ * A long string keeps a strong reference to {@code owner}, which must keep the
+ * bytes alive and unchanged, e.g. the memory mapped {@link NSData} of a chunk.
+ * Short strings are still interned, so an existing equal string is returned
+ * if there is one, and are copied, so they never keep {@code owner} alive.
+ * @param bytes byte buffer, need not be NUL terminated
+ * @param length number of bytes to use from {@code bytes}
+ * @param owner object owning the buffer
+ * @return {@link LuaString} referencing the byte buffer
+ */
++ (LOLuaString *)valueOfBytesNoCopy:(const void *)bytes length:(int)length owner:(id)owner;
+
+/**
+ * Take a substring using java zero-based indexes for begin and end or range.
+ * A long result is a view on the bytes of this string, a short one is a copy.
+ * @param beginIndex the zero-based index of the first character to include
+ * @param endIndex the zero-based index of one past the last character to include
+ * @return {@link LuaString} that is a substring of this
+ */
+- (LOLuaString *)substring:(int)beginIndex end:(int)endIndex;
 
 @end
+
+/**
+ * Convert a string to a number the way lua's arithmetic coercion does:
+ * decimal or hexadecimal, surrounded by optional whitespace.
+ * @return NO if the string is not a numeral
+ * @see LOLuaNumberParse
+ */
+FOUNDATION_EXTERN BOOL LOLuaStringToNumber(LOLuaString *s, double *result);
+
+/**
+ * Get a {@link LuaString} instance for a malloc'ed buffer of {@code length}
+ * bytes, taking ownership of it instead of copying.  The buffer must have
+ * room for a terminating NUL after the bytes.  It is freed at once if an
+ * equal short string is already interned.
+ */
+FOUNDATION_EXTERN LOLuaString *LOLuaStringNewWithOwnedBytes(unsigned char *bytes, int length);
+
+/**
+ * Concatenation of two strings: a rope when the result has at least
+ * {@link LOLuaStringMinRopeLength} bytes, otherwise a flat copy.  A short
+ * {@code b} after a rope whose right leaf is short is merged into that leaf.
+ */
+FOUNDATION_EXTERN LOLuaString *LOLuaStringConcat(LOLuaString *a, LOLuaString *b);
+
+FOUNDATION_EXTERN const unsigned char *LOLuaStringFlatten(LOLuaString *s);
+
+/** The bytes of {@code s}, flattening it first if it is a rope */
+static inline const unsigned char *LOLuaStringBytes(LOLuaString *s)
+{
+    return s->_bytes ?: LOLuaStringFlatten(s);
+}
+
+/** Hash of a byte buffer as used for lua strings and table lookup */
+FOUNDATION_EXTERN NSUInteger LOLuaStringHashBytes(const unsigned char *bytes, int length);
+
+FOUNDATION_EXTERN NSUInteger LOLuaStringComputeHash(LOLuaString *s);
+
+/** Hash of {@code s}, computed on first use */
+static inline NSUInteger LOLuaStringHash(LOLuaString *s)
+{
+    return s->_hashCode ?: LOLuaStringComputeHash(s);
+}
+
+/** Lua string equality: a pointer compare when both are interned, otherwise a byte compare */
+static inline BOOL LOLuaStringEquals(LOLuaString *a, LOLuaString *b)
+{
+    if (a == b)
+        return YES;
+    if (a->_interned && b->_interned)
+        return NO;
+    if (a->_length != b->_length)
+        return NO;
+    // only hashes that are known already are worth comparing
+    if (a->_hashCode && b->_hashCode && a->_hashCode != b->_hashCode)
+        return NO;
+    return memcmp(LOLuaStringBytes(a), LOLuaStringBytes(b), a->_length) == 0;
+}
@@ -6,7 +6,438 @@
 //
 
 #import "LOLuaString.h"
+#import "LOLuaNumber.h"
+#import <pthread.h>
+
+/** Long strings hash at most 2^LOLuaStringHashLimit sampled bytes, as lua does */
+#define LOLuaStringHashLimit 5
+
+NSUInteger LOLuaStringHashBytes(const unsigned char *bytes, int length)
+{
+    NSUInteger h = (NSUInteger)length;
+    int step = (length >> LOLuaStringHashLimit) + 1;
+    for (int l1 = length; l1 >= step; l1 -= step) {
+        h = h ^ ((h << 5) + (h >> 2) + bytes[l1 - 1]);
+    }
+    return h;
+}
+
+BOOL LOLuaStringToNumber(LOLuaString *s, double *result)
+{
+    LOTValue v;
+    if (!LOLuaNumberParse(LOLuaStringBytes(s), s->_length, &v))
+        return NO;
+    *result = LOTValueToDouble(v);
+    return YES;
+}
+
+NSUInteger LOLuaStringComputeHash(LOLuaString *s)
+{
+    // racing threads store the same value
+    return s->_hashCode = LOLuaStringHashBytes(LOLuaStringBytes(s), s->_length);
+}
+
+@interface LOLuaString ()
+
+@property (nonatomic, assign) BOOL ownsBytes;
+@property (nonatomic, strong) id owner;
+
++ (LOLuaString *)valueOfBytes:(const void *)bytes length:(int)length owner:(id)owner;
+
+@end
+
+/**
+ * Immutable {@link NSString} over the bytes of a {@link LOLuaString}.
+ * <p>
+ * Pure ASCII strings, by far the common case for identifiers, keys and
+ * messages, are served from the bytes directly: one byte is one UTF-16
+ * unit.  Anything else is decoded on the first request for characters,
+ * as UTF-8 or, failing that, as Latin-1 the way {@code toNSString} always did.
+ */
+@interface LOLuaStringBridge : NSString {
+@public
+    LOLuaString *_string;
+    BOOL _ascii;
+}
+
+@property (atomic, strong) NSString *decoded;
+
+- (instancetype)initWithLuaString:(LOLuaString *)string;
+
+@end
+
+@implementation LOLuaStringBridge
+
+- (instancetype)initWithLuaString:(LOLuaString *)string
+{
+    if (self = [super init]) {
+        const unsigned char *bytes = LOLuaStringBytes(string);
+        _string = string;
+        _ascii = YES;
+        for (int i = 0; i < string->_length; i++) {
+            if (bytes[i] & 0x80) {
+                _ascii = NO;
+                break;
+            }
+        }
+    }
+    return self;
+}
+
+- (NSString *)decodedString
+{
+    NSString *s = self.decoded;
+    if (s == nil) {
+        s = [[NSString alloc] initWithBytes:_string->_bytes length:_string->_length encoding:NSUTF8StringEncoding]
+            ?: [[NSString alloc] initWithBytes:_string->_bytes length:_string->_length encoding:NSISOLatin1StringEncoding];
+        self.decoded = s;
+    }
+    return s;
+}
+
+/** Whether the UTF-8 encoding of this string is exactly the bytes of the lua string */
+- (BOOL)isUTF8
+{
+    return _ascii || [self.decodedString lengthOfBytesUsingEncoding:NSUTF8StringEncoding] == (NSUInteger)_string->_length;
+}
+
+- (NSUInteger)length
+{
+    return _ascii ? (NSUInteger)_string->_length : self.decodedString.length;
+}
+
+- (unichar)characterAtIndex:(NSUInteger)index
+{
+    if (!_ascii)
+        return [self.decodedString characterAtIndex:index];
+    if (index >= (NSUInteger)_string->_length)
+        [NSException raise:NSRangeException format:@"index %lu beyond bounds", (unsigned long)index];
+    return _string->_bytes[index];
+}
+
+- (void)getCharacters:(unichar *)buffer range:(NSRange)range
+{
+    if (!_ascii) {
+        [self.decodedString getCharacters:buffer range:range];
+        return;
+    }
+    if (NSMaxRange(range) > (NSUInteger)_string->_length)
+        [NSException raise:NSRangeException format:@"range %@ beyond bounds", NSStringFromRange(range)];
+    const unsigned char *bytes = _string->_bytes + range.location;
+    for (NSUInteger i = 0; i < range.length; i++)
+        buffer[i] = bytes[i];
+}
+
+- (NSStringEncoding)fastestEncoding
+{
+    return _ascii ? NSASCIIStringEncoding : NSUTF8StringEncoding;
+}
+
+- (const char *)UTF8String
+{
+    // copied bytes carry a terminating NUL, borrowed ones may not
+    if (_string.ownsBytes && self.isUTF8)
+        return (const char *)_string->_bytes;
+    return super.UTF8String;
+}
+
+- (NSUInteger)lengthOfBytesUsingEncoding:(NSStringEncoding)encoding
+{
+    if (encoding == NSUTF8StringEncoding && self.isUTF8)
+        return _string->_length;
+    return [super lengthOfBytesUsingEncoding:encoding];
+}
+
+- (id)copyWithZone:(NSZone *)zone
+{
+    return self;
+}
+
+@end
 
 @implementation LOLuaString
 
+// the intern table holds its strings weakly, so short strings die normally;
+// lookups reuse a single probe instance, only ever touched under the lock.
+static NSHashTable<LOLuaString *> *_internTable = nil;
+static LOLuaString *_internProbe = nil;
+static pthread_mutex_t _internLock = PTHREAD_MUTEX_INITIALIZER;
+
++ (void)initialize
+{
+    if (self == [LOLuaString class]) {
+        _internTable = [NSHashTable weakObjectsHashTable];
+        _internProbe = [[LOLuaString alloc] init];
+    }
+}
+
++ (LOLuaString *)valueOf:(NSString *)string
+{
+    // a string handed out by toNSString comes back as the original
+    if ([string isKindOfClass:[LOLuaStringBridge class]] && ((LOLuaStringBridge *)string).isUTF8)
+        return ((LOLuaStringBridge *)string)->_string;
+    return [self valueOfBytes:string.UTF8String length:(int)[string lengthOfBytesUsingEncoding:NSUTF8StringEncoding]];
+}
+
++ (LOLuaString *)valueOfBytes:(const void *)bytes length:(int)length
+{
+    return [self valueOfBytes:bytes length:length owner:nil];
+}
+
++ (LOLuaString *)valueOfBytesNoCopy:(const void *)bytes length:(int)length owner:(id)owner
+{
+    return [self valueOfBytes:bytes length:length owner:owner];
+}
+
+/**
+ * Copies the bytes when {@code owner} is nil, otherwise references them.
+ * Short strings are always copied: an interned string may live as long as
+ * any equal string is in use, and must not pin its owner meanwhile.
+ */
++ (LOLuaString *)valueOfBytes:(const void *)bytes length:(int)length owner:(id)owner
+{
+    if (length > LOLuaStringMaxShortLength)
+        return [[LOLuaString alloc] initWithBytes:bytes length:length hash:0 owner:owner];
+
+    NSUInteger hashCode = LOLuaStringHashBytes(bytes, length);
+    pthread_mutex_lock(&_internLock);
+    _internProbe->_bytes = bytes;
+    _internProbe->_length = length;
+    _internProbe->_hashCode = hashCode;
+    LOLuaString *s = [_internTable member:_internProbe];
+    if (s == nil) {
+        s = [[LOLuaString alloc] initWithBytes:bytes length:length hash:hashCode owner:nil];
+        s->_interned = YES;
+        [_internTable addObject:s];
+    }
+    _internProbe->_bytes = NULL;
+    pthread_mutex_unlock(&_internLock);
+    return s;
+}
+
+- (instancetype)initWithBytes:(const void *)bytes length:(int)length hash:(NSUInteger)hashCode owner:(id)owner
+{
+    return [self initWithBytes:bytes length:length hash:hashCode owner:owner copy:owner == nil];
+}
+
+/** With {@code copy} NO and no owner, the string takes over the malloc'ed {@code bytes} */
+- (instancetype)initWithBytes:(const void *)bytes length:(int)length hash:(NSUInteger)hashCode owner:(id)owner copy:(BOOL)copy
+{
+    if (self = [super init]) {
+        if (owner) {
+            _bytes = bytes;
+            _owner = owner;
+        } else if (!copy) {
+            _bytes = bytes;
+            _ownsBytes = YES;
+        } else {
+            unsigned char *copy = malloc(length + 1);
+            memcpy(copy, bytes, length);
+            copy[length] = 0;
+            _bytes = copy;
+            _ownsBytes = YES;
+        }
+        _length = length;
+        _hashCode = hashCode;
+    }
+    return self;
+}
+
+LOLuaString *LOLuaStringNewWithOwnedBytes(unsigned char *bytes, int length)
+{
+    bytes[length] = 0;
+    LOLuaString *s;
+    if (length > LOLuaStringMaxShortLength) {
+        s = [[LOLuaString alloc] initWithBytes:bytes length:length hash:0 owner:nil copy:NO];
+    } else {
+        s = [LOLuaString valueOfBytes:bytes length:length owner:nil];
+        free(bytes);
+    }
+    return s;
+}
+
+// flattening is rare and short, one lock for all strings keeps the rope state simple
+static pthread_mutex_t _flattenLock = PTHREAD_MUTEX_INITIALIZER;
+
+/** A flat copy of {@code a} followed by {@code b} */
+static LOLuaString *LOLuaStringJoin(LOLuaString *a, LOLuaString *b, int length)
+{
+    unsigned char *buffer = malloc(length + 1);
+    memcpy(buffer, LOLuaStringBytes(a), a->_length);
+    memcpy(buffer + a->_length, LOLuaStringBytes(b), b->_length);
+    return LOLuaStringNewWithOwnedBytes(buffer, length);
+}
+
+LOLuaString *LOLuaStringConcat(LOLuaString *a, LOLuaString *b)
+{
+    if (a->_length == 0)
+        return b;
+    if (b->_length == 0)
+        return a;
+    if ((long long)a->_length + b->_length > INT_MAX)
+        [LOLuaValue error:@"string length overflow"];
+    int length = a->_length + b->_length;
+    if (length < LOLuaStringMinRopeLength)
+        return LOLuaStringJoin(a, b, length);
+    LOLuaString *left = a, *right = b;
+    if (b->_length < LOLuaStringMinRopeLength && a->_bytes == NULL) {
+        // appending a short piece to a rope ending in a short leaf grows the leaf
+        // instead, so a string built piecewise has a node per leaf, not per piece
+        pthread_mutex_lock(&_flattenLock);
+        LOLuaString *aleft = a->_left, *aright = a->_right;
+        pthread_mutex_unlock(&_flattenLock);
+        if (aleft && aright->_bytes && aright->_length + b->_length < LOLuaStringMinRopeLength) {
+            left = aleft;
+            right = LOLuaStringJoin(aright, b, aright->_length + b->_length);
+        }
+    }
+    LOLuaString *s = [[LOLuaString alloc] init];
+    s->_left = left;
+    s->_right = right;
+    s->_length = length;
+    return s;
+}
+
+const unsigned char *LOLuaStringFlatten(LOLuaString *s)
+{
+    pthread_mutex_lock(&_flattenLock);
+    if (s->_bytes == NULL) {
+        unsigned char *buffer = malloc(s->_length + 1);
+        buffer[s->_length] = 0;
+        // fill from the end, right halves first; ropes built by appending are deep on the left
+        int capacity = 64, count = 0, offset = s->_length;
+        __unsafe_unretained LOLuaString **pending = malloc(capacity * sizeof(LOLuaString *));
+        pending[count++] = s;
+        while (count > 0) {
+            __unsafe_unretained LOLuaString *node = pending[--count];
+            if (node->_bytes) {
+                offset -= node->_length;
+                memcpy(buffer + offset, node->_bytes, node->_length);
+                continue;
+            }
+            if (count + 2 > capacity) {
+                capacity *= 2;
+                pending = realloc(pending, capacity * sizeof(LOLuaString *));
+            }
+            pending[count++] = node->_left;
+            pending[count++] = node->_right;
+        }
+        free(pending);
+        s.ownsBytes = YES;
+        __atomic_store_n(&s->_bytes, buffer, __ATOMIC_RELEASE);
+        s->_left = nil;
+        s->_right = nil;
+    }
+    pthread_mutex_unlock(&_flattenLock);
+    return s->_bytes;
+}
+
+- (LOLuaString *)substring:(int)beginIndex end:(int)endIndex
+{
+    int length = endIndex - beginIndex;
+    if (length <= LOLuaStringMaxShortLength || length == _length)
+        return length == _length ? self : [LOLuaString valueOfBytes:LOLuaStringBytes(self) + beginIndex length:length];
+    // a view of a view references the string that owns the bytes
+    const unsigned char *bytes = LOLuaStringBytes(self);
+    id owner = self.ownsBytes ? self : self.owner;
+    return [[LOLuaString alloc] initWithBytes:bytes + beginIndex length:length hash:0 owner:owner];
+}
+
+- (void)dealloc
+{
+    if (_ownsBytes)
+        free((void *)_bytes);
+    if (_left == nil)
+        return;
+    // release a deep rope iteratively, taking over the halves of the halves that die with it
+    int capacity = 16, count = 0;
+    CFTypeRef *pending = malloc(capacity * sizeof(CFTypeRef));
+    pending[count++] = CFBridgingRetain(_left);
+    pending[count++] = CFBridgingRetain(_right);
+    _left = nil;
+    _right = nil;
+    while (count > 0) {
+        CFTypeRef ref = pending[--count];
+        __unsafe_unretained LOLuaString *node = (__bridge LOLuaString *)ref;
+        if (node->_left && CFGetRetainCount(ref) == 1) {
+            if (count + 2 > capacity) {
+                capacity *= 2;
+                pending = realloc(pending, capacity * sizeof(CFTypeRef));
+            }
+            pending[count++] = CFBridgingRetain(node->_left);
+            pending[count++] = CFBridgingRetain(node->_right);
+            node->_left = nil;
+            node->_right = nil;
+        }
+        CFRelease(ref);
+    }
+    free(pending);
+}
+
+- (int)length
+{
+    return _length;
+}
+
+- (int)type
+{
+    return LOLuaTypeString;
+}
+
+- (BOOL)isString
+{
+    return YES;
+}
+
+- (NSString *)toNSString
+{
+    return [[LOLuaStringBridge alloc] initWithLuaString:self];
+}
+
+- (void)appendTo:(LOStringBuilder *)sb
+{
+    LOStringBuilderAppendBytes(sb, LOLuaStringBytes(self), _length);
+}
+
+- (LOLuaValue *)toValueString
+{
+    return self;
+}
+
+- (LOLuaNumber *)toNumber
+{
+    LOTValue v;
+    return LOLuaNumberParse(LOLuaStringBytes(self), _length, &v) ? (LOLuaNumber *)LOTValueBox(v) : nil;
+}
+
+- (NSString *)optNSString:(NSString *)defval
+{
+    return self.toNSString;
+}
+
+- (LOLuaString *)optString:(LOLuaString *)defval
+{
+    return self;
+}
+
+- (NSString *)checkNSString
+{
+    return self.toNSString;
+}
+
+- (LOLuaString *)checkString
+{
+    return self;
+}
+
+- (NSUInteger)hash
+{
+    return LOLuaStringHash(self);
+}
+
+- (BOOL)isEqual:(id)object
+{
+    return [object isKindOfClass:[LOLuaString class]] && LOLuaStringEquals(self, object);
+}
+
 @end
@@ -7,6 +7,249 @@
 
 #import "LOLuaValue.h"
 
-@interface LOLuaTable : LOLuaValue
+/**
+ * Storage mode of the array part.  A fresh array part starts out as ints and
+ * is promoted, never demoted, as other values are stored into it:
+ * ints become doubles when a non-integral number arrives, and anything that
+ * is not a number turns the part into generic {@link LOTValue} slots.
+ */
+typedef NS_ENUM(uint8_t, LOTableArrayKind) {
+    LOTableArrayKindInt = 0,
+    LOTableArrayKindDouble,
+    LOTableArrayKindValue,
+};
+
+/** Marks a nil slot in an int array part; storing this int promotes the part */
+#define LOTABLE_INT_NIL INT_MIN
+
+/**
+ * The array part, interpreted according to {@link LOTableArrayKind}.
+ * A double part holds raw IEEE doubles with nil slots stored as the
+ * {@code LO_NIL} bit pattern, so its elements are also valid {@link LOTValue}s.
+ */
+typedef union LOTableArrayPart {
+    LOTValue *values;
+    double *doubles;
+    int *ints;
+} LOTableArrayPart;
+
+/** One slot of the open addressed hash part; a key of 0 marks an empty slot */
+typedef struct LOTableNode {
+    LOTValue key;
+    LOTValue value;
+} LOTableNode;
+
+/**
+ * Inline cache for a lookup with a constant string key, one per instruction.
+ * <p>
+ * Prototypes, and so their caches, are shared between OS threads, so the
+ * cache is a single word, read and written atomically, which can never mix
+ * two fills.  It holds either the hash slot the key was found in, odd,
+ * trusted while that slot of the table at hand still holds the key; or
+ * the version of the table the key was found absent in, even.
+ */
+typedef struct LOFieldCache {
+    uint64_t entry;
+} LOFieldCache;
+
+#define LOFieldCacheSlot(slot)          (((uint64_t)(slot) << 1) | 1)
+#define LOFieldCacheAbsent(version)     ((uint64_t)(version) << 1)
+
+/**
+ * Subclass of {@link LuaValue} for representing lua tables.
+ * <p>
+ * Almost all API's implemented in {@link LuaTable} are defined and documented in {@link LuaValue}.
+ * <p>
+ * A table has an array part holding the values for keys 1..n contiguously,
+ * and a hash part for everything else.  The hash part is a single flat array
+ * of key/value {@link LOTableNode}s using open addressing with linear probing,
+ * so there is no per-entry allocation.  When the hash part fills up the table
+ * is rehashed the way lua does it: integer keys are counted and the array
+ * part is resized to the largest power of two that would be more than half
+ * full, and the hash part is sized for the remaining keys.
+ * <p>
+ * Dense numeric arrays keep their array part unboxed: 4 bytes per element
+ * while everything stored is an int, 8 bytes of plain doubles once a float
+ * arrives, see {@link LOTableArrayKind}.  Numeric parts need no retain or
+ * release traffic and can be handed to vectorized code as a C array.
+ * <p>
+ * Setting a key to nil leaves a dead entry in place, so {@link #next:} keeps
+ * working while fields are cleared during a traversal.
+ * <p>
+ * Values are stored as {@link LOTValue}s; the object API boxes on the way out.
+ * <p>
+ * Every table carries a version that changes whenever a key is added to the
+ * hash part or the hash part is rebuilt.  Versions come from one global atomic
+ * counter, so a version identifies a single table in a single layout, and a
+ * {@link LOFieldCache} holding it knows a key to be absent without hashing.
+ * Updating the value of an existing key keeps the version.
+ * <p>
+ * A table used as a metatable remembers which metatags it lacks in
+ * {@code _flags}, one bit per {@link LOTagMethod}, so indexing or arithmetic
+ * on a value whose metatable has no {@code __index} or {@code __add} does
+ * not probe the hash part again.  Any store of a string key clears the bits.
+ * @see LuaValue
+ */
+@interface LOLuaTable : LOLuaValue {
+@public
+    LOTableArrayPart _arrayPart;
+    int _arraySize;
+    LOTableArrayKind _arrayKind;
+    LOTableNode *_nodes;
+    int _nodeCapacity;
+    int _nodeUsed;
+    /** layout version of the hash part, see {@link LOFieldCache} */
+    uint64_t _version;
+    LOLuaTable *_metatable;
+    /** events known to have no metatag in this table, 1 << {@link LOTagMethod} */
+    uint32_t _flags;
+}
+
+/** Construct table with preset capacity.
+ * @param narray capacity of array part
+ * @param nhash capacity of hash part
+ */
+- (instancetype)initWithArraySize:(int)narray hashSize:(int)nhash;
+
+/** Construct a list from a C array of doubles, stored unboxed.
+ * @param values the values for keys 1..count
+ * @param count number of values
+ */
+- (instancetype)initWithDoubles:(const double *)values count:(int)count;
+
+/** Construct a list from a C array of ints, stored unboxed.
+ * @param values the values for keys 1..count
+ * @param count number of values
+ */
+- (instancetype)initWithInts:(const int *)values count:(int)count;
+
+/** Get a value in a table without metatag processing.
+ * @param key the key to look up, must not be {@link #NIL} or null
+ * @return {@link LuaValue} for that key, or {@link #NIL} if not found
+ */
+- (LOLuaValue *)rawGet:(LOLuaValue *)key;
+
+/** Set a value in a table without metatag processing.
+ * @param key the key to use, must not be {@link #NIL} or null
+ * @param value the value to use, can be {@link #NIL}, must not be null
+ * @throws LuaError if {@code key} is nil or NaN
+ */
+- (void)rawSet:(LOLuaValue *)key value:(LOLuaValue *)value;
+
+- (LOLuaValue *)getInt:(int)key;
+- (void)setInt:(int)key value:(LOLuaValue *)value;
+
+/** Get the length of the array part of the table, the lua '#' operator without metatags.
+ * @return length of the array part, a border as defined by lua
+ */
+- (int)rawLen;
+
+/** Resize the table to exactly these part sizes, rehashing the existing entries. */
+- (void)presize:(int)narray hashSize:(int)nhash;
 
 @end
+
+/** Raw get of any key, borrowed result, LO_NIL if absent */
+FOUNDATION_EXTERN LOTValue LOTableGet(LOLuaTable *t, LOTValue key);
+/** Raw get of a string key, borrowed result, LO_NIL if absent */
+FOUNDATION_EXTERN LOTValue LOTableGetStr(LOLuaTable *t, LOLuaString *key);
+FOUNDATION_EXTERN LOTValue LOTableGetIntSlow(LOLuaTable *t, int key);
+FOUNDATION_EXTERN LOTValue LOTableGetStrFill(LOLuaTable *t, LOLuaString *key, LOFieldCache *cache);
+FOUNDATION_EXTERN void LOTableSetStrFill(LOLuaTable *t, LOLuaString *key, LOTValue value, LOFieldCache *cache);
+/** Raw set, the table retains the key and value; raises on a nil or NaN key */
+FOUNDATION_EXTERN void LOTableSet(LOLuaTable *t, LOTValue key, LOTValue value);
+FOUNDATION_EXTERN void LOTableSetInt(LOLuaTable *t, int key, LOTValue value);
+/** Border of the table, see {@link LOLuaTable#rawLen} */
+FOUNDATION_EXTERN int LOTableLength(LOLuaTable *t);
+/**
+ * Advance a traversal: on entry {@code *key} is the previous key or LO_NIL to start,
+ * on return {@code *key} and {@code *value} hold the next entry (both borrowed).
+ * @return NO when there are no more entries
+ */
+FOUNDATION_EXTERN BOOL LOTableNext(LOLuaTable *t, LOTValue *key, LOTValue *value);
+
+/**
+ * Contiguous doubles of the array part, or NULL unless the part is in double mode.
+ * Nil elements read as NaN.  The pointer is invalidated by any store to the table.
+ * @param count receives the array part size
+ */
+FOUNDATION_EXTERN const double *LOTableDoubleArray(LOLuaTable *t, int *count);
+
+/**
+ * Contiguous ints of the array part, or NULL unless the part is in int mode.
+ * Nil elements read as {@link LOTABLE_INT_NIL}.  The pointer is invalidated by any store to the table.
+ * @param count receives the array part size
+ */
+FOUNDATION_EXTERN const int *LOTableIntArray(LOLuaTable *t, int *count);
+
+/** Element {@code i} (0-based) of the array part as a borrowed value */
+static inline LOTValue LOTableArrayGet(LOLuaTable *t, int i)
+{
+    if (t->_arrayKind == LOTableArrayKindInt) {
+        int v = t->_arrayPart.ints[i];
+        return v == LOTABLE_INT_NIL ? LO_NIL : LOTValueFromInt(v);
+    }
+    return t->_arrayPart.values[i];
+}
+
+/** Raw get of an int key, with the array part lookup inlined */
+static inline LOTValue LOTableGetInt(LOLuaTable *t, int key)
+{
+    if ((unsigned)(key - 1) < (unsigned)t->_arraySize)
+        return LOTableArrayGet(t, key - 1);
+    return LOTableGetIntSlow(t, key);
+}
+
+/** Metatables shared by all values of a type other than table, indexed by {@link LOLuaType}; borrowed */
+FOUNDATION_EXTERN __unsafe_unretained LOLuaTable *LOTypeMetatables[LOLuaTypeThread + 1];
+
+/** Set the metatable shared by all values of {@code type}, such as the string metatable */
+FOUNDATION_EXTERN void LOSetTypeMetatable(int type, LOLuaTable *metatable);
+
+FOUNDATION_EXTERN LOTValue LOTableGetTM(LOLuaTable *mt, LOTagMethod event);
+
+/**
+ * Metatag for {@code event} in the metatable {@code mt}, borrowed, LO_NIL if
+ * absent or if there is no metatable.  A miss is remembered in the flags of
+ * {@code mt}, so checking again costs a bit test.
+ */
+static inline LOTValue LOTableFastTM(LOLuaTable *mt, LOTagMethod event)
+{
+    if (mt == nil || (mt->_flags & (1u << event)))
+        return LO_NIL;
+    return LOTableGetTM(mt, event);
+}
+
+/** The node of {@code key} if {@code entry} caches its slot in {@code t}, else NULL */
+static inline LOTableNode *LOTableCachedNode(LOLuaTable *t, LOLuaString *key, uint64_t entry)
+{
+    if (!(entry & 1))
+        return NULL;
+    uint64_t slot = entry >> 1;
+    if (slot >= (uint64_t)t->_nodeCapacity || t->_nodes[slot].key != LOTValueFromPointer((__bridge void *)key))
+        return NULL;
+    return &t->_nodes[slot];
+}
+
+/** Raw get of a string key through an inline cache, borrowed result */
+static inline LOTValue LOTableGetStrCached(LOLuaTable *t, LOLuaString *key, LOFieldCache *cache)
+{
+    uint64_t entry = __atomic_load_n(&cache->entry, __ATOMIC_RELAXED);
+    LOTableNode *n = LOTableCachedNode(t, key, entry);
+    if (n)
+        return n->value;
+    if (entry == LOFieldCacheAbsent(t->_version))
+        return LO_NIL;
+    return LOTableGetStrFill(t, key, cache);
+}
+
+/** Raw set of a string key through an inline cache; a cached slot is updated in place */
+static inline void LOTableSetStrCached(LOLuaTable *t, LOLuaString *key, LOTValue value, LOFieldCache *cache)
+{
+    LOTableNode *n = LOTableCachedNode(t, key, __atomic_load_n(&cache->entry, __ATOMIC_RELAXED));
+    if (n) {
+        t->_flags = 0;
+        LOTValueAssign(&n->value, value);
+    } else
+        LOTableSetStrFill(t, key, value, cache);
+}
@@ -6,7 +6,626 @@
 //
 
 #import "LOLuaTable.h"
+#import "LOLuaString.h"
+
+/** Largest power of two the array part may grow to, as in lua */
+#define LOTABLE_MAXABITS    30
+#define LOTABLE_MAXASIZE    (1 << LOTABLE_MAXABITS)
+#define LOTABLE_EMPTY_KEY   ((LOTValue)0)
+
+__unsafe_unretained LOLuaTable *LOTypeMetatables[LOLuaTypeThread + 1];
+
+void LOSetTypeMetatable(int type, LOLuaTable *metatable)
+{
+    NSCParameterAssert(type >= 0 && type <= LOLuaTypeThread && type != LOLuaTypeTable);
+    if (metatable)
+        CFRetain((__bridge CFTypeRef)metatable);
+    if (LOTypeMetatables[type])
+        CFRelease((__bridge CFTypeRef)LOTypeMetatables[type]);
+    LOTypeMetatables[type] = metatable;
+}
+
+/**
+ * Source of table versions, shared by tables on all OS threads; 0 is never
+ * handed out, a zeroed cache only matches a table that never had a hash key.
+ */
+static uint64_t LOTableLastVersion;
+
+static inline void LOTableTouch(LOLuaTable *t)
+{
+    t->_version = __atomic_add_fetch(&LOTableLastVersion, 1, __ATOMIC_RELAXED);
+}
+
+static inline BOOL LOTValueIsStringObject(LOTValue v)
+{
+    return LOTValueIsObject(v) && LOTValueGetObject(v)->_type == LOLuaTypeString;
+}
+
+static inline NSUInteger LOTableMix(uint64_t h)
+{
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return (NSUInteger)h;
+}
+
+static inline NSUInteger LOTableHashKey(LOTValue key)
+{
+    if (LOTValueIsStringObject(key))
+        return LOLuaStringHash((__bridge LOLuaString *)LOTValueGetPointer(key));
+    return LOTableMix(key);
+}
+
+static inline BOOL LOTableKeysEqual(LOTValue a, LOTValue b)
+{
+    if (a == b)
+        return YES;
+    return LOTValueIsStringObject(a) && LOTValueIsStringObject(b)
+        && LOLuaStringEquals((__bridge LOLuaString *)LOTValueGetPointer(a), (__bridge LOLuaString *)LOTValueGetPointer(b));
+}
+
+/** Map a key to its canonical form: integral doubles become ints, so 1.0 and 1 are one key */
+static LOTValue LOTableNormalizeKey(LOTValue key)
+{
+    if (LOTValueIsDouble(key)) {
+        double d = LOTValueGetDouble(key);
+        if (d != d)
+            [LOLuaValue error:@"table index is NaN"];
+        if (d >= INT_MIN && d <= INT_MAX && d == (double)(int)d)
+            return LOTValueFromInt((int)d);
+    } else if (key == LO_NIL) {
+        [LOLuaValue error:@"table index is nil"];
+    }
+    return key;
+}
+
+static inline int LOCeilLog2(unsigned int x)
+{
+    return x <= 1 ? 0 : 32 - __builtin_clz(x - 1);
+}
+
+static int LOTableNodeCapacityFor(int n)
+{
+    if (n <= 0)
+        return 0;
+    int cap = 4;
+    while (cap - (cap >> 2) < n)
+        cap <<= 1;
+    return cap;
+}
+
+static LOTableNode *LOTableFindNode(LOLuaTable *t, LOTValue key, NSUInteger h)
+{
+    if (t->_nodeCapacity == 0)
+        return NULL;
+    NSUInteger mask = t->_nodeCapacity - 1;
+    for (NSUInteger i = h & mask;; i = (i + 1) & mask) {
+        LOTableNode *n = &t->_nodes[i];
+        if (n->key == LOTABLE_EMPTY_KEY)
+            return NULL;
+        if (LOTableKeysEqual(n->key, key))
+            return n;
+    }
+}
+
+/** Promote the array part to {@code kind}, converting the stored elements */
+static void LOTableArrayPromote(LOLuaTable *t, LOTableArrayKind kind)
+{
+    if (t->_arrayKind == LOTableArrayKindInt && t->_arraySize > 0) {
+        int *ints = t->_arrayPart.ints;
+        LOTValue *values = malloc(t->_arraySize * sizeof(LOTValue));
+        for (int i = 0; i < t->_arraySize; i++) {
+            if (ints[i] == LOTABLE_INT_NIL)
+                values[i] = LO_NIL;
+            else
+                values[i] = kind == LOTableArrayKindDouble ? LOTValueFromDouble(ints[i]) : LOTValueFromInt(ints[i]);
+        }
+        free(ints);
+        t->_arrayPart.values = values;
+    }
+    t->_arrayKind = kind;
+}
+
+/** Store into element {@code i} (0-based) of the array part, retaining {@code v} and promoting as needed */
+static void LOTableArraySet(LOLuaTable *t, int i, LOTValue v)
+{
+    switch (t->_arrayKind) {
+        case LOTableArrayKindInt:
+            if (LOTValueIsInt(v) && LOTValueGetInt(v) != LOTABLE_INT_NIL) {
+                t->_arrayPart.ints[i] = LOTValueGetInt(v);
+                return;
+            }
+            if (v == LO_NIL) {
+                t->_arrayPart.ints[i] = LOTABLE_INT_NIL;
+                return;
+            }
+            LOTableArrayPromote(t, LOTValueIsNumber(v) ? LOTableArrayKindDouble : LOTableArrayKindValue);
+            LOTableArraySet(t, i, v);
+            return;
+        case LOTableArrayKindDouble:
+            if (LOTValueIsDouble(v) || v == LO_NIL) {
+                t->_arrayPart.values[i] = v;
+                return;
+            }
+            if (LOTValueIsInt(v)) {
+                t->_arrayPart.values[i] = LOTValueFromDouble(LOTValueGetInt(v));
+                return;
+            }
+            LOTableArrayPromote(t, LOTableArrayKindValue);
+            // fall through
+        case LOTableArrayKindValue:
+            LOTValueAssign(&t->_arrayPart.values[i], v);
+            return;
+    }
+}
+
+/** Store into the array part, transferring ownership of {@code v} */
+static inline void LOTableArrayMove(LOLuaTable *t, int i, LOTValue v)
+{
+    LOTableArraySet(t, i, v);
+    LOTValueRelease(v);
+}
+
+/** Insert a key known to be absent into a node array, transferring ownership of key and value */
+static void LOTableMoveNode(LOTableNode *nodes, int capacity, LOTValue key, LOTValue value)
+{
+    NSUInteger mask = capacity - 1;
+    NSUInteger i = LOTableHashKey(key) & mask;
+    while (nodes[i].key != LOTABLE_EMPTY_KEY)
+        i = (i + 1) & mask;
+    nodes[i].key = key;
+    nodes[i].value = value;
+}
+
+static void LOTableResize(LOLuaTable *t, int nasize, int nhsize)
+{
+    int oldasize = t->_arraySize;
+    LOTableNode *oldnodes = t->_nodes;
+    int oldcap = t->_nodeCapacity;
+
+    // never size the hash part below what has to move into it
+    int need = 0;
+    for (int i = nasize; i < oldasize; i++)
+        need += LOTableArrayGet(t, i) != LO_NIL;
+    for (int i = 0; i < oldcap; i++) {
+        LOTableNode *n = &oldnodes[i];
+        if (n->key != LOTABLE_EMPTY_KEY && n->value != LO_NIL
+            && !(LOTValueIsInt(n->key) && (unsigned)(LOTValueGetInt(n->key) - 1) < (unsigned)nasize))
+            need++;
+    }
+    int cap = LOTableNodeCapacityFor(need > nhsize ? need : nhsize);
+    LOTableNode *nodes = cap ? calloc(cap, sizeof(LOTableNode)) : NULL;
+    int used = 0;
+
+    // vanishing slice of the array part moves into the new hash part
+    for (int i = nasize; i < oldasize; i++) {
+        LOTValue v = LOTableArrayGet(t, i);
+        if (v != LO_NIL) {
+            LOTableMoveNode(nodes, cap, LOTValueFromInt(i + 1), v);
+            used++;
+        }
+    }
+    if (nasize == 0) {
+        free(t->_arrayPart.values);
+        t->_arrayPart.values = NULL;
+        t->_arraySize = 0;
+        t->_arrayKind = LOTableArrayKindInt;
+    } else if (nasize != oldasize) {
+        if (t->_arrayKind == LOTableArrayKindInt) {
+            t->_arrayPart.ints = realloc(t->_arrayPart.ints, nasize * sizeof(int));
+            for (int i = oldasize; i < nasize; i++)
+                t->_arrayPart.ints[i] = LOTABLE_INT_NIL;
+        } else {
+            t->_arrayPart.values = realloc(t->_arrayPart.values, nasize * sizeof(LOTValue));
+            for (int i = oldasize; i < nasize; i++)
+                t->_arrayPart.values[i] = LO_NIL;
+        }
+        t->_arraySize = nasize;
+    }
+
+    // old hash entries go to the array part where they now fit, dead entries are dropped
+    for (int i = 0; i < oldcap; i++) {
+        LOTableNode *n = &oldnodes[i];
+        if (n->key == LOTABLE_EMPTY_KEY)
+            continue;
+        if (n->value == LO_NIL) {
+            LOTValueRelease(n->key);
+        } else if (LOTValueIsInt(n->key) && (unsigned)(LOTValueGetInt(n->key) - 1) < (unsigned)nasize) {
+            LOTableArrayMove(t, LOTValueGetInt(n->key) - 1, n->value);
+        } else {
+            LOTableMoveNode(nodes, cap, n->key, n->value);
+            used++;
+        }
+    }
+    free(oldnodes);
+    t->_nodes = nodes;
+    t->_nodeCapacity = cap;
+    t->_nodeUsed = used;
+    LOTableTouch(t);
+}
+
+static int LOTableCountIntKey(LOTValue key, int *nums)
+{
+    if (LOTValueIsInt(key)) {
+        int k = LOTValueGetInt(key);
+        if (k > 0 && k <= LOTABLE_MAXASIZE) {
+            nums[LOCeilLog2(k)]++;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/** Compute the optimal array size: the largest n such that more than n/2 of 1..n are in use */
+static int LOTableComputeSizes(int *nums, int *narray)
+{
+    int a = 0, na = 0, n = 0;
+    unsigned int twotoi = 1;
+    for (int i = 0; twotoi / 2 < (unsigned int)*narray; i++, twotoi *= 2) {
+        if (nums[i] > 0) {
+            a += nums[i];
+            if ((unsigned int)a > twotoi / 2) {
+                n = (int)twotoi;
+                na = a;
+            }
+        }
+        if (a == *narray)
+            break;
+    }
+    *narray = n;
+    return na;
+}
+
+static void LOTableRehash(LOLuaTable *t, LOTValue extraKey)
+{
+    int nums[LOTABLE_MAXABITS + 1] = {0};
+    int nasize = 0, totaluse = 0;
+
+    // keys in the array part, grouped in slices (2^(lg-1), 2^lg]
+    unsigned int ttlg = 1;
+    for (int lg = 0, i = 1; lg <= LOTABLE_MAXABITS; lg++, ttlg *= 2) {
+        int lim = ttlg < (unsigned int)t->_arraySize ? (int)ttlg : t->_arraySize;
+        if (i > lim)
+            break;
+        for (; i <= lim; i++) {
+            if (LOTableArrayGet(t, i - 1) != LO_NIL)
+                nums[lg]++, nasize++;
+        }
+    }
+    totaluse = nasize;
+    for (int i = 0; i < t->_nodeCapacity; i++) {
+        LOTableNode *n = &t->_nodes[i];
+        if (n->key != LOTABLE_EMPTY_KEY && n->value != LO_NIL) {
+            nasize += LOTableCountIntKey(n->key, nums);
+            totaluse++;
+        }
+    }
+    nasize += LOTableCountIntKey(extraKey, nums);
+    totaluse++;
+    int na = LOTableComputeSizes(nums, &nasize);
+    LOTableResize(t, nasize, totaluse - na);
+}
+
+LOTValue LOTableGetIntSlow(LOLuaTable *t, int key)
+{
+    LOTValue k = LOTValueFromInt(key);
+    LOTableNode *n = LOTableFindNode(t, k, LOTableMix(k));
+    return n ? n->value : LO_NIL;
+}
+
+LOTValue LOTableGetStr(LOLuaTable *t, LOLuaString *key)
+{
+    LOTableNode *n = LOTableFindNode(t, LOTValueFromPointer((__bridge void *)key), LOLuaStringHash(key));
+    return n ? n->value : LO_NIL;
+}
+
+LOTValue LOTableGet(LOLuaTable *t, LOTValue key)
+{
+    if (LOTValueIsInt(key))
+        return LOTableGetInt(t, LOTValueGetInt(key));
+    if (key == LO_NIL)
+        return LO_NIL;
+    if (LOTValueIsDouble(key)) {
+        double d = LOTValueGetDouble(key);
+        if (d != d)
+            return LO_NIL;
+        key = LOTableNormalizeKey(key);
+        if (LOTValueIsInt(key))
+            return LOTableGetInt(t, LOTValueGetInt(key));
+    }
+    LOTableNode *n = LOTableFindNode(t, key, LOTableHashKey(key));
+    return n ? n->value : LO_NIL;
+}
+
+void LOTableSet(LOLuaTable *t, LOTValue key, LOTValue value)
+{
+    if (!LOTValueIsInt(key)) {
+        key = LOTableNormalizeKey(key);
+        t->_flags = 0;  /* may be a metatag */
+    }
+    if (LOTValueIsInt(key) && (unsigned)(LOTValueGetInt(key) - 1) < (unsigned)t->_arraySize) {
+        LOTableArraySet(t, LOTValueGetInt(key) - 1, value);
+        return;
+    }
+
+    NSUInteger h = LOTableHashKey(key);
+    LOTableNode *slot = NULL;
+    if (t->_nodeCapacity) {
+        NSUInteger mask = t->_nodeCapacity - 1;
+        for (NSUInteger i = h & mask;; i = (i + 1) & mask) {
+            LOTableNode *n = &t->_nodes[i];
+            if (n->key == LOTABLE_EMPTY_KEY) {
+                if (slot == NULL)
+                    slot = n;
+                break;
+            }
+            if (LOTableKeysEqual(n->key, key)) {
+                LOTValueAssign(&n->value, value);
+                return;
+            }
+            if (slot == NULL && n->value == LO_NIL)
+                slot = n;
+        }
+    }
+    if (value == LO_NIL)
+        return;
+
+    if (slot == NULL || (slot->key == LOTABLE_EMPTY_KEY && t->_nodeUsed + 1 > t->_nodeCapacity - (t->_nodeCapacity >> 2))) {
+        LOTableRehash(t, key);
+        LOTableSet(t, key, value);
+        return;
+    }
+    if (slot->key == LOTABLE_EMPTY_KEY)
+        t->_nodeUsed++;
+    else
+        LOTValueRelease(slot->key);
+    LOTValueRetain(key);
+    LOTValueRetain(value);
+    slot->key = key;
+    slot->value = value;
+    LOTableTouch(t);
+}
+
+LOTValue LOTableGetTM(LOLuaTable *mt, LOTagMethod event)
+{
+    LOTValue tm = LOTableGetStr(mt, LOTagMethodName(event));
+    if (tm == LO_NIL)
+        mt->_flags |= 1u << event;  /* cache this fact */
+    return tm;
+}
+
+LOTValue LOTableGetStrFill(LOLuaTable *t, LOLuaString *key, LOFieldCache *cache)
+{
+    LOTableNode *n = LOTableFindNode(t, LOTValueFromPointer((__bridge void *)key), LOLuaStringHash(key));
+    __atomic_store_n(&cache->entry, n ? LOFieldCacheSlot(n - t->_nodes) : LOFieldCacheAbsent(t->_version), __ATOMIC_RELAXED);
+    return n ? n->value : LO_NIL;
+}
+
+void LOTableSetStrFill(LOLuaTable *t, LOLuaString *key, LOTValue value, LOFieldCache *cache)
+{
+    LOTableSet(t, LOTValueFromPointer((__bridge void *)key), value);
+    LOTableGetStrFill(t, key, cache);
+}
+
+void LOTableSetInt(LOLuaTable *t, int key, LOTValue value)
+{
+    if ((unsigned)(key - 1) < (unsigned)t->_arraySize)
+        LOTableArraySet(t, key - 1, value);
+    else
+        LOTableSet(t, LOTValueFromInt(key), value);
+}
+
+static int LOTableUnboundSearch(LOLuaTable *t, unsigned int j)
+{
+    unsigned int i = j;
+    j++;
+    while (LOTableGetInt(t, (int)j) != LO_NIL) {
+        i = j;
+        if (j > (unsigned int)INT_MAX / 2) {
+            // pathological table, fall back to a linear search
+            i = 1;
+            while (LOTableGetInt(t, (int)i) != LO_NIL)
+                i++;
+            return (int)(i - 1);
+        }
+        j *= 2;
+    }
+    while (j - i > 1) {
+        unsigned int m = (i + j) / 2;
+        if (LOTableGetInt(t, (int)m) == LO_NIL)
+            j = m;
+        else
+            i = m;
+    }
+    return (int)i;
+}
+
+int LOTableLength(LOLuaTable *t)
+{
+    unsigned int j = t->_arraySize;
+    if (j > 0 && LOTableArrayGet(t, j - 1) == LO_NIL) {
+        unsigned int i = 0;
+        while (j - i > 1) {
+            unsigned int m = (i + j) / 2;
+            if (LOTableArrayGet(t, m - 1) == LO_NIL)
+                j = m;
+            else
+                i = m;
+        }
+        return (int)i;
+    }
+    if (t->_nodeCapacity == 0)
+        return (int)j;
+    return LOTableUnboundSearch(t, j);
+}
+
+BOOL LOTableNext(LOLuaTable *t, LOTValue *key, LOTValue *value)
+{
+    int i = 0;
+    if (*key != LO_NIL) {
+        LOTValue k = LOTableNormalizeKey(*key);
+        if (LOTValueIsInt(k) && (unsigned)(LOTValueGetInt(k) - 1) < (unsigned)t->_arraySize) {
+            i = LOTValueGetInt(k);
+        } else {
+            LOTableNode *n = LOTableFindNode(t, k, LOTableHashKey(k));
+            if (n == NULL)
+                [LOLuaValue error:@"invalid key to 'next'"];
+            i = t->_arraySize + (int)(n - t->_nodes) + 1;
+        }
+    }
+    for (; i < t->_arraySize; i++) {
+        LOTValue v = LOTableArrayGet(t, i);
+        if (v != LO_NIL) {
+            *key = LOTValueFromInt(i + 1);
+            *value = v;
+            return YES;
+        }
+    }
+    for (i -= t->_arraySize; i < t->_nodeCapacity; i++) {
+        LOTableNode *n = &t->_nodes[i];
+        if (n->key != LOTABLE_EMPTY_KEY && n->value != LO_NIL) {
+            *key = n->key;
+            *value = n->value;
+            return YES;
+        }
+    }
+    return NO;
+}
+
+const double *LOTableDoubleArray(LOLuaTable *t, int *count)
+{
+    *count = t->_arraySize;
+    return t->_arrayKind == LOTableArrayKindDouble ? t->_arrayPart.doubles : NULL;
+}
+
+const int *LOTableIntArray(LOLuaTable *t, int *count)
+{
+    *count = t->_arraySize;
+    return t->_arrayKind == LOTableArrayKindInt ? t->_arrayPart.ints : NULL;
+}
 
 @implementation LOLuaTable
 
+- (instancetype)init
+{
+    return [self initWithArraySize:0 hashSize:0];
+}
+
+- (instancetype)initWithArraySize:(int)narray hashSize:(int)nhash
+{
+    if (self = [super init]) {
+        LOTableResize(self, narray > 0 ? narray : 0, nhash > 0 ? nhash : 0);
+    }
+    return self;
+}
+
+- (instancetype)initWithDoubles:(const double *)values count:(int)count
+{
+    if (self = [self initWithArraySize:0 hashSize:0]) {
+        LOTableArrayPromote(self, LOTableArrayKindDouble);
+        LOTableResize(self, count, 0);
+        for (int i = 0; i < count; i++)
+            _arrayPart.values[i] = LOTValueFromDouble(values[i]);
+    }
+    return self;
+}
+
+- (instancetype)initWithInts:(const int *)values count:(int)count
+{
+    if (self = [self initWithArraySize:count hashSize:0]) {
+        for (int i = 0; i < count; i++)
+            LOTableArraySet(self, i, LOTValueFromInt(values[i]));
+    }
+    return self;
+}
+
+- (void)dealloc
+{
+    if (_arrayKind == LOTableArrayKindValue) {
+        for (int i = 0; i < _arraySize; i++)
+            LOTValueRelease(_arrayPart.values[i]);
+    }
+    for (int i = 0; i < _nodeCapacity; i++) {
+        if (_nodes[i].key != LOTABLE_EMPTY_KEY) {
+            LOTValueRelease(_nodes[i].key);
+            LOTValueRelease(_nodes[i].value);
+        }
+    }
+    free(_arrayPart.values);
+    free(_nodes);
+}
+
+- (void)presize:(int)narray hashSize:(int)nhash
+{
+    LOTableResize(self, narray, nhash);
+}
+
+- (int)type
+{
+    return LOLuaTypeTable;
+}
+
+- (BOOL)isTable
+{
+    return YES;
+}
+
+- (LOLuaTable *)checkTable
+{
+    return self;
+}
+
+- (LOLuaTable *)optTable:(LOLuaTable *)defval
+{
+    return self;
+}
+
+- (NSString *)toNSString
+{
+    return [NSString stringWithFormat:@"table: %p", self];
+}
+
+- (void)appendTo:(LOStringBuilder *)sb
+{
+    LOStringBuilderAppendAddress(sb, "table", (__bridge void *)self);
+}
+
+- (LOLuaValue *)rawGet:(LOLuaValue *)key
+{
+    return LOTValueBox(LOTableGet(self, LOTValueUnbox(key)));
+}
+
+- (void)rawSet:(LOLuaValue *)key value:(LOLuaValue *)value
+{
+    LOTableSet(self, LOTValueUnbox(key), LOTValueUnbox(value));
+}
+
+- (LOLuaTable *)getmetatable
+{
+    return _metatable;
+}
+
+- (LOLuaValue *)setmetatable:(LOLuaValue *)metatable
+{
+    if (metatable && metatable->_type != LOLuaTypeNil && metatable->_type != LOLuaTypeTable)
+        [LOLuaValue argError:2 msg:@"nil or table expected"];
+    _metatable = metatable && metatable->_type == LOLuaTypeTable ? (LOLuaTable *)metatable : nil;
+    return self;
+}
+
+- (LOLuaValue *)getInt:(int)key
+{
+    return LOTValueBox(LOTableGetInt(self, key));
+}
+
+- (void)setInt:(int)key value:(LOLuaValue *)value
+{
+    LOTableSetInt(self, key, LOTValueUnbox(value));
+}
+
+- (int)rawLen
+{
+    return LOTableLength(self);
+}
+
 @end
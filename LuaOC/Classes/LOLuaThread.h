@@ -6,7 +6,326 @@
 //
 
 #import "LOLuaValue.h"
+#import "LOUpValue.h"
 
-@interface LOLuaThread : LOLuaValue
+@class LOFrameVarargs;
+@class LOLuaError;
+
+/** Initial number of value slots in the stack of a main thread */
+#define LOLuaThreadStackSize 256
+/** Initial number of value slots in the stack of a coroutine, 320 bytes */
+#define LOLuaThreadCoroutineStackSize 40
+/** Default limit on the number of value slots, beyond which a call raises "stack overflow" */
+#define LOLuaThreadMaxStackSize 1000000
+/** Limit on nested native calls, each of which takes native stack; lua to lua calls take none */
+#define LOLuaThreadMaxCCalls 200
+
+/** Status of a coroutine, as reported by {@code coroutine.status} */
+typedef NS_ENUM(int, LOLuaThreadStatus) {
+    /** created and not started yet, or stopped in a yield */
+    LOLuaThreadStatusSuspended = 0,
+    LOLuaThreadStatusRunning,
+    /** active but not running: it resumed another coroutine */
+    LOLuaThreadStatusNormal,
+    /** finished its body or stopped with an error */
+    LOLuaThreadStatusDead,
+};
+
+/**
+ * One activation record of a thread's call stack.
+ * The function is borrowed; the caller keeps it alive for the call.
+ */
+typedef struct LOCallInfo {
+    /** the function running */
+    LOTValue function;
+    /** for lua functions the saved pc, the index of the next instruction; -1 for native functions */
+    int pc;
+    /** stack index of the function slot, results are moved here on return */
+    int func;
+    /** stack index of the first register or argument */
+    int base;
+    /** number of results the caller wants, -1 for all of them */
+    int nresults;
+} LOCallInfo;
+
+/**
+ * Subclass of {@link LuaValue} that implements
+ * a lua coroutine thread.
+ * <p>
+ * Each thread owns a value stack of {@link LOTValue}s.  Arguments for calls
+ * are pushed onto it, and the callee sees them through a
+ * {@link LOFrameVarargs}, a window onto the stack rather than a copy.
+ * Frame windows are pooled per call depth, so a call does not allocate;
+ * a callee that keeps its arguments beyond the call keeps a copy made by
+ * {@link LOVarargs#dealias}, as in LuaJ, and results that share the window
+ * are copied by the call.
+ * <p>
+ * The value stack starts small and doubles when a call needs more room
+ * than it has, up to a per thread maximum; running into the maximum, by
+ * runaway recursion for instance, raises a "stack overflow" lua error.
+ * Growing reallocates the stack, so stack slots are addressed by index,
+ * never by pointer, outside of short sections that cannot grow the stack:
+ * call records hold indices, frame windows read through {@code &_stack},
+ * and open upvalues are rebased when the stack moves.
+ * <p>
+ * Errors can travel without an Objective-C exception: a function records
+ * the error with {@link LOLuaThreadSetError} and returns, and every caller
+ * up to the nearest {@link #pcall:args:} checks {@link LOLuaThreadErrorPending}
+ * and returns as well.  Only when no protected call is active is a recorded
+ * error thrown as a {@link LuaError}, at the next call boundary.
+ * <p>
+ * A thread created with a function is a coroutine.  Coroutines are
+ * stackless: a lua body runs on the coroutine's own value stack in the
+ * interpreter loop of whoever resumes it, and a yield records the values
+ * and makes the interpreter return, leaving the lua frames where they are.
+ * Resuming delivers the values as the results of the call to yield and
+ * reenters the loop at the suspended frame.  A round trip is a few
+ * stores and no OS thread or queue is involved.  This works as long as
+ * nothing but lua frames lies between the resume and the yield; a yield
+ * from under a native frame (a metamethod, a native that calls back into
+ * lua) is an error for such a coroutine.
+ * <p>
+ * The fallback for code that must yield across native frames, and for
+ * bodies that are native functions, is a stackful coroutine: its body runs
+ * on an OS thread of its own and resume and yield hand control back and
+ * forth with semaphores, the way LuaJ runs all of its coroutines.
+ * The OS thread does not keep the coroutine alive: a suspended coroutine
+ * that is closed, or deallocated, wakes its body with an exception that
+ * unwinds it, and the OS thread ends.
+ * @see LuaValue
+ */
+@interface LOLuaThread : LOLuaValue {
+@public
+    LOTValue *_stack;
+    int _stackSize;
+    /** Size the stack may grow to */
+    int _maxStackSize;
+    int _top;
+    /** Recorded error value, nil when no error is pending */
+    LOLuaValue *_error;
+    /** Number of active protected calls */
+    int _nprotected;
+    /** Active calls, innermost last */
+    LOCallInfo *_callInfos;
+    int _callDepth;
+    int _callCapacity;
+    /** Upvalues still pointing into the stack, highest slot first; the list holds a reference */
+    LOUpValue *_openUpvalues;
+    /** Body of a coroutine, nil for a main thread */
+    LOLuaValue *_function;
+    LOLuaThreadStatus _status;
+    /** Number of active native calls on this thread */
+    int _nCcalls;
+    /** Set by a stackless yield while the interpreter returns to the resume */
+    BOOL _yielding;
+    /** Whether the body runs on its own OS thread */
+    BOOL _stackful;
+    /** Values passed between resume and yield */
+    LOVarargs *_transfer;
+}
+
+/**
+ * Create a coroutine running {@code function}.
+ * A lua function runs stackless, anything else on its own OS thread.
+ * @param function the body of the coroutine
+ */
+- (instancetype)initWithFunction:(LOLuaValue *)function;
+
+/**
+ * Create a coroutine running {@code function}.
+ * @param function the body of the coroutine
+ * @param stackful YES to run the body on its own OS thread, so that it may
+ * yield from under native frames
+ */
+- (instancetype)initWithFunction:(LOLuaValue *)function stackful:(BOOL)stackful;
+
+/**
+ * Start or continue the coroutine, as lua's {@code coroutine.resume} does.
+ * @param args the arguments of the body on the first resume, else the results of the yield
+ * @return {@code true} followed by the values passed to yield or returned by the body,
+ * or {@code false} and the error value
+ */
+- (LOVarargs *)resume:(LOVarargs *)args;
+
+/**
+ * Suspend the running coroutine, as lua's {@code coroutine.yield} does.
+ * <p>
+ * In a stackless coroutine this returns NONE at once and the interpreter
+ * unwinds to the resume, so the calling native function must return the
+ * result of this method directly.  In a stackful coroutine it blocks until
+ * the next resume and returns its arguments.
+ * @param args the values to pass to the resume
+ * @return the values passed to the next resume
+ * @throws LuaError when not called from a coroutine, or across a native frame
+ */
++ (LOVarargs *)yield:(LOVarargs *)args;
+
+/**
+ * Kill a suspended coroutine, as lua 5.4's {@code coroutine.close} does.
+ * Its open upvalues are closed, and a stackful body is unwound and its OS
+ * thread ends.  Does nothing to a dead coroutine.
+ * @throws LuaError if the coroutine is running or normal
+ */
+- (void)close;
+
+/**
+ * Size the value stack of this thread.
+ * <p>
+ * The stack is resized to {@code initialSize} slots, or to the slots in use
+ * if there are more, and may grow up to {@code maxSize} slots.  Use a small
+ * initial size for many mostly idle coroutines, and a small maximum to
+ * stop deep recursion early.
+ * @param initialSize number of slots to allocate now
+ * @param maxSize number of slots beyond which calls raise "stack overflow"
+ * @throws LuaError if a size is below 1
+ */
+- (void)setStackSize:(int)initialSize maxStackSize:(int)maxSize;
+
+/** Whether this is not a coroutine but the main thread of an OS thread */
+- (BOOL)isMainThread;
+
+/** Status as seen from the running thread: "suspended", "running", "normal" or "dead" */
+- (NSString *)statusName;
+
+/**
+ * Call {@code function} with the {@code nargs} values in stack slots
+ * [{@code base}, {@code base + nargs}) as its arguments.
+ * The slots from {@code base} upwards are popped when the call returns.
+ * @param function the function to call
+ * @param base stack index of the first argument
+ * @param nargs number of arguments
+ * @return the results of the call
+ */
+- (LOVarargs *)call:(LOLuaValue *)function base:(int)base nargs:(int)nargs;
+
+/**
+ * Call {@code function} with arguments copied onto this thread's value stack.
+ * @param function the function to call
+ * @param values the arguments, borrowed
+ * @param count number of arguments
+ * @return the results of the call
+ */
+- (LOVarargs *)call:(LOLuaValue *)function values:(const LOTValue *)values count:(int)count;
+
+/**
+ * Call {@code function} in protected mode, as lua's {@code pcall} does.
+ * <p>
+ * Errors recorded on this thread are collected here without unwinding,
+ * and a {@link LuaError} thrown by code that still raises is caught as well.
+ * @param function the function to call
+ * @param args the arguments
+ * @return {@code true} followed by the results of the call,
+ * or {@code false} and the error value
+ */
+- (LOVarargs *)pcall:(LOLuaValue *)function args:(LOVarargs *)args;
 
 @end
+
+/**
+ * Reserve {@code n} nil slots on top of the stack.
+ * @return stack index of the first reserved slot
+ * @throws LuaError on stack overflow
+ */
+FOUNDATION_EXTERN int LOLuaThreadReserve(LOLuaThread *L, int n);
+
+/** Release the values in slots [{@code base}, top) and make {@code base} the new top */
+FOUNDATION_EXTERN void LOLuaThreadPopTo(LOLuaThread *L, int base);
+
+/**
+ * The thread running lua code on the calling OS thread.  Outside of any call
+ * this is a main thread created on first use for each OS thread.
+ */
+FOUNDATION_EXTERN LOLuaThread *LOLuaThreadCurrent(void);
+
+/** The thread running lua code on the calling OS thread, nil outside of any call */
+FOUNDATION_EXTERN LOLuaThread *LOLuaThreadRunning(void);
+
+/**
+ * Make {@code L} the running thread of the calling OS thread.
+ * @return the previously running thread, to be restored when the call returns
+ */
+FOUNDATION_EXTERN LOLuaThread *LOLuaThreadSetRunning(LOLuaThread *L);
+
+/**
+ * Enter a call of {@code function}: push an activation record.
+ * @return the record, valid until the next push
+ */
+FOUNDATION_EXTERN LOCallInfo *LOLuaThreadPushCall(LOLuaThread *L, LOLuaValue *function);
+
+/** Leave the innermost call */
+static inline void LOLuaThreadPopCall(LOLuaThread *L)
+{
+    L->_callDepth--;
+}
+
+/**
+ * Record {@code error} as the pending error of {@code L}, replacing any previous one.
+ * @return {@link #NONE}, so a function can return the result directly
+ */
+FOUNDATION_EXTERN LOVarargs *LOLuaThreadSetError(LOLuaThread *L, LOLuaValue *error);
+
+/** Whether an error is recorded and the caller should return without further work */
+static inline BOOL LOLuaThreadErrorPending(LOLuaThread *L)
+{
+    return L->_error != nil;
+}
+
+/** Whether the interpreter must return to native code: an error is pending or the coroutine yields */
+static inline BOOL LOLuaThreadMustUnwind(LOLuaThread *L)
+{
+    return L->_error != nil || L->_yielding;
+}
+
+/**
+ * Take the pending error of {@code L} as a {@link LuaError}, clearing it.
+ * The error captures the call stack, so the frames that failed must still be on it.
+ */
+FOUNDATION_EXTERN LOLuaError *LOLuaThreadTakeError(LOLuaThread *L);
+
+/**
+ * Position of the function at call {@code level} in the "chunkname:currentline: "
+ * form that prefixes error messages, level 0 being the running function.
+ * Empty for a native function or a level beyond the call stack, as in luaL_where.
+ */
+FOUNDATION_EXTERN NSString *LOLuaThreadWhere(LOLuaThread *L, int level);
+
+/**
+ * Reallocate the stack to hold at least {@code size} slots, doubling it
+ * and moving the open upvalues along.  Pointers into the stack are invalid afterwards.
+ * @throws LuaError if {@code size} exceeds the maximum stack size
+ */
+FOUNDATION_EXTERN void LOLuaThreadGrowStack(LOLuaThread *L, int size);
+
+/**
+ * Raise the top to {@code top}, growing the stack if needed.
+ * Slots above the top are always nil, so the new slots need no clearing.
+ * @throws LuaError on stack overflow
+ */
+static inline void LOLuaThreadGrowTop(LOLuaThread *L, int top)
+{
+    if (top > L->_stackSize)
+        LOLuaThreadGrowStack(L, top);
+    if (top > L->_top)
+        L->_top = top;
+}
+
+/** The open upvalue for stack slot {@code index}, created if there is none yet.
+ * The result is borrowed from the open list, {@link LOUpValueRetain} it to keep it. */
+FOUNDATION_EXTERN LOUpValue *LOLuaThreadFindUpvalue(LOLuaThread *L, int index);
+
+FOUNDATION_EXTERN void LOLuaThreadCloseUpvaluesSlow(LOLuaThread *L, int level);
+
+/** Close the open upvalues for slots at or above {@code level}, copying their values off the stack */
+static inline void LOLuaThreadCloseUpvalues(LOLuaThread *L, int level)
+{
+    if (L->_openUpvalues && L->_openUpvalues->v >= &L->_stack[level])
+        LOLuaThreadCloseUpvaluesSlow(L, level);
+}
+
+/** Push a value onto the stack, retaining it */
+static inline void LOLuaThreadPush(LOLuaThread *L, LOTValue v)
+{
+    int i = LOLuaThreadReserve(L, 1);
+    LOTValueRetain(v);
+    L->_stack[i] = v;
+}
@@ -6,7 +6,542 @@
 //
 
 #import "LOLuaThread.h"
+#import "LOFrameVarargs.h"
+#import "LOLuaError.h"
+#import "LOLuaBoolean.h"
+#import "LOLuaClosure.h"
+#import "LOArrayVarargs.h"
 
+static __thread __unsafe_unretained LOLuaThread *_currentThread;
+
+LOLuaThread *LOLuaThreadCurrent(void)
+{
+    if (_currentThread)
+        return _currentThread;
+    NSMutableDictionary *dictionary = [NSThread currentThread].threadDictionary;
+    LOLuaThread *main = dictionary[@"LOLuaThread"];
+    if (!main) {
+        main = [[LOLuaThread alloc] init];
+        dictionary[@"LOLuaThread"] = main;
+    }
+    return main;
+}
+
+LOLuaThread *LOLuaThreadRunning(void)
+{
+    return _currentThread;
+}
+
+LOLuaThread *LOLuaThreadSetRunning(LOLuaThread *L)
+{
+    LOLuaThread *previous = _currentThread;
+    _currentThread = L;
+    return previous;
+}
+
+LOCallInfo *LOLuaThreadPushCall(LOLuaThread *L, LOLuaValue *function)
+{
+    if (L->_callDepth == L->_callCapacity) {
+        int capacity = L->_callCapacity ? L->_callCapacity * 2 : 8;
+        LOCallInfo *callInfos = realloc(L->_callInfos, capacity * sizeof(LOCallInfo));
+        if (!callInfos)
+            [LOLuaValue error:@"not enough memory"];
+        L->_callInfos = callInfos;
+        L->_callCapacity = capacity;
+    }
+    LOCallInfo *ci = &L->_callInfos[L->_callDepth++];
+    ci->function = LOTValueFromPointer((__bridge void *)function);
+    ci->pc = -1;
+    ci->func = -1;
+    ci->base = L->_top;
+    ci->nresults = -1;
+    return ci;
+}
+
+LOUpValue *LOLuaThreadFindUpvalue(LOLuaThread *L, int index)
+{
+    LOTValue *slot = &L->_stack[index];
+    LOUpValue **pp = &L->_openUpvalues;
+    LOUpValue *uv;
+    while ((uv = *pp) != NULL && uv->v >= slot) {
+        if (uv->v == slot)  /* found a corresponding upvalue? */
+            return uv;
+        pp = &uv->next;
+    }
+    /* not found: create a new one and link it in at its place */
+    uv = LOUpValueNewOpen(slot);
+    uv->next = *pp;
+    *pp = uv;
+    return uv;
+}
+
+void LOLuaThreadCloseUpvaluesSlow(LOLuaThread *L, int level)
+{
+    LOTValue *slot = &L->_stack[level];
+    LOUpValue *uv;
+    while ((uv = L->_openUpvalues) != NULL && uv->v >= slot) {
+        L->_openUpvalues = uv->next;
+        LOUpValueClose(uv);
+        LOUpValueRelease(uv);  /* the reference of the open list */
+    }
+}
+
+LOVarargs *LOLuaThreadSetError(LOLuaThread *L, LOLuaValue *error)
+{
+    L->_error = error ?: LOLuaValue.NIL;
+    return LOLuaValue.NONE;
+}
+
+LOLuaError *LOLuaThreadTakeError(LOLuaThread *L)
+{
+    LOLuaError *error = [LOLuaError errorWithMessageObject:L->_error];
+    L->_error = nil;
+    [error captureCallStack];
+    return error;
+}
+
+NSString *LOLuaThreadWhere(LOLuaThread *L, int level)
+{
+    if (level < 0 || level >= L->_callDepth)
+        return @"";
+    LOCallInfo *ci = &L->_callInfos[L->_callDepth - 1 - level];
+    LOLuaValue *function = LOTValueGetObject(ci->function);
+    if (ci->pc < 0 || function.type != LOLuaTypeFunction)
+        return @"";
+    // the saved pc is that of the next instruction
+    NSString *fileLine = [(LOLuaFunction *)function fileLine:MAX(ci->pc - 1, 0)];
+    return fileLine ? [fileLine stringByAppendingString:@": "] : @"";
+}
+
+/** Move the stack to {@code size} slots, nil filling new slots and rebasing the open upvalues */
+static void LOLuaThreadReallocStack(LOLuaThread *L, int size)
+{
+    // pointers into the old block are indeterminate once realloc frees it,
+    // so open upvalues keep their slot index in their unused cell meanwhile
+    LOUpValue *uv;
+    for (uv = L->_openUpvalues; uv; uv = uv->next)
+        uv->value = (LOTValue)(uv->v - L->_stack);
+    LOTValue *stack = realloc(L->_stack, size * sizeof(LOTValue));
+    if (!stack) {
+        for (uv = L->_openUpvalues; uv; uv = uv->next)
+            uv->value = LO_NIL;
+        [LOLuaValue error:@"not enough memory"];
+    }
+    for (int i = L->_stackSize; i < size; i++)
+        stack[i] = LO_NIL;
+    for (uv = L->_openUpvalues; uv; uv = uv->next) {
+        uv->v = stack + uv->value;
+        uv->value = LO_NIL;
+    }
+    L->_stack = stack;
+    L->_stackSize = size;
+}
+
+void LOLuaThreadGrowStack(LOLuaThread *L, int size)
+{
+    if (size > L->_maxStackSize)
+        [LOLuaValue error:@"stack overflow"];
+    int newSize = L->_stackSize * 2;
+    if (newSize < size)
+        newSize = size;
+    if (newSize > L->_maxStackSize)
+        newSize = L->_maxStackSize;
+    LOLuaThreadReallocStack(L, newSize);
+}
+
+int LOLuaThreadReserve(LOLuaThread *L, int n)
+{
+    int base = L->_top;
+    if (n > L->_stackSize - base)
+        LOLuaThreadGrowStack(L, base + n);
+    for (int i = 0; i < n; i++)
+        L->_stack[base + i] = LO_NIL;
+    L->_top = base + n;
+    return base;
+}
+
+void LOLuaThreadPopTo(LOLuaThread *L, int base)
+{
+    while (L->_top > base) {
+        LOTValue v = L->_stack[--L->_top];
+        L->_stack[L->_top] = LO_NIL;
+        LOTValueRelease(v);
+    }
+}
+
+/** {@code args} copied off any value stack, optionally behind {@code first} */
+static LOVarargs *LOLuaThreadCopyArgs(LOLuaValue *first, LOVarargs *args)
+{
+    int n = args.narg;
+    LOTValue values[n + 1];
+    int count = 0;
+    if (first)
+        values[count++] = LOTValueUnbox(first);
+    for (int i = 1; i <= n; i++)
+        values[count++] = LOVarargsArgValue(args, i);
+    return count ? [[LOArrayVarargs alloc] initWithValues:values count:count more:nil] : LOLuaValue.NONE;
+}
+
+/** Thrown by a yield woken to close its coroutine, unwinding the stackful body */
+@interface LOLuaThreadClose : NSObject
+@end
+@implementation LOLuaThreadClose
+@end
+
+@interface LOLuaThread () {
+    /** Handoff of a stackful coroutine: signalled by resume and by yield */
+    dispatch_semaphore_t _resumeSignal;
+    dispatch_semaphore_t _yieldSignal;
+    /** Set by close before waking a suspended stackful body */
+    BOOL _closing;
+}
+
+@property (nonatomic, strong) NSMutableArray<LOFrameVarargs *> *framePool;
+@property (nonatomic, assign) int frameDepth;
+
+- (void)runStackfulBody;
+
+@end
+
+/**
+ * Target of the OS thread of a stackful coroutine.  The thread retains its
+ * target, not the coroutine, so an abandoned coroutine is deallocated,
+ * and closes its body on the way.
+ */
+@interface LOStackfulBody : NSObject {
+@public
+    __unsafe_unretained LOLuaThread *_coroutine;
+}
+@end
+@implementation LOStackfulBody
+
+- (void)run
+{
+    [_coroutine runStackfulBody];
+}
+
+@end
 @implementation LOLuaThread
 
+- (instancetype)init
+{
+    if (self = [super init]) {
+        _maxStackSize = LOLuaThreadMaxStackSize;
+        LOLuaThreadReallocStack(self, LOLuaThreadStackSize);
+        _framePool = [NSMutableArray array];
+        _status = LOLuaThreadStatusRunning;
+    }
+    return self;
+}
+
+- (instancetype)initWithFunction:(LOLuaValue *)function
+{
+    return [self initWithFunction:function stackful:![function isKindOfClass:[LOLuaClosure class]]];
+}
+
+- (instancetype)initWithFunction:(LOLuaValue *)function stackful:(BOOL)stackful
+{
+    if (self = [self init]) {
+        _function = function;
+        // only lua frames can be suspended without a stack of their own
+        _stackful = stackful || ![function isKindOfClass:[LOLuaClosure class]];
+        _status = LOLuaThreadStatusSuspended;
+        if (!_stackful)
+            LOLuaThreadReallocStack(self, LOLuaThreadCoroutineStackSize);
+    }
+    return self;
+}
+
+- (void)setStackSize:(int)initialSize maxStackSize:(int)maxSize
+{
+    if (initialSize < 1 || maxSize < 1)
+        [LOLuaValue error:@"invalid stack size"];
+    // the slots above the top are nil, so they can be cut off
+    if (initialSize < _top)
+        initialSize = _top;
+    _maxStackSize = MAX(maxSize, initialSize);
+    if (initialSize != _stackSize)
+        LOLuaThreadReallocStack(self, initialSize);
+}
+
+- (void)dealloc
+{
+    // a suspended stackful body waits for a resume that can no longer come
+    if (_status == LOLuaThreadStatusSuspended && _resumeSignal)
+        [self close];
+    LOLuaThreadCloseUpvalues(self, 0);
+    LOLuaThreadPopTo(self, 0);
+    free(_stack);
+    free(_callInfos);
+}
+
+- (int)type
+{
+    return LOLuaTypeThread;
+}
+
+- (BOOL)isThread
+{
+    return YES;
+}
+
+- (LOLuaThread *)checkThread
+{
+    return self;
+}
+
+- (LOLuaThread *)optThread:(LOLuaThread *)defval
+{
+    return self;
+}
+
+- (NSString *)toNSString
+{
+    return [NSString stringWithFormat:@"thread: %p", self];
+}
+
+- (void)appendTo:(LOStringBuilder *)sb
+{
+    LOStringBuilderAppendAddress(sb, "thread", (__bridge void *)self);
+}
+
+- (LOVarargs *)call:(LOLuaValue *)function base:(int)base nargs:(int)nargs
+{
+    if (_nCcalls >= LOLuaThreadMaxCCalls) {
+        LOLuaThreadPopTo(self, base);
+        [LOLuaValue error:@"stack overflow (too many nested native calls)"];
+    }
+    if (_frameDepth == (int)_framePool.count)
+        [_framePool addObject:[[LOFrameVarargs alloc] initWithThread:self]];
+    __unsafe_unretained LOFrameVarargs *frame = _framePool[_frameDepth++];
+    frame->_base = base;
+    frame->_count = nargs;
+    frame->_slots = &_stack;
+    frame->_slotsBase = base;
+    frame->_slotsCount = nargs;
+
+    LOVarargs *results = nil;
+    LOLuaError *raised = nil;
+    __unsafe_unretained LOLuaThread *caller = _currentThread;
+    int depth = _callDepth;
+    _currentThread = self;
+    _nCcalls++;
+    LOLuaThreadPushCall(self, function)->base = base;
+    @try {
+        // the window is reused once the call returns: results must not share it
+        results = [[function invoke:frame] dealias];
+        // capture the stack while the function that failed is still on it
+        if (_error && _nprotected == 0)
+            raised = LOLuaThreadTakeError(self);
+    } @finally {
+        _nCcalls--;
+        _callDepth = depth;
+        _currentThread = caller;
+        // a window kept without dealias reads as empty rather than as stale slots
+        frame->_count = 0;
+        frame->_slotsCount = 0;
+        _frameDepth--;
+        LOLuaThreadPopTo(self, base);
+    }
+    if (raised)
+        @throw raised;
+    return results;
+}
+
+- (LOVarargs *)call:(LOLuaValue *)function values:(const LOTValue *)values count:(int)count
+{
+    int base = LOLuaThreadReserve(self, count);
+    for (int i = 0; i < count; i++) {
+        LOTValueRetain(values[i]);
+        _stack[base + i] = values[i];
+    }
+    return [self call:function base:base nargs:count];
+}
+
+- (LOVarargs *)pcall:(LOLuaValue *)function args:(LOVarargs *)args
+{
+    LOVarargs *results = nil;
+    __unsafe_unretained LOLuaThread *caller = _currentThread;
+    int top = _top;
+    int depth = _callDepth;
+    _currentThread = self;
+    _nprotected++;
+    LOLuaThreadPushCall(self, function);
+    @try {
+        results = [function invoke:args];
+    } @catch (LOLuaError *e) {
+        LOLuaThreadSetError(self, e.messageObject);
+    } @finally {
+        _callDepth = depth;
+        _nprotected--;
+        _currentThread = caller;
+    }
+    if (_error) {
+        LOLuaValue *error = _error;
+        _error = nil;
+        LOLuaThreadPopTo(self, top);
+        return [LOLuaValue varargsOf:[LOLuaBoolean defaultFalse] varargs:error];
+    }
+    return [LOLuaValue varargsOf:[LOLuaBoolean defaultTrue] varargs:results ?: LOLuaValue.NONE];
+}
+
+#pragma mark - coroutines
+
+- (BOOL)isMainThread
+{
+    return _function == nil;
+}
+
+- (NSString *)statusName
+{
+    if (self == LOLuaThreadCurrent())
+        return @"running";
+    switch (_status) {
+        case LOLuaThreadStatusSuspended: return @"suspended";
+        case LOLuaThreadStatusRunning: return @"running";
+        case LOLuaThreadStatusNormal: return @"normal";
+        default: return @"dead";
+    }
+}
+
+- (LOVarargs *)resume:(LOVarargs *)args
+{
+    if (_status == LOLuaThreadStatusDead)
+        return [LOLuaValue varargsOf:[LOLuaBoolean defaultFalse] varargs:[LOLuaValue valueOfString:@"cannot resume dead coroutine"]];
+    if (_status != LOLuaThreadStatusSuspended || _function == nil)
+        return [LOLuaValue varargsOf:[LOLuaBoolean defaultFalse] varargs:[LOLuaValue valueOfString:@"cannot resume non-suspended coroutine"]];
+
+    LOLuaThread *resumer = LOLuaThreadRunning();
+    if (resumer && !resumer.isMainThread)
+        resumer->_status = LOLuaThreadStatusNormal;
+    _status = LOLuaThreadStatusRunning;
+    LOVarargs *results = _stackful ? [self resumeStackful:args] : [self resumeStackless:args];
+    if (resumer && !resumer.isMainThread)
+        resumer->_status = LOLuaThreadStatusRunning;
+    return results;
+}
+
+- (LOVarargs *)resumeStackless:(LOVarargs *)args
+{
+    LOVarargs *results = nil;
+    LOLuaValue *error = nil;
+    LOLuaThread *resumer = LOLuaThreadSetRunning(self);
+    @try {
+        results = LOLuaClosureResume(self, args);
+    } @catch (LOLuaError *e) {
+        error = e.messageObject;
+    } @finally {
+        LOLuaThreadSetRunning(resumer);
+    }
+    if (_error) {
+        error = _error;
+        _error = nil;
+    }
+    if (error) {
+        // the frames are abandoned
+        LOLuaThreadCloseUpvalues(self, 0);
+        _callDepth = 0;
+        _yielding = NO;
+        _transfer = nil;
+        LOLuaThreadPopTo(self, 0);
+        _status = LOLuaThreadStatusDead;
+        return [LOLuaValue varargsOf:[LOLuaBoolean defaultFalse] varargs:error];
+    }
+    if (_yielding) {
+        _yielding = NO;
+        results = _transfer;
+        _transfer = nil;
+        _status = LOLuaThreadStatusSuspended;
+    } else {
+        _status = LOLuaThreadStatusDead;
+    }
+    return [LOLuaValue varargsOf:[LOLuaBoolean defaultTrue] varargs:results ?: LOLuaValue.NONE];
+}
+
+- (LOVarargs *)resumeStackful:(LOVarargs *)args
+{
+    // the body borrows the coroutine, which must outlive it while it runs
+    __attribute__((objc_precise_lifetime)) LOLuaThread *running = self;
+    // the body may still read the arguments after this resume has returned
+    _transfer = LOLuaThreadCopyArgs(nil, args);
+    if (_resumeSignal == nil) {
+        _resumeSignal = dispatch_semaphore_create(0);
+        _yieldSignal = dispatch_semaphore_create(0);
+        LOStackfulBody *body = [LOStackfulBody new];
+        body->_coroutine = running;
+        [[[NSThread alloc] initWithTarget:body selector:@selector(run) object:nil] start];
+    } else {
+        dispatch_semaphore_signal(_resumeSignal);
+    }
+    dispatch_semaphore_wait(_yieldSignal, DISPATCH_TIME_FOREVER);
+    LOVarargs *results = _transfer;
+    _transfer = nil;
+    return results;
+}
+
+- (void)runStackfulBody
+{
+    // the coroutine may be gone once the signal is sent
+    dispatch_semaphore_t done = _yieldSignal;
+    @autoreleasepool {
+        LOLuaThreadSetRunning(self);
+        @try {
+            LOVarargs *results = [self pcall:_function args:_transfer];
+            _transfer = LOLuaThreadCopyArgs(nil, results);
+        } @catch (LOLuaThreadClose *e) {
+            _transfer = nil;
+        }
+        _status = LOLuaThreadStatusDead;
+        LOLuaThreadSetRunning(nil);
+    }
+    dispatch_semaphore_signal(done);
+}
+
+- (void)close
+{
+    if (_status == LOLuaThreadStatusDead)
+        return;
+    if (_status != LOLuaThreadStatusSuspended || _function == nil)
+        [LOLuaValue error:@"cannot close a non-suspended coroutine"];
+    if (_stackful && _resumeSignal) {
+        // wake the body to unwind from its yield, and wait for its OS thread to finish
+        _closing = YES;
+        dispatch_semaphore_signal(_resumeSignal);
+        dispatch_semaphore_wait(_yieldSignal, DISPATCH_TIME_FOREVER);
+    }
+    // the frames are abandoned
+    LOLuaThreadCloseUpvalues(self, 0);
+    _callDepth = 0;
+    _yielding = NO;
+    _transfer = nil;
+    LOLuaThreadPopTo(self, 0);
+    _status = LOLuaThreadStatusDead;
+}
+
++ (LOVarargs *)yield:(LOVarargs *)args
+{
+    // a suspended body must not keep its coroutine alive
+    __unsafe_unretained LOLuaThread *L = LOLuaThreadCurrent();
+    if (L.isMainThread)
+        return [LOLuaValue error:@"attempt to yield from outside a coroutine"];
+    if (L->_stackful) {
+        L->_transfer = LOLuaThreadCopyArgs([LOLuaBoolean defaultTrue], args);
+        L->_status = LOLuaThreadStatusSuspended;
+        dispatch_semaphore_signal(L->_yieldSignal);
+        dispatch_semaphore_wait(L->_resumeSignal, DISPATCH_TIME_FOREVER);
+        if (L->_closing)
+            @throw [LOLuaThreadClose new];
+        LOVarargs *results = L->_transfer;
+        L->_transfer = nil;
+        return results;
+    }
+    // only the native call to yield may lie between the resume and here
+    if (L->_nCcalls > 1)
+        return [LOLuaValue error:@"attempt to yield across a C-call boundary"];
+    // the values outlive the call to yield
+    L->_transfer = [args dealias];
+    L->_yielding = YES;
+    return LOLuaValue.NONE;
+}
+
 @end
@@ -6,9 +6,66 @@
 //
 
 #import "LOVarargs.h"
+#import "LOTValue.h"
 
 @class LOLuaNil;
 
+/**
+ * Type enumeration constants for lua values, as returned by {@link #type()}.
+ * <p>
+ * {@link LOLuaTypeInt} is an extended type that is never returned by {@link #type()},
+ * {@link LOLuaTypeNone} is the type of an argument beyond the end of a {@link Varargs}.
+ */
+typedef NS_ENUM(int, LOLuaType) {
+    LOLuaTypeInt = -2,
+    LOLuaTypeNone = -1,
+    LOLuaTypeNil = 0,
+    LOLuaTypeBoolean = 1,
+    LOLuaTypeLightUserData = 2,
+    LOLuaTypeNumber = 3,
+    LOLuaTypeString = 4,
+    LOLuaTypeTable = 5,
+    LOLuaTypeFunction = 6,
+    LOLuaTypeUserData = 7,
+    LOLuaTypeThread = 8,
+    LOLuaTypeValue = 9,
+};
+
+/** String names for each type constant, indexed by {@link LOLuaType} */
+FOUNDATION_EXTERN NSString *LOLuaTypeName(int type);
+
+/**
+ * Events that can be handled by a metatag, in the order of the reference
+ * lua VM so that the ones checked on every table access come first.
+ * A metatable caches the events it has no handler for as bits of its
+ * {@code _flags}, see {@link LOTableFastTM}.
+ */
+typedef NS_ENUM(int, LOTagMethod) {
+    LOTagMethodIndex = 0,
+    LOTagMethodNewIndex,
+    LOTagMethodGC,
+    LOTagMethodMode,
+    LOTagMethodLen,
+    LOTagMethodEq,
+    LOTagMethodAdd,
+    LOTagMethodSub,
+    LOTagMethodMul,
+    LOTagMethodDiv,
+    LOTagMethodMod,
+    LOTagMethodPow,
+    LOTagMethodUnm,
+    LOTagMethodLt,
+    LOTagMethodLe,
+    LOTagMethodConcat,
+    LOTagMethodCall,
+    /** not an operator but the hook of {@code tostring}, cached like the others */
+    LOTagMethodToString,
+    LOTagMethodCount,
+};
+
+/** Interned name of the metatag for an event, such as {@code "__index"} */
+FOUNDATION_EXTERN LOLuaString *LOTagMethodName(LOTagMethod event);
+
 /**
  * Base class for all concrete lua type values.
  * <p>
@@ -94,12 +151,75 @@
  * @see LoadState
  * @see Varargs
  */
-@interface LOLuaValue : LOVarargs
+@interface LOLuaValue : LOVarargs {
+@public
+    /** The value of {@link #type}, cached when the value is created */
+    int _type;
+}
 
 /** LuaValue constant corresponding to lua {@code #NIL} */
 + (LOLuaValue *)NIL;
+
+/** LuaValue constant corresponding to a {@link Varargs} list of no values */
 + (LOLuaValue *)NONE;
 
+/** Construct a {@link Varargs} around an array of {@link LuaValue}s.
+ * <p>
+ * Picks the cheapest representation: {@link #NONE}, the single value itself,
+ * a pair, or an array backed list.
+ * @param values array of {@link LuaValue}s
+ * @return {@link Varargs} wrapping the supplied values.
+ */
++ (LOVarargs *)varargsOf:(NSArray<LOLuaValue *> *)values;
+
+/** Construct a {@link Varargs} around an array of {@link LuaValue}s followed by more values.
+ * @param values array of {@link LuaValue}s
+ * @param more {@link Varargs} values to return after the array, or nil
+ * @return {@link Varargs} wrapping the supplied values.
+ */
++ (LOVarargs *)varargsOf:(NSArray<LOLuaValue *> *)values more:(LOVarargs *)more;
+
+/** Construct a {@link Varargs} with a value prepended to another {@link Varargs}.
+ * <p>
+ * This is useful for returning a value followed by the results of another call,
+ * and costs at most one small object.
+ * @param v1 First {@link LuaValue} in the {@link Varargs}
+ * @param v2 {@link Varargs} supplying the remaining values
+ * @return {@link Varargs} wrapping the supplied values.
+ */
++ (LOVarargs *)varargsOf:(LOLuaValue *)v1 varargs:(LOVarargs *)v2;
+
+/** Construct a {@link Varargs} around a set of 2 or more {@link LuaValue}s.
+ * @param v1 First {@link LuaValue} in the {@link Varargs}
+ * @param v2 Second {@link LuaValue} in the {@link Varargs}
+ * @param v3 {@link Varargs} supplying the remaining values
+ * @return {@link Varargs} wrapping the supplied values.
+ */
++ (LOVarargs *)varargsOf:(LOLuaValue *)v1 value:(LOLuaValue *)v2 varargs:(LOVarargs *)v3;
+
+/** LuaValue constants corresponding to lua {@code true} and {@code false} */
++ (LOLuaValue *)valueOfBoolean:(BOOL)b;
+
+/** Convert java int to a {@link LuaValue}, using the shared instance for small values.
+ * @param i int value to convert
+ * @return {@link LuaInteger} instance, possibly pooled, whose value is i
+ */
++ (LOLuaInteger *)valueOfInt:(int)i;
+
+/** Convert java double to a {@link LuaValue}.
+ * This may return a {@link LuaInteger} or {@link LuaDouble} depending
+ * on the value supplied.
+ * @param d double value to convert
+ * @return {@link LuaNumber} instance, possibly pooled, whose value is d
+ */
++ (LOLuaNumber *)valueOfDouble:(double)d;
+
+/** Convert NSString to a {@link LuaString}, using the interned instance if there is one.
+ * @param s NSString value to convert, encoded as UTF-8
+ * @return {@link LuaString} instance, possibly pooled, whose value is s
+ */
++ (LOLuaString *)valueOfString:(NSString *)s;
+
 // type
 /** Get the enumeration value for the type of this value.
  * @return value for this type, one of
@@ -373,6 +493,14 @@
  */
 - (NSString *)toNSString;
 
+/**
+ * Append the string form of this value, as {@link #toNSString} gives it, to a builder.
+ * No {@code __tostring} metatag processing is done.
+ * @param sb the builder to append to
+ * @see LOTValueAppendToString
+ */
+- (void)appendTo:(LOStringBuilder *)sb;
+
 /** Convert to userdata instance, or null.
  * @return userdata instance if userdata, or null if not {@link LuaUserdata}
  * @see #optuserdata(Object)
@@ -865,6 +993,61 @@
  */
 - (LOLuaValue *)checkNotNil;
 
+/** Check that the value is a {@link LuaBoolean} without throwing.
+ * <p>
+ * The {@code tryCheck...} variants do what the corresponding {@code check...}
+ * method does, but report a failure by recording the error on the running
+ * {@link LOLuaThread} and returning NO instead of throwing, so a binding
+ * can bail out and return to the nearest protected call without an unwind.
+ * @param result receives the value on success, untouched on failure
+ * @return YES if the value had the expected type
+ * @see #checkboolean()
+ * @see LOLuaThread#pcall:args:
+ */
+- (BOOL)tryCheckBoolean:(BOOL *)result;
+
+/** Check that the value is numeric and fetch it as a double without throwing.
+ * @see #tryCheckBoolean:
+ * @see #checkdouble()
+ */
+- (BOOL)tryCheckDouble:(double *)result;
+
+/** Check that the value is numeric and fetch it as an int without throwing.
+ * @see #tryCheckBoolean:
+ * @see #checkint()
+ */
+- (BOOL)tryCheckInt:(int *)result;
+
+/** Check that the value is numeric and fetch it as a long without throwing.
+ * @see #tryCheckBoolean:
+ * @see #checklong()
+ */
+- (BOOL)tryCheckLong:(long *)result;
+
+/** Check that the value is a string without throwing.
+ * @see #tryCheckBoolean:
+ * @see #checkstring()
+ */
+- (BOOL)tryCheckString:(LOLuaString **)result;
+
+/** Check that the value is a table without throwing.
+ * @see #tryCheckBoolean:
+ * @see #checktable()
+ */
+- (BOOL)tryCheckTable:(LOLuaTable **)result;
+
+/** Check that the value is a function without throwing.
+ * @see #tryCheckBoolean:
+ * @see #checkfunction()
+ */
+- (BOOL)tryCheckFunction:(LOLuaFunction **)result;
+
+/** Check that this is not the value {@link #NIL} without throwing.
+ * @return YES if not nil, otherwise NO with an error recorded
+ * @see #checknotnil()
+ */
+- (BOOL)tryCheckNotNil;
+
 /** Return true if this is a valid key in a table index operation.
  * @return true if valid as a table key, otherwise false
  * @see #isnil()
@@ -872,6 +1055,52 @@
  */
 - (BOOL)isValidKey;
 
+/** Get the metatable for this {@link LuaValue}
+ * <p>
+ * For {@link LuaTable} and {@link LuaUserdata} instances,
+ * the metatable returned is this instance metatable.
+ * For all other types, the class metatable value will be returned.
+ * @return metatable, or nil if it there is none
+ */
+- (LOLuaTable *)getmetatable;
+
+/** Set the metatable for this {@link LuaValue}
+ * <p>
+ * For {@link LuaTable} and {@link LuaUserdata}, sets the instance metatable.
+ * For all other types, throws {@link LuaError}.
+ * @param metatable {@link LuaValue} instance to serve as the metatable, or nil or {@link #NIL} to clear it.
+ * @return {@code this}
+ * @throws LuaError if {@code this} is not a table or userdata.
+ */
+- (LOLuaValue *)setmetatable:(LOLuaValue *)metatable;
+
+/** Get a value in a table including metatag processing using {@link #INDEX}.
+ * @param key the key to look up, must not be {@link #NIL} or null
+ * @return {@link LuaValue} for that key, or {@link #NIL} if not found and no metatag
+ * @throws LuaError if {@code this} is not a table,
+ * or there is no {@link #INDEX} metatag,
+ * or key is {@link #NIL}
+ */
+- (LOLuaValue *)get:(LOLuaValue *)key;
+
+/** Set a value in a table including metatag processing using {@link #NEWINDEX}.
+ * @param key Key to set, must not be {@link #NIL} or null
+ * @param value Value to set, can be {@link #NIL}, must not be null
+ * @throws LuaError if there is no {@link #NEWINDEX} metatag,
+ * or key is {@link #NIL}
+ */
+- (void)set:(LOLuaValue *)key value:(LOLuaValue *)value;
+
+/** Call {@code this} with variable arguments and return the results.
+ * <p>
+ * For functions this runs the function; other values are called through
+ * their {@link #CALL} metatag, and without one it is an error.
+ * @param args {@link Varargs} containing the arguments, possibly a window onto a thread's stack
+ * @return All values returned from the call as a {@link Varargs} instance.
+ * @throws LuaError if not a function
+ */
+- (LOVarargs *)invoke:(LOVarargs *)args;
+
 /**
  * Throw a {@link LuaError} with a particular message
  * @param message String providing message details
@@ -939,4 +1168,70 @@
  */
 + (LOLuaValue *)argError:(int)iarg msg:(NSString *)msg;
 
+/**
+ * Record an error with a particular message on the running {@link LOLuaThread},
+ * the non-throwing counterpart of {@link #error:}.
+ * @param message String providing message details
+ * @return NO in all cases, so a failing check can return it directly
+ */
++ (BOOL)recordError:(NSString *)message;
+
+/**
+ * Record an error indicating an invalid argument was supplied to a function,
+ * the non-throwing counterpart of {@link #argError:}.
+ * @param expected String naming the type that was expected
+ * @return NO in all cases
+ */
+- (BOOL)recordArgError:(NSString *)expected;
+
+/**
+ * Record an error indicating an invalid argument was supplied to a function,
+ * the non-throwing counterpart of {@link #argError:msg:}.
+ * @param iarg index of the argument that was invalid, first index is 1
+ * @param msg String providing information about the invalid argument
+ * @return NO in all cases
+ */
++ (BOOL)recordArgError:(int)iarg msg:(NSString *)msg;
+
 @end
+
+/** Type of a value object, read from its cached tag */
+static inline int LOLuaValueType(LOLuaValue *value)
+{
+    return value->_type;
+}
+
+/** Type of an immediate: decoded from the tag, or read from the object's cached tag */
+static inline int LOTValueType(LOTValue v)
+{
+    switch (LOTValueTag(v)) {
+        case LOTVALUE_TAG_NIL: return LOLuaTypeNil;
+        case LOTVALUE_TAG_BOOLEAN: return LOLuaTypeBoolean;
+        case LOTVALUE_TAG_INT: return LOLuaTypeNumber;
+        case LOTVALUE_TAG_OBJECT: return LOTValueGetObject(v)->_type;
+        default: return LOLuaTypeNumber;
+    }
+}
+
+#pragma mark - metatag processing
+
+/** Throw the lua error for applying {@code operation} to a value of the wrong type, such as "attempt to index a nil value" */
+FOUNDATION_EXTERN void LOTValueTypeError(LOTValue v, NSString *operation);
+
+/** The lua index operation {@code t[key]} with {@link #INDEX} processing, result retained */
+FOUNDATION_EXTERN LOTValue LOTValueGetTable(LOTValue t, LOTValue key);
+
+/** The lua assignment {@code t[key] = value} with {@link #NEWINDEX} processing */
+FOUNDATION_EXTERN void LOTValueSetTable(LOTValue t, LOTValue key, LOTValue value);
+
+/** Metamethod of any value for {@code event}, borrowed, {@code LO_NIL} if none */
+FOUNDATION_EXTERN LOTValue LOTValueGetTM(LOTValue v, LOTagMethod event);
+
+/** Call a metamethod with {@code nargs} arguments on the running thread, first result retained */
+FOUNDATION_EXTERN LOTValue LOTValueCallTM(LOTValue tm, const LOTValue *args, int nargs);
+
+/** Append what lua's {@code tostring} gives for {@code v}, calling its {@code __tostring} metatag if any */
+FOUNDATION_EXTERN void LOTValueAppendToString(LOStringBuilder *sb, LOTValue v);
+
+/** Lua's {@code tostring}: the value itself for a string, otherwise a new string */
+FOUNDATION_EXTERN LOLuaString *LOTValueToLuaString(LOTValue v);
@@ -8,9 +8,201 @@
 #import "LOLuaValue.h"
 #import "LOLuaError.h"
 #import "LOLuaNil.h"
+#import "LOLuaBoolean.h"
+#import "LOLuaInteger.h"
+#import "LOLuaDouble.h"
+#import "LOLuaString.h"
+#import "LOLuaNone.h"
+#import "LOPairVarargs.h"
+#import "LOArrayVarargs.h"
+#import "LOLuaThread.h"
+#import "LOLuaTable.h"
+
+/** Limit for chains of {@code __index} and {@code __newindex} tables, to catch loops */
+#define LO_MAXTAGLOOP   100
+
+NSString *LOLuaTypeName(int type)
+{
+    switch (type) {
+        case LOLuaTypeNone: return @"no value";
+        case LOLuaTypeNil: return @"nil";
+        case LOLuaTypeBoolean: return @"boolean";
+        case LOLuaTypeLightUserData: return @"lightuserdata";
+        case LOLuaTypeNumber: return @"number";
+        case LOLuaTypeString: return @"string";
+        case LOLuaTypeTable: return @"table";
+        case LOLuaTypeFunction: return @"function";
+        case LOLuaTypeUserData: return @"userdata";
+        case LOLuaTypeThread: return @"thread";
+        default: return @"value";
+    }
+}
+
+LOLuaValue *LOTValueBox(LOTValue v)
+{
+    switch (LOTValueTag(v)) {
+        case LOTVALUE_TAG_NIL:
+            return [LOLuaNil defaultNil];
+        case LOTVALUE_TAG_BOOLEAN:
+            return v == LO_TRUE ? [LOLuaBoolean defaultTrue] : [LOLuaBoolean defaultFalse];
+        case LOTVALUE_TAG_INT:
+            return [LOLuaInteger valueOf:LOTValueGetInt(v)];
+        case LOTVALUE_TAG_OBJECT:
+            return LOTValueGetObject(v);
+        default:
+            return [[LOLuaDouble alloc] initWithDouble:LOTValueGetDouble(v)];
+    }
+}
+
+LOTValue LOTValueUnbox(LOLuaValue *value)
+{
+    if (value == nil)
+        return LO_NIL;
+    switch (value->_type) {
+        case LOLuaTypeNil:
+            return LO_NIL;
+        case LOLuaTypeBoolean:
+            return LOTValueFromBoolean(value.toBoolean);
+        case LOLuaTypeNumber:
+            return value.isIntType ? LOTValueFromInt(value.toInt) : LOTValueFromDouble(value.toDouble);
+        default:
+            return LOTValueFromPointer((__bridge void *)value);
+    }
+}
+
+LOLuaString *LOTagMethodName(LOTagMethod event)
+{
+    static __unsafe_unretained LOLuaString *names[LOTagMethodCount];
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        NSArray<NSString *> *events = @[@"__index", @"__newindex", @"__gc", @"__mode", @"__len", @"__eq",
+                                        @"__add", @"__sub", @"__mul", @"__div", @"__mod", @"__pow", @"__unm",
+                                        @"__lt", @"__le", @"__concat", @"__call", @"__tostring"];
+        for (int i = 0; i < LOTagMethodCount; i++)
+            names[i] = (__bridge LOLuaString *)CFBridgingRetain([LOLuaValue valueOfString:events[i]]);
+    });
+    return names[event];
+}
+
+#pragma mark - metatag processing
+
+void LOTValueTypeError(LOTValue v, NSString *operation)
+{
+    [LOLuaValue error:[NSString stringWithFormat:@"attempt to %@ a %@ value", operation, LOLuaTypeName(LOTValueType(v))]];
+}
+
+LOTValue LOTValueGetTM(LOTValue v, LOTagMethod event)
+{
+    int type = LOTValueType(v);
+    if (type == LOLuaTypeTable)
+        return LOTableFastTM(((__bridge LOLuaTable *)LOTValueGetPointer(v))->_metatable, event);
+    if ((unsigned)type > LOLuaTypeThread)
+        return LO_NIL;
+    return LOTableFastTM(LOTypeMetatables[type], event);
+}
+
+LOTValue LOTValueCallTM(LOTValue tm, const LOTValue *args, int nargs)
+{
+    __unsafe_unretained LOLuaThread *L = LOLuaThreadCurrent();
+    // a failed metamethod must unwind its native caller even under a
+    // protected call, so it raises, with its frame still on the stack
+    int nprotected = L->_nprotected;
+    L->_nprotected = 0;
+    LOVarargs *results;
+    @try {
+        results = [L call:LOTValueBox(tm) values:args count:nargs];
+    } @finally {
+        L->_nprotected = nprotected;
+    }
+    LOTValue v = results.narg > 0 ? LOVarargsArgValue(results, 1) : LO_NIL;
+    LOTValueRetain(v);
+    return v;
+}
+
+void LOTValueAppendToString(LOStringBuilder *sb, LOTValue v)
+{
+    LOTValue tm = LOTValueGetTM(v, LOTagMethodToString);
+    if (tm == LO_NIL) {
+        LOStringBuilderAppendValue(sb, v);
+        return;
+    }
+    LOTValue res = LOTValueCallTM(tm, &v, 1);
+    if (!(LOTValueIsObject(res) && LOTValueType(res) == LOLuaTypeString)) {
+        LOTValueRelease(res);
+        [LOLuaValue error:@"'__tostring' must return a string"];
+    }
+    LOLuaString *s = (LOLuaString *)LOTValueGetObject(res);
+    LOStringBuilderAppendBytes(sb, LOLuaStringBytes(s), s->_length);
+    LOTValueRelease(res);
+}
+
+LOLuaString *LOTValueToLuaString(LOTValue v)
+{
+    if (LOTValueIsObject(v) && LOTValueType(v) == LOLuaTypeString && LOTValueGetTM(v, LOTagMethodToString) == LO_NIL)
+        return (LOLuaString *)LOTValueGetObject(v);
+    LOStringBuilder *sb = LOStringBuilderAcquire();
+    @try {
+        LOTValueAppendToString(sb, v);
+        return LOStringBuilderToLuaString(sb);
+    } @finally {
+        LOStringBuilderRelease(sb);
+    }
+}
+
+LOTValue LOTValueGetTable(LOTValue t, LOTValue key)
+{
+    for (int loop = 0; loop < LO_MAXTAGLOOP; loop++) {
+        LOTValue tm = LO_NIL;
+        if (LOTValueType(t) == LOLuaTypeTable) {
+            __unsafe_unretained LOLuaTable *h = (__bridge LOLuaTable *)LOTValueGetPointer(t);
+            LOTValue res = LOTableGet(h, key);
+            if (res != LO_NIL || (tm = LOTableFastTM(h->_metatable, LOTagMethodIndex)) == LO_NIL) {
+                LOTValueRetain(res);
+                return res;
+            }
+        } else if ((tm = LOTValueGetTM(t, LOTagMethodIndex)) == LO_NIL) {
+            LOTValueTypeError(t, @"index");
+        }
+        if (LOTValueType(tm) == LOLuaTypeFunction)
+            return LOTValueCallTM(tm, (LOTValue[]){t, key}, 2);
+        t = tm;  /* else repeat with the __index table */
+    }
+    [LOLuaValue error:@"loop in gettable"];
+    return LO_NIL;
+}
+
+void LOTValueSetTable(LOTValue t, LOTValue key, LOTValue value)
+{
+    for (int loop = 0; loop < LO_MAXTAGLOOP; loop++) {
+        LOTValue tm = LO_NIL;
+        if (LOTValueType(t) == LOLuaTypeTable) {
+            __unsafe_unretained LOLuaTable *h = (__bridge LOLuaTable *)LOTValueGetPointer(t);
+            if (LOTableGet(h, key) != LO_NIL || (tm = LOTableFastTM(h->_metatable, LOTagMethodNewIndex)) == LO_NIL) {
+                LOTableSet(h, key, value);
+                return;
+            }
+        } else if ((tm = LOTValueGetTM(t, LOTagMethodNewIndex)) == LO_NIL) {
+            LOTValueTypeError(t, @"index");
+        }
+        if (LOTValueType(tm) == LOLuaTypeFunction) {
+            LOTValueRelease(LOTValueCallTM(tm, (LOTValue[]){t, key, value}, 3));
+            return;
+        }
+        t = tm;  /* else repeat with the __newindex table */
+    }
+    [LOLuaValue error:@"loop in settable"];
+}
 
 @implementation LOLuaValue
 
+- (instancetype)init
+{
+    if (self = [super init]) {
+        _type = self.type;
+    }
+    return self;
+}
+
 + (LOLuaValue *)NIL
 {
     return [LOLuaNil defaultNil];
@@ -18,7 +210,99 @@
 
 + (LOLuaValue *)NONE
 {
-    return [LOLuaNil defaultNil];
+    return [LOLuaNone defaultNone];
+}
+
++ (LOVarargs *)varargsOf:(NSArray<LOLuaValue *> *)values
+{
+    return [self varargsOf:values more:nil];
+}
+
++ (LOVarargs *)varargsOf:(NSArray<LOLuaValue *> *)values more:(LOVarargs *)more
+{
+    NSUInteger n = values.count;
+    if (n == 0)
+        return more ?: LOLuaValue.NONE;
+    if (n == 1)
+        return [self varargsOf:values[0] varargs:more];
+    if (n == 2 && more.narg == 0)
+        return [[LOPairVarargs alloc] initWithValue:values[0] varargs:values[1]];
+    LOTValue buffer[n];
+    for (NSUInteger i = 0; i < n; i++)
+        buffer[i] = LOTValueUnbox(values[i]);
+    return [[LOArrayVarargs alloc] initWithValues:buffer count:(int)n more:more];
+}
+
++ (LOVarargs *)varargsOf:(LOLuaValue *)v1 varargs:(LOVarargs *)v2
+{
+    return v2.narg == 0 ? v1 : [[LOPairVarargs alloc] initWithValue:v1 varargs:v2];
+}
+
++ (LOVarargs *)varargsOf:(LOLuaValue *)v1 value:(LOLuaValue *)v2 varargs:(LOVarargs *)v3
+{
+    if (v3.narg == 0)
+        return [[LOPairVarargs alloc] initWithValue:v1 varargs:v2];
+    return [[LOPairVarargs alloc] initWithValue:v1 varargs:[[LOPairVarargs alloc] initWithValue:v2 varargs:v3]];
+}
+
++ (LOLuaValue *)valueOfBoolean:(BOOL)b
+{
+    return b ? [LOLuaBoolean defaultTrue] : [LOLuaBoolean defaultFalse];
+}
+
++ (LOLuaInteger *)valueOfInt:(int)i
+{
+    return [LOLuaInteger valueOf:i];
+}
+
++ (LOLuaNumber *)valueOfDouble:(double)d
+{
+    LOTValue v = LOTValueFromNumber(d);
+    return (LOLuaNumber *)(LOTValueIsInt(v) ? [LOLuaInteger valueOf:LOTValueGetInt(v)] : [[LOLuaDouble alloc] initWithDouble:d]);
+}
+
++ (LOLuaString *)valueOfString:(NSString *)s
+{
+    return [LOLuaString valueOf:s];
+}
+
+- (int)type
+{
+    return LOLuaTypeValue;
+}
+
+- (LOLuaValue *)arg:(int)i
+{
+    return i == 1 ? self : LOLuaValue.NIL;
+}
+
+- (int)narg
+{
+    return 1;
+}
+
+- (LOLuaValue *)arg1
+{
+    return self;
+}
+
+- (LOTValue)argValue:(int)i
+{
+    return i == 1 ? LOTValueUnbox(self) : LO_NIL;
+}
+
+- (LOVarargs *)subArgs:(int)start
+{
+    if (start == 1)
+        return self;
+    if (start > 1)
+        return LOLuaValue.NONE;
+    return [LOLuaValue argError:1 msg:@"start must be > 0"];
+}
+
+- (NSString *)typeName
+{
+    return LOLuaTypeName(self.type);
 }
 
 - (BOOL)isBoolean
@@ -131,6 +415,11 @@
     return [NSString stringWithFormat:@"%@:%lu", self.typeName, self.hash];
 }
 
+- (void)appendTo:(LOStringBuilder *)sb
+{
+    LOStringBuilderAppendNSString(sb, self.toNSString);
+}
+
 - (id)toUserData
 {
     return nil;
@@ -346,14 +635,108 @@
     return self;
 }
 
+- (BOOL)tryCheckBoolean:(BOOL *)result
+{
+    if (_type != LOLuaTypeBoolean)
+        return [self recordArgError:@"boolean"];
+    *result = self.toBoolean;
+    return YES;
+}
+
+- (BOOL)tryCheckDouble:(double *)result
+{
+    if (_type != LOLuaTypeNumber && !self.isNumber)
+        return [self recordArgError:@"number"];
+    *result = self.checkDouble;
+    return YES;
+}
+
+- (BOOL)tryCheckInt:(int *)result
+{
+    if (_type != LOLuaTypeNumber && !self.isNumber)
+        return [self recordArgError:@"number"];
+    *result = self.checkInt;
+    return YES;
+}
+
+- (BOOL)tryCheckLong:(long *)result
+{
+    if (_type != LOLuaTypeNumber && !self.isNumber)
+        return [self recordArgError:@"number"];
+    *result = self.checkLong;
+    return YES;
+}
+
+- (BOOL)tryCheckString:(LOLuaString **)result
+{
+    if (_type != LOLuaTypeString)
+        return [self recordArgError:@"string"];
+    *result = (LOLuaString *)self;
+    return YES;
+}
+
+- (BOOL)tryCheckTable:(LOLuaTable **)result
+{
+    if (_type != LOLuaTypeTable)
+        return [self recordArgError:@"table"];
+    *result = (LOLuaTable *)self;
+    return YES;
+}
+
+- (BOOL)tryCheckFunction:(LOLuaFunction **)result
+{
+    if (_type != LOLuaTypeFunction)
+        return [self recordArgError:@"function"];
+    *result = (LOLuaFunction *)self;
+    return YES;
+}
+
+- (BOOL)tryCheckNotNil
+{
+    return _type > LOLuaTypeNil ? YES : [self recordArgError:@"value"];
+}
+
 - (BOOL)isValidKey
 {
     return YES;
 }
 
+- (LOLuaTable *)getmetatable
+{
+    return (unsigned)_type <= LOLuaTypeThread ? LOTypeMetatables[_type] : nil;
+}
+
+- (LOLuaValue *)setmetatable:(LOLuaValue *)metatable
+{
+    return [LOLuaValue error:[NSString stringWithFormat:@"cannot set metatable for a %@ value", self.typeName]];
+}
+
+- (LOLuaValue *)get:(LOLuaValue *)key
+{
+    LOTValue v = LOTValueGetTable(LOTValueUnbox(self), LOTValueUnbox(key));
+    LOLuaValue *value = LOTValueBox(v);
+    LOTValueRelease(v);
+    return value;
+}
+
+- (void)set:(LOLuaValue *)key value:(LOLuaValue *)value
+{
+    LOTValueSetTable(LOTValueUnbox(self), LOTValueUnbox(key), LOTValueUnbox(value));
+}
+
+- (LOVarargs *)invoke:(LOVarargs *)args
+{
+    LOTValue tm = LOTValueGetTM(LOTValueUnbox(self), LOTagMethodCall);
+    if (tm == LO_NIL)
+        return [LOLuaValue error:[NSString stringWithFormat:@"attempt to call a %@ value", self.typeName]];
+    return [LOTValueBox(tm) invoke:[LOLuaValue varargsOf:self varargs:args]];
+}
+
 + (LOLuaValue *)error:(NSString *)message
 {
-    @throw [LOLuaError exceptionWithName:@"LuaError" reason:message userInfo:nil];
+    LOLuaError *error = [LOLuaError exceptionWithName:@"LuaError" reason:message userInfo:nil];
+    [error captureCallStack];
+    @throw error;
 }
 
 
@@ -388,16 +771,36 @@
 
 - (LOLuaValue *)argError:(NSString *)expected
 {
-    @throw [LOLuaError exceptionWithName:@"LuaArgError"
-                                  reason:[NSString stringWithFormat:@"bad argument: %@ expected, got %@",expected, self.typeName]
-                                userInfo:nil];
+    LOLuaError *error = [LOLuaError exceptionWithName:@"LuaArgError"
+                                               reason:[NSString stringWithFormat:@"bad argument: %@ expected, got %@",expected, self.typeName]
+                                             userInfo:nil];
+    [error captureCallStack];
+    @throw error;
 }
 
 + (LOLuaValue *)argError:(int)iarg msg:(NSString *)msg
 {
-    @throw [LOLuaError exceptionWithName:@"LuaArgError"
-                                  reason:[NSString stringWithFormat:@"bad argument #%d : %@",iarg, msg]
-                                userInfo:nil];
+    LOLuaError *error = [LOLuaError exceptionWithName:@"LuaArgError"
+                                               reason:[NSString stringWithFormat:@"bad argument #%d : %@",iarg, msg]
+                                             userInfo:nil];
+    [error captureCallStack];
+    @throw error;
+}
+
++ (BOOL)recordError:(NSString *)message
+{
+    LOLuaThreadSetError(LOLuaThreadCurrent(), [LOLuaValue valueOfString:message]);
+    return NO;
+}
+
+- (BOOL)recordArgError:(NSString *)expected
+{
+    return [LOLuaValue recordError:[NSString stringWithFormat:@"bad argument: %@ expected, got %@",expected, self.typeName]];
+}
+
++ (BOOL)recordArgError:(int)iarg msg:(NSString *)msg
+{
+    return [LOLuaValue recordError:[NSString stringWithFormat:@"bad argument #%d : %@",iarg, msg]];
 }
 
 @end
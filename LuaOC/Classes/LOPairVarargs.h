@@ -0,0 +1,31 @@
+//
+//  LOPairVarargs.h
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import "LOVarargs.h"
+
+/** Varargs implementation backed by two values.
+ * <p>
+ * This is an internal class not intended to be used directly.
+ * Instead use the corresponding static method on LuaValue.
+ * <p>
+ * The second element may itself be any {@link Varargs}, so this also
+ * represents a single value prepended to a list of values.
+ *
+ * @see LuaValue#varargsOf(LuaValue, Varargs)
+ */
+@interface LOPairVarargs : LOVarargs
+
+/** Construct a Varargs from an two LuaValue.
+ * <p>
+ * This is an internal class not intended to be used directly.
+ * Instead use the corresponding static method on LuaValue.
+ *
+ * @see LuaValue#varargsOf(LuaValue, Varargs)
+ */
+- (instancetype)initWithValue:(LOLuaValue *)v1 varargs:(LOVarargs *)v2;
+
+@end
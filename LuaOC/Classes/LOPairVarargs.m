@@ -0,0 +1,65 @@
+//
+//  LOPairVarargs.m
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import "LOPairVarargs.h"
+#import "LOLuaValue.h"
+
+@interface LOPairVarargs ()
+
+@property (nonatomic, strong) LOLuaValue *v1;
+@property (nonatomic, strong) LOVarargs *v2;
+
+@end
+@implementation LOPairVarargs
+
+- (instancetype)initWithValue:(LOLuaValue *)v1 varargs:(LOVarargs *)v2
+{
+    if (self = [super init]) {
+        _v1 = v1;
+        _v2 = v2;
+    }
+    return self;
+}
+
+- (LOLuaValue *)arg:(int)i
+{
+    return i == 1 ? _v1 : [_v2 arg:i - 1];
+}
+
+- (LOTValue)argValue:(int)i
+{
+    return i == 1 ? LOTValueUnbox(_v1) : LOVarargsArgValue(_v2, i - 1);
+}
+
+- (int)narg
+{
+    return 1 + _v2.narg;
+}
+
+- (LOLuaValue *)arg1
+{
+    return _v1;
+}
+
+- (LOVarargs *)subArgs:(int)start
+{
+    if (start == 1)
+        return self;
+    if (start == 2)
+        return _v2;
+    if (start > 2)
+        return [_v2 subArgs:start - 1];
+    return [LOLuaValue argError:1 msg:@"start must be > 0"];
+}
+
+- (LOVarargs *)dealias
+{
+    LOVarargs *v2 = [_v2 dealias];
+    return v2 == _v2 ? self : [[LOPairVarargs alloc] initWithValue:_v1 varargs:v2];
+}
+
+@end
@@ -0,0 +1,99 @@
+//
+//  LOPrototype.h
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import <Foundation/Foundation.h>
+#import "LOTValue.h"
+#import "LOLuaTable.h"
+
+@class LOLuaString;
+
+/**
+ * Description of an upvalue of a {@link LOPrototype}: where the closure
+ * finds it when it is created, and its name for debugging.
+ */
+typedef struct LOUpvalDesc {
+    /** Name of the upvalue, a {@link LuaString} or {@code LO_NIL} if stripped */
+    LOTValue name;
+    /** Whether the upvalue is a register of the enclosing function, else one of its upvalues */
+    BOOL instack;
+    /** Register or upvalue index in the enclosing function */
+    uint8_t idx;
+} LOUpvalDesc;
+
+/** Debug information about a local variable: its name and the pcs where it is active */
+typedef struct LOLocVar {
+    LOTValue varname;
+    int startpc;
+    int endpc;
+} LOLocVar;
+
+/**
+ * Prototype representing compiled lua code.
+ * <p>
+ * This is both a straight translation of the corresponding C type,
+ * and the main data structure for execution of compiled lua bytecode.
+ * <p>
+ * Generally, the {@link Prototype} is not constructed directly is an intermediate result
+ * as lua code is loaded using {@link LOLoadState#undump:name:}.
+ * <p>
+ * The arrays are plain C arrays so the interpreter can index them directly.
+ * Constants are {@link LOTValue}s owned by the prototype.
+ * @see LOLoadState
+ */
+@interface LOPrototype : NSObject {
+@public
+    /* constants used by the function */
+    LOTValue *_k;
+    int _kSize;
+    int *_code;
+    int _codeSize;
+    /* functions defined inside the function */
+    NSArray<LOPrototype *> *_p;
+    /* map from opcodes to source lines */
+    int *_lineinfo;
+    int _lineinfoSize;
+    /* information about local variables */
+    LOLocVar *_locvars;
+    int _locvarsSize;
+    /* upvalue information */
+    LOUpvalDesc *_upvalues;
+    int _upvaluesSize;
+    LOLuaString *_source;
+    int _linedefined;
+    int _lastlinedefined;
+    int _numparams;
+    BOOL _isVararg;
+    int _maxstacksize;
+    /* inline caches of the field accesses, one per pc, allocated on first run */
+    LOFieldCache *_fieldCaches;
+    /* machine code of a hot prototype and its size, see LOJIT */
+    void *_jitCode;
+    size_t _jitSize;
+    /* frame entries and loop iterations counted towards compiling it */
+    int _hotness;
+}
+
+/** Short name of the chunk, as used in error messages: the source without its '@' or '=' prefix */
+- (NSString *)shortSource;
+
+/** Get the name of a local variable.
+ *
+ * @param number the local variable number to look up
+ * @param pc the program counter
+ * @return the name, or nil if not found
+ */
+- (LOLuaString *)getLocalName:(int)number pc:(int)pc;
+
+@end
+
+FOUNDATION_EXTERN LOFieldCache *LOPrototypeAllocFieldCaches(LOPrototype *p);
+
+/** The field caches of {@code p}, indexed by pc */
+static inline LOFieldCache *LOPrototypeFieldCaches(LOPrototype *p)
+{
+    return p->_fieldCaches ?: LOPrototypeAllocFieldCaches(p);
+}
@@ -0,0 +1,64 @@
+//
+//  LOPrototype.m
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import "LOPrototype.h"
+#import "LOLuaString.h"
+#import "LOJIT.h"
+
+LOFieldCache *LOPrototypeAllocFieldCaches(LOPrototype *p)
+{
+    p->_fieldCaches = calloc(MAX(p->_codeSize, 1), sizeof(LOFieldCache));
+    return p->_fieldCaches;
+}
+
+@implementation LOPrototype
+
+- (void)dealloc
+{
+    for (int i = 0; i < _kSize; i++)
+        LOTValueRelease(_k[i]);
+    for (int i = 0; i < _locvarsSize; i++)
+        LOTValueRelease(_locvars[i].varname);
+    for (int i = 0; i < _upvaluesSize; i++)
+        LOTValueRelease(_upvalues[i].name);
+    free(_k);
+    free(_code);
+    free(_lineinfo);
+    free(_locvars);
+    free(_upvalues);
+    free(_fieldCaches);
+    LOJITFree(self);
+}
+
+- (NSString *)shortSource
+{
+    NSString *name = _source.toNSString ?: @"?";
+    if ([name hasPrefix:@"@"] || [name hasPrefix:@"="])
+        return [name substringFromIndex:1];
+    if ([name hasPrefix:@"\033"])
+        return @"binary string";
+    return name;
+}
+
+- (LOLuaString *)getLocalName:(int)number pc:(int)pc
+{
+    for (int i = 0; i < _locvarsSize && _locvars[i].startpc <= pc; i++) {
+        if (pc < _locvars[i].endpc) {  /* is variable active? */
+            number--;
+            if (number == 0)
+                return (LOLuaString *)LOTValueGetObject(_locvars[i].varname);
+        }
+    }
+    return nil;  /* not found */
+}
+
+- (NSString *)description
+{
+    return [NSString stringWithFormat:@"<%@:%d>", self.shortSource, _linedefined];
+}
+
+@end
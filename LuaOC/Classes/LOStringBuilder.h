@@ -0,0 +1,91 @@
+//
+//  LOStringBuilder.h
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import <Foundation/Foundation.h>
+#import "LOTValue.h"
+
+@class LOLuaString;
+
+/** A builder keeps at most this many bytes of buffer between uses */
+#define LOStringBuilderMaxRetainedCapacity (64 * 1024)
+
+/** Byte buffer for building strings
+ * <p>
+ * A growable array of bytes that values serialize themselves into with
+ * {@link LOLuaValue#appendTo:}, so that {@code tostring}, {@code print} and
+ * the debug description of a {@link LOVarargs} produce their text without a
+ * temporary string per value.  Bytes are lua string bytes: lua strings are
+ * appended as they are, whatever their encoding.
+ * <p>
+ * Each OS thread has one builder that is reused from call to call, so in the
+ * steady state building a string allocates nothing but the result.
+ * {@link LOStringBuilderAcquire} hands it out, or a fresh builder when it is
+ * already in use further up the native stack, e.g. by a {@code __tostring}
+ * metamethod that calls {@code tostring} itself.  Every builder acquired
+ * must be given back with {@link LOStringBuilderRelease}.
+ * @see LOLuaValue#appendTo:
+ */
+typedef struct LOStringBuilder {
+    unsigned char *bytes;
+    int length;
+    int capacity;
+    /** whether this is the builder of the thread, which is kept after release */
+    BOOL shared;
+} LOStringBuilder;
+
+/** An empty builder, the one of the calling thread unless it is in use */
+FOUNDATION_EXTERN LOStringBuilder *LOStringBuilderAcquire(void);
+
+/** Give back a builder from {@link LOStringBuilderAcquire}; its bytes are gone */
+FOUNDATION_EXTERN void LOStringBuilderRelease(LOStringBuilder *sb);
+
+/** Make room for {@code n} more bytes */
+FOUNDATION_EXTERN void LOStringBuilderGrow(LOStringBuilder *sb, int n);
+
+/** The bytes built so far as a new lua string */
+FOUNDATION_EXTERN LOLuaString *LOStringBuilderToLuaString(LOStringBuilder *sb);
+
+/** The bytes built so far decoded as UTF-8, or as Latin-1 if they are not valid UTF-8 */
+FOUNDATION_EXTERN NSString *LOStringBuilderToNSString(LOStringBuilder *sb);
+
+static inline void LOStringBuilderAppendBytes(LOStringBuilder *sb, const void *bytes, int n)
+{
+    if (sb->capacity - sb->length < n)
+        LOStringBuilderGrow(sb, n);
+    memcpy(sb->bytes + sb->length, bytes, n);
+    sb->length += n;
+}
+
+static inline void LOStringBuilderAppendChar(LOStringBuilder *sb, char c)
+{
+    if (sb->length == sb->capacity)
+        LOStringBuilderGrow(sb, 1);
+    sb->bytes[sb->length++] = (unsigned char)c;
+}
+
+static inline void LOStringBuilderAppendCString(LOStringBuilder *sb, const char *s)
+{
+    LOStringBuilderAppendBytes(sb, s, (int)strlen(s));
+}
+
+/** Append the UTF-8 bytes of {@code s} */
+FOUNDATION_EXTERN void LOStringBuilderAppendNSString(LOStringBuilder *sb, NSString *s);
+
+/** Append an int in decimal */
+FOUNDATION_EXTERN void LOStringBuilderAppendInt(LOStringBuilder *sb, int i);
+
+/** Append a number as lua's {@code tostring} formats it */
+FOUNDATION_EXTERN void LOStringBuilderAppendDouble(LOStringBuilder *sb, double d);
+
+/** Append {@code "<prefix>: <address>"}, the way tables, functions and threads print */
+FOUNDATION_EXTERN void LOStringBuilderAppendAddress(LOStringBuilder *sb, const char *prefix, const void *p);
+
+/**
+ * Append the plain string form of a value, without {@code __tostring}:
+ * immediates are formatted in place, objects append themselves.
+ */
+FOUNDATION_EXTERN void LOStringBuilderAppendValue(LOStringBuilder *sb, LOTValue v);
@@ -0,0 +1,112 @@
+//
+//  LOStringBuilder.m
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import "LOStringBuilder.h"
+#import "LOLuaString.h"
+#import "LOLuaNumber.h"
+
+static __thread LOStringBuilder _threadBuilder = { NULL, 0, 0, YES };
+static __thread BOOL _threadBuilderInUse;
+
+LOStringBuilder *LOStringBuilderAcquire(void)
+{
+    if (!_threadBuilderInUse) {
+        _threadBuilderInUse = YES;
+        _threadBuilder.length = 0;
+        return &_threadBuilder;
+    }
+    return calloc(1, sizeof(LOStringBuilder));
+}
+
+void LOStringBuilderRelease(LOStringBuilder *sb)
+{
+    if (sb->shared) {
+        // keep the buffer for the next string, unless a huge one made it huge
+        if (sb->capacity > LOStringBuilderMaxRetainedCapacity) {
+            free(sb->bytes);
+            sb->bytes = NULL;
+            sb->capacity = 0;
+        }
+        sb->length = 0;
+        _threadBuilderInUse = NO;
+        return;
+    }
+    free(sb->bytes);
+    free(sb);
+}
+
+void LOStringBuilderGrow(LOStringBuilder *sb, int n)
+{
+    if (n > INT_MAX - sb->length)
+        [NSException raise:NSMallocException format:@"string length overflow"];
+    int capacity = sb->capacity ? sb->capacity : 64;
+    while (capacity - sb->length < n)
+        capacity = capacity > INT_MAX / 2 ? INT_MAX : capacity * 2;
+    sb->bytes = realloc(sb->bytes, capacity);
+    sb->capacity = capacity;
+}
+
+LOLuaString *LOStringBuilderToLuaString(LOStringBuilder *sb)
+{
+    return [LOLuaString valueOfBytes:sb->bytes length:sb->length];
+}
+
+NSString *LOStringBuilderToNSString(LOStringBuilder *sb)
+{
+    return [[NSString alloc] initWithBytes:sb->bytes length:sb->length encoding:NSUTF8StringEncoding]
+        ?: [[NSString alloc] initWithBytes:sb->bytes length:sb->length encoding:NSISOLatin1StringEncoding];
+}
+
+void LOStringBuilderAppendNSString(LOStringBuilder *sb, NSString *s)
+{
+    NSUInteger n = [s lengthOfBytesUsingEncoding:NSUTF8StringEncoding];
+    if (n > INT_MAX)
+        [NSException raise:NSMallocException format:@"string length overflow"];
+    if (sb->capacity - sb->length < (int)n)
+        LOStringBuilderGrow(sb, (int)n);
+    [s getBytes:sb->bytes + sb->length maxLength:n usedLength:&n encoding:NSUTF8StringEncoding
+        options:0 range:NSMakeRange(0, s.length) remainingRange:NULL];
+    sb->length += (int)n;
+}
+
+void LOStringBuilderAppendInt(LOStringBuilder *sb, int i)
+{
+    if (sb->capacity - sb->length < 12)
+        LOStringBuilderGrow(sb, 12);
+    sb->length += LOLuaNumberFormatInt(i, (char *)sb->bytes + sb->length);
+}
+
+void LOStringBuilderAppendDouble(LOStringBuilder *sb, double d)
+{
+    if (sb->capacity - sb->length < LOLuaNumberMaxFormatLength)
+        LOStringBuilderGrow(sb, LOLuaNumberMaxFormatLength);
+    sb->length += LOLuaNumberFormat(d, (char *)sb->bytes + sb->length);
+}
+
+void LOStringBuilderAppendAddress(LOStringBuilder *sb, const char *prefix, const void *p)
+{
+    char buf[32];
+    LOStringBuilderAppendCString(sb, prefix);
+    LOStringBuilderAppendBytes(sb, buf, snprintf(buf, sizeof(buf), ": %p", p));
+}
+
+void LOStringBuilderAppendValue(LOStringBuilder *sb, LOTValue v)
+{
+    if (LOTValueIsInt(v)) {
+        LOStringBuilderAppendInt(sb, LOTValueGetInt(v));
+    } else if (LOTValueIsDouble(v)) {
+        LOStringBuilderAppendDouble(sb, LOTValueGetDouble(v));
+    } else if (v == LO_NIL) {
+        LOStringBuilderAppendBytes(sb, "nil", 3);
+    } else if (v == LO_TRUE) {
+        LOStringBuilderAppendBytes(sb, "true", 4);
+    } else if (v == LO_FALSE) {
+        LOStringBuilderAppendBytes(sb, "false", 5);
+    } else {
+        [LOTValueGetObject(v) appendTo:sb];
+    }
+}
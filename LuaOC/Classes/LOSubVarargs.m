@@ -7,6 +7,7 @@
 
 #import "LOSubVarargs.h"
 #import "LOLuaValue.h"
+#import "LOPairVarargs.h"
 
 @interface LOSubVarargs ()
 
@@ -33,6 +34,12 @@
     return i>=_start && i<=_end? [_v arg:i]: LOLuaValue.NIL;
 }
 
+- (LOTValue)argValue:(int)i
+{
+    i += _start-1;
+    return i>=_start && i<=_end? LOVarargsArgValue(_v, i): LO_NIL;
+}
+
 - (LOLuaValue *)arg1
 {
     return [_v arg:_start];
@@ -45,20 +52,24 @@
 
 - (LOVarargs *)subArgs:(int)start
 {
+    if (start <= 0)
+        return [LOLuaValue argError:1 msg:@"start must be > 0"];
     if (start == 1)
         return self;
-    int newstart = self.start + start - 1;
-    if (start > 0) {
-//        if (newstart >= self.end)
-//            return LuaValue.NONE;
-//        if (newstart == self.end)
-//            return v.arg(self.end);
-//        if (newstart == self.end-1)
-//            return new Varargs.PairVarargs(v.arg(this.end-1), v.arg(this.end));
-//        return new SubVarargs(v, newstart, this.end);
-    }
-//    return new SubVarargs(v, newstart, this.end);
-    return nil;
+    int newstart = _start + start - 1;
+    if (newstart > _end)
+        return LOLuaValue.NONE;
+    if (newstart == _end)
+        return [_v arg:_end];
+    if (newstart == _end - 1)
+        return [[LOPairVarargs alloc] initWithValue:[_v arg:_end - 1] varargs:[_v arg:_end]];
+    return [[LOSubVarargs alloc] initWithVarargs:_v start:newstart end:_end];
+}
+
+- (LOVarargs *)dealias
+{
+    LOVarargs *v = [_v dealias];
+    return v == _v ? self : [[LOSubVarargs alloc] initWithVarargs:v start:_start end:_end];
 }
 
 @end
@@ -0,0 +1,204 @@
+//
+//  LOTValue.h
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import <Foundation/Foundation.h>
+
+@class LOLuaValue;
+
+/**
+ * Immediate representation of a lua value, used wherever the runtime stores
+ * values in bulk: value stacks, table slots, constants and upvalues.
+ * <p>
+ * A {@code LOTValue} is a NaN-boxed 64 bit word.  Every bit pattern that is
+ * an ordinary IEEE double (including the canonical quiet NaN) is a number.
+ * The remaining negative quiet NaN space carries a 17 bit tag in bits 63..47
+ * and a 47 bit payload:
+ * <ul>
+ * <li>{@code nil}, {@code true} and {@code false}</li>
+ * <li>32 bit integers, the equivalent of {@link LOLuaInteger}</li>
+ * <li>a pointer to a heap {@link LOLuaValue} (strings, tables, functions, ...)</li>
+ * </ul>
+ * Numbers and booleans therefore never allocate, and the type tests and
+ * unboxing below are a shift and a compare instead of a message send.
+ * <p>
+ * Object payloads are owned: a slot holding an object keeps one retain on it.
+ * Use {@link LOTValueAssign} to store into a slot, and {@link LOTValueRetain} /
+ * {@link LOTValueRelease} when moving values around by hand.
+ * Values returned from accessors are borrowed unless documented otherwise.
+ *
+ * @see LOLuaValue
+ */
+typedef uint64_t LOTValue;
+
+#define LOTVALUE_TAG_SHIFT      47
+#define LOTVALUE_PAYLOAD_MASK   ((1ULL << LOTVALUE_TAG_SHIFT) - 1)
+
+/** Highest tag that is still a double: 0xFFF8000000000000, the x86 default NaN */
+#define LOTVALUE_TAG_MAXDOUBLE  0x1FFF0u
+#define LOTVALUE_TAG_NIL        0x1FFF1u
+#define LOTVALUE_TAG_BOOLEAN    0x1FFF2u
+#define LOTVALUE_TAG_INT        0x1FFF3u
+#define LOTVALUE_TAG_OBJECT     0x1FFF4u
+
+#define LOTVALUE_MAKE(tag, payload) (((LOTValue)(tag) << LOTVALUE_TAG_SHIFT) | (LOTValue)(payload))
+
+#define LO_NIL      LOTVALUE_MAKE(LOTVALUE_TAG_NIL, 0)
+#define LO_FALSE    LOTVALUE_MAKE(LOTVALUE_TAG_BOOLEAN, 0)
+#define LO_TRUE     LOTVALUE_MAKE(LOTVALUE_TAG_BOOLEAN, 1)
+#define LO_NAN      0x7FF8000000000000ULL
+
+#pragma mark - type tests
+
+static inline uint32_t LOTValueTag(LOTValue v)
+{
+    return (uint32_t)(v >> LOTVALUE_TAG_SHIFT);
+}
+
+static inline BOOL LOTValueIsNil(LOTValue v)
+{
+    return v == LO_NIL;
+}
+
+static inline BOOL LOTValueIsBoolean(LOTValue v)
+{
+    return LOTValueTag(v) == LOTVALUE_TAG_BOOLEAN;
+}
+
+static inline BOOL LOTValueIsInt(LOTValue v)
+{
+    return LOTValueTag(v) == LOTVALUE_TAG_INT;
+}
+
+static inline BOOL LOTValueIsDouble(LOTValue v)
+{
+    return LOTValueTag(v) <= LOTVALUE_TAG_MAXDOUBLE;
+}
+
+static inline BOOL LOTValueIsNumber(LOTValue v)
+{
+    return LOTValueTag(v) <= LOTVALUE_TAG_MAXDOUBLE || LOTValueTag(v) == LOTVALUE_TAG_INT;
+}
+
+static inline BOOL LOTValueIsObject(LOTValue v)
+{
+    return LOTValueTag(v) == LOTVALUE_TAG_OBJECT;
+}
+
+/** Lua truthiness: everything except {@code nil} and {@code false} is true */
+static inline BOOL LOTValueToBoolean(LOTValue v)
+{
+    return v != LO_NIL && v != LO_FALSE;
+}
+
+#pragma mark - construction and unboxing
+
+static inline LOTValue LOTValueFromBoolean(BOOL b)
+{
+    return b ? LO_TRUE : LO_FALSE;
+}
+
+static inline LOTValue LOTValueFromInt(int i)
+{
+    return LOTVALUE_MAKE(LOTVALUE_TAG_INT, (uint32_t)i);
+}
+
+static inline int LOTValueGetInt(LOTValue v)
+{
+    return (int)(uint32_t)v;
+}
+
+/** Box a double as is, canonicalizing NaN payloads so they cannot alias a tag */
+static inline LOTValue LOTValueFromDouble(double d)
+{
+    LOTValue v;
+    if (d != d)
+        return LO_NAN;
+    memcpy(&v, &d, sizeof(v));
+    return v;
+}
+
+static inline double LOTValueGetDouble(LOTValue v)
+{
+    double d;
+    memcpy(&d, &v, sizeof(d));
+    return d;
+}
+
+/**
+ * Box a number, choosing the int representation when {@code d} is integral
+ * and fits in an int, as {@code LuaValue.valueOf(double)} does.
+ */
+static inline LOTValue LOTValueFromNumber(double d)
+{
+    if (d >= INT_MIN && d <= INT_MAX) {
+        int i = (int)d;
+        if (d == (double)i && !(i == 0 && signbit(d)))
+            return LOTValueFromInt(i);
+    }
+    return LOTValueFromDouble(d);
+}
+
+/** Numeric value of an int or double, 0 for anything else */
+static inline double LOTValueToDouble(LOTValue v)
+{
+    if (LOTValueIsInt(v))
+        return (double)LOTValueGetInt(v);
+    if (LOTValueIsDouble(v))
+        return LOTValueGetDouble(v);
+    return 0;
+}
+
+/** Borrowed object payload as a plain pointer, NULL if not an object */
+static inline void *LOTValueGetPointer(LOTValue v)
+{
+    return LOTValueIsObject(v) ? (void *)(uintptr_t)(v & LOTVALUE_PAYLOAD_MASK) : NULL;
+}
+
+static inline LOTValue LOTValueFromPointer(const void *p)
+{
+    return LOTVALUE_MAKE(LOTVALUE_TAG_OBJECT, (uintptr_t)p);
+}
+
+#define LOTValueGetObject(v)   ((__bridge LOLuaValue *)LOTValueGetPointer(v))
+
+#pragma mark - ownership
+
+static inline void LOTValueRetain(LOTValue v)
+{
+    if (LOTValueIsObject(v))
+        CFRetain((CFTypeRef)LOTValueGetPointer(v));
+}
+
+static inline void LOTValueRelease(LOTValue v)
+{
+    if (LOTValueIsObject(v))
+        CFRelease((CFTypeRef)LOTValueGetPointer(v));
+}
+
+/** Store {@code v} into an owned slot, retaining the new and releasing the old value */
+static inline void LOTValueAssign(LOTValue *slot, LOTValue v)
+{
+    LOTValue old = *slot;
+    LOTValueRetain(v);
+    *slot = v;
+    LOTValueRelease(old);
+}
+
+#pragma mark - bridging to LOLuaValue
+
+/**
+ * Convert an immediate to its {@link LOLuaValue} object form.
+ * Ints, doubles, booleans and nil are boxed, objects are returned as is.
+ */
+FOUNDATION_EXTERN LOLuaValue *LOTValueBox(LOTValue v);
+
+/**
+ * Convert a {@link LOLuaValue} to its immediate form without retaining it.
+ * Numbers, booleans and nil become immediates, everything else a pointer.
+ * A nil object pointer is treated as {@code LuaValue.NIL}.
+ */
+FOUNDATION_EXTERN LOTValue LOTValueUnbox(LOLuaValue *value);
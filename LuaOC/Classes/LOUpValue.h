@@ -0,0 +1,68 @@
+//
+//  LOUpValue.h
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import <Foundation/Foundation.h>
+#import "LOTValue.h"
+
+/** Upvalue used with Closure formulation
+ * <p>
+ * A small reference counted C cell, as in the reference lua VM.  While the
+ * variable it captures is live the upvalue is open: {@code v} points straight
+ * at the variable's slot on the thread's value stack, and the upvalue is
+ * linked into the thread's list of open upvalues.  When the frame exits the
+ * upvalue is closed: the value is copied into the cell and {@code v} points
+ * at the copy.  Reads and writes are a single indirection either way.
+ * <p>
+ * Upvalues are owned by the closures that share them, and by the thread's
+ * open list while open.  They are not thread safe.
+ * @see LOLuaClosure
+ * @see LOLuaThreadFindUpvalue
+ */
+typedef struct LOUpValue {
+    /** the variable: a stack slot while open, {@code value} once closed */
+    LOTValue *v;
+    /** owned value once closed */
+    LOTValue value;
+    /** next open upvalue of the thread, lower on the stack */
+    struct LOUpValue *next;
+    uint32_t refcount;
+} LOUpValue;
+
+/** Create a closed upvalue holding {@code value}, retained, with one reference */
+FOUNDATION_EXTERN LOUpValue *LOUpValueNewClosed(LOTValue value);
+
+/** Create an open upvalue for a stack slot, with one reference */
+FOUNDATION_EXTERN LOUpValue *LOUpValueNewOpen(LOTValue *slot);
+
+/** Close an open upvalue, copying the value off the stack */
+FOUNDATION_EXTERN void LOUpValueClose(LOUpValue *uv);
+
+/** Drop a reference, freeing the upvalue with the last one */
+FOUNDATION_EXTERN void LOUpValueRelease(LOUpValue *uv);
+
+static inline LOUpValue *LOUpValueRetain(LOUpValue *uv)
+{
+    uv->refcount++;
+    return uv;
+}
+
+static inline BOOL LOUpValueIsOpen(LOUpValue *uv)
+{
+    return uv->v != &uv->value;
+}
+
+/** Borrowed value of the upvalue */
+static inline LOTValue LOUpValueGet(LOUpValue *uv)
+{
+    return *uv->v;
+}
+
+/** Set the value of the upvalue, retaining it */
+static inline void LOUpValueSet(LOUpValue *uv, LOTValue v)
+{
+    LOTValueAssign(uv->v, v);
+}
@@ -0,0 +1,46 @@
+//
+//  LOUpValue.m
+//  LuaOC
+//
+//  Created by agent on 2026/10/16.
+//
+
+#import "LOUpValue.h"
+
+LOUpValue *LOUpValueNewClosed(LOTValue value)
+{
+    LOUpValue *uv = malloc(sizeof(LOUpValue));
+    LOTValueRetain(value);
+    uv->value = value;
+    uv->v = &uv->value;
+    uv->next = NULL;
+    uv->refcount = 1;
+    return uv;
+}
+
+LOUpValue *LOUpValueNewOpen(LOTValue *slot)
+{
+    LOUpValue *uv = malloc(sizeof(LOUpValue));
+    uv->value = LO_NIL;
+    uv->v = slot;
+    uv->next = NULL;
+    uv->refcount = 1;
+    return uv;
+}
+
+void LOUpValueClose(LOUpValue *uv)
+{
+    LOTValue value = *uv->v;
+    LOTValueRetain(value);
+    uv->value = value;
+    uv->v = &uv->value;
+    uv->next = NULL;
+}
+
+void LOUpValueRelease(LOUpValue *uv)
+{
+    if (--uv->refcount == 0) {
+        LOTValueRelease(uv->value);
+        free(uv);
+    }
+}
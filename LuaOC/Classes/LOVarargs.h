@@ -6,6 +6,8 @@
 //
 
 #import <Foundation/Foundation.h>
+#import "LOTValue.h"
+#import "LOStringBuilder.h"
 
 @class LOLuaValue;
 @class LOLuaClosure;
@@ -41,8 +43,20 @@
  * @see LuaValue#varargsOf(LuaValue[], int, int)
  * @see LuaValue#varargsOf(LuaValue[], int, int, Varargs)
  * @see LuaValue#subargs(int)
+ * <p>
+ * Implementations whose leading values are contiguous {@link LOTValue}s
+ * (stack windows, array slices) publish them through {@code _slots}, so the
+ * argument accessors below can read them inline without a message send.
  */
-@interface LOVarargs : NSObject
+@interface LOVarargs : NSObject {
+@public
+    /** Where the pointer to the contiguous values is kept, or NULL */
+    LOTValue * const *_slots;
+    /** Index of argument 1 within {@code *_slots} */
+    int _slotsBase;
+    /** Number of arguments readable through {@code _slots} */
+    int _slotsCount;
+}
 
 /**
  * Get the n-th argument value (1-based).
@@ -67,6 +81,15 @@
  */
 - (LOLuaValue *)arg1;
 
+/**
+ * Get the n-th argument value (1-based) in its immediate form, without boxing.
+ * The result is borrowed from this varargs.
+ * @param i the index of the argument to get, 1 is the first argument
+ * @return Value at position i, or LO_NIL if there is none.
+ * @see #arg:
+ */
+- (LOTValue)argValue:(int)i;
+
 /**
  * Evaluate any pending tail call and return result.
  * @return the evaluated tail call result
@@ -391,6 +414,36 @@
  * */
 - (void)argCheck:(BOOL)test index:(int)i message:(NSString *)msg;
 
+/** Return argument i as an int without throwing.
+ * <p>
+ * The {@code tryCheck...} and {@code tryOpt...} variants behave like
+ * the corresponding {@code check...} and {@code opt...} methods, but on a
+ * type mismatch they record the argument error on the running
+ * {@link LOLuaThread} and return NO instead of throwing.  A function seeing
+ * NO should return at once; the error surfaces at the nearest protected call.
+ * @param i the index of the argument to test, 1 is the first argument
+ * @param result receives the value on success, untouched on failure
+ * @return YES if the argument had the expected type
+ * @see LOLuaThread#pcall:args:
+ * */
+- (BOOL)tryCheckInt:(int)i result:(int *)result;
+- (BOOL)tryCheckLong:(int)i result:(long *)result;
+- (BOOL)tryCheckDouble:(int)i result:(double *)result;
+- (BOOL)tryCheckBoolean:(int)i result:(BOOL *)result;
+- (BOOL)tryCheckString:(int)i result:(LOLuaString **)result;
+- (BOOL)tryCheckTable:(int)i result:(LOLuaTable **)result;
+- (BOOL)tryCheckFunction:(int)i result:(LOLuaFunction **)result;
+
+/** Return argument i as an int, {@code defval} if nil or missing, without throwing.
+ * @see #tryCheckInt:result:
+ * */
+- (BOOL)tryOptInt:(int)i defval:(int)defval result:(int *)result;
+- (BOOL)tryOptLong:(int)i defval:(long)defval result:(long *)result;
+- (BOOL)tryOptDouble:(int)i defval:(double)defval result:(double *)result;
+- (BOOL)tryOptBoolean:(int)i defval:(BOOL)defval result:(BOOL *)result;
+- (BOOL)tryOptString:(int)i defval:(LOLuaString *)defval result:(LOLuaString **)result;
+- (BOOL)tryOptTable:(int)i defval:(LOLuaTable *)defval result:(LOLuaTable **)result;
+
 /** Return true if there is no argument or nil at argument i.
  * @param i the index of the argument to test, 1 is the first argument
  * @return true if argument i contains either no argument or nil
@@ -415,7 +468,7 @@
  * @param i the index of the argument to convert, 1 is the first argument
  * @return char value with fraction discarded and truncated if necessary if argument i is number, otherwise 0
  * */
-- (char)toChar;
+- (char)toChar:(int)i;
 
 /** Return argument i as a java double value or 0 if not a number.
  * @param i the index of the argument to convert, 1 is the first argument
@@ -471,10 +524,15 @@
 - (id)toUserData:(int)i clazz:(Class)c;
 
 /** Convert the list of varargs values to a human readable java String.
- * @return String value in human readable form such as {1,2}.
+ * @return String value in human readable form such as (1,2).
  */
 - (NSString *)toNSString;
 
+/** Append the human readable form of {@link #toNSString} to a builder.
+ * @param sb the builder to append to
+ */
+- (void)appendTo:(LOStringBuilder *)sb;
+
 /** Convert the value or values to a java String using Varargs.tojstring()
  * @return String value in human readable form.
  * @see Varargs#tojstring()
@@ -488,6 +546,18 @@
  */
 - (LOVarargs *)subArgs:(int)start;
 
+/**
+ * Return Varargs that does not share a thread's value stack for its storage.
+ * <p>
+ * The arguments a native function receives are a window onto the caller's
+ * value stack, valid only until the function returns, when the window is
+ * reused for the next call.  A function that keeps its arguments, or a
+ * {@link #subArgs:} of them, beyond the call must keep the result of this
+ * instead.  Results returned from a call are dealiased by the call.
+ * @return Varargs containing same values, copied off the stack if needed
+ */
+- (LOVarargs *)dealias;
+
 
 
 
@@ -528,3 +598,11 @@
 
 
 @end
+
+/** Argument {@code i} as a borrowed immediate, read inline when the varargs publishes its slots */
+static inline LOTValue LOVarargsArgValue(LOVarargs *args, int i)
+{
+    if (args->_slots && (unsigned)(i - 1) < (unsigned)args->_slotsCount)
+        return (*args->_slots)[args->_slotsBase + i - 1];
+    return [args argValue:i];
+}
@@ -21,39 +21,54 @@
     return NO;
 }
 
+- (LOTValue)argValue:(int)i
+{
+    return LOTValueUnbox([self arg:i]);
+}
+
 - (int)type:(int)i
 {
-    return [[self arg:i] type];
+    return LOTValueType(LOVarargsArgValue(self, i));
+}
+
+- (BOOL)isNil:(int)i
+{
+    return LOTValueIsNil(LOVarargsArgValue(self, i));
 }
 
 - (BOOL)isFunction:(int)i
 {
-    return [self arg:i].isFunction;
+    return LOTValueType(LOVarargsArgValue(self, i)) == LOLuaTypeFunction;
 }
 
 - (BOOL)isNumber:(int)i
 {
-    return [self arg:i].isNumber;
+    LOTValue v = LOVarargsArgValue(self, i);
+    if (LOTValueIsNumber(v))
+        return YES;
+    return LOTValueType(v) == LOLuaTypeString && LOTValueGetObject(v).isNumber;
 }
 
 - (BOOL)isString:(int)i
 {
-    return [self arg:i].isString;
+    int type = LOTValueType(LOVarargsArgValue(self, i));
+    return type == LOLuaTypeString || type == LOLuaTypeNumber;
 }
 
 - (BOOL)isTable:(int)i
 {
-    return [self arg:i].isTable;
+    return LOTValueType(LOVarargsArgValue(self, i)) == LOLuaTypeTable;
 }
 
 - (BOOL)isThread:(int)i
 {
-    return [self arg:i].isThread;
+    return LOTValueType(LOVarargsArgValue(self, i)) == LOLuaTypeThread;
 }
 
 - (BOOL)isUserData:(int)i
 {
-    return [self arg:i].isUserData;
+    int type = LOTValueType(LOVarargsArgValue(self, i));
+    return type == LOLuaTypeUserData || type == LOLuaTypeLightUserData;
 }
 
 - (BOOL)isValue:(int)i
@@ -63,6 +78,11 @@
 
 - (BOOL)optBoolean:(int)i defval:(BOOL)defval
 {
+    LOTValue v = LOVarargsArgValue(self, i);
+    if (LOTValueIsBoolean(v))
+        return v == LO_TRUE;
+    if (v == LO_NIL)
+        return defval;
     return [[self arg:i] optBoolean:defval];
 }
 
@@ -71,13 +91,37 @@
     return [[self arg:i] optClosure:defval];
 }
 
+- (double)optDouble:(int)i defval:(double)defval
+{
+    LOTValue v = LOVarargsArgValue(self, i);
+    if (LOTValueIsInt(v))
+        return LOTValueGetInt(v);
+    if (LOTValueIsDouble(v))
+        return LOTValueGetDouble(v);
+    if (v == LO_NIL)
+        return defval;
+    return [[self arg:i] optDouble:defval];
+}
+
 - (LOLuaFunction *)optFunction:(int)i defval:(LOLuaFunction *)defval
 {
+    LOTValue v = LOVarargsArgValue(self, i);
+    if (v == LO_NIL)
+        return defval;
+    if (LOTValueType(v) == LOLuaTypeFunction)
+        return (LOLuaFunction *)LOTValueGetObject(v);
     return [[self arg:i] optFunction:defval];
 }
 
 - (int)optInt:(int)i defval:(int)defval
 {
+    LOTValue v = LOVarargsArgValue(self, i);
+    if (LOTValueIsInt(v))
+        return LOTValueGetInt(v);
+    if (LOTValueIsDouble(v))
+        return (int)(long)LOTValueGetDouble(v);
+    if (v == LO_NIL)
+        return defval;
     return [[self arg:i] optInt:defval];
 }
 
@@ -88,6 +132,13 @@
 
 - (long)optLong:(int)i defval:(long)defval
 {
+    LOTValue v = LOVarargsArgValue(self, i);
+    if (LOTValueIsInt(v))
+        return LOTValueGetInt(v);
+    if (LOTValueIsDouble(v))
+        return (long)LOTValueGetDouble(v);
+    if (v == LO_NIL)
+        return defval;
     return [[self arg:i] optLong:defval];
 }
 
@@ -103,11 +154,21 @@
 
 - (LOLuaString *)optString:(int)i defval:(LOLuaString *)defval
 {
+    LOTValue v = LOVarargsArgValue(self, i);
+    if (v == LO_NIL)
+        return defval;
+    if (LOTValueType(v) == LOLuaTypeString)
+        return (LOLuaString *)LOTValueGetObject(v);
     return [[self arg:i] optString:defval];
 }
 
 - (LOLuaTable *)optTable:(int)i defval:(LOLuaTable *)defval
 {
+    LOTValue v = LOVarargsArgValue(self, i);
+    if (v == LO_NIL)
+        return defval;
+    if (LOTValueType(v) == LOLuaTypeTable)
+        return (LOLuaTable *)LOTValueGetObject(v);
     return [[self arg:i] optTable:defval];
 }
 
@@ -133,6 +194,9 @@
 
 - (BOOL)checkBoolean:(int)i
 {
+    LOTValue v = LOVarargsArgValue(self, i);
+    if (LOTValueIsBoolean(v))
+        return v == LO_TRUE;
     return [self arg:i].checkBoolean;
 }
 
@@ -143,16 +207,29 @@
 
 - (double)checkDouble:(int)i
 {
+    LOTValue v = LOVarargsArgValue(self, i);
+    if (LOTValueIsInt(v))
+        return LOTValueGetInt(v);
+    if (LOTValueIsDouble(v))
+        return LOTValueGetDouble(v);
     return [self arg:i].checkDouble;
 }
 
 - (LOLuaFunction *)checkFunction:(int)i
 {
+    LOTValue v = LOVarargsArgValue(self, i);
+    if (LOTValueType(v) == LOLuaTypeFunction)
+        return (LOLuaFunction *)LOTValueGetObject(v);
     return [self arg:i].checkFunction;
 }
 
 - (int)checkInt:(int)i
 {
+    LOTValue v = LOVarargsArgValue(self, i);
+    if (LOTValueIsInt(v))
+        return LOTValueGetInt(v);
+    if (LOTValueIsDouble(v))
+        return (int)(long)LOTValueGetDouble(v);
     return [self arg:i].checkNumber.toInt;
 }
 
@@ -163,6 +240,11 @@
 
 - (long)checkLong:(int)i
 {
+    LOTValue v = LOVarargsArgValue(self, i);
+    if (LOTValueIsInt(v))
+        return LOTValueGetInt(v);
+    if (LOTValueIsDouble(v))
+        return (long)LOTValueGetDouble(v);
     return [self arg:i].checkNumber.toLong;
 }
 
@@ -178,16 +260,25 @@
 
 - (LOLuaString *)checkString:(int)i
 {
+    LOTValue v = LOVarargsArgValue(self, i);
+    if (LOTValueType(v) == LOLuaTypeString)
+        return (LOLuaString *)LOTValueGetObject(v);
     return [self arg:i].checkString;
 }
 
 - (LOLuaTable *)checkTable:(int)i
 {
+    LOTValue v = LOVarargsArgValue(self, i);
+    if (LOTValueType(v) == LOLuaTypeTable)
+        return (LOLuaTable *)LOTValueGetObject(v);
     return [self arg:i].checkTable;
 }
 
 - (LOLuaThread *)checkThread:(int)i
 {
+    LOTValue v = LOVarargsArgValue(self, i);
+    if (LOTValueType(v) == LOLuaTypeThread)
+        return (LOLuaThread *)LOTValueGetObject(v);
     return [self arg:i].checkThread;
 }
 
@@ -208,6 +299,9 @@
 
 - (LOLuaValue *)checkNotNil:(int)i
 {
+    LOTValue v = LOVarargsArgValue(self, i);
+    if (v != LO_NIL && LOTValueIsObject(v))
+        return LOTValueGetObject(v);
     return [self arg:i].checkNotNil;
 }
 
@@ -216,44 +310,188 @@
     if (!test) [LOLuaValue argError:i msg:@"value expected"];
 }
 
+static BOOL LOVarargsTypeError(LOVarargs *args, int i, NSString *expected)
+{
+    return [LOLuaValue recordArgError:i msg:[NSString stringWithFormat:@"%@ expected, got %@",
+                                             expected, LOLuaTypeName([args type:i])]];
+}
+
+- (BOOL)tryCheckInt:(int)i result:(int *)result
+{
+    LOTValue v = LOVarargsArgValue(self, i);
+    if (LOTValueIsInt(v))
+        *result = LOTValueGetInt(v);
+    else if (LOTValueIsDouble(v))
+        *result = (int)(long)LOTValueGetDouble(v);
+    else {
+        LOLuaValue *arg = [self arg:i];
+        if (!arg.isNumber)
+            return LOVarargsTypeError(self, i, @"number");
+        *result = arg.checkInt;
+    }
+    return YES;
+}
+
+- (BOOL)tryCheckLong:(int)i result:(long *)result
+{
+    LOTValue v = LOVarargsArgValue(self, i);
+    if (LOTValueIsInt(v))
+        *result = LOTValueGetInt(v);
+    else if (LOTValueIsDouble(v))
+        *result = (long)LOTValueGetDouble(v);
+    else {
+        LOLuaValue *arg = [self arg:i];
+        if (!arg.isNumber)
+            return LOVarargsTypeError(self, i, @"number");
+        *result = arg.checkLong;
+    }
+    return YES;
+}
+
+- (BOOL)tryCheckDouble:(int)i result:(double *)result
+{
+    LOTValue v = LOVarargsArgValue(self, i);
+    if (LOTValueIsNumber(v))
+        *result = LOTValueToDouble(v);
+    else {
+        LOLuaValue *arg = [self arg:i];
+        if (!arg.isNumber)
+            return LOVarargsTypeError(self, i, @"number");
+        *result = arg.checkDouble;
+    }
+    return YES;
+}
+
+- (BOOL)tryCheckBoolean:(int)i result:(BOOL *)result
+{
+    LOTValue v = LOVarargsArgValue(self, i);
+    if (!LOTValueIsBoolean(v))
+        return LOVarargsTypeError(self, i, @"boolean");
+    *result = v == LO_TRUE;
+    return YES;
+}
+
+- (BOOL)tryCheckString:(int)i result:(LOLuaString **)result
+{
+    LOTValue v = LOVarargsArgValue(self, i);
+    if (LOTValueType(v) != LOLuaTypeString)
+        return LOVarargsTypeError(self, i, @"string");
+    *result = (LOLuaString *)LOTValueGetObject(v);
+    return YES;
+}
+
+- (BOOL)tryCheckTable:(int)i result:(LOLuaTable **)result
+{
+    LOTValue v = LOVarargsArgValue(self, i);
+    if (LOTValueType(v) != LOLuaTypeTable)
+        return LOVarargsTypeError(self, i, @"table");
+    *result = (LOLuaTable *)LOTValueGetObject(v);
+    return YES;
+}
+
+- (BOOL)tryCheckFunction:(int)i result:(LOLuaFunction **)result
+{
+    LOTValue v = LOVarargsArgValue(self, i);
+    if (LOTValueType(v) != LOLuaTypeFunction)
+        return LOVarargsTypeError(self, i, @"function");
+    *result = (LOLuaFunction *)LOTValueGetObject(v);
+    return YES;
+}
+
+- (BOOL)tryOptInt:(int)i defval:(int)defval result:(int *)result
+{
+    if (LOVarargsArgValue(self, i) == LO_NIL) {
+        *result = defval;
+        return YES;
+    }
+    return [self tryCheckInt:i result:result];
+}
+
+- (BOOL)tryOptLong:(int)i defval:(long)defval result:(long *)result
+{
+    if (LOVarargsArgValue(self, i) == LO_NIL) {
+        *result = defval;
+        return YES;
+    }
+    return [self tryCheckLong:i result:result];
+}
+
+- (BOOL)tryOptDouble:(int)i defval:(double)defval result:(double *)result
+{
+    if (LOVarargsArgValue(self, i) == LO_NIL) {
+        *result = defval;
+        return YES;
+    }
+    return [self tryCheckDouble:i result:result];
+}
+
+- (BOOL)tryOptBoolean:(int)i defval:(BOOL)defval result:(BOOL *)result
+{
+    if (LOVarargsArgValue(self, i) == LO_NIL) {
+        *result = defval;
+        return YES;
+    }
+    return [self tryCheckBoolean:i result:result];
+}
+
+- (BOOL)tryOptString:(int)i defval:(LOLuaString *)defval result:(LOLuaString **)result
+{
+    if (LOVarargsArgValue(self, i) == LO_NIL) {
+        *result = defval;
+        return YES;
+    }
+    return [self tryCheckString:i result:result];
+}
+
+- (BOOL)tryOptTable:(int)i defval:(LOLuaTable *)defval result:(LOLuaTable **)result
+{
+    if (LOVarargsArgValue(self, i) == LO_NIL) {
+        *result = defval;
+        return YES;
+    }
+    return [self tryCheckTable:i result:result];
+}
+
 - (BOOL)isNoneOrNil:(int)i
 {
-    return i>self.narg || [self arg:i].isNil;
+    return LOTValueIsNil(LOVarargsArgValue(self, i));
 }
 
 - (BOOL)toBoolean:(int)i
 {
-    return [self arg:i].toBoolean;
+    return LOTValueToBoolean(LOVarargsArgValue(self, i));
 }
 
 - (Byte)toByte:(int)i
 {
-    return [self arg:i].toByte;
+    return (Byte)(long)LOTValueToDouble(LOVarargsArgValue(self, i));
 }
 
 - (char)toChar:(int)i
 {
-    return [self arg:i].toChar;
+    return (char)(long)LOTValueToDouble(LOVarargsArgValue(self, i));
 }
 
 - (double)toDouble:(int)i
 {
-    return [self arg:i].toDouble;
+    return LOTValueToDouble(LOVarargsArgValue(self, i));
 }
 
 - (float)toFloat:(int)i
 {
-    return [self arg:i].toFloat;
+    return (float)LOTValueToDouble(LOVarargsArgValue(self, i));
 }
 
 - (int)toInt:(int)i
 {
-    return [self arg:i].toInt;
+    LOTValue v = LOVarargsArgValue(self, i);
+    return LOTValueIsInt(v) ? LOTValueGetInt(v) : (int)(long)LOTValueToDouble(v);
 }
 
 - (long)toLong:(int)i
 {
-    return [self arg:i].toLong;
+    LOTValue v = LOVarargsArgValue(self, i);
+    return LOTValueIsInt(v) ? LOTValueGetInt(v) : (long)LOTValueToDouble(v);
 }
 
 - (NSString *)toNSString:(int)i
@@ -263,7 +501,7 @@
 
 - (short)toShort:(int)i
 {
-    return [self arg:i].toShort;
+    return (short)(long)LOTValueToDouble(LOVarargsArgValue(self, i));
 }
 
 -(id)toUserData:(int)i
@@ -278,14 +516,22 @@
 
 - (NSString *)toNSString
 {
-    NSMutableString *ms = [NSMutableString stringWithString:@"("];
+    LOStringBuilder *sb = LOStringBuilderAcquire();
+    [self appendTo:sb];
+    NSString *s = LOStringBuilderToNSString(sb);
+    LOStringBuilderRelease(sb);
+    return s;
+}
+
+- (void)appendTo:(LOStringBuilder *)sb
+{
+    LOStringBuilderAppendChar(sb, '(');
     for (int i = 1, n = self.narg; i <= n; i++) {
-        if (i>1) {
-            [ms appendString:@","];
-        }
-        [ms appendString:[self arg:i].toString];
+        if (i > 1)
+            LOStringBuilderAppendChar(sb, ',');
+        LOStringBuilderAppendValue(sb, LOVarargsArgValue(self, i));
     }
-    return ms.copy;
+    LOStringBuilderAppendChar(sb, ')');
 }
 
 - (NSString *)toString
@@ -293,6 +539,11 @@
     return self.toNSString;
 }
 
+- (LOVarargs *)dealias
+{
+    return self;
+}
+
 
 
 